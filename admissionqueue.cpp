@@ -0,0 +1,127 @@
+#include "admissionqueue.h"
+
+#include <QObject>
+#include <QMutexLocker>
+#include <QTextStream>
+
+static const qint64 sWaitEdges[AdmissionQueue::sNbBuckets - 1] = {10, 50, 100, 500, 1000, 5000, 10000}; //!< ms
+static const char  *sLengthNames[AdmissionQueue::sNbBuckets] = {"1", "2", "4", "8", "16", "32", "64", "64+"};
+static const char  *sWaitNames[AdmissionQueue::sNbBuckets]   = {"10ms", "50ms", "100ms", "500ms", "1s", "5s", "10s", "10s+"};
+
+AdmissionQueue::AdmissionQueue(int aMaxSize):
+    iMaxSize(aMaxSize), iMutex(), iWaiters(), iAdmitted(),
+    iNbWaiting(0), iNbAdmitted(0), iNbQueued(0), iNbAdmissions(0), iNbTimeouts(0), iNbFull(0)
+{
+    for (int i = 0; i < sNbBuckets; ++i){
+        iLengths[i].store(0);
+        iWaits[i].store(0);
+    }
+}
+
+int AdmissionQueue::getLengthBucket(int aLength){
+    int bucket = 0;
+    for (int max = 1; bucket < sNbBuckets - 1 && aLength > max; max <<= 1)
+        ++bucket;
+    return bucket;
+}
+
+int AdmissionQueue::getWaitBucket(qint64 aWaitMs){
+    int bucket = 0;
+    while (bucket < sNbBuckets - 1 && aWaitMs >= sWaitEdges[bucket])
+        ++bucket;
+    return bucket;
+}
+
+void AdmissionQueue::updateCounts_noLock(){
+    iNbWaiting.store(iWaiters.size());
+    iNbAdmitted.store(iAdmitted.size());
+}
+
+bool AdmissionQueue::push(QObject *aSession, bool aFirst){
+    if (iMaxSize <= 0)
+        return false; // no queue
+
+    QMutexLocker lock(&iMutex);
+    if (!aFirst && iWaiters.size() >= iMaxSize){
+        iNbFull.fetchAndAddRelaxed(1);
+        return false;
+    }
+
+    Waiter waiter;
+    waiter.session = aSession;
+    waiter.waited.start();
+    if (aFirst)
+        iWaiters.prepend(waiter);
+    else
+        iWaiters.append(waiter);
+    updateCounts_noLock();
+
+    if (!aFirst){ // not queued again
+        iNbQueued.fetchAndAddRelaxed(1);
+        iLengths[getLengthBucket(iWaiters.size())].fetchAndAddRelaxed(1);
+    }
+    return true;
+}
+
+int AdmissionQueue::admit(int aNbFree){
+    QMutexLocker lock(&iMutex);
+    int nbAdmitted = 0;
+    while (!iWaiters.isEmpty() && iAdmitted.size() < aNbFree){
+        Waiter waiter = iWaiters.takeFirst();
+        iAdmitted.insert(waiter.session);
+        iWaits[getWaitBucket(waiter.waited.elapsed())].fetchAndAddRelaxed(1);
+        QMetaObject::invokeMethod(waiter.session, "admissionGranted", Qt::QueuedConnection);
+        ++nbAdmitted;
+    }
+    updateCounts_noLock();
+
+    iNbAdmissions.fetchAndAddRelaxed(nbAdmitted);
+    return nbAdmitted;
+}
+
+void AdmissionQueue::admitted(QObject *aSession){
+    QMutexLocker lock(&iMutex);
+    iAdmitted.remove(aSession);
+    updateCounts_noLock();
+}
+
+bool AdmissionQueue::cancel(QObject *aSession){
+    QMutexLocker lock(&iMutex);
+    for (int i = 0; i < iWaiters.size(); ++i){
+        if (iWaiters[i].session == aSession){
+            iWaiters.removeAt(i);
+            updateCounts_noLock();
+            iNbTimeouts.fetchAndAddRelaxed(1);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool AdmissionQueue::leave(QObject *aSession){
+    QMutexLocker lock(&iMutex);
+    for (int i = 0; i < iWaiters.size(); ++i){
+        if (iWaiters[i].session == aSession){
+            iWaiters.removeAt(i);
+            break;
+        }
+    }
+    bool wasAdmitted = iAdmitted.remove(aSession);
+    updateCounts_noLock();
+    return wasAdmitted;
+}
+
+void AdmissionQueue::dump(QTextStream &aStream){
+    aStream << "Admission queue: " << getNumberOfWaiting() << " waiting (max: " << iMaxSize << "), "
+            << getNumberOfAdmitted() << " admitted, " << getNumberOfQueued() << " queued, "
+            << getNumberOfAdmissions() << " admissions, " << getNumberOfTimeouts() << " timeouts, "
+            << getNumberOfFull() << " refused (full)\n";
+
+    aStream << "\t- queue length:";
+    for (int i = 0; i < sNbBuckets; ++i)
+        aStream << " <=" << sLengthNames[i] << ": " << getLengthCount(i);
+    aStream << "\n\t- wait time:";
+    for (int i = 0; i < sNbBuckets; ++i)
+        aStream << " <" << sWaitNames[i] << ": " << getWaitCount(i);
+    aStream << "\n";
+}
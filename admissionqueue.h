@@ -0,0 +1,105 @@
+#ifndef ADMISSIONQUEUE_H
+#define ADMISSIONQUEUE_H
+
+#include "constants.h"
+
+#include <QList>
+#include <QSet>
+#include <QMutex>
+#include <QElapsedTimer>
+#include <QAtomicInteger>
+
+QT_FORWARD_DECLARE_CLASS(QObject)
+QT_FORWARD_DECLARE_CLASS(QTextStream)
+
+/*!
+ * \brief Bounded FIFO of the sessions waiting for a NntpConnection when they're all in use (Thread_Safe)
+ * - instead of a 502 (and the client reconnecting in a loop), a session waits for the next connection released
+ * - each connection released admits the head of the queue: the session gets a queued call of its slot
+ *   admissionGranted() and takes the connection with the admission (admitted)
+ * - the connections free for the admitted sessions can't be taken by the newcomers (isOpen)
+ * - the session gives up after its own timeout (cancel), a session closing passes its admission on (leave)
+ * - histograms of the queue length (at each push) and of the wait times (at each admission)
+ */
+class AdmissionQueue
+{
+public:
+    explicit AdmissionQueue(int aMaxSize); //!< \param aMaxSize : max number of sessions waiting (0: no queue)
+    AdmissionQueue(const AdmissionQueue &)              = delete;
+    AdmissionQueue(const AdmissionQueue &&)             = delete;
+    AdmissionQueue & operator=(const AdmissionQueue &)  = delete;
+    AdmissionQueue & operator=(const AdmissionQueue &&) = delete;
+
+    ~AdmissionQueue() = default;
+
+    /*!
+     * \brief wait for a connection
+     * \param aSession : its slot admissionGranted() will be called
+     * \param aFirst   : at the head of the queue (an admitted session that couldn't get its connection, even if full)
+     * \return false if the queue is full (or disabled)
+     */
+    bool push(QObject *aSession, bool aFirst = false);
+
+    int  admit(int aNbFree);          //!< admit the head sessions while there are less admitted than aNbFree (number admitted)
+    void admitted(QObject *aSession); //!< the admitted session has used its admission
+    bool cancel(QObject *aSession);   //!< timeout: remove the session if it's still waiting (false if admitted meanwhile)
+    bool leave(QObject *aSession);    //!< the session closes: forget it (true if it had been admitted: to pass on)
+
+    inline bool isOpen(int aNbFree) const; //!< can a newcomer take one of aNbFree connections (nobody waiting for it)
+
+    inline int     getMaxSize() const;             //!< max number of sessions waiting
+    inline int     getNumberOfWaiting() const;     //!< sessions waiting
+    inline int     getNumberOfAdmitted() const;    //!< sessions admitted that haven't taken their connection yet
+    inline quint64 getNumberOfQueued() const;      //!< sessions queued since start
+    inline quint64 getNumberOfAdmissions() const;  //!< admissions since start
+    inline quint64 getNumberOfTimeouts() const;    //!< sessions that gave up since start
+    inline quint64 getNumberOfFull() const;        //!< sessions refused (queue full) since start
+
+    static const int sNbBuckets = 8; //!< buckets of the histograms
+    static int getLengthBucket(int aLength);    //!< bucket of a queue length: 1, 2, 3-4, 5-8... 65+
+    static int getWaitBucket(qint64 aWaitMs);   //!< bucket of a wait time: <10ms, <50ms, <100ms, <500ms, <1s, <5s, <10s, more
+    inline quint64 getLengthCount(int aBucket) const; //!< pushes with a queue length in the bucket
+    inline quint64 getWaitCount(int aBucket) const;   //!< admissions with a wait time in the bucket
+
+    void dump(QTextStream &aStream); //!< write the statistics and the histograms
+
+private:
+    struct Waiter {               //!< a session in the queue
+        QObject      *session;    //!< the session
+        QElapsedTimer waited;     //!< since its push
+    };
+
+    void updateCounts_noLock();   //!< iNbWaiting and iNbAdmitted from the containers
+
+private:
+    const int               iMaxSize;   //!< max number of sessions waiting
+    QMutex                  iMutex;     //!< protects iWaiters and iAdmitted
+    QList<Waiter>           iWaiters;   //!< sessions waiting (FIFO)
+    QSet<QObject *>         iAdmitted;  //!< sessions admitted not connected yet
+
+    QAtomicInteger<int>     iNbWaiting;   //!< iWaiters.size() (lock free reads)
+    QAtomicInteger<int>     iNbAdmitted;  //!< iAdmitted.size() (lock free reads)
+    QAtomicInteger<quint64> iNbQueued;    //!< sessions queued since start
+    QAtomicInteger<quint64> iNbAdmissions;//!< admissions since start
+    QAtomicInteger<quint64> iNbTimeouts;  //!< sessions that gave up since start
+    QAtomicInteger<quint64> iNbFull;      //!< sessions refused since start
+
+    QAtomicInteger<quint64> iLengths[sNbBuckets]; //!< histogram of the queue length at each push
+    QAtomicInteger<quint64> iWaits[sNbBuckets];   //!< histogram of the wait times at each admission
+};
+
+bool AdmissionQueue::isOpen(int aNbFree) const {
+    return iNbWaiting.load() == 0 && aNbFree > iNbAdmitted.load();
+}
+
+int     AdmissionQueue::getMaxSize() const {return iMaxSize;}
+int     AdmissionQueue::getNumberOfWaiting() const {return iNbWaiting.load();}
+int     AdmissionQueue::getNumberOfAdmitted() const {return iNbAdmitted.load();}
+quint64 AdmissionQueue::getNumberOfQueued() const {return iNbQueued.load();}
+quint64 AdmissionQueue::getNumberOfAdmissions() const {return iNbAdmissions.load();}
+quint64 AdmissionQueue::getNumberOfTimeouts() const {return iNbTimeouts.load();}
+quint64 AdmissionQueue::getNumberOfFull() const {return iNbFull.load();}
+quint64 AdmissionQueue::getLengthCount(int aBucket) const {return iLengths[aBucket].load();}
+quint64 AdmissionQueue::getWaitCount(int aBucket) const {return iWaits[aBucket].load();}
+
+#endif // ADMISSIONQUEUE_H
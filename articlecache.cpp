@@ -0,0 +1,208 @@
+#include "articlecache.h"
+#include "articlestore.h"
+#include "nntp.h"
+
+#include <QMutexLocker>
+#include <QTextStream>
+
+ArticleCache::ArticleCache(qint64 aMaxSize, ushort aNbShards, qint64 aMaxArticle):
+    iMaxShardSize(aMaxSize / (aNbShards ? aNbShards : 1)),
+    iMaxArticle(qMin(aMaxArticle, iMaxShardSize)),
+    iNbShards(aNbShards ? aNbShards : 1),
+    iShards(new Shard[iNbShards]), iStore(Q_NULLPTR),
+    iHits(0), iStoreHits(0), iMisses(0), iEvictions(0), iBytesServed(0)
+{
+    for (ushort i = 0; i < iNbShards; ++i){
+        iShards[i].head = Q_NULLPTR;
+        iShards[i].tail = Q_NULLPTR;
+        iShards[i].size = 0;
+    }
+}
+
+ArticleCache::~ArticleCache(){
+    for (ushort i = 0; i < iNbShards; ++i)
+        qDeleteAll(iShards[i].index);
+    delete[] iShards;
+    delete iStore;
+}
+
+void ArticleCache::setStore(ArticleStore *aStore){
+    delete iStore;
+    iStore = aStore;
+}
+
+qint64 ArticleCache::getMaxArticleSize() const {
+    if (iStore)
+        return qMax(iMaxArticle, iStore->getMaxArticleSize());
+    return iMaxArticle;
+}
+
+QByteArray ArticleCache::getKey(const QByteArray &aCmd){
+    const char *cmd = aCmd.constData();
+    char type;
+    if (Nntp::isCommand(cmd, "BODY"))
+        type = 'B';
+    else if (Nntp::isCommand(cmd, "ARTICLE"))
+        type = 'A';
+    else if (Nntp::isCommand(cmd, "HEAD"))
+        type = 'H';
+    else
+        return QByteArray();
+
+    if (!Nntp::isMessageIdCommand(cmd))
+        return QByteArray();
+
+    int start = aCmd.indexOf('<');
+    int end   = aCmd.indexOf('>', start);
+    if (end == -1)
+        return QByteArray();
+
+    QByteArray key(1, type);
+    key.append(aCmd.constData() + start, end - start + 1);
+    return key;
+}
+
+bool ArticleCache::isArticleResponse(const QByteArray &aStatusLine){
+    ushort code = Nntp::getResponseCode(aStatusLine.constData());
+    return code == 220 || code == 221 || code == 222;
+}
+
+bool ArticleCache::get(const QByteArray &aKey, QByteArray &aResponse){
+    Shard &shard = getShard(aKey);
+    bool   found = false;
+    {
+        QMutexLocker lock(&shard.mutex);
+        Entry *entry = shard.index.value(aKey, Q_NULLPTR);
+        if (entry){
+            unlink(shard, entry);
+            pushFront(shard, entry);
+            aResponse = entry->response; // shared, no copy
+            found     = true;
+        }
+    }
+
+    if (!found){
+        if (!iStore || !iStore->get(aKey, aResponse)){
+            iMisses.fetchAndAddRelaxed(1);
+            return false;
+        }
+        insertInMemory(aKey, aResponse); // popular again
+        iStoreHits.fetchAndAddRelaxed(1);
+    }
+    else
+        iHits.fetchAndAddRelaxed(1);
+    iBytesServed.fetchAndAddRelaxed(static_cast<quint64>(aResponse.size()));
+    return true;
+}
+
+bool ArticleCache::contains(const QByteArray &aKey){
+    Shard &shard = getShard(aKey);
+    {
+        QMutexLocker lock(&shard.mutex);
+        if (shard.index.contains(aKey))
+            return true;
+    }
+    return iStore && iStore->contains(aKey);
+}
+
+void ArticleCache::insert(const QByteArray &aKey, const QByteArray &aResponse){
+    if (iStore)
+        iStore->insert(aKey, aResponse);
+    insertInMemory(aKey, aResponse);
+}
+
+void ArticleCache::insertInMemory(const QByteArray &aKey, const QByteArray &aResponse){
+    qint64 size = aResponse.size();
+    if (size == 0 || size > iMaxArticle)
+        return;
+
+    Shard &shard = getShard(aKey);
+    QMutexLocker lock(&shard.mutex);
+
+    Entry *entry = shard.index.value(aKey, Q_NULLPTR);
+    if (entry){
+        // fetched twice at the same time: refresh it
+        shard.size -= entry->response.size();
+        entry->response = aResponse;
+        shard.size += size;
+        unlink(shard, entry);
+        pushFront(shard, entry);
+    } else {
+        entry           = new Entry();
+        entry->key      = aKey;
+        entry->response = aResponse;
+        shard.index.insert(aKey, entry);
+        pushFront(shard, entry);
+        shard.size += size;
+    }
+
+    // evict the least recently used (never the one we've just added)
+    while (shard.size > iMaxShardSize && shard.tail != entry){
+        Entry *lru = shard.tail;
+        unlink(shard, lru);
+        shard.index.remove(lru->key);
+        shard.size -= lru->response.size();
+        delete lru;
+        iEvictions.fetchAndAddRelaxed(1);
+    }
+}
+
+qint64 ArticleCache::getSize(){
+    qint64 size = 0;
+    for (ushort i = 0; i < iNbShards; ++i){
+        QMutexLocker lock(&iShards[i].mutex);
+        size += iShards[i].size;
+    }
+    return size;
+}
+
+int ArticleCache::getNumberOfArticles(){
+    int nb = 0;
+    for (ushort i = 0; i < iNbShards; ++i){
+        QMutexLocker lock(&iShards[i].mutex);
+        nb += iShards[i].index.size();
+    }
+    return nb;
+}
+
+double ArticleCache::getHitRatio() const {
+    quint64 hits  = iHits.load() + iStoreHits.load();
+    quint64 total = hits + iMisses.load();
+    return total ? static_cast<double>(hits) / total : 0.;
+}
+
+void ArticleCache::dump(QTextStream &aStream){
+    aStream << "Article cache: " << getNumberOfArticles() << " articles, "
+            << getSize() / 1048576 << " / " << iMaxShardSize * iNbShards / 1048576 << " MB"
+            << ", hit ratio: " << QString::number(100 * getHitRatio(), 'f', 1) << "%"
+            << " (hits: " << getNumberOfHits() << ", disk hits: " << getNumberOfStoreHits()
+            << ", misses: " << getNumberOfMisses() << ")"
+            << ", served: " << getBytesServed() / 1048576 << " MB"
+            << ", evictions: " << getNumberOfEvictions() << "\n";
+    if (iStore)
+        iStore->dump(aStream);
+}
+
+void ArticleCache::unlink(Shard &aShard, Entry *aEntry){
+    if (aEntry->prev)
+        aEntry->prev->next = aEntry->next;
+    else
+        aShard.head = aEntry->next;
+
+    if (aEntry->next)
+        aEntry->next->prev = aEntry->prev;
+    else
+        aShard.tail = aEntry->prev;
+
+    aEntry->prev = aEntry->next = Q_NULLPTR;
+}
+
+void ArticleCache::pushFront(Shard &aShard, Entry *aEntry){
+    aEntry->prev = Q_NULLPTR;
+    aEntry->next = aShard.head;
+    if (aShard.head)
+        aShard.head->prev = aEntry;
+    aShard.head = aEntry;
+    if (!aShard.tail)
+        aShard.tail = aEntry;
+}
@@ -0,0 +1,122 @@
+#ifndef ARTICLECACHE_H
+#define ARTICLECACHE_H
+
+#include "constants.h"
+
+#include <QByteArray>
+#include <QHash>
+#include <QMutex>
+#include <QAtomicInteger>
+
+QT_FORWARD_DECLARE_CLASS(QTextStream)
+QT_FORWARD_DECLARE_CLASS(ArticleStore)
+
+/*!
+ * \brief Process wide memory bounded cache of the article responses, keyed by message-id (Thread_Safe)
+ * - only ARTICLE / HEAD / BODY by message-id are cached (the response doesn't depend on the group)
+ * - the whole response is kept (status line, data block and terminator) so a hit is written as is
+ * - sharded: each shard has its own mutex, hash index and LRU list, and 1/nbShards of the max size
+ * - filled by the NntpConnections at the end of the responses, read by the sessions and the multiplexers
+ * - the responses are implicitly shared QByteArrays: a hit doesn't copy the data
+ * - optional disk tier (ArticleStore): every response is also written there, a memory miss
+ *   is looked up on disk and brought back in memory (a memory size of 0 only uses the disk)
+ */
+class ArticleCache
+{
+public:
+    /*!
+     * \brief ArticleCache constructor
+     * \param aMaxSize    : max size of the cached responses (Bytes)
+     * \param aNbShards   : number of shards (independent locks)
+     * \param aMaxArticle : max size of a response to be cached (Bytes)
+     */
+    explicit ArticleCache(qint64 aMaxSize, ushort aNbShards = cArticleCacheShards,
+                          qint64 aMaxArticle = cArticleCacheMaxArticle);
+    ArticleCache(const ArticleCache &)              = delete;
+    ArticleCache(const ArticleCache &&)             = delete;
+    ArticleCache & operator=(const ArticleCache &)  = delete;
+    ArticleCache & operator=(const ArticleCache &&) = delete;
+
+    ~ArticleCache(); //!< free all the entries (and the ArticleStore)
+
+    void setStore(ArticleStore *aStore); //!< add a disk tier (takes ownership, must be opened)
+
+    //! cache key of a command line ("A<id>", "H<id>" or "B<id>"), empty if the command can't be cached
+    static QByteArray getKey(const QByteArray &aCmd);
+
+    //! is aStatusLine a successful article response (220, 221 or 222)
+    static bool isArticleResponse(const QByteArray &aStatusLine);
+
+    /*!
+     * \brief get a cached response (and make it the most recently used of its shard)
+     * \param aKey      : key given by getKey
+     * \param aResponse : the response if found
+     * \return true on a hit (hit/miss statistics updated)
+     */
+    bool get(const QByteArray &aKey, QByteArray &aResponse);
+    bool contains(const QByteArray &aKey);  //!< is aKey cached in memory or on disk (no statistics, no LRU update)
+
+    //! add a response (on disk too), evicting the least recently used of its shard if needed
+    void insert(const QByteArray &aKey, const QByteArray &aResponse);
+
+    qint64 getMaxArticleSize() const; //!< max size of a response to be cached (in memory or on disk)
+
+    qint64 getSize();               //!< size of the responses cached
+    int    getNumberOfArticles();   //!< number of responses cached
+
+    inline quint64 getNumberOfHits() const;      //!< hits in memory since start
+    inline quint64 getNumberOfStoreHits() const; //!< hits on the disk tier since start
+    inline quint64 getNumberOfMisses() const;    //!< misses of both tiers since start
+    inline quint64 getNumberOfEvictions() const; //!< evictions since start
+    inline quint64 getBytesServed() const;       //!< bytes served from the cache since start
+    double         getHitRatio() const;          //!< (hits + store hits) / (hits + store hits + misses)
+
+    void dump(QTextStream &aStream); //!< write the statistics
+
+private:
+    struct Entry{ //!< a cached response (node of the LRU list of its shard)
+        QByteArray key;
+        QByteArray response;
+        Entry     *prev; //!< more recently used
+        Entry     *next; //!< less recently used
+    };
+
+    struct Shard{
+        QMutex                     mutex;
+        QHash<QByteArray, Entry *> index;
+        Entry                     *head; //!< most recently used
+        Entry                     *tail; //!< least recently used
+        qint64                     size; //!< size of the responses of the shard
+    };
+
+    inline Shard &getShard(const QByteArray &aKey); //!< shard of a key
+    void insertInMemory(const QByteArray &aKey, const QByteArray &aResponse); //!< add a response to the memory tier
+
+    static void unlink(Shard &aShard, Entry *aEntry);    //!< remove an entry from the LRU list
+    static void pushFront(Shard &aShard, Entry *aEntry); //!< make an entry the most recently used
+
+private:
+    const qint64           iMaxShardSize;  //!< max size of a shard
+    const qint64           iMaxArticle;    //!< max size of a response to be cached
+    const ushort           iNbShards;      //!< number of shards
+    Shard                 *iShards;        //!< the shards (owns them)
+    ArticleStore          *iStore;         //!< disk tier (owns it, Q_NULLPTR if none)
+
+    QAtomicInteger<quint64> iHits;         //!< hits in memory since start
+    QAtomicInteger<quint64> iStoreHits;    //!< hits on the disk tier since start
+    QAtomicInteger<quint64> iMisses;       //!< misses of both tiers since start
+    QAtomicInteger<quint64> iEvictions;    //!< evictions since start
+    QAtomicInteger<quint64> iBytesServed;  //!< bytes served since start
+};
+
+quint64 ArticleCache::getNumberOfHits() const {return iHits.load();}
+quint64 ArticleCache::getNumberOfStoreHits() const {return iStoreHits.load();}
+quint64 ArticleCache::getNumberOfMisses() const {return iMisses.load();}
+quint64 ArticleCache::getNumberOfEvictions() const {return iEvictions.load();}
+quint64 ArticleCache::getBytesServed() const {return iBytesServed.load();}
+
+ArticleCache::Shard &ArticleCache::getShard(const QByteArray &aKey){
+    return iShards[qHash(aKey) % iNbShards];
+}
+
+#endif // ARTICLECACHE_H
@@ -0,0 +1,253 @@
+#include "articlestore.h"
+#include "nntpproxy.h"
+
+#include <QFile>
+#include <QDir>
+#include <QStringList>
+#include <QMutexLocker>
+#include <QReadLocker>
+#include <QWriteLocker>
+#include <QTextStream>
+#include <cstring>
+
+ArticleStore::ArticleStore(const QString &aDirectory, qint64 aSegmentSize, ushort aNbSegments):
+    iDirectory(aDirectory), iSegmentSize(aSegmentSize),
+    iNbSegments(aNbSegments ? aNbSegments : 1),
+    iLock(), iAppendMutex(), iIndex(), iSegments(),
+    iHits(0), iMisses(0), iEvictions(0), iBytesServed(0)
+{}
+
+ArticleStore::~ArticleStore(){
+    for (Segment *segment : iSegments)
+        closeSegment(segment, false);
+}
+
+quint64 ArticleStore::hashKey(const QByteArray &aKey){
+    quint64 hash = 14695981039346656037ULL;
+    for (int i = 0; i < aKey.size(); ++i){
+        hash ^= static_cast<uchar>(aKey.at(i));
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+bool ArticleStore::open(){
+    QDir dir(iDirectory);
+    if (!dir.exists() && !dir.mkpath(iDirectory)){
+        NntpProxy::log("[ArticleStore] ", QString("Can't create the directory ").append(iDirectory));
+        return false;
+    }
+
+    // segment names are zero padded: sorted by name = oldest first
+    QStringList filters;
+    filters.append("segment-*.seg");
+    QStringList files = dir.entryList(filters, QDir::Files, QDir::Name);
+    for (const QString &fileName : files){
+        Segment *segment = loadSegment(dir.filePath(fileName));
+        if (segment)
+            iSegments.append(segment);
+    }
+    while (iSegments.size() > iNbSegments)
+        evictOldestSegment();
+
+    if (iSegments.isEmpty()){
+        Segment *segment = createSegment(1);
+        if (!segment)
+            return false;
+        iSegments.append(segment);
+    }
+
+    QString str("Opened in ");
+    str += iDirectory;
+    str += QString(": %1 segments, %2 articles").arg(iSegments.size()).arg(iIndex.size());
+    NntpProxy::log("[ArticleStore] ", str);
+    return true;
+}
+
+ArticleStore::Segment *ArticleStore::createSegment(quint64 aSeqNo){
+    QFile *file = new QFile(getFilePath(aSeqNo));
+    uchar *map  = Q_NULLPTR;
+    if (file->open(QIODevice::ReadWrite | QIODevice::Truncate) && file->resize(iSegmentSize))
+        map = file->map(0, iSegmentSize);
+    if (!map){
+        NntpProxy::log("[ArticleStore] ", QString("Can't create the segment ").append(file->fileName()));
+        file->remove();
+        delete file;
+        return Q_NULLPTR;
+    }
+
+    memcpy(map, &sSegmentMagic, sizeof(sSegmentMagic));
+    memcpy(map + sizeof(sSegmentMagic), &aSeqNo, sizeof(aSeqNo));
+    memset(map + sSegmentHeaderSize, 0, sRecordHeaderSize); // no record yet
+
+    Segment *segment = new Segment();
+    segment->seqNo   = aSeqNo;
+    segment->file    = file;
+    segment->map     = map;
+    segment->used    = sSegmentHeaderSize;
+    return segment;
+}
+
+ArticleStore::Segment *ArticleStore::loadSegment(const QString &aFileName){
+    QFile *file = new QFile(aFileName);
+    uchar *map  = Q_NULLPTR;
+    if (file->open(QIODevice::ReadWrite) && file->size() == iSegmentSize)
+        map = file->map(0, iSegmentSize);
+
+    quint64 magic = 0, seqNo = 0;
+    if (map){
+        memcpy(&magic, map, sizeof(magic));
+        memcpy(&seqNo, map + sizeof(magic), sizeof(seqNo));
+    }
+    if (!map || magic != sSegmentMagic){
+        NntpProxy::log("[ArticleStore] ", QString("Invalid segment removed: ").append(aFileName));
+        if (map)
+            file->unmap(map);
+        file->remove();
+        delete file;
+        return Q_NULLPTR;
+    }
+
+    Segment *segment = new Segment();
+    segment->seqNo   = seqNo;
+    segment->file    = file;
+    segment->map     = map;
+    segment->used    = sSegmentHeaderSize;
+
+    // walk the records up to the first one that isn't complete
+    while (segment->used + sRecordHeaderSize <= iSegmentSize){
+        const uchar *record = map + segment->used;
+        quint32 recordMagic, dataLen;
+        quint16 keyLen;
+        memcpy(&recordMagic, record, 4);
+        memcpy(&keyLen, record + 4, 2);
+        memcpy(&dataLen, record + 8, 4);
+        qint64 recordSize = sRecordHeaderSize + keyLen + dataLen;
+        if (recordMagic != sRecordMagic || keyLen == 0 || segment->used + recordSize > iSegmentSize)
+            break;
+
+        QByteArray key(reinterpret_cast<const char *>(record + sRecordHeaderSize), keyLen);
+        quint64 hash = hashKey(key);
+        iIndex.insert(hash, {seqNo, static_cast<quint32>(segment->used), dataLen});
+        segment->hashes.append(hash);
+        segment->used += recordSize;
+    }
+    return segment;
+}
+
+void ArticleStore::closeSegment(Segment *aSegment, bool aRemoveFile){
+    aSegment->file->unmap(aSegment->map);
+    aSegment->file->close();
+    if (aRemoveFile)
+        aSegment->file->remove();
+    delete aSegment->file;
+    delete aSegment;
+}
+
+void ArticleStore::evictOldestSegment(){
+    Segment *oldest = iSegments.takeFirst();
+    for (quint64 hash : oldest->hashes){
+        auto it = iIndex.find(hash);
+        if (it != iIndex.end() && it.value().seqNo == oldest->seqNo)
+            iIndex.erase(it);
+    }
+    closeSegment(oldest, true);
+    iEvictions.fetchAndAddRelaxed(1);
+}
+
+bool ArticleStore::get(const QByteArray &aKey, QByteArray &aResponse){
+    quint64 hash = hashKey(aKey);
+    {
+        QReadLocker lock(&iLock);
+        auto it = iIndex.constFind(hash);
+        if (it != iIndex.constEnd()){
+            const Location &loc = it.value();
+            Segment *segment    = findSegment(loc.seqNo);
+            const char *record  = segment ? reinterpret_cast<const char *>(segment->map + loc.offset) : Q_NULLPTR;
+            quint16 keyLen      = 0;
+            if (record)
+                memcpy(&keyLen, record + 4, 2);
+            if (record && keyLen == aKey.size() && memcmp(record + sRecordHeaderSize, aKey.constData(), keyLen) == 0){
+                aResponse = QByteArray(record + sRecordHeaderSize + keyLen, static_cast<int>(loc.length));
+                lock.unlock();
+                iHits.fetchAndAddRelaxed(1);
+                iBytesServed.fetchAndAddRelaxed(loc.length);
+                return true;
+            }
+        }
+    }
+    iMisses.fetchAndAddRelaxed(1);
+    return false;
+}
+
+bool ArticleStore::contains(const QByteArray &aKey){
+    QReadLocker lock(&iLock);
+    return iIndex.contains(hashKey(aKey));
+}
+
+void ArticleStore::insert(const QByteArray &aKey, const QByteArray &aResponse){
+    qint64 recordSize = sRecordHeaderSize + aKey.size() + aResponse.size();
+    if (aKey.size() > cArticleStoreMaxKey || aResponse.size() > getMaxArticleSize())
+        return;
+
+    quint64 hash = hashKey(aKey);
+    QMutexLocker appendLock(&iAppendMutex);
+    if (contains(aKey))
+        return; // fetched twice at the same time
+
+    Segment *segment = iSegments.last(); // only changed by the appends
+    if (segment->used + recordSize > iSegmentSize){
+        Segment *next = createSegment(segment->seqNo + 1);
+        if (!next)
+            return;
+
+        QWriteLocker lock(&iLock);
+        iSegments.append(next);
+        while (iSegments.size() > iNbSegments)
+            evictOldestSegment();
+        segment = next;
+    }
+
+    // the readers only reach the record once it's indexed
+    uchar  *record  = segment->map + segment->used;
+    quint32 dataLen = static_cast<quint32>(aResponse.size());
+    quint16 keyLen  = static_cast<quint16>(aKey.size());
+    memcpy(record + sRecordHeaderSize, aKey.constData(), keyLen);
+    memcpy(record + sRecordHeaderSize + keyLen, aResponse.constData(), dataLen);
+    memset(record + 6, 0, 2);
+    memcpy(record + 4, &keyLen, 2);
+    memcpy(record + 8, &dataLen, 4);
+    memcpy(record, &sRecordMagic, 4); // last: a crash before leaves an invalid record (end of the segment)
+
+    // end marker for the scan on restart
+    qint64 end = segment->used + recordSize;
+    if (end + sRecordHeaderSize <= iSegmentSize)
+        memset(segment->map + end, 0, sRecordHeaderSize);
+
+    QWriteLocker lock(&iLock);
+    iIndex.insert(hash, {segment->seqNo, static_cast<quint32>(segment->used), dataLen});
+    segment->hashes.append(hash);
+    segment->used = end;
+}
+
+int ArticleStore::getNumberOfArticles(){
+    QReadLocker lock(&iLock);
+    return iIndex.size();
+}
+
+int ArticleStore::getNumberOfSegments(){
+    QReadLocker lock(&iLock);
+    return iSegments.size();
+}
+
+void ArticleStore::dump(QTextStream &aStream){
+    quint64 hits  = getNumberOfHits();
+    quint64 total = hits + getNumberOfMisses();
+    aStream << "Article store: " << getNumberOfArticles() << " articles in "
+            << getNumberOfSegments() << " / " << iNbSegments << " segments of "
+            << iSegmentSize / 1048576 << " MB"
+            << ", hit ratio: " << QString::number(total ? 100. * hits / total : 0., 'f', 1) << "%"
+            << " (hits: " << hits << ", misses: " << getNumberOfMisses() << ")"
+            << ", served: " << getBytesServed() / 1048576 << " MB"
+            << ", evicted segments: " << getNumberOfEvictedSegments() << "\n";
+}
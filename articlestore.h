@@ -0,0 +1,136 @@
+#ifndef ARTICLESTORE_H
+#define ARTICLESTORE_H
+
+#include "constants.h"
+
+#include <QString>
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QVector>
+#include <QMutex>
+#include <QReadWriteLock>
+#include <QAtomicInteger>
+
+QT_FORWARD_DECLARE_CLASS(QFile)
+QT_FORWARD_DECLARE_CLASS(QTextStream)
+
+/*!
+ * \brief Disk tier of the ArticleCache: article responses appended to memory mapped segment files (Thread_Safe)
+ * - a segment is a file of fixed size (preallocated and mapped) made of records appended one after the other
+ *   (segment header: magic + sequence number, record: header + key + response)
+ * - in memory, only a compact index: hash of the key -> (segment, offset, length)
+ *   (the key is stored in the record and checked on a hit, so a hash collision is just a miss)
+ * - eviction by whole segments, oldest first (FIFO): no fragmentation, no compaction
+ * - the index is rebuilt on startup by scanning the records of the segments found in the directory
+ * - the appends are serialized (iAppendMutex), the readers only wait for the publication
+ *   of an index entry or the eviction of a segment (iLock)
+ */
+class ArticleStore
+{
+public:
+    /*!
+     * \brief ArticleStore constructor (call open() before using it)
+     * \param aDirectory   : where the segment files are
+     * \param aSegmentSize : size of a segment file (Bytes)
+     * \param aNbSegments  : max number of segments (the disk used is aSegmentSize * aNbSegments)
+     */
+    explicit ArticleStore(const QString &aDirectory, qint64 aSegmentSize, ushort aNbSegments);
+    ArticleStore(const ArticleStore &)              = delete;
+    ArticleStore(const ArticleStore &&)             = delete;
+    ArticleStore & operator=(const ArticleStore &)  = delete;
+    ArticleStore & operator=(const ArticleStore &&) = delete;
+
+    ~ArticleStore(); //!< unmap and close the segments (the files are kept)
+
+    bool open(); //!< create the directory if needed, map the existing segments and rebuild the index
+
+    /*!
+     * \brief copy a stored response out of its segment
+     * \param aKey      : ArticleCache key
+     * \param aResponse : the response if found
+     * \return true on a hit (hit/miss statistics updated)
+     */
+    bool get(const QByteArray &aKey, QByteArray &aResponse);
+    bool contains(const QByteArray &aKey); //!< is aKey stored (no statistics)
+
+    void insert(const QByteArray &aKey, const QByteArray &aResponse); //!< append a response (evicting the oldest segment if needed)
+
+    inline qint64 getMaxArticleSize() const; //!< biggest response a segment can hold
+
+    int     getNumberOfArticles();                 //!< number of responses indexed
+    int     getNumberOfSegments();                 //!< number of segments on disk
+    inline quint64 getNumberOfHits() const;        //!< hits since start
+    inline quint64 getNumberOfMisses() const;      //!< misses since start
+    inline quint64 getNumberOfEvictedSegments() const; //!< segments evicted since start
+    inline quint64 getBytesServed() const;         //!< bytes read from the segments since start
+
+    void dump(QTextStream &aStream); //!< write the statistics
+
+    static quint64 hashKey(const QByteArray &aKey); //!< stable hash of a key (FNV-1a 64, same after a restart)
+
+private:
+    struct Segment{
+        quint64          seqNo;  //!< sequence number (name of the file, eviction order)
+        QFile           *file;   //!< the file (owned)
+        uchar           *map;    //!< mapping of the whole file
+        qint64           used;   //!< end of the last record
+        QVector<quint64> hashes; //!< hashes of the records (to clean the index on eviction)
+    };
+
+    struct Location{ //!< where a response is
+        quint64 seqNo;
+        quint32 offset; //!< offset of the record
+        quint32 length; //!< length of the response
+    };
+
+    Segment *createSegment(quint64 aSeqNo);          //!< new preallocated and mapped segment file
+    Segment *loadSegment(const QString &aFileName);  //!< map an existing segment and index its records
+    void     evictOldestSegment();                   //!< drop the oldest segment (iLock held for write)
+    void     closeSegment(Segment *aSegment, bool aRemoveFile); //!< unmap and delete a segment
+    inline QString getFilePath(quint64 aSeqNo) const; //!< path of a segment file
+    inline Segment *findSegment(quint64 aSeqNo) const; //!< segment of a sequence number (iLock held)
+
+private:
+    static const quint64 sSegmentMagic = 0x3147455350544e4eULL; //!< "NNTPSEG1"
+    static const quint32 sRecordMagic  = 0x5243444eU;           //!< "NDCR"
+    static const qint64  sSegmentHeaderSize = 16; //!< magic + seqNo
+    static const qint64  sRecordHeaderSize  = 12; //!< magic + key length + response length
+
+    const QString              iDirectory;    //!< where the segment files are
+    const qint64               iSegmentSize;  //!< size of a segment file
+    const ushort               iNbSegments;   //!< max number of segments
+
+    QReadWriteLock             iLock;         //!< protects iIndex and iSegments
+    QMutex                     iAppendMutex;  //!< serializes the appends
+    QHash<quint64, Location>   iIndex;        //!< hash of the key -> location of the response
+    QList<Segment *>           iSegments;     //!< segments, oldest first (the last one is the active one)
+
+    QAtomicInteger<quint64>    iHits;         //!< hits since start
+    QAtomicInteger<quint64>    iMisses;       //!< misses since start
+    QAtomicInteger<quint64>    iEvictions;    //!< segments evicted since start
+    QAtomicInteger<quint64>    iBytesServed;  //!< bytes read since start
+};
+
+qint64 ArticleStore::getMaxArticleSize() const {
+    return iSegmentSize - sSegmentHeaderSize - sRecordHeaderSize - cArticleStoreMaxKey;
+}
+
+quint64 ArticleStore::getNumberOfHits() const {return iHits.load();}
+quint64 ArticleStore::getNumberOfMisses() const {return iMisses.load();}
+quint64 ArticleStore::getNumberOfEvictedSegments() const {return iEvictions.load();}
+quint64 ArticleStore::getBytesServed() const {return iBytesServed.load();}
+
+QString ArticleStore::getFilePath(quint64 aSeqNo) const {
+    return QString("%1/segment-%2.seg").arg(iDirectory).arg(aSeqNo, 12, 10, QChar('0'));
+}
+
+ArticleStore::Segment *ArticleStore::findSegment(quint64 aSeqNo) const {
+    for (Segment *segment : iSegments){
+        if (segment->seqNo == aSeqNo)
+            return segment;
+    }
+    return Q_NULLPTR;
+}
+
+#endif // ARTICLESTORE_H
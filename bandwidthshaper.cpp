@@ -0,0 +1,212 @@
+#include "bandwidthshaper.h"
+#include "tokenbucket.h"
+
+#include <QMutexLocker>
+#include <QTextStream>
+
+BandwidthShaper::BandwidthShaper(const QVector<UserClassParameters *> &aClasses, uint aIpRate, uint aIpBurst):
+    iMutex(), iClasses(), iUserClasses(), iIpLimits(),
+    iUserBuckets(), iIpBuckets(), iThrottled()
+{
+    Limits unlimited = {0, static_cast<qint64>(cDefaultShapingBurst) * 1024};
+    iClasses.insert(cDefaultUserClass, unlimited);
+    for (const UserClassParameters *params : aClasses){
+        setClass(params->name, params->rate, params->burst);
+        for (const QString &login : params->users)
+            setUserClass(login, params->name);
+    }
+    setIpRate(aIpRate, aIpBurst);
+}
+
+BandwidthShaper::~BandwidthShaper(){
+    for (auto it = iUserBuckets.begin(); it != iUserBuckets.end(); ++it)
+        delete it.value().bucket;
+    for (auto it = iIpBuckets.begin(); it != iIpBuckets.end(); ++it)
+        delete it.value().bucket;
+}
+
+BandwidthShaper::Limits BandwidthShaper::getUserLimits_noLock(const QString &aLogin) const {
+    return iClasses.value(iUserClasses.value(aLogin, cDefaultUserClass), iClasses.value(cDefaultUserClass));
+}
+
+TokenBucket *BandwidthShaper::acquireBucket_noLock(QHash<QString, Bucket> &aBuckets, const QString &aKey,
+                                                   const Limits &aLimits){
+    auto it = aBuckets.find(aKey);
+    if (it == aBuckets.end()){
+        Bucket bucket = {new TokenBucket(aLimits.rate, aLimits.burst), 0};
+        it = aBuckets.insert(aKey, bucket);
+    }
+    ++it.value().nbFlows;
+    return it.value().bucket;
+}
+
+qint64 BandwidthShaper::releaseBucket_noLock(QHash<QString, Bucket> &aBuckets, const QString &aKey){
+    auto it = aBuckets.find(aKey);
+    if (it == aBuckets.end() || --it.value().nbFlows > 0)
+        return 0;
+
+    qint64 throttled = it.value().bucket->getThrottledTime();
+    delete it.value().bucket;
+    aBuckets.erase(it);
+    return throttled;
+}
+
+BandwidthShaper::Flow BandwidthShaper::acquire(const QString &aLogin, const QString &aIp){
+    QMutexLocker lock(&iMutex);
+    Flow flow = {aLogin, aIp, Q_NULLPTR, Q_NULLPTR};
+    flow.user = acquireBucket_noLock(iUserBuckets, aLogin, getUserLimits_noLock(aLogin));
+    if (iIpLimits.rate > 0)
+        flow.ipBucket = acquireBucket_noLock(iIpBuckets, aIp, iIpLimits);
+    return flow;
+}
+
+void BandwidthShaper::release(Flow &aFlow){
+    if (!isAcquired(aFlow))
+        return;
+
+    QMutexLocker lock(&iMutex);
+    qint64 throttled = releaseBucket_noLock(iUserBuckets, aFlow.login);
+    if (throttled > 0)
+        iThrottled[aFlow.login] += throttled;
+    if (aFlow.ipBucket)
+        releaseBucket_noLock(iIpBuckets, aFlow.ip);
+
+    aFlow.user     = Q_NULLPTR;
+    aFlow.ipBucket = Q_NULLPTR;
+}
+
+qint64 BandwidthShaper::take(const Flow &aFlow, qint64 aWanted, qint64 &aDelay){
+    aDelay = 0;
+    if (!isAcquired(aFlow))
+        return aWanted;
+
+    qint64 now     = TokenBucket::now();
+    qint64 granted = aFlow.user->take(aWanted, now, aDelay);
+    if (granted > 0 && aFlow.ipBucket){
+        qint64 ipGranted = aFlow.ipBucket->take(granted, now, aDelay);
+        aFlow.user->giveBack(granted - ipGranted);
+        granted = ipGranted;
+    }
+    return granted;
+}
+
+void BandwidthShaper::giveBack(const Flow &aFlow, qint64 aBytes){
+    if (!isAcquired(aFlow) || aBytes <= 0)
+        return;
+
+    aFlow.user->giveBack(aBytes);
+    if (aFlow.ipBucket)
+        aFlow.ipBucket->giveBack(aBytes);
+}
+
+qint64 BandwidthShaper::charge(const Flow &aFlow, qint64 aBytes){
+    if (!isAcquired(aFlow) || aBytes <= 0)
+        return 0;
+
+    qint64 now   = TokenBucket::now();
+    qint64 delay = aFlow.user->charge(aBytes, now);
+    if (aFlow.ipBucket)
+        delay = qMax(delay, aFlow.ipBucket->charge(aBytes, now));
+    return delay;
+}
+
+void BandwidthShaper::addThrottledTime(const Flow &aFlow, qint64 aNs){
+    if (isAcquired(aFlow))
+        aFlow.user->addThrottledTime(aNs);
+}
+
+bool BandwidthShaper::setClass(const QString &aName, uint aRate, uint aBurst){
+    if (aName.isEmpty())
+        return false;
+
+    QMutexLocker lock(&iMutex);
+    Limits limits = {static_cast<qint64>(aRate) * 1024, static_cast<qint64>(aBurst) * 1024};
+    iClasses.insert(aName, limits);
+
+    // the users of the class having a session get the new limits now
+    for (auto it = iUserBuckets.begin(); it != iUserBuckets.end(); ++it){
+        if (iUserClasses.value(it.key(), cDefaultUserClass) == aName)
+            it.value().bucket->setRate(limits.rate, limits.burst);
+    }
+
+    QString str("Class ");
+    str += aName;
+    str += ": ";
+    str += QString::number(aRate);
+    str += " KB/s (burst: ";
+    str += QString::number(aBurst);
+    str += " KB)";
+    _log(str);
+    return true;
+}
+
+bool BandwidthShaper::setUserClass(const QString &aLogin, const QString &aName){
+    QMutexLocker lock(&iMutex);
+    if (!iClasses.contains(aName))
+        return false;
+
+    setUserClass_noLock(aLogin, aName);
+    return true;
+}
+
+void BandwidthShaper::setUserClass_noLock(const QString &aLogin, const QString &aName){
+    if (aName == cDefaultUserClass)
+        iUserClasses.remove(aLogin);
+    else
+        iUserClasses.insert(aLogin, aName);
+
+    auto it = iUserBuckets.find(aLogin);
+    if (it != iUserBuckets.end()){
+        Limits limits = iClasses.value(aName);
+        it.value().bucket->setRate(limits.rate, limits.burst);
+    }
+}
+
+void BandwidthShaper::setIpRate(uint aRate, uint aBurst){
+    QMutexLocker lock(&iMutex);
+    iIpLimits.rate  = static_cast<qint64>(aRate) * 1024;
+    iIpLimits.burst = static_cast<qint64>(aBurst) * 1024;
+
+    // the flows acquired without IP bucket keep going without
+    for (auto it = iIpBuckets.begin(); it != iIpBuckets.end(); ++it)
+        it.value().bucket->setRate(iIpLimits.rate, iIpLimits.burst);
+}
+
+qint64 BandwidthShaper::getThrottledTime(const QString &aLogin){
+    QMutexLocker lock(&iMutex);
+    qint64 throttled = iThrottled.value(aLogin, 0);
+    auto it = iUserBuckets.find(aLogin);
+    if (it != iUserBuckets.end())
+        throttled += it.value().bucket->getThrottledTime();
+    return throttled;
+}
+
+QString BandwidthShaper::getUserClass(const QString &aLogin){
+    QMutexLocker lock(&iMutex);
+    return iUserClasses.value(aLogin, cDefaultUserClass);
+}
+
+void BandwidthShaper::dump(QTextStream &aStream){
+    QMutexLocker lock(&iMutex);
+    aStream << "Shaping: " << iUserBuckets.size() << " users, " << iIpBuckets.size() << " IPs";
+    if (iIpLimits.rate > 0)
+        aStream << " (IP: " << iIpLimits.rate / 1024 << " KB/s, burst: " << iIpLimits.burst / 1024 << " KB)";
+    aStream << "\n";
+
+    for (auto it = iClasses.cbegin(); it != iClasses.cend(); ++it){
+        aStream << "\t- class " << it.key() << ": ";
+        if (it.value().rate > 0)
+            aStream << it.value().rate / 1024 << " KB/s, burst: " << it.value().burst / 1024 << " KB\n";
+        else
+            aStream << "unlimited\n";
+    }
+
+    // throttled time of the users (with a session or not anymore)
+    QHash<QString, qint64> throttled(iThrottled);
+    for (auto it = iUserBuckets.cbegin(); it != iUserBuckets.cend(); ++it)
+        throttled[it.key()] += it.value().bucket->getThrottledTime();
+    for (auto it = throttled.cbegin(); it != throttled.cend(); ++it){
+        if (it.value() > 0)
+            aStream << "\t- " << it.key() << " throttled: " << it.value() / 1000000 << " ms\n";
+    }
+}
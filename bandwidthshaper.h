@@ -0,0 +1,103 @@
+#ifndef BANDWIDTHSHAPER_H
+#define BANDWIDTHSHAPER_H
+
+#include "constants.h"
+#include "nntpproxy.h"
+
+#include <QHash>
+#include <QVector>
+#include <QMutex>
+
+QT_FORWARD_DECLARE_CLASS(QTextStream)
+QT_FORWARD_DECLARE_CLASS(TokenBucket)
+
+/*!
+ * \brief Bandwidth of the responses forwarded to the users (Thread_Safe)
+ * - a TokenBucket per user (login), shared by all its sessions, with the rate of its class
+ *   (cDefaultUserClass for the users not listed in any class)
+ * - optionally a TokenBucket per IP (ipRate) on top of it
+ * - the NntpConnections take from the buckets of their Flow lock free (take, giveBack),
+ *   iMutex is only held to acquire or release a Flow and to change the limits
+ * - the limits can be changed at runtime (setClass, setUserClass, setIpRate: MonitoringServer)
+ * - the time a user has been throttled is kept after its sessions are gone (getThrottledTime)
+ */
+class BandwidthShaper
+{
+public:
+    struct Flow {              //!< buckets of a session (a Flow with no bucket is unlimited)
+        QString      login;    //!< user of the session
+        QString      ip;       //!< IP of the session
+        TokenBucket *user;     //!< bucket of the user (Q_NULLPTR: not acquired)
+        TokenBucket *ipBucket; //!< bucket of the IP (Q_NULLPTR: no IP rate)
+    };
+
+    /*!
+     * \brief BandwidthShaper constructor
+     * \param aClasses : user classes (rate and burst in KB)
+     * \param aIpRate  : KB/s per IP (0: no IP bucket)
+     * \param aIpBurst : KB
+     */
+    explicit BandwidthShaper(const QVector<UserClassParameters *> &aClasses, uint aIpRate, uint aIpBurst);
+    ~BandwidthShaper(); //!< delete the buckets
+    BandwidthShaper(const BandwidthShaper &)              = delete;
+    BandwidthShaper(const BandwidthShaper &&)             = delete;
+    BandwidthShaper & operator=(const BandwidthShaper &)  = delete;
+    BandwidthShaper & operator=(const BandwidthShaper &&) = delete;
+
+    Flow acquire(const QString &aLogin, const QString &aIp); //!< buckets of a session (to release)
+    void release(Flow &aFlow);                               //!< the session doesn't forward anymore
+
+    /*!
+     * \brief take up to aWanted bytes from both buckets of a flow (lock free)
+     * \param aDelay : ns to wait when nothing can be sent now
+     * \return bytes that can be sent now
+     */
+    static qint64 take(const Flow &aFlow, qint64 aWanted, qint64 &aDelay);
+    static void giveBack(const Flow &aFlow, qint64 aBytes);        //!< bytes taken but not sent
+    static qint64 charge(const Flow &aFlow, qint64 aBytes);        //!< bytes sent without take (cache): ns to wait
+    static void addThrottledTime(const Flow &aFlow, qint64 aNs);   //!< the flow waited aNs
+    static inline bool isAcquired(const Flow &aFlow);              //!< does the flow have buckets
+
+    bool setClass(const QString &aName, uint aRate, uint aBurst);  //!< add or change a class (KB/s, KB), false if invalid
+    bool setUserClass(const QString &aLogin, const QString &aName);//!< move a user to a class, false if unknown class
+    void setIpRate(uint aRate, uint aBurst);                       //!< change the IP buckets (KB/s, KB), 0: none
+
+    qint64 getThrottledTime(const QString &aLogin);  //!< ns the user has been throttled since start
+    QString getUserClass(const QString &aLogin);     //!< class of a user
+
+    void dump(QTextStream &aStream); //!< write the classes and the throttled time of the users
+
+private:
+    struct Limits {   //!< rate and burst of a class or of the IPs
+        qint64 rate;  //!< bytes per second (0: unlimited)
+        qint64 burst; //!< bytes
+    };
+    struct Bucket {            //!< bucket shared by the sessions of a user or of an IP
+        TokenBucket *bucket;   //!< the bucket (owns it)
+        int          nbFlows;  //!< sessions using it
+    };
+
+    Limits getUserLimits_noLock(const QString &aLogin) const; //!< limits of the class of a user
+    void   setUserClass_noLock(const QString &aLogin, const QString &aName); //!< record the class and apply it
+    static TokenBucket *acquireBucket_noLock(QHash<QString, Bucket> &aBuckets, const QString &aKey, const Limits &aLimits);
+    static qint64 releaseBucket_noLock(QHash<QString, Bucket> &aBuckets, const QString &aKey); //!< throttled ns if deleted
+
+    inline void _log(const QString & aMessage) const; //!< Add a log line
+
+private:
+    QMutex                  iMutex;         //!< protects what follows (not the buckets)
+    QHash<QString, Limits>  iClasses;       //!< user classes by name
+    QHash<QString, QString> iUserClasses;   //!< class of the users listed (login -> name)
+    Limits                  iIpLimits;      //!< limits of the IPs (rate 0: no IP bucket)
+    QHash<QString, Bucket>  iUserBuckets;   //!< buckets of the users having a session (by login)
+    QHash<QString, Bucket>  iIpBuckets;     //!< buckets of the IPs having a session
+    QHash<QString, qint64>  iThrottled;     //!< throttled ns of the users whose buckets have been deleted
+};
+
+bool BandwidthShaper::isAcquired(const Flow &aFlow){return aFlow.user != Q_NULLPTR;}
+
+void BandwidthShaper::_log(const QString & aMessage) const {
+     NntpProxy::log("[BandwidthShaper] ", aMessage);
+}
+
+#endif // BANDWIDTHSHAPER_H
@@ -0,0 +1,115 @@
+#include "bloomfilter.h"
+
+#include <QMutexLocker>
+#include <cmath>
+
+static const quint32 sMinNbBits = 1024; //!< smallest generation
+
+BloomFilter::BloomFilter(qint64 aMemorySize, double aFalsePositiveRate):
+    iNbBits(roundNbBits(aMemorySize)), iMask(iNbBits - 1),
+    iNbHashes(computeNbHashes(aFalsePositiveRate)),
+    iCapacity(computeCapacity(iNbBits, aFalsePositiveRate)),
+    iNbKeys(), iCurrent(0), iNbRotations(0), iMutex()
+{
+    for (int i = 0; i < 2; ++i){
+        iWords[i] = new QAtomicInteger<quint32>[iNbBits / 32]; // zeroed
+        iNbKeys[i].store(0);
+    }
+}
+
+BloomFilter::~BloomFilter(){
+    delete[] iWords[0];
+    delete[] iWords[1];
+}
+
+quint32 BloomFilter::roundNbBits(qint64 aMemorySize){
+    // half of the memory per generation, rounded down to a power of 2
+    quint32 nbBits = sMinNbBits;
+    while (static_cast<qint64>(nbBits) * 2 <= aMemorySize * 4 && nbBits < 0x80000000)
+        nbBits <<= 1;
+    return nbBits;
+}
+
+double BloomFilter::checkRate(double aFalsePositiveRate){
+    return (aFalsePositiveRate > 0 && aFalsePositiveRate < 1) ? aFalsePositiveRate : cDefaultMissingIndexFpr;
+}
+
+int BloomFilter::computeNbHashes(double aFalsePositiveRate){
+    double nbHashes = std::log2(1 / checkRate(aFalsePositiveRate));
+    return qMax(1, static_cast<int>(std::ceil(nbHashes)));
+}
+
+int BloomFilter::computeCapacity(quint32 aNbBits, double aFalsePositiveRate){
+    double capacity = aNbBits * std::log(2) * std::log(2) / std::log(1 / checkRate(aFalsePositiveRate));
+    return qMax(1, static_cast<int>(capacity));
+}
+
+quint64 BloomFilter::hash(const QByteArray &aKey){
+    quint64 hash = 14695981039346656037ULL;
+    for (int i = 0; i < aKey.size(); ++i){
+        hash ^= static_cast<uchar>(aKey.at(i));
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+void BloomFilter::add(const QByteArray &aKey){
+    quint64 h   = hash(aKey);
+    int current = iCurrent.load();
+    QAtomicInteger<quint32> *words = iWords[current];
+    for (int i = 0; i < iNbHashes; ++i){
+        quint32 bit = getBit(i, h);
+        words[bit >> 5].fetchAndOrRelaxed(1u << (bit & 31));
+    }
+
+    if (iNbKeys[current].fetchAndAddRelaxed(1) + 1 >= iCapacity)
+        rotate();
+}
+
+bool BloomFilter::contains(const QByteArray &aKey) const {
+    quint64 h = hash(aKey);
+    return isInGeneration(0, h) || isInGeneration(1, h);
+}
+
+bool BloomFilter::isInGeneration(int aGeneration, quint64 aKeyHash) const {
+    const QAtomicInteger<quint32> *words = iWords[aGeneration];
+    for (int i = 0; i < iNbHashes; ++i){
+        quint32 bit = getBit(i, aKeyHash);
+        if (!(words[bit >> 5].load() & (1u << (bit & 31))))
+            return false;
+    }
+    return true;
+}
+
+void BloomFilter::rotate(){
+    QMutexLocker lock(&iMutex);
+    int current = iCurrent.load();
+    if (iNbKeys[current].load() < iCapacity)
+        return; // rotated by another thread
+
+    int previous = 1 - current;
+    QAtomicInteger<quint32> *words = iWords[previous];
+    for (quint32 i = 0; i < iNbBits / 32; ++i)
+        words[i].store(0);
+    iNbKeys[previous].store(0);
+    iCurrent.store(previous);
+    iNbRotations.fetchAndAddRelaxed(1);
+}
+
+void BloomFilter::clear(){
+    QMutexLocker lock(&iMutex);
+    for (int g = 0; g < 2; ++g){
+        for (quint32 i = 0; i < iNbBits / 32; ++i)
+            iWords[g][i].store(0);
+        iNbKeys[g].store(0);
+    }
+}
+
+double BloomFilter::getFalsePositiveRate() const {
+    double notFalsePositive = 1;
+    for (int g = 0; g < 2; ++g){
+        double fillRatio = 1 - std::exp(-static_cast<double>(iNbHashes) * iNbKeys[g].load() / iNbBits);
+        notFalsePositive *= 1 - std::pow(fillRatio, iNbHashes);
+    }
+    return 1 - notFalsePositive;
+}
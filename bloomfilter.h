@@ -0,0 +1,81 @@
+#ifndef BLOOMFILTER_H
+#define BLOOMFILTER_H
+
+#include "constants.h"
+
+#include <QByteArray>
+#include <QMutex>
+#include <QAtomicInteger>
+
+/*!
+ * \brief Rotating Bloom filter: set membership of a stream of keys in a fixed memory (Thread_Safe, lock free but the rotations)
+ * - two generations of m bits (half of the memory each, m rounded down to a power of 2)
+ * - the keys are added to the current generation, contains() looks at both
+ * - the number of hashes k and the capacity of a generation are derived from the target
+ *   false positive rate p: k = log2(1/p), capacity = m * ln(2)^2 / ln(1/p)
+ * - once the current generation is full, the previous one is cleared and becomes the current one:
+ *   the oldest keys are forgotten and the false positive rate stays under 2p
+ * - no false negative until a key is rotated out (or cleared concurrently by a rotation)
+ */
+class BloomFilter
+{
+public:
+    /*!
+     * \brief BloomFilter constructor
+     * \param aMemorySize        : bytes of the two generations
+     * \param aFalsePositiveRate : target false positive rate of a full generation
+     */
+    explicit BloomFilter(qint64 aMemorySize, double aFalsePositiveRate);
+    ~BloomFilter();
+    BloomFilter(const BloomFilter &)              = delete;
+    BloomFilter(const BloomFilter &&)             = delete;
+    BloomFilter & operator=(const BloomFilter &)  = delete;
+    BloomFilter & operator=(const BloomFilter &&) = delete;
+
+    void add(const QByteArray &aKey);            //!< record aKey (may rotate the generations)
+    bool contains(const QByteArray &aKey) const; //!< has aKey (probably) been recorded
+    void clear();                                //!< forget all the keys
+
+    double getFalsePositiveRate() const;          //!< estimated false positive rate of contains() now
+
+    inline qint64  getMemorySize() const;       //!< bytes of the two generations
+    inline int     getNumberOfHashes() const;   //!< bits set per key
+    inline int     getCapacity() const;         //!< keys per generation before a rotation
+    inline int     getNumberOfKeys() const;     //!< keys recorded in the two generations
+    inline quint64 getNumberOfRotations() const;//!< rotations since start
+
+private:
+    static quint64 hash(const QByteArray &aKey); //!< FNV-1a 64 bits
+    static quint32 roundNbBits(qint64 aMemorySize);                      //!< bits of a generation
+    static double  checkRate(double aFalsePositiveRate);                 //!< default rate if out of ]0, 1[
+    static int     computeNbHashes(double aFalsePositiveRate);           //!< log2(1/p) rounded up
+    static int     computeCapacity(quint32 aNbBits, double aFalsePositiveRate); //!< m * ln(2)^2 / ln(1/p)
+    inline quint32 getBit(int aHash, quint64 aKeyHash) const; //!< bit of the i-th hash (double hashing)
+    bool isInGeneration(int aGeneration, quint64 aKeyHash) const; //!< are all the bits of the key set
+    void rotate(); //!< clear the previous generation and make it the current one
+
+private:
+    const quint32            iNbBits;     //!< bits per generation (power of 2)
+    const quint32            iMask;       //!< iNbBits - 1
+    const int                iNbHashes;   //!< bits set per key
+    const int                iCapacity;   //!< keys per generation before a rotation
+    QAtomicInteger<quint32> *iWords[2];   //!< the two generations (owns them)
+    QAtomicInteger<int>      iNbKeys[2];  //!< keys added to each generation
+    QAtomicInteger<int>      iCurrent;    //!< generation the keys are added to
+    QAtomicInteger<quint64>  iNbRotations;//!< rotations since start
+    QMutex                   iMutex;      //!< one rotation at a time
+};
+
+qint64  BloomFilter::getMemorySize() const {return 2 * static_cast<qint64>(iNbBits / 8);}
+int     BloomFilter::getNumberOfHashes() const {return iNbHashes;}
+int     BloomFilter::getCapacity() const {return iCapacity;}
+int     BloomFilter::getNumberOfKeys() const {return iNbKeys[0].load() + iNbKeys[1].load();}
+quint64 BloomFilter::getNumberOfRotations() const {return iNbRotations.load();}
+
+quint32 BloomFilter::getBit(int aHash, quint64 aKeyHash) const {
+    quint32 h1 = static_cast<quint32>(aKeyHash);
+    quint32 h2 = static_cast<quint32>(aKeyHash >> 32) | 1;
+    return (h1 + static_cast<quint32>(aHash) * h2) & iMask;
+}
+
+#endif // BLOOMFILTER_H
@@ -7,15 +7,19 @@
 #include <QSslCertificate>
 #include <QFile>
 #include <QAbstractSocket>
+#include <QTimer>
 
 
 Connection::Connection(qintptr aSocketDescriptor, bool ssl, bool servSocket, const char * aClassName):
     QObject(), iSocketDescriptor(aSocketDescriptor), isSsl(ssl),
     isServerSocket(servSocket), iSocket(Q_NULLPTR), iOutputCon(Q_NULLPTR),
-    iLogPrefix(aClassName)
+    iTimer(new QTimer(this)), isWriteBufferHigh(false), isPaused(false), iConnectTimer(), iLogPrefix(aClassName)
 {
     iLogPrefix.append("[").append(QString::number(iSocketDescriptor)).append("] ");
 
+    iTimer->setSingleShot(true);
+    connect(iTimer, &QTimer::timeout, this, &Connection::onTimeout);
+
 #ifdef LOG_CONSTRUCTORS
     QTextStream &is = NntpProxy::acquireLog(iLogPrefix);
     is << "Constructor, isSsl: " << isSsl
@@ -44,103 +48,190 @@ bool Connection::startTcpConnection(const char* aHost, ushort aPort){
         if (!createSslSocket())
             return false;
     } else
-        iSocket = new QTcpSocket();
+        iSocket = new QTcpSocket(this);
 
+    // connect socket and signal
+    // note - Qt::DirectConnection is used because it's multithreaded
+    //        This makes the slot to be invoked immediately, when the signal is emitted.
 
+    // what we don't read stays in the kernel (TCP flow control) rather than in Qt
+    iSocket->setReadBufferSize(NntpProxy::getWriteBufferHigh());
+    connect(iSocket, SIGNAL(bytesWritten(qint64)), this, SLOT(onBytesWritten(qint64)));
 
-    // if server side socket we attach it to the socketDescriptor
-    if (isServerSocket){
-        // Attach the socket to the native descriptor
-        if(!iSocket->setSocketDescriptor(iSocketDescriptor)) {
-            QString err("Setting socket Descriptor: ");
-            err += iSocket->errorString();
-#ifdef LOG_CONNECTION_ERRORS_BEFORE_EMIT_SIGNALS
-            _log(err);
-#endif
-            emit socketError(err);
-            return false;
-        }
-    } else {
+    qRegisterMetaType<QAbstractSocket::SocketError>("SocketError" );
+    connect(iSocket, SIGNAL(error(QAbstractSocket::SocketError)),
+                    this, SLOT(onErrors(QAbstractSocket::SocketError)), Qt::QueuedConnection);
+
+    // Client socket: everything else is driven by the socket signals
+    if (!isServerSocket){
+        connect(iSocket, SIGNAL(connected()), this, SLOT(onSocketConnected()));
+        startHandshakeTimer();
+        iConnectTimer.start();
         iSocket->connectToHost(aHost, aPort);
-        // we need to wait...
-        if(!iSocket->waitForConnected(5000)){
-            QString err("connecting to host: ");
-            err += aHost;
-            err += ":";
-            err += QString::number(aPort);
-            err += ". socket error: ";
-            err += iSocket->errorString();
+        return true;
+    }
+
+    // server side socket we attach it to the socketDescriptor
+    if(!iSocket->setSocketDescriptor(iSocketDescriptor)) {
+        QString err("Setting socket Descriptor: ");
+        err += iSocket->errorString();
 #ifdef LOG_CONNECTION_ERRORS_BEFORE_EMIT_SIGNALS
-            _log(err);
+        _log(err);
 #endif
-            emit socketError(err);
-            return false;
-        }
+        emit socketError(err);
+        return false;
     }
 
-    // connect socket and signal
-    // note - Qt::DirectConnection is used because it's multithreaded
-    //        This makes the slot to be invoked immediately, when the signal is emitted.
-
-    qRegisterMetaType<QAbstractSocket::SocketError>("SocketError" );
     connect(iSocket, SIGNAL(disconnected()), this, SLOT(disconnected()));
-    connect(iSocket, SIGNAL(error(QAbstractSocket::SocketError)),
-                    this, SLOT(onErrors(QAbstractSocket::SocketError)), Qt::QueuedConnection);
 
+    if (isSsl){
+        static_cast<QSslSocket*>(iSocket)->startServerEncryption();
+#ifdef LOG_SSL_STEPS
+        _log("> Encryption handshake started");
+#endif
+    }
+
+    // Server socket send Hello Message and wait for requests
+    iSocket->write(Nntp::getResponse(201));
+
+    _log("> Client Connected");
+
+    emit connected();
+    return true;
+}
+
+void Connection::onSocketConnected(){
+    connect(iSocket, SIGNAL(disconnected()), this, SLOT(disconnected()));
 
     if (isSsl){
-        QSslSocket *ssl_socket = static_cast<QSslSocket*>(iSocket);
-        if (isServerSocket)
-            ssl_socket->startServerEncryption();
-        else
-            ssl_socket->startClientEncryption();
+        static_cast<QSslSocket*>(iSocket)->startClientEncryption();
 #ifdef LOG_SSL_STEPS
-        _log("> Encryption handshake done");
+        _log("> Encryption handshake started");
 #endif
     }
 
+    // on an SSL socket, readyRead is only emitted with decrypted data
+    connect(iSocket, SIGNAL(readyRead()), this, SLOT(readWelcome()), Qt::DirectConnection);
+}
 
-    // If Server socket send Hello Message and wait for requests
-    if (isServerSocket){
-        iSocket->write(Nntp::getResponse(201));
-    } else {
-        do {
-            iSocket->waitForReadyRead();
-        } while (!iSocket->canReadLine());
-        QByteArray lineArr = iSocket->readLine();
-
-        if(strncmp(lineArr.constData(), Nntp::getResponse(200), 3) != 0){
-            QString err("Reading welcome message. Should start with 200... Server message: ");
-            err += lineArr.constData();
+void Connection::readWelcome(){
+    if (!iSocket->canReadLine())
+        return; // wait for the full line
+
+    disconnect(iSocket, SIGNAL(readyRead()), this, SLOT(readWelcome()));
+    stopHandshakeTimer();
+
+    QByteArray lineArr = iSocket->readLine();
+    if(strncmp(lineArr.constData(), Nntp::getResponse(200), 3) != 0){
+        QString err("Reading welcome message. Should start with 200... Server message: ");
+        err += lineArr.constData();
 #ifdef LOG_CONNECTION_ERRORS_BEFORE_EMIT_SIGNALS
-            _log(err);
+        _log(err);
 #endif
-            emit socketError(err);
-            return false;
-        }
+        emit socketError(err);
+        return;
     }
 
-    _log("> Client Connected");
+    _log("> Connected to server");
 
     emit connected();
-    return true;
+}
+
+void Connection::onTimeout(){
+    QString err("Timeout: no answer after ");
+    err += QString::number(NntpProxy::getSocketTimeout());
+    err += " ms";
+#ifdef LOG_CONNECTION_ERRORS_BEFORE_EMIT_SIGNALS
+    _log(err);
+#endif
+    emit socketError(err);
+}
+
+void Connection::startHandshakeTimer(){
+    iTimer->start(NntpProxy::getSocketTimeout());
+}
+
+void Connection::stopHandshakeTimer(){
+    iTimer->stop();
 }
 
 void Connection::startAsyncRead(){
     _log("startAsyncRead");
     connect(iSocket, SIGNAL(readyRead()), this, SLOT(readyRead()), Qt::DirectConnection);
+
+    // data may have been received during the handshakes (pipelined commands)
+    if (iSocket->bytesAvailable() > 0)
+        readyRead();
+}
+
+void Connection::stopAsyncRead(){
+    disconnect(iSocket, SIGNAL(readyRead()), this, SLOT(readyRead()));
 }
 
 void Connection::closeConnection(){
     _log("closeConnection");
-    disconnect(iSocket, SIGNAL(readyRead()), this, SLOT(readyRead()));
+    stopAsyncRead();
+}
+
+void Connection::setOutput(Connection *aOutputCon){
+    if (iOutputCon && iOutputCon != aOutputCon){
+        disconnect(iOutputCon, &Connection::writeBufferDrained, this, &Connection::resumeRead);
+        if (isPaused) // what's buffered goes to the new output (or is dropped)
+            QMetaObject::invokeMethod(this, "resumeRead", Qt::QueuedConnection);
+    }
+    iOutputCon = aOutputCon;
+}
+
+qint64 Connection::getBytesToWrite() const {
+    return iSocket ? iSocket->bytesToWrite() : 0;
+}
+
+qint64 Connection::getBufferedSize() const {
+    if (!iSocket)
+        return 0;
+    return iSocket->bytesAvailable() + iSocket->bytesToWrite();
+}
+
+bool Connection::isWriteBufferFull(){
+    if (getBytesToWrite() < NntpProxy::getWriteBufferHigh())
+        return false;
+
+    isWriteBufferHigh = true;
+    return true;
+}
+
+bool Connection::isOutputFull(){
+    if (!iOutputCon || iOutputCon->getBytesToWrite() < NntpProxy::getWriteBufferHigh())
+        return false;
+
+    if (!isPaused){
+        isPaused = true;
+        iOutputCon->isWriteBufferHigh = true;
+        connect(iOutputCon, &Connection::writeBufferDrained, this, &Connection::resumeRead, Qt::UniqueConnection);
+    }
+    return true;
+}
+
+void Connection::onBytesWritten(qint64 aBytes){
+    Q_UNUSED(aBytes);
+    if (isWriteBufferHigh && iSocket->bytesToWrite() <= NntpProxy::getWriteBufferLow()){
+        isWriteBufferHigh = false;
+        emit writeBufferDrained();
+    }
+}
+
+void Connection::resumeRead(){
+    if (!isPaused)
+        return;
+    isPaused = false;
+    readyRead(); // what has been left in the buffers
 }
 
 
 bool Connection::createSslSocket(){
     _log("SSL socket");
 
-    QSslSocket *ssl_socket = new QSslSocket();
+    QSslSocket *ssl_socket = new QSslSocket(this);
     iSocket = ssl_socket;
 
 
@@ -209,6 +300,7 @@ void Connection::onSslErrors(const QList<QSslError> &errors){
 }
 
 void Connection::onErrors(QAbstractSocket::SocketError) {
+    stopHandshakeTimer();
     QString err("Error Socket: ");
     err += iSocket->errorString();
 #ifdef LOG_CONNECTION_ERRORS_BEFORE_EMIT_SIGNALS
@@ -6,10 +6,12 @@
 
 #include <QObject>
 #include <QTcpSocket>
+#include <QElapsedTimer>
 
 QT_FORWARD_DECLARE_CLASS(QSslSocket)
 QT_FORWARD_DECLARE_CLASS(QSslError)
 QT_FORWARD_DECLARE_CLASS(QByteArray)
+QT_FORWARD_DECLARE_CLASS(QTimer)
 
 
 /*!
@@ -17,6 +19,14 @@ QT_FORWARD_DECLARE_CLASS(QByteArray)
  * Abstract class. Children needs to implement the slots readyRead() and disconnected()
  * and the method closeConnection().
  *
+ * Client connections are fully asynchronous: the TCP connect, the SSL handshake and the
+ * welcome message are driven by the socket signals and end with connected() or socketError()
+ * (iTimer ensures we never wait more than the socket timeout)
+ *
+ * Backpressure: a Child stops reading its socket while the write buffer of iOutputCon is over
+ * the high watermark (isOutputFull) and reads again once it drained under the low one
+ * (writeBufferDrained -> resumeRead). The Qt read buffer is bounded by the high watermark,
+ * so the TCP window of the source closes meanwhile.
  */
 class Connection : public QObject
 {
@@ -42,18 +52,27 @@ public:
     virtual void   closeConnection() = 0; //!< how to close the connection
     inline qintptr getId() const;         //!< Connection id: iSocketDescriptor
     void           startAsyncRead();      //!< connect QTcpSocket::readyRead to local readyRead
+    void           stopAsyncRead();       //!< disconnect QTcpSocket::readyRead from local readyRead
 
     inline void    write(const QByteArray & aBuffer); //!< write on the socket
-    inline void    setOutput(Connection *aOutputCon); //!< set iOutputCon
+    inline void    write(const char *aData, qint64 aLen); //!< write raw data on the socket (no QByteArray)
+    void           setOutput(Connection *aOutputCon); //!< set iOutputCon (and stop waiting for the previous one)
     inline QString getIpAddress() const;              //! return the Peer Ip Address
+    inline qintptr getSocketFd() const;               //!< native descriptor of the real socket
+    inline bool    flush();                           //!< write what is buffered, return if all has been written
+    virtual qint64 getBytesToWrite() const;           //!< bytes queued in the write buffer of the socket
+    virtual qint64 getBufferedSize() const;           //!< bytes held by the connection (socket read and write buffers...)
+    inline bool    isReadPaused() const;              //!< is the reading paused till iOutputCon drains
+    bool           isWriteBufferFull();               //!< is the write buffer over the high watermark (writeBufferDrained emitted once drained)
 
 
 signals:
     void error(QTcpSocket::SocketError socketerror); //!< Socket Error
     void socketError(QString aError);                //!< Error during socket creation (ssl or not)
 
-    void connected(); //!< TCP connection established (good ending of startTcpConnection)
+    void connected(); //!< TCP connection established and welcome message received (async ending of startTcpConnection)
     void closed();    //!< TCP socket is closed
+    void writeBufferDrained(); //!< the write buffer went back under the low watermark after being over the high one
 
 
 public slots:
@@ -65,8 +84,10 @@ public slots:
      * If (aHost, aPort) are given, it's a client connection
      * Else it's a server connection that will be attached to the descriptor
      * Depending on isSsl, the connection will be encrypted
+     * For a client connection, the method returns immediately
+     * and connected() is emitted once the welcome message is received
      *
-     *  \return if the TCP connection is established
+     *  \return false if the connection couldn't be started
      */
     bool startTcpConnection(const char* aHost = NULL, ushort aPort = 0);
 
@@ -74,12 +95,25 @@ public slots:
     void onSslErrors(const QList<QSslError> &errors); //!< SSL errors handler
     void onErrors(QAbstractSocket::SocketError);      //!< Socket errors handler
 
+    void onSocketConnected(); //!< client socket connected: start SSL handshake and wait for the welcome message
+    void readWelcome();       //!< read the welcome message of the server (200)
+    void onTimeout();         //!< iTimer expired before the end of a handshake
+
+    void onBytesWritten(qint64 aBytes); //!< emit writeBufferDrained once under the low watermark
+    void resumeRead();                  //!< iOutputCon drained: read again (connects to &Connection::writeBufferDrained)
+
 protected:
     inline void _log(const QString &     aMessage) const; //!< log function for QString
     inline void _log(const char*         aMessage) const; //!< log function for char *
     inline void _log(const std::string & aMessage) const; //!< log function for std::string
 
 
+    void startHandshakeTimer(); //!< (re)start iTimer with the socket timeout of the proxy
+    void stopHandshakeTimer();  //!< stop iTimer (handshake step done)
+
+    //! is the write buffer of iOutputCon over the high watermark (the reading is then paused till it drains)
+    bool isOutputFull();
+
 private:
     bool createSslSocket(); //!< Create an SSL connection over the QTcpSocket
 
@@ -89,18 +123,32 @@ protected:
     bool        isServerSocket;    //!< server socket or client socket?
     QTcpSocket *iSocket;           //!< Real TCP socket
     Connection *iOutputCon;        //!< Connection where what's read on the socket is forwarded
+    QTimer     *iTimer;            //!< Timeout of the asynchronous handshakes (owns it)
+    bool        isWriteBufferHigh; //!< has the write buffer gone over the high watermark (writeBufferDrained to emit)
+    bool        isPaused;          //!< reading paused till iOutputCon drains
+    QElapsedTimer iConnectTimer;   //!< started by startTcpConnection (client sockets): time base of the connection
     QString     iLogPrefix;        //!< log prefix: Connection[<iSocketDescriptor>]
 };
 
 
 qintptr Connection::getId() const { return iSocketDescriptor;}
 
-void Connection::setOutput(Connection *aOutputCon){iOutputCon = aOutputCon;}
-
 void Connection::write(const QByteArray & aBuffer){iSocket->write(aBuffer);}
 
+void Connection::write(const char *aData, qint64 aLen){iSocket->write(aData, aLen);}
+
 QString Connection::getIpAddress() const {return iSocket->peerAddress().toString();}
 
+qintptr Connection::getSocketFd() const {return iSocket->socketDescriptor();}
+
+bool Connection::flush(){
+    iSocket->flush();
+    return iSocket->bytesToWrite() == 0;
+}
+
+
+bool Connection::isReadPaused() const {return isPaused;}
+
 void Connection::_log(const char* aMessage) const {
      NntpProxy::log(iLogPrefix, aMessage);
 }
@@ -3,6 +3,7 @@
 
 #include <iostream>
 #include <QString>
+#include <QStringList>
 
 #include <QtGlobal> // ushort...
 
@@ -38,6 +39,50 @@ static const ushort    cDefaultPortNntp      = 119;
 static const ushort    cDefaultPortMonitor   = 1111;
 static const ushort    cDefaultSocketTimeout = 5000;
 static const ushort    cDefaultMaxConPerUser = 3;
+static const ushort    cDefaultNbWorkers     = 0; // 0: one Worker Thread per core
+static const bool      cUseReusePort         = false;
+static const ushort    cDefaultStatsInterval = 60; // seconds, 0: no stats
+static const ushort    cDefaultPoolIdleTimeout = 50; // seconds an idle NntpConnection stays in the pool, 0: no pool
+static const ushort    cDefaultPipelineWindow = 8; // max client commands in flight on a NntpConnection
+static const bool      cUseMultiplexing      = false;
+static const bool      cUseSplice            = false; // Linux only, plaintext client and server
+static const bool      cUseCoalescing        = true;  // concurrent fetches of the same article share one backend response
+static const bool      cUseFailover          = true;  // an article missing on a server (430/423) is asked to the next ones
+static const ushort    cDefaultServerPriority = 0;    // tier of a server in the failover order (lowest first)
+static const ushort    cMaxNntpServers        = 32;  // servers active at once (slots of the per User connection counters)
+static const ushort    cDefaultMissingIndexSize = 256; // KB per server of message-ids known missing on it, 0: no index
+static const double    cDefaultMissingIndexFpr  = 0.01; // target false positive rate of the missing index
+static const ushort    cDefaultAdmissionQueueSize = 64; // sessions waiting for a NntpConnection when all in use, 0: 502 at once
+static const ushort    cDefaultAdmissionTimeout   = 15; // seconds a session waits for a NntpConnection before its 502
+static const bool      cUseShaping           = true;  // token buckets per user (class) and per IP on the responses forwarded
+static const uint      cDefaultShapingBurst  = 1024;  // KB a user or an IP can get at once after an idle period
+static const qint64    cShapingChunk         = 16384; // smallest grant of a token bucket (bytes), a flow waits for it
+static const constexpr char* cDefaultUserClass = "default"; // class of the users not listed in any class
+static const uint      cDefaultServerRate    = 0;     // KB/s ceiling of the reads on all the connections of a server, 0: none
+static const qint64    cReadGrantInterval    = 10;    // ms of the ceiling of a server granted at once to a waiting connection
+static const ushort    cBandwidthSampleInterval = 1000; // ms between two throughput samples of a server
+static const bool      cUseServerScoring     = true;  // weight the server selection by the measured performance of the servers
+static const double    cScoreEwmaAlpha       = 0.2;   // weight of a new sample in the moving averages of a server
+static const qint64    cScoreArticleSize     = 786432; // reference article (bytes) of the expected time of a server
+static const qint64    cScoreMinTransferSize = 65536;  // smallest response giving a throughput sample
+static const qint64    cForwardBufferSize    = 131072; // ring buffer of a NntpConnection to forward the responses in chunks
+static const ushort    cDefaultWriteBufferHigh = 512; // KB queued on a socket before pausing the reading of its source
+static const ushort    cDefaultWriteBufferLow  = 128; // KB queued on a socket under which its source is read again
+static const ushort    cDefaultArticleCacheSize = 0;  // MB of article responses cached in memory, 0: no cache
+static const ushort    cArticleCacheShards     = 16;  // independent locks of the article cache
+static const qint64    cArticleCacheMaxArticle = 8388608; // bigger responses are not cached
+static const ushort    cDefaultArticleStoreSegmentSize = 256; // MB, size of a segment file of the article store
+static const ushort    cDefaultArticleStoreSegments    = 16;  // max number of segment files (oldest evicted first)
+static const int       cArticleStoreMaxKey     = 512;  // max size of a key (message-id) in the article store
+static const ushort    cDefaultHotWindow       = 60;   // seconds of a window of the hot tracker
+static const ushort    cDefaultHotWindows      = 5;    // windows of the sliding window of the hot tracker
+static const int       cHotSketchWidth         = 4096; // counters per row of a count-min sketch
+static const int       cHotSketchDepth         = 4;    // rows (hashes) of a count-min sketch
+static const int       cHotTopK                = 100;  // keys monitored per window and dimension
+static const int       cHotQueueSize           = 8192; // events queued per Worker for the hot tracker (power of 2)
+static const ushort    cHotDrainInterval       = 100;  // ms between two drains of the hot tracker queues
+static const ushort    cMuxRetryDelay        = 100;  // ms before retrying to get a backend connection
+static const ushort    cMuxBackendIdleTimeout = 5;   // seconds before an idle backend goes back to the server pool
 static const bool      cIsClientSSL          = false;
 static const bool      cUseMonitorServer     = false;
 
@@ -56,26 +101,40 @@ struct NntpServerParameters{
     QString pass;
     ushort  maxConnections;
     bool    ssl;
+    ushort  poolIdleTimeout;
+    ushort  priority; // tier in the failover order (lowest first)
+    bool    fill;     // block account: only used when the primary servers miss an article
+    uint    maxRate;  // KB/s ceiling of the reads on all its connections (0: none)
 
     NntpServerParameters():
-       name(""), port(119), auth(false), login(""), pass(""), maxConnections(1), ssl(false)
+       name(""), port(119), auth(false), login(""), pass(""), maxConnections(1), ssl(false),
+       poolIdleTimeout(cDefaultPoolIdleTimeout), priority(cDefaultServerPriority), fill(false),
+       maxRate(cDefaultServerRate)
     {}
 
     NntpServerParameters(const char * aName, ushort aPort = 119, bool aAuth = false,
                          const char * aLogin = "", const char *aPass = "",
-                         ushort aMaxCon = 1, bool aSsl = false):
+                         ushort aMaxCon = 1, bool aSsl = false,
+                         ushort aPoolIdleTimeout = cDefaultPoolIdleTimeout,
+                         ushort aPriority = cDefaultServerPriority, bool aFill = false,
+                         uint aMaxRate = cDefaultServerRate):
        name(aName), port(aPort), auth(aAuth), login(aLogin),
-       pass(aPass), maxConnections(aMaxCon), ssl(aSsl)
+       pass(aPass), maxConnections(aMaxCon), ssl(aSsl), poolIdleTimeout(aPoolIdleTimeout),
+       priority(aPriority), fill(aFill), maxRate(aMaxRate)
     {}
 
     NntpServerParameters(const NntpServerParameters& aParams):
         name(aParams.name), port(aParams.port), auth(aParams.auth), login(aParams.login),
-        pass(aParams.pass), maxConnections(aParams.maxConnections), ssl(aParams.ssl)
+        pass(aParams.pass), maxConnections(aParams.maxConnections), ssl(aParams.ssl),
+        poolIdleTimeout(aParams.poolIdleTimeout), priority(aParams.priority), fill(aParams.fill),
+        maxRate(aParams.maxRate)
     {}
 
     NntpServerParameters(NntpServerParameters&& aParams):
         name(std::move(aParams.name)), port(aParams.port), auth(aParams.auth), login(std::move(aParams.login)),
-        pass(std::move(aParams.pass)), maxConnections(aParams.maxConnections), ssl(aParams.ssl)
+        pass(std::move(aParams.pass)), maxConnections(aParams.maxConnections), ssl(aParams.ssl),
+        poolIdleTimeout(aParams.poolIdleTimeout), priority(aParams.priority), fill(aParams.fill),
+        maxRate(aParams.maxRate)
     {}
 
 };
@@ -110,11 +169,29 @@ struct DatabaseParameters{
     {}
 };
 
+struct UserClassParameters{
+    QString     name;
+    uint        rate;  // KB/s per user, 0: unlimited
+    uint        burst; // KB
+    QStringList users; // logins of the class
+
+    UserClassParameters():
+        name(cDefaultUserClass), rate(0), burst(cDefaultShapingBurst), users()
+    {}
+
+    UserClassParameters(const char *aName, uint aRate, uint aBurst = cDefaultShapingBurst,
+                        const QStringList &aUsers = QStringList()):
+        name(aName), rate(aRate), burst(aBurst), users(aUsers)
+    {}
+};
+
 std::ostream &  operator<<(std::ostream &stream, const QString &str);
 
 std::ostream & operator<<(std::ostream &stream, const NntpServerParameters & p);
 
 std::ostream & operator<<(std::ostream &stream, const DatabaseParameters & p);
 
+std::ostream & operator<<(std::ostream &stream, const UserClassParameters & p);
+
 #endif // NNTPSERVERPARAMETERS
 
@@ -0,0 +1,60 @@
+#include "countminsketch.h"
+
+#include <cstring>
+
+CountMinSketch::CountMinSketch(int aWidth, int aDepth):
+    iWidth(roundWidth(aWidth)), iDepth(aDepth > 0 ? aDepth : 1),
+    iMask(static_cast<quint32>(iWidth - 1)),
+    iCounters(new quint32[static_cast<size_t>(iWidth) * iDepth]), iTotal(0)
+{
+    clear();
+}
+
+CountMinSketch::~CountMinSketch(){
+    delete[] iCounters;
+}
+
+int CountMinSketch::roundWidth(int aWidth){
+    int width = 1;
+    while (width < aWidth)
+        width <<= 1;
+    return width;
+}
+
+quint64 CountMinSketch::hash(const QByteArray &aKey){
+    quint64 hash = 14695981039346656037ULL;
+    for (int i = 0; i < aKey.size(); ++i){
+        hash ^= static_cast<uchar>(aKey.at(i));
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+quint32 CountMinSketch::add(const QByteArray &aKey, quint32 aCount){
+    quint64 h   = hash(aKey);
+    quint32 min = 0xFFFFFFFF;
+    for (int row = 0; row < iDepth; ++row)
+        min = qMin(min, iCounters[getIndex(row, h)]);
+
+    quint32 target = (min > 0xFFFFFFFF - aCount) ? 0xFFFFFFFF : min + aCount;
+    for (int row = 0; row < iDepth; ++row){
+        quint32 &counter = iCounters[getIndex(row, h)];
+        if (counter < target)
+            counter = target;
+    }
+    iTotal += aCount;
+    return target;
+}
+
+quint32 CountMinSketch::estimate(const QByteArray &aKey) const {
+    quint64 h   = hash(aKey);
+    quint32 min = 0xFFFFFFFF;
+    for (int row = 0; row < iDepth; ++row)
+        min = qMin(min, iCounters[getIndex(row, h)]);
+    return min;
+}
+
+void CountMinSketch::clear(){
+    memset(iCounters, 0, static_cast<size_t>(iWidth) * iDepth * sizeof(quint32));
+    iTotal = 0;
+}
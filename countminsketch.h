@@ -0,0 +1,67 @@
+#ifndef COUNTMINSKETCH_H
+#define COUNTMINSKETCH_H
+
+#include "constants.h"
+
+#include <QByteArray>
+
+/*!
+ * \brief Count-Min sketch: approximate counts of a stream of keys in a fixed memory
+ * - aDepth rows of aWidth counters (width rounded up to a power of 2)
+ * - a key increments one counter per row, its estimate is the smallest of them
+ * - the estimate never under-counts, it over-counts by at most total * e / width
+ *   with a probability 1 - exp(-depth)
+ * - conservative update: only the counters under the new estimate are raised
+ * - not Thread_Safe (one HotTracker thread)
+ */
+class CountMinSketch
+{
+public:
+    /*!
+     * \brief CountMinSketch constructor
+     * \param aWidth : counters per row
+     * \param aDepth : number of rows (independent hashes)
+     */
+    explicit CountMinSketch(int aWidth = cHotSketchWidth, int aDepth = cHotSketchDepth);
+    ~CountMinSketch();
+    CountMinSketch(const CountMinSketch &)              = delete;
+    CountMinSketch(const CountMinSketch &&)             = delete;
+    CountMinSketch & operator=(const CountMinSketch &)  = delete;
+    CountMinSketch & operator=(const CountMinSketch &&) = delete;
+
+    quint32 add(const QByteArray &aKey, quint32 aCount = 1); //!< count aKey, return its new estimate
+    quint32 estimate(const QByteArray &aKey) const;          //!< approximate count of aKey
+    void    clear();                                         //!< reset all the counters
+
+    inline int     getWidth() const;      //!< counters per row
+    inline int     getDepth() const;      //!< number of rows
+    inline quint64 getTotal() const;      //!< sum of all the counts added
+    inline qint64  getMemorySize() const; //!< bytes used by the counters
+
+private:
+    static quint64 hash(const QByteArray &aKey); //!< FNV-1a 64 bits
+    static int     roundWidth(int aWidth);       //!< next power of 2
+    inline quint32 getIndex(int aRow, quint64 aHash) const; //!< counter of a row (double hashing)
+
+private:
+    const int     iWidth;    //!< counters per row (power of 2)
+    const int     iDepth;    //!< number of rows
+    const quint32 iMask;     //!< iWidth - 1
+    quint32      *iCounters; //!< the iDepth rows (owns them)
+    quint64       iTotal;    //!< sum of all the counts added
+};
+
+int     CountMinSketch::getWidth() const {return iWidth;}
+int     CountMinSketch::getDepth() const {return iDepth;}
+quint64 CountMinSketch::getTotal() const {return iTotal;}
+qint64  CountMinSketch::getMemorySize() const {
+    return static_cast<qint64>(iWidth) * iDepth * sizeof(quint32);
+}
+
+quint32 CountMinSketch::getIndex(int aRow, quint64 aHash) const {
+    quint32 h1 = static_cast<quint32>(aHash);
+    quint32 h2 = static_cast<quint32>(aHash >> 32) | 1;
+    return static_cast<quint32>(aRow) * iWidth + ((h1 + aRow * h2) & iMask);
+}
+
+#endif // COUNTMINSKETCH_H
@@ -0,0 +1,169 @@
+#include "failover.h"
+#include "nntpservermanager.h"
+#include "nntpconnection.h"
+#include "singleflight.h"
+#include "articlecache.h"
+#include "nntp.h"
+
+Failover::Failover(qintptr aId, NntpServerManager &aSrvMgr, Connection *aClient,
+                   const QByteArray &aCmd, const QByteArray &aStatusLine,
+                   ushort aServerId, Flight *aFlight):
+    QObject(), iId(aId), iSrvMgr(aSrvMgr), iClient(aClient),
+    iCmd(aCmd), iMessageId(getMessageId(aCmd)), iStatusLine(aStatusLine), iTried(), iFlight(aFlight), iCon(Q_NULLPTR),
+    iLogPrefix(QString("Failover").append("[").append(QString::number(iId)).append("] "))
+{
+    iTried.append(aServerId);
+    iSrvMgr.addMissing(aServerId, iMessageId);
+}
+
+Failover::~Failover(){
+    if (iCon)
+        giveBackConnection(false);
+
+    if (iFlight){
+        iFlight->finish(false);
+        iFlight->deref();
+    }
+}
+
+bool Failover::canFailover(const QByteArray &aCmd){
+    if (!NntpProxy::useFailover())
+        return false;
+
+    const char *cmd = aCmd.constData();
+    if (!Nntp::isMessageIdCommand(cmd))
+        return false; // the article numbers are specific to each server
+
+    return Nntp::isCommand(cmd, "ARTICLE") || Nntp::isCommand(cmd, "BODY")
+            || Nntp::isCommand(cmd, "HEAD") || Nntp::isCommand(cmd, "STAT");
+}
+
+bool Failover::isMissing(const QByteArray &aStatusLine){
+    ushort code = Nntp::getResponseCode(aStatusLine.constData());
+    return code == 430 || code == 423;
+}
+
+QByteArray Failover::getMessageId(const QByteArray &aCmd){
+    int start = aCmd.indexOf('<');
+    if (start == -1)
+        return QByteArray();
+    int end = aCmd.indexOf('>', start);
+    if (end == -1)
+        return QByteArray();
+    return aCmd.mid(start, end - start + 1);
+}
+
+void Failover::start(){
+    iCon = iSrvMgr.getFailoverNntpConnection(iId, iTried, iMessageId);
+    if (iCon == Q_NULLPTR){
+        giveUp();
+        return;
+    }
+
+    iTried.append(iCon->getServerId());
+
+    QString str("Article missing, asking the server ");
+    str += iCon->getServerHost();
+    str += " (try ";
+    str += QString::number(iTried.size());
+    str += ")";
+    _log(str);
+
+    connect(iCon, &NntpConnection::responseDone,   this, &Failover::backendResponseDone);
+    connect(iCon, &NntpConnection::articleMissing, this, &Failover::backendArticleMissing);
+    connect(iCon, &NntpConnection::closed,         this, &Failover::backendClosed);
+    connect(iCon, &Connection::socketError,        this, &Failover::backendError);
+
+    // Connection from the warm pool of the server: ready to use
+    if (iCon->isAuthenticated()){
+        sendCommand();
+        return;
+    }
+
+    connect(iCon, &NntpConnection::authenticated, this, &Failover::backendAuthenticated);
+    if (!iCon->startTcpConnection(iCon->getServerHost().toStdString().c_str(), iCon->getServerPort())){
+        _log("Error starting a failover connection...");
+        backendLost();
+    }
+}
+
+void Failover::sendCommand(){
+    iCon->setOutput(iClient);
+    iCon->startAsyncRead();
+    iCon->sendCommand(iCmd, iFlight, true);
+    iFlight = Q_NULLPTR; // the connection holds it
+}
+
+void Failover::backendAuthenticated(){
+    sendCommand();
+}
+
+void Failover::backendResponseDone(QByteArray aCmd, QByteArray aStatusLine, qint64 aSize){
+    if (ArticleCache::isArticleResponse(aStatusLine) || Nntp::getResponseCode(aStatusLine.constData()) == 223)
+        iSrvMgr.addRescued(iCon->getServerId());
+
+    giveBackConnection(true);
+    emit done(aCmd, aStatusLine, aSize);
+}
+
+void Failover::backendArticleMissing(QByteArray aCmd, QByteArray aStatusLine, Flight *aFlight){
+    Q_UNUSED(aCmd);
+    iStatusLine = aStatusLine;
+    iFlight     = aFlight;
+    iSrvMgr.addMissing(iCon->getServerId(), iMessageId);
+
+    giveBackConnection(true);
+    start();
+}
+
+void Failover::backendClosed(){
+    _log("Failover connection closed");
+    backendLost();
+}
+
+void Failover::backendError(QString aError){
+    QString str("Failover connection error: ");
+    str += aError;
+    _log(str);
+    backendLost();
+}
+
+void Failover::backendLost(){
+    bool isStarted = iCon->hasResponseStarted();
+    giveBackConnection(false);
+
+    if (isStarted)
+        emit failed(); // the client may have got a part of the response
+    else
+        start();
+}
+
+void Failover::giveBackConnection(bool aRecycle){
+    NntpConnection *con = iCon;
+    iCon = Q_NULLPTR;
+
+    con->disconnect(this);
+    con->setOutput(Q_NULLPTR);
+    if (aRecycle && iSrvMgr.recycleNntpConnection(con))
+        return; // the pool of the server owns it now
+
+    iSrvMgr.releaseNntpConnection(con);
+    con->deleteLater(); // we may be in one of its signals
+}
+
+void Failover::giveUp(){
+    QString str("Article missing on all the servers tried (");
+    str += QString::number(iTried.size());
+    str += ")";
+    _log(str);
+
+    iClient->write(iStatusLine);
+    if (iFlight){
+        // the followers get the same answer
+        iFlight->append(iStatusLine.constData(), iStatusLine.size());
+        iFlight->finish(true);
+        iFlight->deref();
+        iFlight = Q_NULLPTR;
+    }
+    emit done(iCmd, iStatusLine, iStatusLine.size());
+}
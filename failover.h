@@ -0,0 +1,113 @@
+#ifndef FAILOVER_H
+#define FAILOVER_H
+
+#include "constants.h"
+#include "nntpproxy.h"
+
+#include <QObject>
+#include <QByteArray>
+#include <QList>
+
+QT_FORWARD_DECLARE_CLASS(Connection)
+QT_FORWARD_DECLARE_CLASS(NntpConnection)
+QT_FORWARD_DECLARE_CLASS(NntpServerManager)
+QT_FORWARD_DECLARE_CLASS(Flight)
+
+/*!
+ * \brief Failover of an article command by message-id that got a 430/423 from its server
+ * - the next servers are asked in the failover order of the NntpServerManager
+ *   (primary servers then fill ones, by priority), each one at most once
+ * - the connections are borrowed from the servers (warm pool first, no User accounting)
+ *   and given back to their pool once the response is done
+ * - the first response that isn't missing is forwarded to the client (done)
+ *   if no server has the article, the client gets the last 430/423 (done)
+ * - each server that hasn't the article records its message-id in its missing index
+ *   and the servers whose index has it are not asked (cf NntpServer::isKnownMissing)
+ * - the Flight of the command (followers of the article) goes along with the retries
+ * - lives in the thread of its owner (SessionHandler or NntpMultiplexer) that deletes it after done() or failed()
+ */
+class Failover : public QObject
+{
+    Q_OBJECT
+
+public:
+    /*!
+     * \brief Failover constructor
+     * \param aId         : id of the session (used for log purposes and as id of the connections)
+     * \param aSrvMgr     : handle on the NntpServerManager to borrow the connections
+     * \param aClient     : client connection where the response is written (not owned)
+     * \param aCmd        : article command
+     * \param aStatusLine : 430/423 status line of the first server
+     * \param aServerId   : first server (that doesn't have the article)
+     * \param aFlight     : Flight of the command (takes the reference, Q_NULLPTR if none)
+     */
+    explicit Failover(qintptr aId, NntpServerManager &aSrvMgr, Connection *aClient,
+                      const QByteArray &aCmd, const QByteArray &aStatusLine,
+                      ushort aServerId, Flight *aFlight);
+    Failover(const Failover &)              = delete;
+    Failover(const Failover &&)             = delete;
+    Failover & operator=(const Failover &)  = delete;
+    Failover & operator=(const Failover &&) = delete;
+
+    ~Failover(); //!< give back the connection in use, fail the Flight if not done
+
+    static bool canFailover(const QByteArray &aCmd);      //!< ARTICLE/BODY/HEAD/STAT by message-id (and failover enabled)
+    static bool isMissing(const QByteArray &aStatusLine); //!< is the status line a 430 or a 423
+    static QByteArray getMessageId(const QByteArray &aCmd); //!< <message-id> of the command (empty if none)
+
+    void start(); //!< ask the next server
+
+    inline const QByteArray &getCommand() const; //!< article command
+    inline int getNumberOfTries() const;         //!< servers asked so far (the first one included)
+
+signals:
+    /*!
+     * \brief the response has been written to the client (the article or the last 430/423)
+     * \param aCmd        : the command
+     * \param aStatusLine : status line written to the client
+     * \param aSize       : size of the response written to the client
+     */
+    void done(QByteArray aCmd, QByteArray aStatusLine, qint64 aSize);
+    void failed(); //!< connection lost in the middle of the response (the client got a part of it)
+
+public slots:
+    void backendAuthenticated(); //!< connects to &NntpConnection::authenticated
+    void backendResponseDone(QByteArray aCmd, QByteArray aStatusLine, qint64 aSize); //!< connects to &NntpConnection::responseDone
+    void backendArticleMissing(QByteArray aCmd, QByteArray aStatusLine, Flight *aFlight); //!< connects to &NntpConnection::articleMissing
+    void backendClosed();                //!< connects to &NntpConnection::closed
+    void backendError(QString aError);   //!< connects to &Connection::socketError
+
+private:
+    inline void _log(const QString & aMessage) const; //!< Add a log line
+    inline void _log(const char*     aMessage) const; //!< Add a log line
+
+    void sendCommand();                    //!< send the command on the authenticated connection
+    void giveBackConnection(bool aRecycle); //!< back to the pool of its server (aRecycle) or released and deleted
+    void backendLost();                    //!< the connection failed: next server or failed()
+    void giveUp();                         //!< no server left: write the last status line to the client
+
+private:
+    const qintptr       iId;         //!< id of the session
+    NntpServerManager & iSrvMgr;     //!< handle on the NntpServerManager
+    Connection        * iClient;     //!< client connection (not owned)
+    const QByteArray    iCmd;        //!< article command
+    const QByteArray    iMessageId;  //!< message-id of the article
+    QByteArray          iStatusLine; //!< last 430/423 status line received
+    QList<ushort>       iTried;      //!< servers already asked
+    Flight            * iFlight;     //!< Flight of the command while no connection holds it (holds the reference)
+    NntpConnection    * iCon;        //!< connection to the server being asked (owned till given back)
+    const QString       iLogPrefix;  //!< log prefix
+};
+
+const QByteArray &Failover::getCommand() const {return iCmd;}
+int Failover::getNumberOfTries() const {return iTried.size();}
+
+void Failover::_log(const char* aMessage) const {
+     NntpProxy::log(iLogPrefix, aMessage);
+}
+
+void Failover::_log(const QString & aMessage) const {
+     NntpProxy::log(iLogPrefix, aMessage);
+}
+
+#endif // FAILOVER_H
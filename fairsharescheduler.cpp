@@ -0,0 +1,210 @@
+#include "fairsharescheduler.h"
+
+#include <QObject>
+#include <QMutexLocker>
+#include <QTextStream>
+
+FairShareScheduler::FairShareScheduler():
+    iMutex(), iShares(), iSessions(), iRequests(), iVictims(),
+    iNbRequests(0), iNbGrants(0), iNbRefusals(0)
+{}
+
+int FairShareScheduler::getShare_noLock(int aMaxConnections) const {
+    return iShares.isEmpty() ? aMaxConnections : aMaxConnections / iShares.size();
+}
+
+void FairShareScheduler::releaseShare_noLock(User *aUser){
+    auto it = iShares.find(aUser);
+    if (it != iShares.end() && it.value().forwarding.isEmpty() && it.value().nbIncoming <= 0)
+        iShares.erase(it);
+}
+
+void FairShareScheduler::addForwarding(QObject *aSession, User *aUser){
+    QMutexLocker lock(&iMutex);
+    iShares[aUser].forwarding.append(aSession);
+    iSessions.insert(aSession, aUser);
+}
+
+void FairShareScheduler::removeForwarding(QObject *aSession){
+    QMutexLocker lock(&iMutex);
+    auto it = iSessions.find(aSession);
+    if (it == iSessions.end())
+        return;
+
+    User *user = it.value();
+    iSessions.erase(it);
+    iShares[user].forwarding.removeOne(aSession);
+    releaseShare_noLock(user);
+}
+
+bool FairShareScheduler::requestNntpConnection(QObject *aSession, User *aUser, qintptr aInputConId, int aMaxConnections){
+    iNbRequests.fetchAndAddRelaxed(1);
+
+    QMutexLocker lock(&iMutex);
+    Share &share = iShares[aUser]; // the user counts in the share from now
+    int nbCons   = share.forwarding.size() + share.nbIncoming;
+    int fair     = getShare_noLock(aMaxConnections);
+    if (nbCons >= fair){
+        releaseShare_noLock(aUser);
+        iNbRefusals.fetchAndAddRelaxed(1);
+        _log(QString("The user already has its fair share of connections: %1").arg(fair));
+        return false;
+    }
+
+    ++share.nbIncoming;
+    Request request = {aUser, Q_NULLPTR, aInputConId, aMaxConnections, Q_NULLPTR, Q_NULLPTR};
+    if (!findVictim_noLock(aSession, request)){
+        --iShares[aUser].nbIncoming;
+        releaseShare_noLock(aUser);
+        iNbRefusals.fetchAndAddRelaxed(1);
+        _log(QString("There is no user with more connections than the fair share: %1").arg(fair));
+        return false;
+    }
+
+    iRequests.insert(aSession, request);
+    return true;
+}
+
+bool FairShareScheduler::findVictim_noLock(QObject *aRequester, Request &aRequest){
+    // the user the most above its share (the share may have changed since the request)
+    int   maxCons    = getShare_noLock(aRequest.maxCons);
+    User *victimUser = Q_NULLPTR;
+    for (auto it = iShares.cbegin(); it != iShares.cend(); ++it){
+        if (it.key() != aRequest.user && it.value().forwarding.size() > maxCons){
+            maxCons    = it.value().forwarding.size();
+            victimUser = it.key();
+        }
+    }
+    if (victimUser == Q_NULLPTR)
+        return false;
+
+    // its oldest session yields (it's not a candidate anymore)
+    QObject *victim = iShares[victimUser].forwarding.takeFirst();
+    iSessions.remove(victim);
+    releaseShare_noLock(victimUser);
+
+    aRequest.victim     = victim;
+    aRequest.victimUser = victimUser;
+    iVictims.insert(victim, aRequester);
+    QMetaObject::invokeMethod(victim, "yieldNntpConnection", Qt::QueuedConnection);
+
+    _log(QString("A session of a user with %1 connections is asked to yield one").arg(maxCons));
+    return true;
+}
+
+void FairShareScheduler::refuse_noLock(QObject *aRequester){
+    Request request = iRequests.take(aRequester);
+    --iShares[request.user].nbIncoming;
+    releaseShare_noLock(request.user);
+    iNbRefusals.fetchAndAddRelaxed(1);
+    QMetaObject::invokeMethod(aRequester, "nntpConnectionRefused", Qt::QueuedConnection);
+}
+
+bool FairShareScheduler::startYield(QObject *aVictim, qintptr &aInputConId){
+    QMutexLocker lock(&iMutex);
+    auto it = iVictims.find(aVictim);
+    if (it == iVictims.end())
+        return false;
+
+    aInputConId = iRequests[it.value()].inputConId;
+    return true;
+}
+
+bool FairShareScheduler::yielded(QObject *aVictim, NntpConnection *aCon){
+    QMutexLocker lock(&iMutex);
+    auto it = iVictims.find(aVictim);
+    if (it == iVictims.end())
+        return false;
+
+    QObject *requester = it.value();
+    iVictims.erase(it);
+
+    Request &request = iRequests[requester];
+    request.victim   = Q_NULLPTR;
+    request.con      = aCon;
+    iNbGrants.fetchAndAddRelaxed(1);
+    QMetaObject::invokeMethod(requester, "nntpConnectionGranted", Qt::QueuedConnection);
+    return true;
+}
+
+void FairShareScheduler::yieldFailed(QObject *aVictim){
+    QMutexLocker lock(&iMutex);
+    auto it = iVictims.find(aVictim);
+    if (it == iVictims.end())
+        return;
+
+    QObject *requester = it.value();
+    iVictims.erase(it);
+
+    Request &request = iRequests[requester];
+    request.victim   = Q_NULLPTR;
+    if (!findVictim_noLock(requester, request))
+        refuse_noLock(requester);
+}
+
+NntpConnection *FairShareScheduler::takeGranted(QObject *aSession){
+    QMutexLocker lock(&iMutex);
+    auto it = iRequests.find(aSession);
+    if (it == iRequests.end() || it.value().con == Q_NULLPTR)
+        return Q_NULLPTR;
+
+    NntpConnection *con = it.value().con;
+    User *user          = it.value().user;
+    iRequests.erase(it);
+    --iShares[user].nbIncoming;
+    releaseShare_noLock(user);
+    return con;
+}
+
+NntpConnection *FairShareScheduler::removeSession(QObject *aSession){
+    QMutexLocker lock(&iMutex);
+
+    // forwarding: not a candidate anymore
+    auto itSession = iSessions.find(aSession);
+    if (itSession != iSessions.end()){
+        User *user = itSession.value();
+        iSessions.erase(itSession);
+        iShares[user].forwarding.removeOne(aSession);
+        releaseShare_noLock(user);
+    }
+
+    // victim: it won't yield, its requester goes on with another one
+    auto itVictim = iVictims.find(aSession);
+    if (itVictim != iVictims.end()){
+        QObject *requester = itVictim.value();
+        iVictims.erase(itVictim);
+
+        Request &request = iRequests[requester];
+        request.victim   = Q_NULLPTR;
+        if (!findVictim_noLock(requester, request))
+            refuse_noLock(requester);
+    }
+
+    // requester: its victim keeps its connection
+    NntpConnection *con = Q_NULLPTR;
+    auto itRequest = iRequests.find(aSession);
+    if (itRequest != iRequests.end()){
+        Request request = itRequest.value();
+        iRequests.erase(itRequest);
+        if (request.victim){
+            iVictims.remove(request.victim);
+            iShares[request.victimUser].forwarding.append(request.victim);
+            iSessions.insert(request.victim, request.victimUser);
+        }
+        con = request.con;
+        --iShares[request.user].nbIncoming;
+        releaseShare_noLock(request.user);
+    }
+    return con;
+}
+
+int FairShareScheduler::getNumberOfUsers(){
+    QMutexLocker lock(&iMutex);
+    return iShares.size();
+}
+
+void FairShareScheduler::dump(QTextStream &aStream){
+    aStream << "Fair share: " << getNumberOfUsers() << " users, "
+            << getNumberOfRequests() << " requests, " << getNumberOfGrants() << " granted, "
+            << getNumberOfRefusals() << " refused\n";
+}
@@ -0,0 +1,112 @@
+#ifndef FAIRSHARESCHEDULER_H
+#define FAIRSHARESCHEDULER_H
+
+#include "constants.h"
+#include "nntpproxy.h"
+
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QAtomicInteger>
+
+QT_FORWARD_DECLARE_CLASS(QObject)
+QT_FORWARD_DECLARE_CLASS(QTextStream)
+QT_FORWARD_DECLARE_CLASS(User)
+QT_FORWARD_DECLARE_CLASS(NntpConnection)
+
+/*!
+ * \brief Fair share of the NntpConnections between the users once they're all in use (Thread_Safe)
+ * - the fair share of a user is the max number of connections divided by the number of users
+ *   (users with a session forwarding or waiting for a connection), kept incrementally
+ * - a session that can't get a connection asks for one (requestNntpConnection): if its user is under
+ *   its share, a forwarding session of the user the most above its share is asked to yield its own
+ * - everything is done by message passing (queued calls of the slots of the sessions, any thread):
+ *     victim:    yieldNntpConnection()   -> startYield, takes over its slot, yielded (or yieldFailed)
+ *     requester: nntpConnectionGranted() -> takeGranted (pulls the connection to its thread)
+ *                nntpConnectionRefused() -> no victim left
+ * - iMutex is only held to update the bookkeeping, never across a wait or a call to a session
+ */
+class FairShareScheduler
+{
+public:
+    FairShareScheduler();
+    FairShareScheduler(const FairShareScheduler &)              = delete;
+    FairShareScheduler(const FairShareScheduler &&)             = delete;
+    FairShareScheduler & operator=(const FairShareScheduler &)  = delete;
+    FairShareScheduler & operator=(const FairShareScheduler &&) = delete;
+
+    ~FairShareScheduler() = default;
+
+    void addForwarding(QObject *aSession, User *aUser); //!< aSession forwards on its own NntpConnection (may be asked to yield it)
+    void removeForwarding(QObject *aSession);            //!< aSession doesn't forward anymore (QUIT...)
+
+    /*!
+     * \brief ask for the connection of another user (asynchronous)
+     * \param aSession        : requester (its slot nntpConnectionGranted() or nntpConnectionRefused() will be called)
+     * \param aUser           : user of the requester
+     * \param aInputConId     : id of the connection to create
+     * \param aMaxConnections : number of connections of all the servers
+     * \return false if the user has its fair share already or no user is above its share (refused now)
+     */
+    bool requestNntpConnection(QObject *aSession, User *aUser, qintptr aInputConId, int aMaxConnections);
+
+    //! the victim handles yieldNntpConnection(): false if the request has gone meanwhile, the id of the new connection otherwise
+    bool startYield(QObject *aVictim, qintptr &aInputConId);
+    //! the victim gives the connection that took over its slot (no thread affinity), false if the requester has gone (to release)
+    bool yielded(QObject *aVictim, NntpConnection *aCon);
+    void yieldFailed(QObject *aVictim); //!< the victim couldn't yield: next victim or refused
+
+    NntpConnection *takeGranted(QObject *aSession); //!< connection granted to the requester (Q_NULLPTR if none)
+
+    //! aSession is closing: forget it (returns a connection granted but not taken that the caller has to release)
+    NntpConnection *removeSession(QObject *aSession);
+
+    inline quint64 getNumberOfRequests() const; //!< requests since start
+    inline quint64 getNumberOfGrants() const;   //!< connections yielded to a requester since start
+    inline quint64 getNumberOfRefusals() const; //!< requests refused since start
+    int getNumberOfUsers();                     //!< users sharing the connections
+
+    void dump(QTextStream &aStream); //!< write the statistics
+
+private:
+    struct Share {                  //!< connections of a user
+        QList<QObject *> forwarding; //!< sessions forwarding on their own connection (victim candidates)
+        int              nbIncoming; //!< requests of the user in progress
+    };
+    struct Request {                //!< a requester waiting for a connection
+        User           *user;       //!< user of the requester
+        User           *victimUser; //!< user of the victim
+        qintptr         inputConId; //!< id of the connection to create
+        int             maxCons;    //!< number of connections of all the servers (at the request time)
+        QObject        *victim;     //!< session asked to yield (Q_NULLPTR once yielded)
+        NntpConnection *con;        //!< connection granted not taken yet
+    };
+
+    int getShare_noLock(int aMaxConnections) const; //!< connections per user
+    bool findVictim_noLock(QObject *aRequester, Request &aRequest); //!< ask a session of the most served user to yield
+    void refuse_noLock(QObject *aRequester);         //!< no victim: nntpConnectionRefused()
+    void releaseShare_noLock(User *aUser);           //!< forget the user if it has no session left
+
+    inline void _log(const QString & aMessage) const; //!< Add a log line
+
+private:
+    QMutex                      iMutex;     //!< protects what follows
+    QHash<User *, Share>        iShares;    //!< users sharing the connections
+    QHash<QObject *, User *>    iSessions;  //!< forwarding sessions and their user
+    QHash<QObject *, Request>   iRequests;  //!< requesters waiting for a connection
+    QHash<QObject *, QObject *> iVictims;   //!< victim asked to yield and its requester
+
+    QAtomicInteger<quint64>     iNbRequests; //!< requests since start
+    QAtomicInteger<quint64>     iNbGrants;   //!< connections yielded since start
+    QAtomicInteger<quint64>     iNbRefusals; //!< requests refused since start
+};
+
+quint64 FairShareScheduler::getNumberOfRequests() const {return iNbRequests.load();}
+quint64 FairShareScheduler::getNumberOfGrants() const {return iNbGrants.load();}
+quint64 FairShareScheduler::getNumberOfRefusals() const {return iNbRefusals.load();}
+
+void FairShareScheduler::_log(const QString & aMessage) const {
+     NntpProxy::log("[FairShareScheduler] ", aMessage);
+}
+
+#endif // FAIRSHARESCHEDULER_H
@@ -0,0 +1,176 @@
+#include "hottracker.h"
+#include "articlecache.h"
+#include "nntp.h"
+
+#include <QTimer>
+#include <QHash>
+#include <QTextStream>
+#include <algorithm>
+
+static const char *sDimensionNames[HotTracker::NbDimensions] = {"msgid", "group", "user", "ip"};
+
+HotTracker::HotTracker(ushort aNbProducers, ushort aWindow, ushort aNbWindows):
+    QObject(), iWindow(aWindow ? aWindow : 1), iWindows(), iCurrent(0), iQueues(),
+    iDrainTimer(new QTimer(this)), iRotateTimer(new QTimer(this)),
+    iNbEvents(0), iNbDropped(0)
+{
+    for (ushort i = 0; i < (aNbWindows ? aNbWindows : 1); ++i)
+        iWindows.append(new Window());
+
+    for (ushort i = 0; i < (aNbProducers ? aNbProducers : 1); ++i){
+        Queue *queue  = new Queue();
+        queue->events = new Event[cHotQueueSize];
+        queue->head.store(0);
+        queue->tail.store(0);
+        iQueues.append(queue);
+    }
+
+    iDrainTimer->setInterval(cHotDrainInterval);
+    connect(iDrainTimer, &QTimer::timeout, this, &HotTracker::drain);
+    iRotateTimer->setInterval(iWindow * 1000);
+    connect(iRotateTimer, &QTimer::timeout, this, &HotTracker::rotate);
+}
+
+HotTracker::~HotTracker(){
+    for (Window *window : iWindows)
+        delete window;
+    for (Queue *queue : iQueues){
+        delete[] queue->events;
+        delete queue;
+    }
+}
+
+const char *HotTracker::getDimensionName(DIMENSION aDimension){
+    return sDimensionNames[aDimension];
+}
+
+bool HotTracker::getDimension(const QByteArray &aName, DIMENSION &aDimension){
+    for (int i = 0; i < NbDimensions; ++i){
+        if (aName.toLower() == sDimensionNames[i]){
+            aDimension = static_cast<DIMENSION>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool HotTracker::record(ushort aProducer, const QByteArray &aCmd, const QByteArray &aUser, const QByteArray &aIp){
+    Queue  *queue = iQueues[aProducer % iQueues.size()];
+    quint32 tail  = queue->tail.load();
+    if (tail - queue->head.loadAcquire() >= static_cast<quint32>(cHotQueueSize)){
+        iNbDropped.fetchAndAddRelaxed(1);
+        return false;
+    }
+
+    Event &event = queue->events[tail & (cHotQueueSize - 1)];
+    event.cmd  = aCmd;
+    event.user = aUser;
+    event.ip   = aIp;
+    queue->tail.storeRelease(tail + 1); // publish the event
+    return true;
+}
+
+void HotTracker::start(){
+    iDrainTimer->start();
+    iRotateTimer->start();
+}
+
+void HotTracker::drain(){
+    for (Queue *queue : iQueues){
+        quint32 head = queue->head.load();
+        quint32 tail = queue->tail.loadAcquire();
+        if (head == tail)
+            continue;
+
+        quint64 nbEvents = tail - head;
+        while (head != tail){
+            Event &event = queue->events[head & (cHotQueueSize - 1)];
+            process(event);
+            event = Event(); // release the QByteArrays in the tracker thread
+            ++head;
+        }
+        queue->head.storeRelease(head); // give the slots back to the producer
+        iNbEvents.fetchAndAddRelaxed(nbEvents);
+    }
+}
+
+void HotTracker::rotate(){
+    drain(); // the events queued belong to the window ending
+
+    iCurrent = (iCurrent + 1) % iWindows.size();
+    Window *window = iWindows[iCurrent];
+    for (int i = 0; i < NbDimensions; ++i){
+        window->sketches[i].clear();
+        window->tops[i].clear();
+    }
+}
+
+void HotTracker::process(const Event &aEvent){
+    if (!aEvent.user.isEmpty())
+        count(User, aEvent.user);
+    if (!aEvent.ip.isEmpty())
+        count(ClientIp, aEvent.ip);
+
+    const char *cmd = aEvent.cmd.constData();
+    if (Nntp::isCommand(cmd, "GROUP")){
+        QList<QByteArray> tokens = aEvent.cmd.simplified().split(' ');
+        if (tokens.size() > 1)
+            count(Group, tokens[1]);
+    } else {
+        // ARTICLE, HEAD or BODY by message-id: the popularity is the one of the article
+        QByteArray key = ArticleCache::getKey(aEvent.cmd);
+        if (!key.isEmpty())
+            count(MessageId, key.mid(1));
+    }
+}
+
+QList<HotTracker::Hit> HotTracker::getTop(DIMENSION aDimension, int aNb) const {
+    // the candidates are the keys monitored in any window,
+    // their count is the sum of the estimates of all the windows
+    QHash<QByteArray, quint64> candidates;
+    for (const Window *window : iWindows){
+        for (const SpaceSaving::Item &item : window->tops[aDimension].getItems())
+            candidates.insert(item.key, 0);
+    }
+
+    QList<Hit> hits;
+    for (auto it = candidates.cbegin(); it != candidates.cend(); ++it)
+        hits.append({it.key(), getEstimate(aDimension, it.key())});
+
+    std::sort(hits.begin(), hits.end(), [](const Hit &a, const Hit &b){
+        return a.count > b.count;
+    });
+    while (hits.size() > aNb)
+        hits.removeLast();
+    return hits;
+}
+
+quint64 HotTracker::getEstimate(DIMENSION aDimension, const QByteArray &aKey) const {
+    quint64 count = 0;
+    for (const Window *window : iWindows)
+        count += window->sketches[aDimension].estimate(aKey);
+    return count;
+}
+
+qint64 HotTracker::getMemorySize() const {
+    qint64 size = 0;
+    for (const Window *window : iWindows){
+        for (int i = 0; i < NbDimensions; ++i)
+            size += window->sketches[i].getMemorySize();
+    }
+    return size;
+}
+
+void HotTracker::dump(QTextStream &aStream) const {
+    aStream << "Hot tracker: " << getNumberOfEvents() << " commands (dropped: "
+            << getNumberOfDroppedEvents() << "), sliding window: " << iWindows.size()
+            << " x " << iWindow << " s, sketches: " << getMemorySize() / 1024 << " KB\n";
+
+    for (int i = 0; i < NbDimensions; ++i){
+        DIMENSION dimension = static_cast<DIMENSION>(i);
+        aStream << "Top " << getDimensionName(dimension) << ":";
+        for (const Hit &hit : getTop(dimension, 10))
+            aStream << " " << hit.key << " (" << hit.count << ")";
+        aStream << "\n";
+    }
+}
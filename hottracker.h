@@ -0,0 +1,124 @@
+#ifndef HOTTRACKER_H
+#define HOTTRACKER_H
+
+#include "constants.h"
+#include "countminsketch.h"
+#include "spacesaving.h"
+
+#include <QObject>
+#include <QByteArray>
+#include <QList>
+#include <QVector>
+#include <QAtomicInteger>
+
+QT_FORWARD_DECLARE_CLASS(QTextStream)
+QT_FORWARD_DECLARE_CLASS(QTimer)
+
+/*!
+ * \brief Streaming popularity of the message-ids, groups, users and client IPs (hot articles detection)
+ * - the InputConnections record each client command in the queue of their Worker:
+ *   single producer / single consumer ring, lock free, an event is dropped when it is full
+ * - the tracker lives in its own thread (with the MonitoringServer) and drains the queues periodically:
+ *   BODY / ARTICLE / HEAD by message-id and GROUP are parsed there, out of the data path
+ * - each dimension has a CountMinSketch (estimate of any key) and a SpaceSaving top-k per window
+ * - sliding window: aNbWindows windows of aWindow seconds, the oldest one is dropped at each rotation
+ *   (the memory is bounded: nbWindows * nbDimensions * (sketch + top-k))
+ */
+class HotTracker : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum DIMENSION {MessageId = 0, Group, User, ClientIp, NbDimensions};
+
+    struct Hit{ //!< a key and its count over the sliding window
+        QByteArray key;
+        quint64    count;
+    };
+
+    /*!
+     * \brief HotTracker constructor
+     * \param aNbProducers : number of queues (one per Worker)
+     * \param aWindow      : duration of a window (seconds)
+     * \param aNbWindows   : number of windows of the sliding window
+     */
+    explicit HotTracker(ushort aNbProducers, ushort aWindow = cDefaultHotWindow,
+                        ushort aNbWindows = cDefaultHotWindows);
+    HotTracker(const HotTracker &)              = delete;
+    HotTracker(const HotTracker &&)             = delete;
+    HotTracker & operator=(const HotTracker &)  = delete;
+    HotTracker & operator=(const HotTracker &&) = delete;
+
+    ~HotTracker(); //!< free the windows and the queues
+
+    static const char *getDimensionName(DIMENSION aDimension); //!< "msgid", "group", "user" or "ip"
+    static bool        getDimension(const QByteArray &aName, DIMENSION &aDimension); //!< parse a dimension name
+
+    /*!
+     * \brief record a client command (data path, lock free)
+     * Thread_Safe as long as each producer id is only used by one thread (its Worker)
+     * \return false if the queue is full (event dropped)
+     */
+    bool record(ushort aProducer, const QByteArray &aCmd, const QByteArray &aUser, const QByteArray &aIp);
+
+    // from the tracker thread
+    QList<Hit> getTop(DIMENSION aDimension, int aNb) const;                //!< hottest keys over the sliding window
+    quint64    getEstimate(DIMENSION aDimension, const QByteArray &aKey) const; //!< count of a key over the sliding window
+    void       dump(QTextStream &aStream) const;                           //!< write the statistics and the top 10s
+
+    inline ushort  getWindow() const;              //!< duration of a window (seconds)
+    inline ushort  getNumberOfWindows() const;     //!< number of windows of the sliding window
+    inline quint64 getNumberOfEvents() const;      //!< commands processed since start (Thread_Safe)
+    inline quint64 getNumberOfDroppedEvents() const; //!< commands dropped (queue full) since start (Thread_Safe)
+    qint64         getMemorySize() const;          //!< bytes used by the sketches
+
+public slots:
+    void start();  //!< start the periodic drain and rotate (to call in the tracker thread)
+    void drain();  //!< process the events queued by the producers
+    void rotate(); //!< open a new window (the oldest one is dropped)
+
+private:
+    struct Event{ //!< a recorded command (implicitly shared QByteArrays: no copy)
+        QByteArray cmd;
+        QByteArray user;
+        QByteArray ip;
+    };
+
+    struct Queue{ //!< single producer / single consumer ring
+        Event                  *events; //!< cHotQueueSize slots (owns them)
+        QAtomicInteger<quint32> head;   //!< next event to process (written by the tracker)
+        QAtomicInteger<quint32> tail;   //!< next free slot (written by the producer)
+    };
+
+    struct Window{ //!< counts of a time slice
+        CountMinSketch sketches[NbDimensions];
+        SpaceSaving    tops[NbDimensions];
+    };
+
+    void process(const Event &aEvent);                                   //!< count a command in the current window
+    inline void count(DIMENSION aDimension, const QByteArray &aKey);    //!< count a key in the current window
+
+private:
+    const ushort            iWindow;     //!< duration of a window (seconds)
+    QVector<Window *>       iWindows;    //!< ring of the windows (owns them)
+    int                     iCurrent;    //!< index of the current window
+    QVector<Queue *>        iQueues;     //!< one queue per producer (owns them)
+    QTimer                 *iDrainTimer; //!< periodic drain (owns it)
+    QTimer                 *iRotateTimer;//!< periodic rotate (owns it)
+
+    QAtomicInteger<quint64> iNbEvents;   //!< commands processed since start
+    QAtomicInteger<quint64> iNbDropped;  //!< commands dropped since start
+};
+
+ushort  HotTracker::getWindow() const {return iWindow;}
+ushort  HotTracker::getNumberOfWindows() const {return static_cast<ushort>(iWindows.size());}
+quint64 HotTracker::getNumberOfEvents() const {return iNbEvents.load();}
+quint64 HotTracker::getNumberOfDroppedEvents() const {return iNbDropped.load();}
+
+void HotTracker::count(DIMENSION aDimension, const QByteArray &aKey){
+    Window *window = iWindows[iCurrent];
+    window->sketches[aDimension].add(aKey);
+    window->tops[aDimension].offer(aKey);
+}
+
+#endif // HOTTRACKER_H
@@ -6,7 +6,9 @@
 #include <algorithm> //std::transform
 
 InputConnection::InputConnection(qintptr aSocketDescriptor):
-    Connection(aSocketDescriptor, NntpProxy::isClientSSL(), true, "InputConnection")
+    Connection(aSocketDescriptor, NntpProxy::isClientSSL(), true, "InputConnection"),
+    iAuthUser(), iAuthPass(), iAuthTries(0),
+    iHotTracker(Q_NULLPTR), iHotProducer(0), iHotUser(), iHotIp()
 {
     connect(this, &InputConnection::connected, this, &InputConnection::doAuthentication);
 
@@ -21,21 +23,24 @@ bool InputConnection::doAuthentication(){
 
     _log("doAuthentication");
 
-    const std::regex & authReg = Nntp::getCmdRegex(Nntp::CMDS::authinfo);
-    std::smatch match;
+    // the client has the socket timeout to authenticate
+    connect(iSocket, SIGNAL(readyRead()), this, SLOT(authRead()), Qt::DirectConnection);
+    startHandshakeTimer();
 
-    std::string user;
-    std::string pass;
-    bool isAuthenticated = false;
+    // the client may have been fast
+    if (iSocket->canReadLine())
+        authRead();
 
-    for (int i=0; i < cAuthenticationTry; ++i){
-        do {
-            if (!iSocket->isOpen())
-                return false;
+    return true;
+}
 
-            iSocket->waitForReadyRead();
-        } while (iSocket->isOpen() && !iSocket->canReadLine());
+void InputConnection::authRead(){
 
+    const std::regex & authReg = Nntp::getCmdRegex(Nntp::CMDS::authinfo);
+    std::smatch match;
+
+    // several lines can arrive in the same segment (pipelined USER and PASS)
+    while (iSocket->canReadLine()){
         QByteArray lineArr = iSocket->readLine();
 
 #ifdef LOG_INPUT_AUTH
@@ -45,51 +50,61 @@ bool InputConnection::doAuthentication(){
 #endif
 
         if(strcmp(lineArr.constData(), Nntp::QUIT) == 0){
+            stopHandshakeTimer();
+            disconnect(iSocket, SIGNAL(readyRead()), this, SLOT(authRead()));
             iSocket->disconnectFromHost();
-            break;
+            return;
         }
 
-        std::string line(lineArr);
+        std::string line(lineArr.constData());
         std::regex_match(line, match, authReg);
         if (!match.size()){
+            if (++iAuthTries >= cAuthenticationTry){
+                authFailed("Wrong Authentication!");
+                return;
+            }
             iSocket->write(Nntp::getResponse(480));
             continue;
         }
 
         std::string cmd = match[1];
         std::transform(cmd.begin(), cmd.end(), cmd.begin(), ::tolower);
-        if (cmd == "user"){
-            user = match[2];
-            if (!pass.empty())
-                isAuthenticated = true;
-        } else {
-            pass = match[2];
-            if (!user.empty())
-                isAuthenticated = true;
-        }
-
-        if (isAuthenticated) {
-            break;
+        if (cmd == "user")
+            iAuthUser = match[2];
+        else
+            iAuthPass = match[2];
+
+        if (!iAuthUser.empty() && !iAuthPass.empty()){
+            // Authentication steps done, the next lines are commands
+            // they stay in the socket buffer until the forwarding starts
+            stopHandshakeTimer();
+            disconnect(iSocket, SIGNAL(readyRead()), this, SLOT(authRead()));
+
+            std::string user, pass;
+            user.swap(iAuthUser);
+            pass.swap(iAuthPass);
+            emit authenticated(user, pass);
+            return;
         } else {
             iSocket->write(Nntp::getResponse(381));
         }
     }
+}
 
-    if (isAuthenticated)
-        emit authenticated(user, pass);
-    else {
+void InputConnection::authFailed(const char *aError){
+    stopHandshakeTimer();
+    disconnect(iSocket, SIGNAL(readyRead()), this, SLOT(authRead()));
 #ifdef LOG_CONNECTION_ERRORS_BEFORE_EMIT_SIGNALS
-        _log("Wrong Authentication!");
+    _log(aError);
 #endif
-        emit socketError("Wrong Authentication!");
-    }
-
-    return isAuthenticated;
+    emit socketError(aError);
 }
 
 void InputConnection::readyRead()
 {
-    if(iSocket->canReadLine()){
+    // a client may pipeline several commands in the same segment
+    // (we stop while the server is not taking what we send, cf isOutputFull)
+    while (!isOutputFull() && iSocket->canReadLine()){
         QByteArray line = iSocket->readLine();
 
 #ifdef LOG_INPUT_DATA
@@ -98,17 +113,18 @@ void InputConnection::readyRead()
         _log(str);
 #endif
 
-        if(strcmp(line.constData(), Nntp::QUIT) == 0){
-            closeConnection();
-        } else {
-            iOutputCon->write(line);
-//            iSocket->write(line);
-        }
-
+        emit commandReceived(line);
     }
 }
 
 
+void InputConnection::setHotTracker(HotTracker *aTracker, ushort aProducer, const QByteArray &aUser){
+    iHotTracker  = aTracker;
+    iHotProducer = aProducer;
+    iHotUser     = aUser;
+    iHotIp       = getIpAddress().toUtf8();
+}
+
 void InputConnection::closeConnection(){
     // Stop async read
     Connection::closeConnection();
@@ -116,7 +132,7 @@ void InputConnection::closeConnection(){
     if (iOutputCon) {
         iOutputCon->setOutput(Q_NULLPTR); // To avoid circular calls
         iOutputCon->closeConnection();
-        iOutputCon = Q_NULLPTR;
+        setOutput(Q_NULLPTR);
     }
 
     // close input socket
@@ -2,9 +2,14 @@
 #define INPUTCONNECTION_H
 
 #include "connection.h"
+#include "hottracker.h"
 
 /*!
  * \brief Server Side Nntp Connection (handle communication with the client that connects to the Proxy)
+ * The client AUTHINFO is parsed asynchronously on readyRead (USER and PASS can be pipelined)
+ * and must be done before the socket timeout (no thread is blocked while the client is idle)
+ * Then each complete line is given to the SessionHandler (commandReceived) that may pipeline them.
+ * Once authenticated, the commands can be recorded in the HotTracker (queue of the Worker, lock free).
  */
 class InputConnection : public Connection
 {
@@ -19,14 +24,38 @@ public:
 
     void closeConnection(); //!< How to close the connection
 
+    //! record the commands of the session in the HotTracker (queue aProducer, the Worker id)
+    void setHotTracker(HotTracker *aTracker, ushort aProducer, const QByteArray &aUser);
+    inline void recordCommand(const QByteArray &aCmd); //!< record a client command (not the posted data)
+
 signals:
     void error(QString err); //!< signal errors (socket errors, authentication,...)
     void authenticated(std::string user, std::string pass); //!< Authentication steps done (but user not verified in DB)
+    void commandReceived(QByteArray aCmd); //!< complete line received from the client (command or posted data)
 
 public slots:
     void readyRead();        //!< Async Read, how to handle it
     void disconnected();     //!< What to do on socket disconnection
     bool doAuthentication(); //!< Launch the Authentication protocol (emit authenticated if success)
+    void authRead();         //!< parse the AUTHINFO lines received so far
+
+private:
+    void authFailed(const char *aError); //!< stop the authentication and emit socketError
+
+private:
+    std::string iAuthUser;  //!< login received with AUTHINFO USER
+    std::string iAuthPass;  //!< pass received with AUTHINFO PASS
+    ushort      iAuthTries; //!< number of wrong AUTHINFO lines received
+
+    HotTracker *iHotTracker;  //!< where to record the commands (DOES NOT own it, Q_NULLPTR if not monitoring)
+    ushort      iHotProducer; //!< queue of the HotTracker (Worker id)
+    QByteArray  iHotUser;     //!< login of the session
+    QByteArray  iHotIp;       //!< ip of the client
 };
 
+void InputConnection::recordCommand(const QByteArray &aCmd){
+    if (iHotTracker)
+        iHotTracker->record(iHotProducer, aCmd, iHotUser, iHotIp);
+}
+
 #endif // INPUTCONNECTION_H
@@ -0,0 +1,171 @@
+#include "monitoringserver.h"
+#include "hottracker.h"
+#include "bandwidthshaper.h"
+
+#include <QTcpSocket>
+#include <QTextStream>
+
+MonitoringServer::MonitoringServer(HotTracker &aTracker):
+    QTcpServer(), iTracker(aTracker), iLogPrefix("[MonitoringServer] "), iAdmins()
+{
+    connect(this, &MonitoringServer::startListening, this, &MonitoringServer::listenOn);
+}
+
+MonitoringServer::~MonitoringServer(){
+    _log("Destruction");
+}
+
+void MonitoringServer::listenOn(ushort aPort){
+    QString str;
+    if (!listen(QHostAddress::LocalHost, aPort)){
+        str = "Can't listen on port ";
+        str += QString::number(aPort);
+        str += ": ";
+        str += errorString();
+    } else {
+        str = "Listening on localhost port ";
+        str += QString::number(aPort);
+    }
+    _log(str);
+
+    iTracker.start();
+}
+
+void MonitoringServer::incomingConnection(qintptr aSocketDescriptor){
+    QTcpSocket *socket = new QTcpSocket(this);
+    if (!socket->setSocketDescriptor(aSocketDescriptor)){
+        _log("Error attaching client socket");
+        delete socket;
+        return;
+    }
+
+    connect(socket, SIGNAL(readyRead()), this, SLOT(readCommands()));
+    connect(socket, SIGNAL(disconnected()), this, SLOT(clientDisconnected()));
+    socket->write("200 NntpProxy monitoring ready\r\n");
+}
+
+void MonitoringServer::readCommands(){
+    QTcpSocket *socket = qobject_cast<QTcpSocket *>(sender());
+    if (!socket)
+        return;
+
+    while (socket->canReadLine()){
+        bool quit    = false;
+        bool isAdmin = iAdmins.contains(socket);
+        socket->write(execute(socket->readLine(), quit, isAdmin));
+        if (isAdmin)
+            iAdmins.insert(socket);
+        if (quit){
+            socket->disconnectFromHost();
+            return;
+        }
+    }
+}
+
+void MonitoringServer::clientDisconnected(){
+    QObject *socket = sender();
+    if (socket){
+        iAdmins.remove(socket);
+        socket->deleteLater();
+    }
+}
+
+QByteArray MonitoringServer::shape(const QList<QByteArray> &aTokens){
+    BandwidthShaper *shaper = NntpProxy::getBandwidthShaper();
+    QByteArray target = aTokens.size() > 1 ? aTokens[1].toUpper() : QByteArray();
+    bool isRateOk = false, isBurstOk = true;
+
+    if (target == "CLASS" && (aTokens.size() == 4 || aTokens.size() == 5)){
+        uint rate  = aTokens[3].toUInt(&isRateOk);
+        uint burst = aTokens.size() == 5 ? aTokens[4].toUInt(&isBurstOk) : cDefaultShapingBurst;
+        if (isRateOk && isBurstOk && shaper->setClass(QString::fromUtf8(aTokens[2]), rate, burst))
+            return "200 Class set\r\n";
+    } else if (target == "USER" && aTokens.size() == 4){
+        if (shaper->setUserClass(QString::fromUtf8(aTokens[2]), QString::fromUtf8(aTokens[3])))
+            return "200 User class set\r\n";
+        return "430 No such class\r\n";
+    } else if (target == "IP" && (aTokens.size() == 3 || aTokens.size() == 4)){
+        uint rate  = aTokens[2].toUInt(&isRateOk);
+        uint burst = aTokens.size() == 4 ? aTokens[3].toUInt(&isBurstOk) : cDefaultShapingBurst;
+        if (isRateOk && isBurstOk){
+            shaper->setIpRate(rate, burst);
+            return "200 IP rate set\r\n";
+        }
+    }
+    return "501 Syntax error\r\n";
+}
+
+QByteArray MonitoringServer::execute(const QByteArray &aLine, bool &aQuit, bool &aIsAdmin){
+    QList<QByteArray> tokens = aLine.simplified().split(' ');
+    QByteArray cmd = tokens.first().toUpper();
+    QByteArray response;
+    HotTracker::DIMENSION dimension;
+
+    if (cmd == "QUIT"){
+        aQuit = true;
+        response = "205 Bye\r\n";
+    } else if (cmd == "HELP"){
+        response = "100 Commands\r\n"
+                   "STATS\r\n"
+                   "TOP <msgid|group|user|ip> [nb]\r\n"
+                   "COUNT <msgid|group|user|ip> <key>\r\n"
+                   "SHAPING\r\n"
+                   "SHAPE CLASS <name> <KB/s> [burst KB]\r\n"
+                   "SHAPE USER <login> <class>\r\n"
+                   "SHAPE IP <KB/s> [burst KB]\r\n"
+                   "AUTH <password>\r\n"
+                   "QUIT\r\n"
+                   ".\r\n";
+    } else if (cmd == "STATS"){
+        iTracker.drain();
+        QString stats;
+        QTextStream stream(&stats);
+        iTracker.dump(stream);
+        stream.flush();
+        response = "200 Stats\r\n";
+        for (const QString &line : stats.split('\n', QString::SkipEmptyParts))
+            response.append(line.toUtf8()).append("\r\n");
+        response.append(".\r\n");
+    } else if (cmd == "TOP" && tokens.size() >= 2 && HotTracker::getDimension(tokens[1], dimension)){
+        int nb = tokens.size() > 2 ? tokens[2].toInt() : 10;
+        iTracker.drain();
+        response = QByteArray("200 Top ").append(HotTracker::getDimensionName(dimension)).append("\r\n");
+        for (const HotTracker::Hit &hit : iTracker.getTop(dimension, nb > 0 ? nb : 10))
+            response.append(QByteArray::number(hit.count)).append(' ').append(hit.key).append("\r\n");
+        response.append(".\r\n");
+    } else if (cmd == "COUNT" && tokens.size() == 3 && HotTracker::getDimension(tokens[1], dimension)){
+        iTracker.drain();
+        response = QByteArray("200 ").append(QByteArray::number(iTracker.getEstimate(dimension, tokens[2])))
+                .append(' ').append(tokens[2]).append("\r\n");
+    } else if (cmd == "SHAPING" && NntpProxy::getBandwidthShaper()){
+        QString stats;
+        QTextStream stream(&stats);
+        NntpProxy::getBandwidthShaper()->dump(stream);
+        stream.flush();
+        response = "200 Shaping\r\n";
+        for (const QString &line : stats.split('\n', QString::SkipEmptyParts))
+            response.append(line.toUtf8()).append("\r\n");
+        response.append(".\r\n");
+    } else if (cmd == "AUTH" && tokens.size() == 2){
+        const QString &password = NntpProxy::getShapingPassword();
+        aIsAdmin = !password.isEmpty() && QString::fromUtf8(tokens[1]) == password;
+        if (aIsAdmin)
+            response = "281 Authentication accepted\r\n";
+        else {
+            _log("AUTH refused");
+            response = "481 Authentication failed\r\n";
+        }
+    } else if (cmd == "SHAPE" && NntpProxy::getBandwidthShaper()){
+        if (aIsAdmin)
+            response = shape(tokens);
+        else
+            response = "480 Authentication required (AUTH)\r\n";
+    } else if (cmd == "SHAPING" || cmd == "SHAPE"){
+        response = "503 Shaping disabled\r\n";
+    } else if (cmd == "TOP" || cmd == "COUNT" || cmd == "AUTH"){
+        response = "501 Syntax error\r\n";
+    } else {
+        response = "500 Unknown command\r\n";
+    }
+    return response;
+}
@@ -0,0 +1,75 @@
+#ifndef MONITORINGSERVER_H
+#define MONITORINGSERVER_H
+
+#include "constants.h"
+#include "nntpproxy.h" // inline log functions
+
+#include <QtNetwork/QTcpServer>
+#include <QSet>
+
+QT_FORWARD_DECLARE_CLASS(HotTracker)
+QT_FORWARD_DECLARE_CLASS(QTcpSocket)
+
+/*!
+ * \brief Monitoring server (portMonitoring, localhost only as it exposes users and IPs)
+ * - lives in the thread of the HotTracker so it reads it without locking
+ * - line based text protocol with NNTP like responses:
+ *   STATS                  : statistics and top 10s of the HotTracker (multi-line)
+ *   TOP <dimension> [nb]   : hottest keys of a dimension (msgid, group, user or ip) with their count (multi-line)
+ *   COUNT <dimension> <key>: estimated count of a key over the sliding window
+ *   SHAPING                : classes of the BandwidthShaper and throttled time of the users (multi-line)
+ *   SHAPE CLASS <name> <KB/s> [burst KB], SHAPE USER <login> <class>, SHAPE IP <KB/s> [burst KB]:
+ *                            change the limits of the BandwidthShaper at runtime (0 KB/s: unlimited),
+ *                            only after AUTH <shapingPassword> (refused if no shapingPassword is configured)
+ *   AUTH <password>        : allow the SHAPE commands on this connection
+ *   HELP, QUIT
+ * - without monitoring in the config file, the limits can only be changed there (restart)
+ */
+class MonitoringServer : public QTcpServer
+{
+    Q_OBJECT
+
+public:
+    explicit MonitoringServer(HotTracker &aTracker); //!< created in main Thread then moved to the tracker one
+    MonitoringServer(const MonitoringServer &)              = delete;
+    MonitoringServer(const MonitoringServer &&)             = delete;
+    MonitoringServer & operator=(const MonitoringServer &)  = delete;
+    MonitoringServer & operator=(const MonitoringServer &&) = delete;
+
+    ~MonitoringServer(); //!< trace destruction (the client sockets are children)
+
+    //! response of a command line (aIsAdmin: the client has passed AUTH, set by it)
+    QByteArray execute(const QByteArray &aLine, bool &aQuit, bool &aIsAdmin);
+    static QByteArray shape(const QList<QByteArray> &aTokens); //!< response of a SHAPE command
+
+signals:
+    void startListening(ushort aPort); //!< trigger &MonitoringServer::listenOn in the tracker Thread
+
+public slots:
+    void listenOn(ushort aPort); //!< listen on localhost and start the HotTracker
+    void readCommands();         //!< connects to QTcpSocket::readyRead of the clients
+    void clientDisconnected();   //!< connects to QTcpSocket::disconnected of the clients
+
+protected:
+    //! QTcpServer, create the client socket in the tracker Thread
+    void incomingConnection(qintptr aSocketDescriptor);
+
+private:
+    inline void _log(const QString & aMessage) const; //!< Add a log line
+    inline void _log(const char*     aMessage) const; //!< Add a log line
+
+private:
+    HotTracker      &iTracker;   //!< handle on the HotTracker (DOES NOT own it)
+    const QString    iLogPrefix; //!< log prefix
+    QSet<QObject *>  iAdmins;    //!< clients allowed to use SHAPE (AUTH)
+};
+
+void MonitoringServer::_log(const char* aMessage) const {
+     NntpProxy::log(iLogPrefix, aMessage);
+}
+
+void MonitoringServer::_log(const QString & aMessage) const {
+     NntpProxy::log(iLogPrefix, aMessage);
+}
+
+#endif // MONITORINGSERVER_H
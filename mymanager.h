@@ -5,14 +5,18 @@
 #include "nntpproxy.h"
 
 #include <QList>
+#include <QHash>
 #include <QMutex>
 #include <QMutexLocker>
 #include <QTextStream>
 
 /*!
- * \brief "Thread Safe" wrapper of a QList of pointers
+ * \brief "Thread Safe" wrapper of a QList of pointers indexed by the id of the data
+ * - Data::getId() returns the Key (qHash and operator== needed), unique in the manager
+ * - iIndex gives the position of each data in iList: find, insert and erase in O(1)
+ * - iList keeps the insertion order but for erase that moves the last data in the hole
  */
-template<typename Data> class MyManager
+template<typename Data, typename Key = ushort> class MyManager
 {
 public:
     explicit MyManager(const char * aDataType); //!< \param name of the data type
@@ -31,6 +35,14 @@ public:
      */
     bool erase(Data *aData, bool useMutex = true);
 
+    /*!
+     * \brief insert data at the end of the list (blocking or non blocking, Thread_Safe by default)
+     * \param aData    : data to insert
+     * \param useMutex : shall we protect (lock) the list
+     * \return false if there is already a data with the same id
+     */
+    bool insert(Data *aData, bool useMutex = true);
+
     inline ushort size() const; //!< return the size of the list Thread_Safe
     inline ushort size_noLock() const; //!< return the size of the list (non blocking)
 
@@ -46,11 +58,11 @@ protected:
      * \param useMutex : shall we protect (lock) the list
      * \return
      */
-    Data * find(ushort aId,  bool useMutex = true) const;
+    Data * find(const Key &aId, bool useMutex = true) const;
 
     /*!
      * \brief find data in the list (blocking or non blocking, Thread_Safe by default)
-     * \param aData    : data to find (dereference pointer and use operator== on objects)
+     * \param aData    : data to find (by its id)
      * \param useMutex : shall we protect (lock) the list
      * \return
      */
@@ -61,6 +73,7 @@ protected:
 
 protected:
     QList<Data *>   iList;      //!< list of pointers
+    QHash<Key, int> iIndex;     //!< position in iList of each id
     mutable QMutex *mMutex;     //!< Mutex to be thread safe
     const QString   iDataName;  //!< string name of the data type
     const QString   iLogPrefix; //!< log prefix iDataName<Manager>
@@ -68,23 +81,23 @@ protected:
 
 //////////////////////
 /// inlines functions
-template<typename Data> ushort MyManager<Data>::size() const{
+template<typename Data, typename Key> ushort MyManager<Data, Key>::size() const{
     QMutexLocker lock(mMutex);
     return iList.size();
 }
-template<typename Data> ushort MyManager<Data>::size_noLock() const{
+template<typename Data, typename Key> ushort MyManager<Data, Key>::size_noLock() const{
     return iList.size();
 }
 
-template<typename Data> void MyManager<Data>::_log(const QString & aMessage) const{
+template<typename Data, typename Key> void MyManager<Data, Key>::_log(const QString & aMessage) const{
     NntpProxy::log(iLogPrefix, aMessage);
 }
 
-template<typename Data> void MyManager<Data>::_log(const char * aMessage) const{
+template<typename Data, typename Key> void MyManager<Data, Key>::_log(const char * aMessage) const{
     NntpProxy::log(iLogPrefix, aMessage);
 }
 
-template<typename Data> QString MyManager<Data>::getSizeStr_noLock() const{
+template<typename Data, typename Key> QString MyManager<Data, Key>::getSizeStr_noLock() const{
     return QString("Current list size: ").append(QString::number(iList.size()));
 }
 
@@ -92,8 +105,8 @@ template<typename Data> QString MyManager<Data>::getSizeStr_noLock() const{
 ////////////////////
 // Normal functions
 
-template<typename Data> MyManager<Data>::MyManager(const char * aDataType):
-    iList(), mMutex(new QMutex()), iDataName(aDataType),
+template<typename Data, typename Key> MyManager<Data, Key>::MyManager(const char * aDataType):
+    iList(), iIndex(), mMutex(new QMutex()), iDataName(aDataType),
     iLogPrefix(QString("[").append(iDataName).append("Manager] "))
 {
 #ifdef LOG_CONSTRUCTORS
@@ -101,7 +114,7 @@ template<typename Data> MyManager<Data>::MyManager(const char * aDataType):
 #endif
 }
 
-template<typename Data> MyManager<Data>::~MyManager(){
+template<typename Data, typename Key> MyManager<Data, Key>::~MyManager(){
     mMutex->lock();
 #ifdef LOG_CONSTRUCTORS
     QString str("Destructor, ");
@@ -112,18 +125,30 @@ template<typename Data> MyManager<Data>::~MyManager(){
         delete iList[i];
 
     iList.clear();
+    iIndex.clear();
     mMutex->unlock();
     delete mMutex;
 }
 
-template<typename Data> bool MyManager<Data>::erase(Data *aData, bool useMutex){
+template<typename Data, typename Key> bool MyManager<Data, Key>::erase(Data *aData, bool useMutex){
     if (useMutex)
         mMutex->lock();
 
-    bool out = iList.removeOne(aData);
+    bool out = false;
+    int pos  = iIndex.value(aData->getId(), -1);
+    if (pos != -1 && iList[pos] == aData){
+        // the last data takes the hole
+        Data *last = iList.takeLast();
+        if (last != aData){
+            iList[pos] = last;
+            iIndex[last->getId()] = pos;
+        }
+        iIndex.remove(aData->getId());
+        out = true;
+    }
 
     QTextStream &is = NntpProxy::acquireLog(iLogPrefix);
-    is << "erase " << iDataName << " with id: " << aData->getId()
+    is << "erase " << iDataName << ": " << *aData
        << ", result: " << out
        << ", " << getSizeStr_noLock();
     NntpProxy::releaseLog();
@@ -134,17 +159,14 @@ template<typename Data> bool MyManager<Data>::erase(Data *aData, bool useMutex){
     return out;
 }
 
-template<typename Data> Data * MyManager<Data>::find(ushort aId, bool useMutex) const{
-    Data *out = Q_NULLPTR;
-
+template<typename Data, typename Key> bool MyManager<Data, Key>::insert(Data *aData, bool useMutex){
     if (useMutex)
         mMutex->lock();
 
-    for (int i=0; i<iList.size(); ++i){
-        if (iList[i]->getId() == aId){
-            out = iList[i];
-            break;
-        }
+    bool out = !iIndex.contains(aData->getId());
+    if (out){
+        iIndex.insert(aData->getId(), iList.size());
+        iList.append(aData);
     }
 
     if (useMutex)
@@ -153,18 +175,12 @@ template<typename Data> Data * MyManager<Data>::find(ushort aId, bool useMutex)
     return out;
 }
 
-template<typename Data> Data * MyManager<Data>::find(Data *aData, bool useMutex) const{
-    Data *out = Q_NULLPTR;
-
+template<typename Data, typename Key> Data * MyManager<Data, Key>::find(const Key &aId, bool useMutex) const{
     if (useMutex)
         mMutex->lock();
 
-    for (int i=0; i<iList.size(); ++i){
-        if (*aData == *(iList[i])){
-            out = iList[i];
-            break;
-        }
-    }
+    int   pos = iIndex.value(aId, -1);
+    Data *out = (pos == -1) ? Q_NULLPTR : iList[pos];
 
     if (useMutex)
         mMutex->unlock();
@@ -172,7 +188,11 @@ template<typename Data> Data * MyManager<Data>::find(Data *aData, bool useMutex)
     return out;
 }
 
-template<typename Data> void MyManager<Data>::dump() const{
+template<typename Data, typename Key> Data * MyManager<Data, Key>::find(Data *aData, bool useMutex) const{
+    return find(aData->getId(), useMutex);
+}
+
+template<typename Data, typename Key> void MyManager<Data, Key>::dump() const{
     QMutexLocker lock(mMutex);
     QTextStream &ostream = NntpProxy::acquireLog(iLogPrefix);
     ostream << "Dump, " << getSizeStr_noLock() << "\n";
@@ -182,7 +202,7 @@ template<typename Data> void MyManager<Data>::dump() const{
     NntpProxy::releaseLog();
 }
 
-template<typename Data> void MyManager<Data>::dump(QTextStream &aStream){
+template<typename Data, typename Key> void MyManager<Data, Key>::dump(QTextStream &aStream){
     QMutexLocker lock(mMutex);
     aStream << iLogPrefix << "Dump, " << getSizeStr_noLock() << "\n";
     for (int i=0; i<iList.size(); ++i){
@@ -1,5 +1,8 @@
 #include "nntp.h"
 
+#include <cctype>
+#include <cstring>
+
 std::map<unsigned short, const char *> Nntp::sResponses{};
 std::map<Nntp::CMDS, std::regex>      Nntp::sCmdRegex{};
 
@@ -17,6 +20,57 @@ const std::regex & Nntp::getCmdRegex(Nntp::CMDS aCmd){
     return sCmdRegex.at(aCmd);
 }
 
+unsigned short Nntp::getResponseCode(const char *aLine){
+    if (!isdigit(aLine[0]) || !isdigit(aLine[1]) || !isdigit(aLine[2]))
+        return 0;
+    return static_cast<unsigned short>(100*(aLine[0]-'0') + 10*(aLine[1]-'0') + (aLine[2]-'0'));
+}
+
+bool Nntp::isCommand(const char *aLine, const char *aCmd){
+    while (*aLine == ' ' || *aLine == '\t')
+        ++aLine;
+
+    size_t len = strlen(aCmd);
+    if (strncasecmp(aLine, aCmd, len) != 0)
+        return false;
+
+    char next = aLine[len];
+    return next == ' ' || next == '\t' || next == '\r' || next == '\n' || next == '\0';
+}
+
+bool Nntp::isMultiLineResponse(const char *aCmdLine, unsigned short aCode){
+    switch (aCode) {
+    case 100: // HELP
+    case 101: // CAPABILITIES
+    case 215: // LIST
+    case 220: // ARTICLE
+    case 221: // HEAD, XHDR
+    case 222: // BODY
+    case 224: // OVER, XOVER
+    case 225: // HDR
+    case 230: // NEWNEWS
+    case 231: // NEWGROUPS
+    case 282: // XGTITLE
+        return true;
+    case 211: // only LISTGROUP (GROUP is single line)
+        return isCommand(aCmdLine, "LISTGROUP");
+    default:
+        return false;
+    }
+}
+
+bool Nntp::isMessageIdCommand(const char *aCmdLine){
+    while (*aCmdLine == ' ' || *aCmdLine == '\t')
+        ++aCmdLine;
+
+    const char *arg = strchr(aCmdLine, ' ');
+    if (arg == nullptr)
+        return false;
+    while (*arg == ' ')
+        ++arg;
+    return *arg == '<';
+}
+
 void Nntp::initMaps(){
     setResponsesMap();
     setCmdRegexMap();
@@ -68,6 +122,9 @@ void Nntp::setResponsesMap(){
     //rfc977: 3.6.  The LIST command
     sResponses[215] = "215 list of newsgroups follows\r\n";
 
+    //rfc977: 3.10.  The POST command
+    sResponses[440] = "440 posting not allowed\r\n";
+
     //rfc977: 3.11.  The QUIT command
     sResponses[205] = "205 Good Bye, thanks for using NG_LinK\r\n";
 
@@ -26,6 +26,18 @@ public:
     //! return the regular expression to match a command
     static const std::regex & getCmdRegex(CMDS aCmd);
 
+    //! return the code of a response line (0 if it doesn't start with 3 digits)
+    static unsigned short getResponseCode(const char *aLine);
+
+    //! is the command line aLine the command aCmd (case insensitive, aCmd in upper case)
+    static bool isCommand(const char *aLine, const char *aCmd);
+
+    //! does the response aCode to the command aCmdLine come with a data block ending with ".\r\n"
+    static bool isMultiLineResponse(const char *aCmdLine, unsigned short aCode);
+
+    //! is the article of the command given by a message-id (<...>) rather than depending on the current group
+    static bool isMessageIdCommand(const char *aCmdLine);
+
 private:
     explicit Nntp(); // no instances
     Nntp(const Nntp &)              = delete;
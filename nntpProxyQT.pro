@@ -20,12 +20,33 @@ SOURCES += main.cpp \
     usermanager.cpp \
     nntpserver.cpp \
     nntpconnection.cpp \
-    mythread.cpp \
+    worker.cpp \
+    workermanager.cpp \
     sessionhandler.cpp \
     sessionmanager.cpp \
     nntpservermanager.cpp \
     database.cpp \
-    mycrypt.cpp
+    mycrypt.cpp \
+    nntplistener.cpp \
+    nntpmultiplexer.cpp \
+    responseframer.cpp \
+    ringbuffer.cpp \
+    nntpscanner.cpp \
+    articlecache.cpp \
+    articlestore.cpp \
+    countminsketch.cpp \
+    spacesaving.cpp \
+    hottracker.cpp \
+    monitoringserver.cpp \
+    singleflight.cpp \
+    failover.cpp \
+    bloomfilter.cpp \
+    serverscore.cpp \
+    fairsharescheduler.cpp \
+    admissionqueue.cpp \
+    tokenbucket.cpp \
+    bandwidthshaper.cpp \
+    readscheduler.cpp
 
 HEADERS += \
     nntpproxy.h \
@@ -38,12 +59,33 @@ HEADERS += \
     usermanager.h \
     nntpserver.h \
     nntpconnection.h \
-    mythread.h \
+    worker.h \
+    workermanager.h \
     constants_tests.h \
     sessionhandler.h \
     sessionmanager.h \
     nntpservermanager.h \
     mymanager.h \
     database.h \
-    mycrypt.h
+    mycrypt.h \
+    nntplistener.h \
+    nntpmultiplexer.h \
+    responseframer.h \
+    ringbuffer.h \
+    nntpscanner.h \
+    articlecache.h \
+    articlestore.h \
+    countminsketch.h \
+    spacesaving.h \
+    hottracker.h \
+    monitoringserver.h \
+    singleflight.h \
+    failover.h \
+    bloomfilter.h \
+    serverscore.h \
+    fairsharescheduler.h \
+    admissionqueue.h \
+    tokenbucket.h \
+    bandwidthshaper.h \
+    readscheduler.h
 
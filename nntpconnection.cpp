@@ -1,21 +1,68 @@
 #include "nntpconnection.h"
 #include "nntp.h"
 #include "nntpproxy.h"
+#include "articlecache.h"
+#include "failover.h"
+#include "tokenbucket.h"
+#include "readscheduler.h"
+#include "bloomfilter.h"
+
+#include <QThread>
+#include <QSocketNotifier>
+#include <QTimer>
+#include <cstring>
+
+#ifdef Q_OS_LINUX
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/socket.h>
+#endif
+
+static const int sPeekBufferSize = 65536; //!< default capacity of a pipe
 
 
 NntpConnection::NntpConnection(qintptr aInputId,
                                const NntpServer & aServer):
     Connection(aInputId, aServer.isSsl(), false, "NntpConnection"),
-    iServer(aServer), iDownloadSize(0)
+    iServer(aServer), iServerId(aServer.getId()), iScore(aServer.getScore()), iReadScheduler(aServer.getReadScheduler()),
+    iMissingIndex(aServer.getMissingIndex()),
+    iDownloadSize(0), iAuthState(AuthState::NotAuthenticated), iAuthPass(),
+    iIdleTimer(), iFramer(), iRing(Q_NULLPTR), iCacheKey(), iCacheData(), iFlights(),
+    iFailovers(), iHeldStatus(), isHeld(false),
+    iSentTimes(), iResponseStart(0), iLastResponseEnd(0), isResponseSlowed(false),
+    iShaping(), iShapingTimer(Q_NULLPTR), isWaitingBuckets(false), isWaitingServer(false),
+    iServerGrant(0), iThrottleStart(0),
+    iSpliceFd(-1), iSpliceOutFd(-1), iSpliceIn(0), iPipeSize(0),
+    iSplicedCmds(), iSplicedStatus(), iSplicedSizes(), iPeekBuffer(),
+    iReadNotifier(Q_NULLPTR), iWriteNotifier(Q_NULLPTR), iSendNotifier(Q_NULLPTR), iSpliceOut()
 {
+    iPipe[0] = iPipe[1] = -1;
     iLogPrefix.append("Serv[").append(QString::number(iServer.getId())).append("] ");
+    connect(this, &NntpConnection::connected, this, &NntpConnection::doAuthentication);
 #ifdef LOG_CONSTRUCTORS
     _log("Constructor");
 #endif
 }
 
 
+NntpConnection::~NntpConnection(){
+    failFlights();
+    clearShaping();
+    if (isSplicing())
+        stopSplice(false);
+    delete iRing;
+}
+
 bool NntpConnection::doAuthentication(){
+    iScore->addConnectTime(iConnectTimer.elapsed());
+
+    if (!iServer.needAuthentication()){
+        iAuthState = AuthState::Authenticated;
+        emit authenticated();
+        return true;
+    }
+
 #ifdef LOG_NEWS_AUTH
     QString str("> doAuthentication user: ");
     str += iServer.getAuthUser();
@@ -31,8 +78,8 @@ bool NntpConnection::doAuthentication(){
         return false;
     }
 
-    std::string pass = iServer.getAuthPass().toStdString();
-    if (!NntpProxy::decrypt(pass)){
+    iAuthPass = iServer.getAuthPass().toStdString();
+    if (!NntpProxy::decrypt(iAuthPass)){
         QString err("Error decrypting user password: ");
         err += iServer.getAuthPass();
         _log(err);
@@ -44,94 +91,744 @@ bool NntpConnection::doAuthentication(){
     cmd += user;
     cmd += Nntp::ENDLINE;
 
+    iAuthState = AuthState::WaitUserResponse;
+    connect(iSocket, SIGNAL(readyRead()), this, SLOT(authRead()), Qt::DirectConnection);
+    startHandshakeTimer();
 
     iSocket->write(cmd.c_str());
+    return true;
+}
 
-    do {
-        iSocket->waitForReadyRead();
-    } while (!iSocket->canReadLine());
-    QByteArray lineArr = iSocket->readLine();
+void NntpConnection::authRead(){
+    while (iSocket->canReadLine()){
+        QByteArray lineArr = iSocket->readLine();
 #ifdef LOG_NEWS_AUTH
-    {
-        QString str("Authinfo pass response: ");
-        str += lineArr.constData();
-        _log(str);
-    }
+        {
+            QString str("Authinfo response: ");
+            str += lineArr.constData();
+            _log(str);
+        }
 #endif
 
-    if(strncmp(lineArr.constData(), Nntp::getResponse(381), 2) != 0){
-        QString err("Wrong Authentication: response from '");
-        err += cmd.c_str();
-        err += "' should start with 38... resp: ";
-        err += lineArr.constData();
+        if (iAuthState == AuthState::WaitUserResponse){
+            if(strncmp(lineArr.constData(), Nntp::getResponse(381), 2) != 0){
+                QString err("Wrong Authentication: response from '");
+                err += Nntp::AUTHINFO_USER;
+                err += "' should start with 38... resp: ";
+                err += lineArr.constData();
 #ifdef LOG_CONNECTION_ERRORS_BEFORE_EMIT_SIGNALS
-        _log(err);
+                _log(err);
 #endif
-        emit socketError(err);
-        return false;
+                stopHandshakeTimer();
+                disconnect(iSocket, SIGNAL(readyRead()), this, SLOT(authRead()));
+                iAuthState = AuthState::NotAuthenticated;
+                emit socketError(err);
+                return;
+            }
+
+            std::string cmd(Nntp::AUTHINFO_PASS);
+            cmd += iAuthPass;
+            cmd += Nntp::ENDLINE;
+            iAuthPass.clear();
+
+            iAuthState = AuthState::WaitPassResponse;
+            startHandshakeTimer();
+            iSocket->write(cmd.c_str());
+
+        } else if (iAuthState == AuthState::WaitPassResponse){
+            stopHandshakeTimer();
+            disconnect(iSocket, SIGNAL(readyRead()), this, SLOT(authRead()));
+
+            if(strncmp(lineArr.constData(), Nntp::getResponse(281), 2) != 0){
+                QString err("Wrong Authentication: response from '");
+                err += Nntp::AUTHINFO_PASS;
+                err += "' should start with 28... resp: ";
+                err += lineArr.constData();
+#ifdef LOG_CONNECTION_ERRORS_BEFORE_EMIT_SIGNALS
+                _log(err);
+#endif
+                iAuthState = AuthState::NotAuthenticated;
+                emit socketError(err);
+                return;
+            }
+
+            _log("> Authentication succeed");
+            iAuthState = AuthState::Authenticated;
+            emit authenticated();
+            return;
+        }
     }
+}
 
 
-    cmd = Nntp::AUTHINFO_PASS;
-    cmd += pass;
-    cmd += Nntp::ENDLINE;
-    iSocket->write(cmd.c_str());
+void NntpConnection::releaseToPool(){
+    if (isSplicing())
+        stopSplice(true); // the socket goes back to Qt
 
-    do {
-        iSocket->waitForReadyRead();
-    } while (!iSocket->canReadLine());
-    lineArr = iSocket->readLine();
+    stopAsyncRead();
+    setOutput(Q_NULLPTR);
+    isHeld = false; // the session that held the responses is done with them
+    clearShaping(); // and so are its buckets (and its turn for the server)
 
-#ifdef LOG_NEWS_AUTH
-    {
-        QString str("Authinfo pass response: ");
-        str += lineArr.constData();
-        _log(str);
+    iIdleTimer.start();
+    moveToThread(Q_NULLPTR); // the thread pulling it from the pool will adopt it
+}
+
+bool NntpConnection::acquireFromPool(qintptr aInputId, qint64 aMaxIdleMs){
+    // objects without thread affinity can be pulled by the current thread
+    moveToThread(QThread::currentThread());
+
+    if (iIdleTimer.elapsed() > aMaxIdleMs)
+        return false;
+
+    if (iSocket->state() != QAbstractSocket::ConnectedState)
+        return false;
+
+    // Health check: non blocking poll of the socket, a healthy idle connection
+    // has nothing to say (server timeout message or remote close otherwise)
+    iSocket->waitForReadyRead(0);
+    if (iSocket->state() != QAbstractSocket::ConnectedState || iSocket->bytesAvailable() > 0)
+        return false;
+    if (iRing && !iRing->isEmpty())
+        return false; // data received after the last response
+
+    iSocketDescriptor = aInputId;
+    iDownloadSize     = 0;
+    iLogPrefix = QString("NntpConnection[").append(QString::number(aInputId)).append("] ");
+    iLogPrefix.append("Serv[").append(QString::number(iServer.getId())).append("] ");
+
+    _log("Reused from the pool");
+    return true;
+}
+
+void NntpConnection::sendCommand(const QByteArray &aCmd, Flight *aFlight, bool aFailover){
+    iFramer.addCommand(aCmd);
+    iFlights.append(aFlight);
+    iFailovers.append(aFailover);
+    iSentTimes.append(iConnectTimer.elapsed());
+    sendData(aCmd);
+}
+
+void NntpConnection::expectResponse(const QByteArray &aCmd){
+    iFramer.addCommand(aCmd);
+    iFlights.append(Q_NULLPTR);
+    iFailovers.append(false);
+    iSentTimes.append(iConnectTimer.elapsed());
+}
+
+bool NntpConnection::isKnownMissing(const QByteArray &aMessageId) const {
+    return iMissingIndex && !aMessageId.isEmpty() && iMissingIndex->contains(aMessageId);
+}
+
+void NntpConnection::releaseResponses(){
+    if (!isHeld)
+        return;
+
+    isHeld = false;
+    QMetaObject::invokeMethod(this, "readHeldResponses", Qt::QueuedConnection);
+}
+
+void NntpConnection::readHeldResponses(){
+    // nothing to do if closed, pooled or held again in between
+    if (!isHeld && !isSplicing() && iRing && iFramer.getNumberOfPendingCommands() > 0
+            && iSocket->state() == QAbstractSocket::ConnectedState)
+        readResponses();
+}
+
+void NntpConnection::failFlights(){
+    for (Flight *&flight : iFlights){
+        if (flight){
+            flight->finish(false);
+            flight->deref();
+            flight = Q_NULLPTR;
+        }
+    }
+}
+
+void NntpConnection::sendData(const QByteArray &aData){
+#ifdef Q_OS_LINUX
+    if (isSplicing()){
+        // kept in order behind what the server hasn't taken yet
+        iSpliceOut.append(aData);
+        spliceSend();
+        return;
     }
 #endif
+    iSocket->write(aData);
+}
+
+qint64 NntpConnection::getBytesToWrite() const {
+    // the client is paused on it as on the Qt write buffer (isOutputFull)
+    return Connection::getBytesToWrite() + iSpliceOut.size();
+}
 
-    if(strncmp(lineArr.constData(), Nntp::getResponse(281), 2) != 0){
-        QString err("Wrong Authentication: response from '");
-        err += Nntp::AUTHINFO_PASS;
-        err += "' should start with 28... resp: ";
-        err += lineArr.constData();
+void NntpConnection::spliceSend(){
+#ifdef Q_OS_LINUX
+    int sent = 0;
+    while (sent < iSpliceOut.size()){
+        ssize_t n = ::send(iSpliceFd, iSpliceOut.constData() + sent, iSpliceOut.size() - sent,
+                           MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (n > 0){
+            sent += static_cast<int>(n);
+            continue;
+        }
+        int sendErrno = errno;
+        if (n < 0 && sendErrno == EINTR)
+            continue;
+        if (n < 0 && (sendErrno == EAGAIN || sendErrno == EWOULDBLOCK))
+            break; // the server socket is full (big article): the rest waits for iSendNotifier
+
+        QString err("Error writing on the splice socket: ");
+        err += strerror(sendErrno);
 #ifdef LOG_CONNECTION_ERRORS_BEFORE_EMIT_SIGNALS
         _log(err);
 #endif
         emit socketError(err);
-        return false;
+        return;
     }
+    iSpliceOut.remove(0, sent);
+    iSendNotifier->setEnabled(!iSpliceOut.isEmpty());
 
-    _log("> Authentication succeed");
-    emit authenticated();
-    return true;
+    if (isWriteBufferHigh && iSpliceOut.size() <= NntpProxy::getWriteBufferLow()){
+        isWriteBufferHigh = false;
+        emit writeBufferDrained(); // the client is read again
+    }
+#endif
 }
 
+void NntpConnection::emitResponseDone(){
+    QByteArray cmd, status;
+    qint64     size;
+    iFramer.takeResponse(cmd, status, size);
+    iFailovers.removeFirst();
+    iSentTimes.removeFirst();
+    recordResponseEnd(size);
 
-void NntpConnection::readyRead()
-{
-    while (iSocket->canReadLine()){
-        QByteArray line = iSocket->readLine();
+    Flight *flight = iFlights.takeFirst();
+    if (flight){
+        flight->finish(true);
+        flight->deref();
+    }
+
+    if (!iCacheKey.isEmpty()){
+        if (ArticleCache::isArticleResponse(status))
+            NntpProxy::getArticleCache()->insert(iCacheKey, iCacheData);
+        iCacheKey.clear();
+        iCacheData = QByteArray(); // the cache shares it
+    }
+
+    emit responseDone(cmd, status, size); // may send the next command
+}
+
+void NntpConnection::emitArticleMissing(){
+    QByteArray cmd, status;
+    qint64     size;
+    iFramer.takeResponse(cmd, status, size);
+    iFailovers.removeFirst();
+    iSentTimes.removeFirst();
+    recordResponseEnd(size);
+    Flight *flight = iFlights.takeFirst(); // given to the receiver
+
+    iCacheKey.clear();
+    iCacheData = QByteArray();
+
+    // the responses of the next commands must not overtake the one of another server
+    isHeld = true;
+    emit articleMissing(cmd, status, flight);
+}
+
+void NntpConnection::recordResponseStart(){
+    qint64 now = iConnectTimer.elapsed();
+    if (!isResponseSlowed){
+        // pipelined commands: the server starts with this one once the previous response is sent
+        iScore->addFirstByteTime(now - qMax(iSentTimes.first(), iLastResponseEnd));
+    }
+    iResponseStart   = now;
+    isResponseSlowed = false;
+}
+
+void NntpConnection::recordResponseEnd(qint64 aSize){
+    iLastResponseEnd = iConnectTimer.elapsed();
+    if (!isResponseSlowed)
+        iScore->addTransfer(aSize, iLastResponseEnd - iResponseStart);
+}
+
+void NntpConnection::setShaping(const BandwidthShaper::Flow &aFlow){
+    clearShaping();
+    iShaping = aFlow;
+}
+
+void NntpConnection::clearShaping(){
+    if (iShapingTimer)
+        iShapingTimer->stop();
+    if (isWaitingBuckets){
+        isWaitingBuckets = false;
+        BandwidthShaper::addThrottledTime(iShaping, TokenBucket::now() - iThrottleStart);
+    }
+
+    BandwidthShaper *shaper = NntpProxy::getBandwidthShaper();
+    if (shaper)
+        shaper->release(iShaping);
+
+    ReadScheduler &scheduler = *iReadScheduler;
+    scheduler.leave(this);
+    if (isWaitingServer){
+        isWaitingServer = false;
+        scheduler.addThrottledTime(TokenBucket::now() - iThrottleStart);
+    }
+    scheduler.giveBack(iServerGrant);
+    iServerGrant = 0;
+}
+
+qint64 NntpConnection::shape(qint64 aWanted){
+    // ceiling of the server first: once reached, its connections are served in weighted order
+    ReadScheduler &scheduler = *iReadScheduler;
+    if (iServerGrant == 0){
+        iServerGrant = scheduler.take(this, aWanted);
+        if (iServerGrant == 0){
+            isWaitingServer = true;
+            iThrottleStart  = TokenBucket::now();
+            return 0; // readGranted
+        }
+    }
+
+    qint64 allowed = qMin(aWanted, iServerGrant);
+    if (BandwidthShaper::isAcquired(iShaping)){
+        qint64 delay = 0;
+        allowed = BandwidthShaper::take(iShaping, allowed, delay);
+        if (allowed == 0){
+            waitBuckets(delay); // the grant of the server is kept meanwhile
+            return 0;
+        }
+    }
+    iServerGrant -= allowed;
+    return allowed;
+}
+
+void NntpConnection::unshape(qint64 aBytes){
+    if (aBytes <= 0)
+        return;
+
+    BandwidthShaper::giveBack(iShaping, aBytes);
+    iReadScheduler->giveBack(aBytes);
+}
+
+void NntpConnection::waitBuckets(qint64 aDelay){
+    // over the rate: the server socket isn't read meanwhile (its TCP window closes)
+    if (!iShapingTimer){
+        iShapingTimer = new QTimer(this);
+        iShapingTimer->setSingleShot(true);
+        iShapingTimer->setTimerType(Qt::PreciseTimer);
+        connect(iShapingTimer, &QTimer::timeout, this, &NntpConnection::shapingReady);
+    }
+    isWaitingBuckets = true;
+    iThrottleStart   = TokenBucket::now();
+    iShapingTimer->start(static_cast<int>((aDelay + 999999) / 1000000));
+}
+
+void NntpConnection::shapingReady(){
+    if (!isWaitingBuckets)
+        return;
+
+    isWaitingBuckets = false;
+    BandwidthShaper::addThrottledTime(iShaping, TokenBucket::now() - iThrottleStart);
+    resumeShaped();
+}
+
+void NntpConnection::readGranted(qint64 aBytes){
+    ReadScheduler &scheduler = *iReadScheduler;
+    if (!isWaitingServer){
+        scheduler.giveBack(aBytes); // left the scheduler meanwhile (released or closed)
+        return;
+    }
+
+    isWaitingServer = false;
+    iServerGrant   += aBytes;
+    scheduler.addThrottledTime(TokenBucket::now() - iThrottleStart);
+    resumeShaped();
+}
+
+void NntpConnection::resumeShaped(){
+    if (isSplicing()){
+        iReadNotifier->setEnabled(true);
+        spliceRead();
+    } else if (iRing && iFramer.getNumberOfPendingCommands() > 0)
+        readResponses();
+}
+
+void NntpConnection::readResponses(){
+    if (!iRing)
+        iRing = new RingBuffer(cForwardBufferSize);
+
+    while (true) {
+        forwardResponses();
+        if (iFramer.getNumberOfPendingCommands() == 0 || isPaused || isHeld || isThrottled())
+            return; // what follows (if anything) isn't part of a response, or the client is full (or over its rate)
+
+        // bulk read of whatever is available in the free contiguous space
+        qint64 len = iSocket->read(iRing->getWritePtr(), iRing->getWritableContiguous());
+        if (len <= 0)
+            return;
+        iRing->commit(len);
+    }
+}
+
+void NntpConnection::forwardResponses(){
+    while (!iRing->isEmpty() && iFramer.getNumberOfPendingCommands() > 0){
+        if (isHeld || isThrottled() || isOutputFull()){
+            isResponseSlowed = true; // the timing of the server isn't what we measure
+            return; // releaseResponses, shapingReady, readGranted, or resumeRead once the client has drained
+        }
+        ArticleCache *cache = NntpProxy::getArticleCache();
+        if (!iFramer.hasResponseStarted()){
+            recordResponseStart();
+            if (cache)
+                iCacheKey = ArticleCache::getKey(iFramer.getCurrentCommand());
+        }
+
+        const char *data    = iRing->getReadPtr();
+        qint64      allowed = shape(iRing->getReadableContiguous());
+        if (allowed == 0){
+            isResponseSlowed = true;
+            return; // shapingReady or readGranted
+        }
+        qint64      len     = iFramer.scan(data, allowed);
+        unshape(allowed - len); // the end of the response is before
+
+        if (!iCacheKey.isEmpty()){
+            if (iCacheData.size() + len <= cache->getMaxArticleSize())
+                iCacheData.append(data, static_cast<int>(len));
+            else {
+                iCacheKey.clear(); // too big for the cache
+                iCacheData = QByteArray();
+            }
+        }
 
 #ifdef LOG_NEWS_DATA
         QString str("Data In: ");
-        str += line;
+        str += QByteArray::fromRawData(data, static_cast<int>(len));
         _log(str);
 #endif
 
-        if (iOutputCon){
-            iOutputCon->write(line);
-            iDownloadSize += line.size();
-        } else {
-            closeConnection();
+        iDownloadSize += len;
+        iRing->consume(len);
+
+        if (iFailovers.first()){
+            // nothing is forwarded before the status line: a missing article is asked to another server
+            iHeldStatus.append(data, static_cast<int>(len)); // copied before the ring space is reused
+            if (!iFramer.isStatusLineRead())
+                continue;
+
+            iFailovers.first() = false;
+            if (iFramer.isEndOfResponse() && Failover::isMissing(iFramer.getStatusLine())){
+                iHeldStatus.clear();
+                emitArticleMissing();
+                continue;
+            }
+            data = iHeldStatus.constData();
+            len  = iHeldStatus.size();
         }
+
+        if (iOutputCon)
+            iOutputCon->write(data, len);
+        if (iFlights.first())
+            iFlights.first()->append(data, len);
+        iHeldStatus.clear();
+
+        if (iFramer.isEndOfResponse())
+            emitResponseDone(); // may send the next command, close or release the connection
     }
 }
 
+void NntpConnection::forwardUnsolicited(){
+    if (!iRing)
+        iRing = new RingBuffer(cForwardBufferSize);
+
+    while (true) {
+        while (!iRing->isEmpty()){
+            if (isOutputFull())
+                return;
+            const char *data = iRing->getReadPtr();
+            qint64      len  = iRing->getReadableContiguous();
+
+#ifdef LOG_NEWS_DATA
+            QString str("Data In: ");
+            str += QByteArray::fromRawData(data, static_cast<int>(len));
+            _log(str);
+#endif
+
+            iOutputCon->write(data, len);
+            iDownloadSize += len;
+            iRing->consume(len);
+        }
+
+        qint64 len = iSocket->read(iRing->getWritePtr(), iRing->getWritableContiguous());
+        if (len <= 0)
+            return;
+        iRing->commit(len);
+    }
+}
+
+qint64 NntpConnection::getBufferedSize() const {
+    qint64 size = Connection::getBufferedSize() + iPipeSize;
+    if (iRing)
+        size += iRing->size();
+    return size;
+}
+
+void NntpConnection::readyRead()
+{
+    if (iFramer.getNumberOfPendingCommands() > 0){
+        readResponses();
+        return;
+    }
+
+    if (iOutputCon)
+        forwardUnsolicited();
+    else
+        closeConnection();
+}
+
+
+bool NntpConnection::startSplice(Connection *aOutput){
+#ifdef Q_OS_LINUX
+    if (isSsl || NntpProxy::isClientSSL() || isSplicing())
+        return false;
+
+    // nothing must be left in the Qt buffers (it would be reordered)
+    if (iSocket->bytesAvailable() > 0 || (iRing && !iRing->isEmpty()) || !aOutput->flush())
+        return false;
+
+    if (pipe2(iPipe, O_NONBLOCK | O_CLOEXEC) == -1){
+        QString err("Error creating splice pipe: ");
+        err += strerror(errno);
+        _log(err);
+        return false;
+    }
+    fcntl(iPipe[1], F_SETPIPE_SZ, sPeekBufferSize);
+
+    // the client socket stays in Qt for the commands, we write on a dup
+    // so our notifier doesn't collide with the Qt ones
+    iSpliceOutFd = fcntl(static_cast<int>(aOutput->getSocketFd()), F_DUPFD_CLOEXEC, 0);
+    iSpliceFd    = fcntl(static_cast<int>(iSocket->socketDescriptor()), F_DUPFD_CLOEXEC, 0);
+    if (iSpliceOutFd == -1 || iSpliceFd == -1){
+        _log("Error duplicating the sockets for splice");
+        stopSplice(false);
+        return false;
+    }
+    fcntl(iSpliceFd, F_SETFL, fcntl(iSpliceFd, F_GETFL) | O_NONBLOCK);
+
+    // Qt releases its descriptor (no shutdown, the connection lives with our dup)
+    stopAsyncRead();
+    iSocket->blockSignals(true);
+    iSocket->abort();
+    iSocket->blockSignals(false);
+
+    iPeekBuffer.resize(sPeekBufferSize);
+    iReadNotifier  = new QSocketNotifier(iSpliceFd, QSocketNotifier::Read, this);
+    iWriteNotifier = new QSocketNotifier(iSpliceOutFd, QSocketNotifier::Write, this);
+    iSendNotifier  = new QSocketNotifier(iSpliceFd, QSocketNotifier::Write, this);
+    iWriteNotifier->setEnabled(false);
+    iSendNotifier->setEnabled(false);
+    connect(iReadNotifier,  &QSocketNotifier::activated, this, &NntpConnection::spliceRead);
+    connect(iWriteNotifier, &QSocketNotifier::activated, this, &NntpConnection::spliceWrite);
+    connect(iSendNotifier,  &QSocketNotifier::activated, this, &NntpConnection::spliceSend);
+
+    _log("Forwarding with splice()");
+    return true;
+#else
+    Q_UNUSED(aOutput);
+    return false;
+#endif
+}
+
+void NntpConnection::stopSplice(bool aRestoreSocket){
+#ifdef Q_OS_LINUX
+    delete iReadNotifier;
+    delete iWriteNotifier;
+    delete iSendNotifier;
+    iReadNotifier  = Q_NULLPTR;
+    iWriteNotifier = Q_NULLPTR;
+    iSendNotifier  = Q_NULLPTR;
+
+    if (iPipe[0] != -1){
+        ::close(iPipe[0]);
+        ::close(iPipe[1]);
+        iPipe[0] = iPipe[1] = -1;
+    }
+    if (iSpliceOutFd != -1){
+        ::close(iSpliceOutFd);
+        iSpliceOutFd = -1;
+    }
+
+    if (iSpliceFd != -1){
+        // give the socket back to Qt (pool) or close it
+        if (!aRestoreSocket || !iSocket->setSocketDescriptor(iSpliceFd))
+            ::close(iSpliceFd);
+        else if (!iSpliceOut.isEmpty())
+            iSocket->write(iSpliceOut); // what the server hasn't taken yet goes through Qt
+        iSpliceFd = -1;
+    }
+    iSpliceOut.clear();
+
+    iSpliceIn = iPipeSize = 0;
+    iSplicedCmds.clear();
+    iSplicedStatus.clear();
+    iSplicedSizes.clear();
+    iPeekBuffer.clear();
+#else
+    Q_UNUSED(aRestoreSocket);
+#endif
+}
+
+void NntpConnection::spliceRead(){
+#ifdef Q_OS_LINUX
+    if (iPipeSize > 0 || isThrottled())
+        return; // waiting for the client (or for the buckets or the server)
+    if (iSpliceIn > 0){
+        if (splicePump()) // what has been framed wasn't all in the socket yet
+            spliceWrite();
+        return;
+    }
+
+    qint64 allowed = shape(sPeekBufferSize);
+    if (allowed == 0){
+        iReadNotifier->setEnabled(false); // shapingReady or readGranted
+        return;
+    }
+
+    char *buf = iPeekBuffer.data();
+    ssize_t n = ::recv(iSpliceFd, buf, allowed, MSG_PEEK | MSG_DONTWAIT);
+    int recvErrno = errno; // before unshape
+    if (n <= 0)
+        unshape(allowed);
+    if (n == 0){
+        stopSplice(false);
+        disconnected();
+        return;
+    }
+    if (n < 0){
+        if (recvErrno == EAGAIN || recvErrno == EWOULDBLOCK || recvErrno == EINTR)
+            return;
+        QString err("Error reading on the splice socket: ");
+        err += strerror(recvErrno);
+#ifdef LOG_CONNECTION_ERRORS_BEFORE_EMIT_SIGNALS
+        _log(err);
+#endif
+        emit socketError(err);
+        return;
+    }
+
+    // frame what we've peeked, several responses may end in it
+    qint64 framed = 0;
+    while (framed < n){
+        framed += iFramer.scan(buf + framed, n - framed);
+        if (!iFramer.isEndOfResponse())
+            break;
+
+        QByteArray cmd, status;
+        qint64     size;
+        iFramer.takeResponse(cmd, status, size);
+        iFailovers.removeFirst(); // no failover on the splice path
+        iSentTimes.removeFirst(); // nor timing
+        Flight *flight = iFlights.takeFirst();
+        if (flight){ // the response isn't seen on the splice path
+            flight->finish(false);
+            flight->deref();
+        }
+        iSplicedCmds.append(cmd);
+        iSplicedStatus.append(status);
+        iSplicedSizes.append(size);
+    }
+
+    iSpliceIn      = framed;
+    iDownloadSize += framed;
+    unshape(allowed - framed);
+
+    if (splicePump())
+        spliceWrite();
+#endif
+}
+
+bool NntpConnection::splicePump(){
+#ifdef Q_OS_LINUX
+    while (iSpliceIn > 0 || iPipeSize > 0){
+        if (iSpliceIn > 0){
+            ssize_t n = splice(iSpliceFd, Q_NULLPTR, iPipe[1], Q_NULLPTR, iSpliceIn,
+                               SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+            int spliceErrno = errno;
+            if (n > 0){
+                iSpliceIn -= n;
+                iPipeSize += n;
+            } else if (n == 0 || (n < 0 && spliceErrno == EAGAIN)){
+                if (iPipeSize == 0){
+                    // nothing to move: wait for the next read notification (spliceRead)
+                    iWriteNotifier->setEnabled(false);
+                    iReadNotifier->setEnabled(true);
+                    return false;
+                }
+            } else if (n < 0 && spliceErrno != EINTR){
+                QString err("Error splicing from the server: ");
+                err += strerror(spliceErrno);
+                _log(err);
+                emit socketError(err);
+                return false;
+            }
+        }
+
+        if (iPipeSize > 0){
+            ssize_t n = splice(iPipe[0], Q_NULLPTR, iSpliceOutFd, Q_NULLPTR, iPipeSize,
+                               SPLICE_F_MOVE | SPLICE_F_NONBLOCK | SPLICE_F_MORE);
+            int spliceErrno = errno;
+            if (n > 0)
+                iPipeSize -= n;
+            else if (n < 0 && (spliceErrno == EAGAIN || spliceErrno == EINTR)){
+                // client not ready: stop reading the server until it is
+                iReadNotifier->setEnabled(false);
+                iWriteNotifier->setEnabled(true);
+                return false;
+            } else {
+                QString err("Error splicing to the client: ");
+                err += strerror(spliceErrno);
+                _log(err);
+                emit socketError(err);
+                return false;
+            }
+        }
+    }
+    return true;
+#else
+    return true;
+#endif
+}
+
+void NntpConnection::spliceWrite(){
+#ifdef Q_OS_LINUX
+    if (!splicePump())
+        return;
+
+    iWriteNotifier->setEnabled(false);
+    iReadNotifier->setEnabled(true);
+
+    // the data of these responses has been given to the client
+    while (!iSplicedCmds.isEmpty()){
+        QByteArray cmd    = iSplicedCmds.takeFirst();
+        QByteArray status = iSplicedStatus.takeFirst();
+        qint64     size   = iSplicedSizes.takeFirst();
+        emit responseDone(cmd, status, size); // may send the next command
+        if (!isSplicing())
+            return; // closed in between
+    }
+#endif
+}
 
 void NntpConnection::closeConnection(){
     // Stop async read
     Connection::closeConnection();
+    failFlights();
+
+    if (isSplicing())
+        stopSplice(false);
 
     // close input socket
     if (iSocket && iSocket->isOpen())
@@ -140,7 +837,7 @@ void NntpConnection::closeConnection(){
     if (iOutputCon) {
         iOutputCon->setOutput(Q_NULLPTR); // To avoid circular calls
         iOutputCon->closeConnection();
-        iOutputCon = Q_NULLPTR;
+        setOutput(Q_NULLPTR);
     }
 }
 
@@ -148,5 +845,6 @@ void NntpConnection::closeConnection(){
 
 void NntpConnection::disconnected(){
     _log("Disconnected...");
+    failFlights();
     emit closed();
 }
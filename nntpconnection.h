@@ -3,9 +3,41 @@
 
 #include "connection.h"
 #include "nntpserver.h"
+#include "responseframer.h"
+#include "ringbuffer.h"
+#include "singleflight.h"
+#include "bandwidthshaper.h"
+
+#include <QElapsedTimer>
+
+QT_FORWARD_DECLARE_CLASS(QSocketNotifier)
+QT_FORWARD_DECLARE_CLASS(QTimer)
 
 /*!
  * \brief Nntp Client Connection (connect to a server with SSL or not)
+ * The AUTHINFO USER/PASS handshake is an asynchronous state machine driven by readyRead,
+ * started automatically once Connection::connected() is emitted.
+ * It ends with authenticated() or socketError().
+ *
+ * Once authenticated, a connection can be kept idle in the pool of its NntpServer
+ * (no thread affinity while pooled) and reused by another session.
+ *
+ * Commands sent with sendCommand() are framed: the responses are still forwarded to
+ * iOutputCon (or dropped if there is none) and responseDone() is emitted at the end of each one.
+ * The data is read in bulk in a fixed ring buffer (allocated once, kept while pooled)
+ * and forwarded in chunks: no line splitting nor allocation per line.
+ * The article responses by message-id are also kept to fill the ArticleCache (if enabled)
+ * and given to the Flight of the command if other sessions are waiting for the same article.
+ *
+ * The responses of the commands sent for failover are only forwarded once their status line is known:
+ * a missing article (430/423) isn't forwarded, articleMissing() is emitted instead of responseDone()
+ * and the next responses are held till releaseResponses() (another server answers meanwhile).
+ *
+ * On Linux, with plaintext sockets on both sides, the responses can be forwarded with splice()
+ * (startSplice): the socket is taken from Qt, the data is only peeked to be framed and goes
+ * from the server socket to the client one through a pipe without being copied in user space.
+ * What the client sends meanwhile (article of a POST) is buffered while the server socket is full
+ * and the client isn't read till it drained (iSpliceOut counts in getBytesToWrite).
  */
 class NntpConnection  : public Connection
 {
@@ -19,16 +51,76 @@ public:
      */
     explicit NntpConnection(qintptr aInputId,
                             const NntpServer & aServer);
+    ~NntpConnection(); //!< close the splice path if any, delete the ring buffer
     NntpConnection(const NntpConnection &)              = delete;
     NntpConnection(const NntpConnection &&)             = delete;
     NntpConnection & operator=(const NntpConnection &)  = delete;
     NntpConnection & operator=(const NntpConnection &&) = delete;
 
+    enum AuthState{ //!< steps of the asynchronous authentication
+        NotAuthenticated = 0,
+        WaitUserResponse = 1,
+        WaitPassResponse = 2,
+        Authenticated    = 3
+    };
+
     inline ushort getServerId() const;            //!< return the server Id
     inline const QString & getServerHost() const; //!< return the server hostname
     inline ushort getServerPort() const;          //!< return the server port
 
-    bool doAuthentication();              //!< do the Nntp Authentication steps
+    inline bool isAuthenticated() const;  //!< is the connection ready for commands
+
+    /*!
+     * \brief detach the connection from its session so it can be pooled by its NntpServer
+     * (must be called from the thread of the connection, it won't have any thread affinity after)
+     */
+    void releaseToPool();
+
+    /*!
+     * \brief pull a pooled connection in the current thread and check it is still usable
+     * \param aInputId    : input socket id of the new session
+     * \param aMaxIdleMs  : maximum time the connection may have stayed idle
+     * \return false if the connection is not healthy anymore (to be deleted)
+     */
+    bool acquireFromPool(qintptr aInputId, qint64 aMaxIdleMs);
+
+    /*!
+     * \brief write a command whose response has to be framed (responseDone emitted at its end)
+     * \param aCmd    : full command line (ending with \r\n)
+     * \param aFlight : Flight to feed with the response (SingleFlight::lead, the connection takes the reference)
+     * \param aFailover : hold the status line so a missing article can be asked to another server (articleMissing)
+     */
+    void sendCommand(const QByteArray &aCmd, Flight *aFlight = Q_NULLPTR, bool aFailover = false);
+
+    //! frame a response without sending a command (aCmd already written, like the article of a POST)
+    void expectResponse(const QByteArray &aCmd);
+
+    void sendData(const QByteArray &aData); //!< write raw data to the server (article of a POST)
+    qint64 getBytesToWrite() const override; //!< socket write buffer (or what waits to be sent on the splice socket)
+
+    /*!
+     * \brief forward the responses to aOutput with splice() (Linux, plaintext sockets only)
+     * \param aOutput : client connection (must be plaintext)
+     * \return false if the splice path can't be used (we stay on the Qt path)
+     */
+    bool startSplice(Connection *aOutput);
+    inline bool isSplicing() const; //!< is the splice path used
+
+    inline void holdResponses(); //!< hold the responses till releaseResponses() (a Failover answers first)
+    void releaseResponses(); //!< forward again the responses held since articleMissing() or holdResponses()
+    inline bool isHoldingResponses() const; //!< are the responses held since articleMissing()
+
+    bool isKnownMissing(const QByteArray &aMessageId) const; //!< is the article in the missing index of the server
+
+    //! limit the responses forwarded by the buckets of aFlow (BandwidthShaper::acquire, released with the connection)
+    void setShaping(const BandwidthShaper::Flow &aFlow);
+    inline const BandwidthShaper::Flow &getShaping() const; //!< buckets of the session (the cache hits are charged to them)
+    inline bool isThrottled() const; //!< is the forwarding waiting for the buckets of its Flow (or for its server)
+
+    inline int  getNumberOfPendingCommands() const; //!< number of commands sent still waiting for the end of their response
+    inline bool hasResponseStarted() const;         //!< has the response of the first pending command started
+
+    qint64 getBufferedSize() const; //!< socket buffers plus what is in the ring buffer (or in the splice pipe)
 
     inline ulong getDownloadSize() const; //!< return the downloaded size in Bytes (after authentication)
     inline uint getDownloadSizeMB() const;//!< return the downloaded size in MB (after authentication)
@@ -38,21 +130,120 @@ signals:
     void authenticated();    //!< Authentication succeed (server ready for commands)
     void serverRemoved();    //!< signal sent when the server is getting removed from the system
 
+    /*!
+     * \brief end of the response of a command sent with sendCommand
+     * \param aCmd        : the command
+     * \param aStatusLine : first line of the response
+     * \param aSize       : size of the whole response in Bytes
+     */
+    void responseDone(QByteArray aCmd, QByteArray aStatusLine, qint64 aSize);
+
+    /*!
+     * \brief the server doesn't have the article of a command sent for failover (nothing forwarded)
+     * emitted instead of responseDone, the next responses are held till releaseResponses()
+     * \param aCmd        : the command
+     * \param aStatusLine : 430 or 423 status line
+     * \param aFlight     : Flight of the command (the receiver takes the reference, Q_NULLPTR if none)
+     */
+    void articleMissing(QByteArray aCmd, QByteArray aStatusLine, Flight *aFlight);
+
 public slots:
+    bool doAuthentication(); //!< start the Nntp Authentication steps (connects to &Connection::connected)
+    void authRead();         //!< handle the AUTHINFO responses of the server
     void readyRead();        //!< Async Read, how to handle it
     void disconnected();     //!< What to do on socket disconnection
     void closeConnection();  //!< How to close the connection
 
+    void spliceRead();  //!< splice path: the server socket is readable
+    void spliceWrite(); //!< splice path: the client socket is writable again
+    void spliceSend();  //!< splice path: send iSpliceOut to the server (the server socket is writable again)
+
+    void readHeldResponses(); //!< forward what arrived while the responses were held (queued by releaseResponses)
+    void readGranted(qint64 aBytes); //!< queued by the ReadScheduler of the server: aBytes can be read
+
+private:
+    void readResponses();    //!< forward the responses of the pending commands detecting their ends
+    void forwardResponses(); //!< forward what is buffered in iRing up to the end of the last pending response
+    void forwardUnsolicited(); //!< forward data that isn't part of any response (server messages)
+    void emitResponseDone(); //!< pop the response that just ended from iFramer and emit responseDone
+    void emitArticleMissing(); //!< pop the missing article response from iFramer, hold the next ones and emit articleMissing
+    void failFlights();      //!< the responses won't come: fail the Flights of the pending commands
+    void recordResponseStart();            //!< first byte of the current response: time to first byte sample
+    void recordResponseEnd(qint64 aSize);  //!< end of the current response: throughput sample
+
+    qint64 shape(qint64 aWanted); //!< bytes of aWanted the server and the buckets of iShaping allow now (0: wait)
+    void unshape(qint64 aBytes);  //!< bytes allowed by shape but not read nor forwarded
+    void waitBuckets(qint64 aDelay); //!< stop reading for aDelay ns (over the rate of the buckets of iShaping)
+    void shapingReady();          //!< iShapingTimer: the buckets have tokens again, forward what is waiting
+    void resumeShaped();          //!< read and forward again after a wait for the buckets or the server
+    void clearShaping();          //!< release iShaping and leave the ReadScheduler of the server (stop waiting)
+
+    bool splicePump();    //!< move the framed bytes from the server socket to the client one (false if blocked)
+    void stopSplice(bool aRestoreSocket); //!< leave the splice path (give the socket back to Qt or close it)
+
 private:
     const NntpServer & iServer;        //!< handle to its server
+    const ushort       iServerId;      //!< id of its server (kept if the server is removed before us)
+    QSharedPointer<ServerScore> iScore; //!< performance of its server (kept if the server is removed before us)
+    QSharedPointer<ReadScheduler> iReadScheduler; //!< bandwidth ceiling of its server (idem)
+    QSharedPointer<BloomFilter> iMissingIndex; //!< missing index of its server (idem, null if disabled)
     ulong              iDownloadSize;  //!< Bytes received (after authentication)
+    AuthState          iAuthState;     //!< current step of the authentication
+    std::string        iAuthPass;      //!< decrypted pass to send once the user is accepted
+    QElapsedTimer      iIdleTimer;     //!< time spent in the pool of the server
+
+    ResponseFramer     iFramer;        //!< framing of the responses of the commands sent
+    RingBuffer        *iRing;          //!< data read from the server not forwarded yet (owns it, lazy allocation)
+    QByteArray         iCacheKey;      //!< ArticleCache key of the current response (empty if not cached)
+    QByteArray         iCacheData;     //!< current response kept for the ArticleCache
+    QList<Flight *>    iFlights;       //!< Flights of the pending commands (Q_NULLPTR if none), aligned with iFramer
+    QList<bool>        iFailovers;     //!< are the pending commands sent for failover, aligned with iFramer
+    QByteArray         iHeldStatus;    //!< beginning of the current response held till its status line is complete
+    bool               isHeld;         //!< responses held since articleMissing
+    QList<qint64>      iSentTimes;     //!< iConnectTimer time of the pending commands, aligned with iFramer
+    qint64             iResponseStart; //!< iConnectTimer time of the first byte of the current response
+    qint64             iLastResponseEnd; //!< iConnectTimer time of the end of the last response
+    bool               isResponseSlowed; //!< the current response waited for the client (no ServerScore sample)
+
+    // bandwidth shaping
+    BandwidthShaper::Flow iShaping;    //!< buckets of the user the responses are forwarded to
+    QTimer            *iShapingTimer;  //!< end of the wait for the buckets (owns it, lazy allocation)
+    bool               isWaitingBuckets; //!< waiting for the buckets: nothing is read nor forwarded
+    bool               isWaitingServer;  //!< waiting for a grant of the ReadScheduler of the server (readGranted)
+    qint64             iServerGrant;   //!< bytes taken from the ReadScheduler not allowed by shape yet
+    qint64             iThrottleStart; //!< TokenBucket::now() at the start of the wait
+
+    // splice path (Linux)
+    int                iSpliceFd;      //!< server socket taken from Qt (-1 if not splicing)
+    int                iSpliceOutFd;   //!< dup of the client socket
+    int                iPipe[2];       //!< pipe between the two sockets
+    qint64             iSpliceIn;      //!< bytes framed still to move from the server socket to the pipe
+    qint64             iPipeSize;      //!< bytes in the pipe still to write to the client
+    QList<QByteArray>  iSplicedCmds;   //!< commands of the responses ended in the bytes being moved
+    QList<QByteArray>  iSplicedStatus; //!< status lines of the responses ended in the bytes being moved
+    QList<qint64>      iSplicedSizes;  //!< sizes of the responses ended in the bytes being moved
+    QByteArray         iPeekBuffer;    //!< where the server data is peeked to be framed (fixed size)
+    QSocketNotifier   *iReadNotifier;  //!< server socket readable (owns it)
+    QSocketNotifier   *iWriteNotifier; //!< client socket writable (owns it)
+    QSocketNotifier   *iSendNotifier;  //!< server socket writable, armed while iSpliceOut isn't empty (owns it)
+    QByteArray         iSpliceOut;     //!< client data (article of a POST) the server socket hasn't taken yet
 
 };
 
-ushort NntpConnection::getServerId() const {return iServer.getId();}
+ushort NntpConnection::getServerId() const {return iServerId;}
 const QString & NntpConnection::getServerHost() const{return iServer.getName();}
 ushort NntpConnection::getServerPort() const{return iServer.getPort();}
 
+bool NntpConnection::isAuthenticated() const {return iAuthState == AuthState::Authenticated;}
+bool NntpConnection::isThrottled() const {return isWaitingBuckets || isWaitingServer;}
+const BandwidthShaper::Flow &NntpConnection::getShaping() const {return iShaping;}
+
+int  NntpConnection::getNumberOfPendingCommands() const {return iFramer.getNumberOfPendingCommands();}
+bool NntpConnection::hasResponseStarted() const {return iFramer.hasResponseStarted();}
+bool NntpConnection::isSplicing() const {return iSpliceFd != -1;}
+void NntpConnection::holdResponses(){isHeld = true;}
+bool NntpConnection::isHoldingResponses() const {return isHeld;}
+
 ulong NntpConnection::getDownloadSize() const {return iDownloadSize;}
 uint NntpConnection::getDownloadSizeMB() const {return iDownloadSize/1048576;}
 #endif // NNTPCONNECTION_H
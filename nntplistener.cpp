@@ -0,0 +1,113 @@
+#include "nntplistener.h"
+#include "nntpproxy.h"
+#include "worker.h"
+#include "sessionmanager.h"
+#include "sessionhandler.h"
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <unistd.h>
+#include <cstring>
+#include <cerrno>
+
+NntpListener::NntpListener(Worker *aWorker, SessionManager &aSessionMgr):
+    QTcpServer(), iWorker(aWorker), iSessionMgr(aSessionMgr),
+    iLogPrefix(QString("NntpListener").append("[").append(QString::number(aWorker->getId())).append("] "))
+{
+#ifdef LOG_CONSTRUCTORS
+    _log("Constructor");
+#endif
+    connect(this, &NntpListener::startListening, this, &NntpListener::attachSocket);
+}
+
+NntpListener::~NntpListener(){
+#ifdef LOG_CONSTRUCTORS
+    _log("Destructor");
+#endif
+}
+
+qintptr NntpListener::openReusePortSocket(ushort aPort){
+#ifdef SO_REUSEPORT
+    int on = 1, off = 0;
+
+    // Dual stack socket like QHostAddress::Any, fallback on IPv4 only
+    int fd = ::socket(AF_INET6, SOCK_STREAM, 0);
+    if (fd != -1){
+        struct sockaddr_in6 addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin6_family = AF_INET6;
+        addr.sin6_addr   = in6addr_any;
+        addr.sin6_port   = htons(aPort);
+
+        if (::setsockopt(fd, IPPROTO_IPV6, IPV6_V6ONLY, &off, sizeof(off)) != 0
+                || ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on)) != 0
+                || ::setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on)) != 0
+                || ::bind(fd, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) != 0){
+            ::close(fd);
+            fd = -1;
+        }
+    }
+
+    if (fd == -1){
+        fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        if (fd == -1)
+            return -1;
+
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family      = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_ANY);
+        addr.sin_port        = htons(aPort);
+
+        if (::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on)) != 0
+                || ::setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on)) != 0
+                || ::bind(fd, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) != 0){
+            int error = errno; // the cause, not the one of close
+            ::close(fd);
+            errno = error;
+            return -1;
+        }
+    }
+
+    if (::listen(fd, SOMAXCONN) != 0){
+        int error = errno;
+        ::close(fd);
+        errno = error;
+        return -1;
+    }
+
+    return fd;
+#else
+    Q_UNUSED(aPort);
+    return -1;
+#endif
+}
+
+void NntpListener::attachSocket(qintptr aSocketDescriptor){
+    if (!setSocketDescriptor(aSocketDescriptor)){
+        QString err("Error attaching listening socket: ");
+        err += errorString();
+        _log(err);
+        ::close(aSocketDescriptor);
+        return;
+    }
+    _log("Listening (SO_REUSEPORT)");
+}
+
+void NntpListener::incomingConnection(qintptr aSocketDescriptor){
+
+    // We have a new connection
+    QString str("New incoming connection: ");
+    str += QString::number(aSocketDescriptor);
+    _log(str);
+
+    if (!NntpProxy::isAcceptingConnections()){
+        _log("Error, the proxy is not accepting connections");
+        return;
+    }
+
+    // The SessionHandler is created in the Worker Thread, no need to move it
+    SessionHandler *session = iSessionMgr.newSession(aSocketDescriptor, iWorker);
+
+    emit session->startConnection(); // direct call, we're already in the Worker thread
+}
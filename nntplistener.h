@@ -0,0 +1,71 @@
+#ifndef NNTPLISTENER_H
+#define NNTPLISTENER_H
+
+#include "constants.h"
+#include "nntpproxy.h" // inline log functions
+
+#include <QtNetwork/QTcpServer>
+
+QT_FORWARD_DECLARE_CLASS(Worker)
+QT_FORWARD_DECLARE_CLASS(SessionManager)
+
+/*!
+ * \brief Listening socket living in a Worker Thread (reusePort mode)
+ * - each Worker has its own socket bound to the same port with SO_REUSEPORT
+ *   so the kernel spreads the accepts between the Workers
+ * - the SessionHandlers are created locally in the Worker (no move between threads)
+ */
+class NntpListener : public QTcpServer
+{
+    Q_OBJECT
+
+public:
+    /*!
+     * \brief NntpListener constructor (created in main Thread then moved to its Worker)
+     * \param aWorker     : Worker where the listener and its sessions are running
+     * \param aSessionMgr : Manager used to create the SessionHandlers
+     */
+    explicit NntpListener(Worker *aWorker, SessionManager & aSessionMgr);
+    NntpListener(const NntpListener &)              = delete;
+    NntpListener(const NntpListener &&)             = delete;
+    NntpListener & operator=(const NntpListener &)  = delete;
+    NntpListener & operator=(const NntpListener &&) = delete;
+
+    ~NntpListener(); //!< trace destruction
+
+    /*!
+     * \brief open a listening socket on aPort with SO_REUSEPORT (Linux only)
+     * \param aPort : port to listen on (all addresses)
+     * \return the native socket descriptor or -1 on error (errno set)
+     */
+    static qintptr openReusePortSocket(ushort aPort);
+
+signals:
+    void startListening(qintptr aSocketDescriptor); //!< trigger &NntpListener::attachSocket in the Worker Thread
+
+public slots:
+    void attachSocket(qintptr aSocketDescriptor); //!< attach the listening socket opened by openReusePortSocket
+
+protected:
+    //! QTcpServer, create a SessionHandler via SessionManager directly in the Worker Thread
+    void incomingConnection(qintptr aSocketDescriptor);
+
+private:
+    inline void _log(const QString & aMessage) const; //!< Add a log line
+    inline void _log(const char*     aMessage) const; //!< Add a log line
+
+private:
+    Worker         *iWorker;     //!< Worker running the listener (DOES NOT own it)
+    SessionManager &iSessionMgr; //!< Handle on the SessionManager
+    const QString   iLogPrefix;  //!< log prefix
+};
+
+void NntpListener::_log(const char* aMessage) const {
+     NntpProxy::log(iLogPrefix, aMessage);
+}
+
+void NntpListener::_log(const QString & aMessage) const {
+     NntpProxy::log(iLogPrefix, aMessage);
+}
+
+#endif // NNTPLISTENER_H
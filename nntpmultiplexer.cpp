@@ -0,0 +1,654 @@
+#include "nntpmultiplexer.h"
+#include "nntpservermanager.h"
+#include "nntpconnection.h"
+#include "inputconnection.h"
+#include "user.h"
+#include "nntp.h"
+#include "articlecache.h"
+#include "singleflight.h"
+#include "failover.h"
+#include "tokenbucket.h"
+
+#include <QTimer>
+
+NntpMultiplexer::NntpMultiplexer(ushort aId, NntpServerManager &aSrvMgr):
+    QObject(), iId(aId), iSrvMgr(aSrvMgr),
+    iClients(), iReadyClients(), iThrottledClients(), iBackends(), iIdleBackends(), iNbConnecting(0),
+    iRetryTimer(new QTimer(this)), iIdleTimer(new QTimer(this)), iShapingTimer(new QTimer(this)),
+    iLogPrefix(QString("NntpMultiplexer").append("[").append(QString::number(iId)).append("] "))
+{
+#ifdef LOG_CONSTRUCTORS
+    _log("Constructor");
+#endif
+    iRetryTimer->setSingleShot(true);
+    iRetryTimer->setInterval(cMuxRetryDelay);
+    connect(iRetryTimer, &QTimer::timeout, this, &NntpMultiplexer::dispatch);
+
+    iIdleTimer->setInterval(1000);
+    connect(iIdleTimer, &QTimer::timeout, this, &NntpMultiplexer::releaseIdleBackends);
+
+    iShapingTimer->setSingleShot(true);
+    iShapingTimer->setTimerType(Qt::PreciseTimer);
+    connect(iShapingTimer, &QTimer::timeout, this, &NntpMultiplexer::shapingReady);
+}
+
+NntpMultiplexer::~NntpMultiplexer(){
+#ifdef LOG_CONSTRUCTORS
+    _log("Destructor");
+#endif
+    for (Backend *backend : iBackends.values()){
+        backend->con->disconnect(this);
+        backend->con->setOutput(Q_NULLPTR);
+        iSrvMgr.releaseNntpConnection(backend->con);
+        delete backend->con;
+        delete backend;
+    }
+    iBackends.clear();
+
+    BandwidthShaper *shaper = NntpProxy::getBandwidthShaper();
+    for (Client *client : iClients.values()){
+        releaseFlight(client);
+        delete client->failover;
+        if (shaper)
+            shaper->release(client->shaping);
+    }
+    qDeleteAll(iClients);
+    iClients.clear();
+}
+
+
+void NntpMultiplexer::addClient(InputConnection *aInput, User *aUser){
+    Client *client = new Client();
+    client->input  = aInput;
+    client->user   = aUser;
+    client->isBusy = false;
+    client->flight = Q_NULLPTR;
+    client->flightOffset = 0;
+    client->failover = Q_NULLPTR;
+    client->shapedUntil = 0;
+    if (BandwidthShaper *shaper = NntpProxy::getBandwidthShaper())
+        client->shaping = shaper->acquire(aUser->getLogin(), aUser->getIp());
+    else
+        client->shaping = BandwidthShaper::Flow();
+    iClients.insert(aInput, client);
+    connect(aInput, &Connection::writeBufferDrained, this, &NntpMultiplexer::flightUpdated);
+
+    // timers have to be started from the thread of the Worker
+    if (!iIdleTimer->isActive())
+        iIdleTimer->start();
+}
+
+void NntpMultiplexer::removeClient(InputConnection *aInput){
+    Client *client = iClients.take(aInput);
+    if (client == Q_NULLPTR)
+        return;
+
+    iReadyClients.removeOne(client);
+    iThrottledClients.removeOne(client);
+    releaseFlight(client);
+    delete client->failover; // before the input it writes to
+    if (BandwidthShaper *shaper = NntpProxy::getBandwidthShaper())
+        shaper->release(client->shaping);
+
+    // the response in flight will be dropped
+    for (Backend *backend : iBackends.values()){
+        if (backend->client == client){
+            backend->client = Q_NULLPTR;
+            backend->con->setOutput(Q_NULLPTR);
+        }
+    }
+
+    delete client;
+}
+
+
+void NntpMultiplexer::clientCommand(QByteArray aCmd){
+    InputConnection *input = static_cast<InputConnection *>(sender());
+    Client *client = iClients.value(input, Q_NULLPTR);
+    if (client == Q_NULLPTR)
+        return;
+
+    // commands followed by a data block from the client can't be multiplexed
+    const char *cmd = aCmd.constData();
+    if (Nntp::isCommand(cmd, "POST") || Nntp::isCommand(cmd, "IHAVE")){
+        input->write(Nntp::getResponse(440));
+        return;
+    }
+
+    input->recordCommand(aCmd);
+    client->cmds.append(aCmd);
+    if (!client->isBusy && client->cmds.size() == 1){
+        iReadyClients.append(client);
+        dispatch();
+    }
+}
+
+
+void NntpMultiplexer::dispatch(){
+    while (!iReadyClients.isEmpty()){
+        // the client waits till it is back under its rate (shapingReady)
+        if (isOverRate(iReadyClients.first())){
+            iThrottledClients.append(iReadyClients.takeFirst());
+            continue;
+        }
+
+        // QUIT doesn't need a backend
+        if (Nntp::isCommand(iReadyClients.first()->cmds.first().constData(), "QUIT")){
+            clientQuit(iReadyClients.takeFirst());
+            continue;
+        }
+
+        // neither does an article of the cache
+        if (serveFromCache(iReadyClients.first())){
+            Client *client = iReadyClients.takeFirst();
+            if (!client->cmds.isEmpty())
+                iReadyClients.append(client);
+            continue;
+        }
+
+        // or an article being fetched for another session
+        if (followFlight(iReadyClients.first())){
+            iReadyClients.removeFirst();
+            continue;
+        }
+
+        if (iIdleBackends.isEmpty()){
+            if (iNbConnecting >= iReadyClients.size())
+                return; // the backends connecting will dispatch
+
+            if (!borrowBackend()){
+                if (iNbConnecting == 0 && !iRetryTimer->isActive())
+                    iRetryTimer->start();
+                return;
+            }
+            continue;
+        }
+
+        Client *client = iReadyClients.takeFirst();
+
+        // prefer a backend already in the group of the client (no replay)
+        Backend *backend = Q_NULLPTR;
+        for (int i = iIdleBackends.size() - 1; i >= 0; --i){
+            if (iIdleBackends[i]->group == client->group){
+                backend = iIdleBackends.takeAt(i);
+                break;
+            }
+        }
+        if (backend == Q_NULLPTR)
+            backend = iIdleBackends.takeLast();
+
+        startCommand(backend, client);
+    }
+}
+
+bool NntpMultiplexer::borrowBackend(){
+    NntpConnection *con = iSrvMgr.getSharedNntpConnection(iId);
+    if (con == Q_NULLPTR)
+        return false;
+
+    Backend *backend         = new Backend();
+    backend->con             = con;
+    backend->client          = Q_NULLPTR;
+    backend->isClientCmdSent = false;
+    backend->isConnecting    = false;
+    iBackends.insert(con, backend);
+
+    connect(con, &NntpConnection::responseDone,  this, &NntpMultiplexer::backendResponseDone);
+    connect(con, &NntpConnection::closed,        this, &NntpMultiplexer::backendClosed);
+    connect(con, &Connection::socketError,       this, &NntpMultiplexer::backendError);
+    connect(con, &NntpConnection::serverRemoved, this, &NntpMultiplexer::backendServerRemoved);
+    connect(con, &NntpConnection::articleMissing, this, &NntpMultiplexer::backendArticleMissing);
+
+    // Connection from the warm pool of the server: ready to use
+    if (con->isAuthenticated()){
+        con->startAsyncRead();
+        setIdle(backend);
+        return true;
+    }
+
+    connect(con, &NntpConnection::authenticated, this, &NntpMultiplexer::backendAuthenticated);
+    backend->isConnecting = true;
+    ++iNbConnecting;
+    if (!con->startTcpConnection(con->getServerHost().toStdString().c_str(), con->getServerPort())){
+        _log("Error starting a backend connection...");
+        dropBackend(backend);
+        return false;
+    }
+    return true;
+}
+
+void NntpMultiplexer::dropBackend(Backend *aBackend, bool aRelease){
+    NntpConnection *con = aBackend->con;
+    iBackends.remove(con);
+    iIdleBackends.removeOne(aBackend);
+    if (aBackend->isConnecting)
+        --iNbConnecting;
+
+    con->disconnect(this);
+    con->setOutput(Q_NULLPTR);
+    if (aRelease)
+        iSrvMgr.releaseNntpConnection(con);
+    con->deleteLater(); // we may be in one of its signals
+
+    delete aBackend;
+}
+
+void NntpMultiplexer::setIdle(Backend *aBackend){
+    aBackend->client          = Q_NULLPTR;
+    aBackend->isClientCmdSent = false;
+    aBackend->con->setOutput(Q_NULLPTR);
+    aBackend->idleTimer.start();
+    iIdleBackends.append(aBackend);
+}
+
+
+void NntpMultiplexer::startCommand(Backend *aBackend, Client *aClient){
+    aClient->isBusy = true;
+
+    const QByteArray &cmd = aClient->cmds.first();
+    if (Failover::canFailover(cmd) && aBackend->con->isKnownMissing(Failover::getMessageId(cmd))){
+        // the server of the backend said no recently: straight to the next ones
+        ushort servId = aBackend->con->getServerId();
+        iSrvMgr.addSkipped(servId);
+        setIdle(aBackend);
+        startFailover(aClient, cmd, QByteArray(Nntp::getResponse(430)), servId, leadFlight(cmd));
+        return;
+    }
+
+    aBackend->client          = aClient;
+    aBackend->isClientCmdSent = false;
+    aBackend->replay = getReplay(cmd, aClient->group, aClient->article, aBackend->group, aBackend->article);
+
+    sendNext(aBackend);
+}
+
+QList<QByteArray> NntpMultiplexer::getReplay(const QByteArray &aCmd,
+                                             const QByteArray &aClientGroup, const QByteArray &aClientArticle,
+                                             const QByteArray &aBackendGroup, const QByteArray &aBackendArticle){
+    QList<QByteArray> replay;
+    if (!isGroupCommand(aCmd) || aClientGroup.isEmpty())
+        return replay;
+
+    QByteArray backendArticle = aBackendArticle;
+    if (aClientGroup != aBackendGroup){
+        replay.append(QByteArray("GROUP ").append(aClientGroup).append(Nntp::ENDLINE));
+        backendArticle.clear(); // the GROUP resets the current article
+    }
+
+    // only commands without argument use the current article
+    if (getArgument(aCmd).isEmpty() && aClientArticle != backendArticle){
+        if (aClientArticle.isEmpty()) // first article of the group: only a GROUP sets it back
+            replay.append(QByteArray("GROUP ").append(aClientGroup).append(Nntp::ENDLINE));
+        else
+            replay.append(QByteArray("STAT ").append(aClientArticle).append(Nntp::ENDLINE));
+    }
+    return replay;
+}
+
+void NntpMultiplexer::sendNext(Backend *aBackend){
+    if (!aBackend->replay.isEmpty()){
+        aBackend->con->setOutput(Q_NULLPTR); // the client doesn't see the replay
+        aBackend->con->sendCommand(aBackend->replay.takeFirst());
+    } else {
+        aBackend->con->setOutput(aBackend->client->input);
+        aBackend->isClientCmdSent = true;
+        const QByteArray &cmd = aBackend->client->cmds.first();
+        aBackend->con->sendCommand(cmd, leadFlight(cmd), Failover::canFailover(cmd));
+    }
+}
+
+
+void NntpMultiplexer::backendAuthenticated(){
+    Backend *backend = iBackends.value(static_cast<NntpConnection *>(sender()), Q_NULLPTR);
+    if (backend == Q_NULLPTR)
+        return;
+
+    backend->isConnecting = false;
+    --iNbConnecting;
+    backend->con->startAsyncRead();
+    setIdle(backend);
+    dispatch();
+}
+
+void NntpMultiplexer::backendResponseDone(QByteArray aCmd, QByteArray aStatusLine, qint64 aSize){
+    Backend *backend = iBackends.value(static_cast<NntpConnection *>(sender()), Q_NULLPTR);
+    if (backend == Q_NULLPTR)
+        return;
+
+    updateState(aCmd, aStatusLine, backend->group, backend->article);
+
+    Client *client = backend->client;
+    if (client != Q_NULLPTR){
+        if (!backend->isClientCmdSent){
+            sendNext(backend); // still replaying the state of the client
+            return;
+        }
+
+        updateState(aCmd, aStatusLine, client->group, client->article);
+        client->cmds.removeFirst();
+        client->user->addDownloadSize(static_cast<ulong>(aSize));
+        chargeShaping(client, aSize); // forwarded unshaped by the shared backend
+        client->isBusy = false;
+        if (!client->cmds.isEmpty())
+            iReadyClients.append(client);
+    }
+
+    setIdle(backend);
+    dispatch();
+}
+
+void NntpMultiplexer::backendArticleMissing(QByteArray aCmd, QByteArray aStatusLine, Flight *aFlight){
+    Backend *backend = iBackends.value(static_cast<NntpConnection *>(sender()), Q_NULLPTR);
+    if (backend == Q_NULLPTR)
+        return;
+
+    // the backend only had this command: nothing held, ready for another client
+    Client *client = backend->client;
+    ushort servId  = backend->con->getServerId();
+    backend->con->releaseResponses();
+    setIdle(backend);
+
+    if (client == Q_NULLPTR){
+        // client gone: the followers fetch it themselves
+        if (aFlight){
+            aFlight->finish(false);
+            aFlight->deref();
+        }
+    } else
+        startFailover(client, aCmd, aStatusLine, servId, aFlight);
+    dispatch();
+}
+
+void NntpMultiplexer::startFailover(Client *aClient, const QByteArray &aCmd, const QByteArray &aStatusLine,
+                                    ushort aServerId, Flight *aFlight){
+    aClient->failover = new Failover(aClient->input->getId(), iSrvMgr, aClient->input,
+                                     aCmd, aStatusLine, aServerId, aFlight);
+    connect(aClient->failover, &Failover::done,   this, &NntpMultiplexer::failoverDone);
+    connect(aClient->failover, &Failover::failed, this, &NntpMultiplexer::failoverFailed);
+    aClient->failover->start();
+}
+
+NntpMultiplexer::Client *NntpMultiplexer::getFailoverClient(QObject *aFailover) const {
+    for (Client *client : iClients.values()){
+        if (client->failover == aFailover)
+            return client;
+    }
+    return Q_NULLPTR;
+}
+
+void NntpMultiplexer::failoverDone(QByteArray aCmd, QByteArray aStatusLine, qint64 aSize){
+    Q_UNUSED(aCmd);
+    Q_UNUSED(aStatusLine); // an article by message-id doesn't change the group nor the current article
+    Client *client = getFailoverClient(sender());
+    if (client == Q_NULLPTR)
+        return;
+
+    client->failover->deleteLater(); // we're in one of its signals
+    client->failover = Q_NULLPTR;
+
+    client->cmds.removeFirst();
+    client->user->addDownloadSize(static_cast<ulong>(aSize));
+    chargeShaping(client, aSize);
+    client->isBusy = false;
+    if (!client->cmds.isEmpty())
+        iReadyClients.append(client);
+    dispatch();
+}
+
+void NntpMultiplexer::failoverFailed(){
+    Client *client = getFailoverClient(sender());
+    if (client == Q_NULLPTR)
+        return;
+
+    client->failover->deleteLater();
+    client->failover = Q_NULLPTR;
+    _log("Failover lost in the middle of a response, closing the client...");
+    client->input->closeConnection();
+}
+
+void NntpMultiplexer::backendFailed(Backend *aBackend){
+    Client *client = aBackend->client;
+    if (client == Q_NULLPTR)
+        return;
+
+    aBackend->client = Q_NULLPTR;
+    client->isBusy   = false;
+    if (!aBackend->isClientCmdSent || !aBackend->con->hasResponseStarted()){
+        // nothing has been forwarded yet, another backend will answer
+        iReadyClients.prepend(client);
+    } else {
+        _log("Backend lost in the middle of a response, closing the client...");
+        client->input->closeConnection();
+    }
+}
+
+bool NntpMultiplexer::serveFromCache(Client *aClient){
+    ArticleCache *cache = NntpProxy::getArticleCache();
+    if (!cache)
+        return false;
+
+    QByteArray key = ArticleCache::getKey(aClient->cmds.first());
+    QByteArray response;
+    if (key.isEmpty() || !cache->get(key, response))
+        return false;
+
+    // an article by message-id doesn't change the group nor the current article
+    aClient->input->write(response);
+    aClient->user->addDownloadSize(static_cast<ulong>(response.size()));
+    chargeShaping(aClient, response.size());
+    aClient->cmds.removeFirst();
+    return true;
+}
+
+bool NntpMultiplexer::followFlight(Client *aClient){
+    SingleFlight *flights = NntpProxy::getSingleFlight();
+    if (!flights)
+        return false;
+
+    QByteArray key = ArticleCache::getKey(aClient->cmds.first());
+    if (key.isEmpty())
+        return false;
+
+    aClient->flight = flights->follow(key, this);
+    if (!aClient->flight)
+        return false;
+
+    aClient->flightOffset = 0;
+    aClient->isBusy       = true; // flightUpdated queued
+    return true;
+}
+
+void NntpMultiplexer::readFlight(Client *aClient){
+    if (aClient->input->isWriteBufferFull() || isOverRate(aClient))
+        return; // flightUpdated once it drains or shapingReady
+
+    QByteArray data;
+    Flight::STATE state = aClient->flight->read(this, aClient->flightOffset, data);
+    if (!data.isEmpty()){
+        aClient->input->write(data);
+        aClient->user->addDownloadSize(static_cast<ulong>(data.size()));
+        NntpProxy::getSingleFlight()->addBytesShared(data.size());
+        chargeShaping(aClient, data.size());
+    }
+    if (state == Flight::InProgress)
+        return;
+
+    releaseFlight(aClient);
+    aClient->isBusy = false;
+    if (state == Flight::Failed){
+        if (aClient->flightOffset > 0){
+            _log("Flight lost in the middle of a response, closing the client...");
+            aClient->input->closeConnection();
+        } else
+            iReadyClients.prepend(aClient); // nothing written yet, a backend will answer
+        return;
+    }
+
+    // an article by message-id doesn't change the group nor the current article
+    aClient->cmds.removeFirst();
+    if (!aClient->cmds.isEmpty())
+        iReadyClients.append(aClient);
+}
+
+void NntpMultiplexer::releaseFlight(Client *aClient){
+    if (!aClient->flight)
+        return;
+
+    aClient->flight->removeReader(this);
+    aClient->flight->deref();
+    aClient->flight = Q_NULLPTR;
+}
+
+void NntpMultiplexer::chargeShaping(Client *aClient, qint64 aBytes){
+    // already written: the buckets go in debt and the next commands of the client wait for them
+    qint64 delay = BandwidthShaper::charge(aClient->shaping, aBytes);
+    if (delay <= 0)
+        return;
+
+    qint64 now   = TokenBucket::now();
+    qint64 until = now + delay;
+    if (until <= aClient->shapedUntil)
+        return;
+
+    BandwidthShaper::addThrottledTime(aClient->shaping, until - qMax(now, aClient->shapedUntil));
+    aClient->shapedUntil = until;
+}
+
+bool NntpMultiplexer::isOverRate(Client *aClient){
+    if (aClient->shapedUntil == 0)
+        return false;
+
+    qint64 delay = aClient->shapedUntil - TokenBucket::now();
+    if (delay <= 0){
+        aClient->shapedUntil = 0;
+        return false;
+    }
+
+    int ms = static_cast<int>((delay + 999999) / 1000000);
+    if (!iShapingTimer->isActive() || iShapingTimer->remainingTime() > ms)
+        iShapingTimer->start(ms);
+    return true;
+}
+
+void NntpMultiplexer::shapingReady(){
+    // the ones still in debt go back to iThrottledClients and restart the timer
+    while (!iThrottledClients.isEmpty())
+        iReadyClients.append(iThrottledClients.takeFirst());
+    flightUpdated(); // and dispatch
+}
+
+Flight *NntpMultiplexer::leadFlight(const QByteArray &aCmd){
+    SingleFlight *flights = NntpProxy::getSingleFlight();
+    QByteArray key        = flights ? ArticleCache::getKey(aCmd) : QByteArray();
+    return key.isEmpty() ? Q_NULLPTR : flights->lead(key);
+}
+
+void NntpMultiplexer::flightUpdated(){
+    for (Client *client : iClients.values()){
+        if (client->flight)
+            readFlight(client);
+    }
+    dispatch();
+}
+
+void NntpMultiplexer::clientQuit(Client *aClient){
+    aClient->cmds.clear();
+    aClient->input->write(Nntp::getResponse(205));
+    aClient->input->closeConnection(); // the session will remove the client
+}
+
+void NntpMultiplexer::backendClosed(){
+    Backend *backend = iBackends.value(static_cast<NntpConnection *>(sender()), Q_NULLPTR);
+    if (backend == Q_NULLPTR)
+        return;
+
+    _log("Backend closed");
+    backendFailed(backend);
+    dropBackend(backend);
+    iRetryTimer->start();
+}
+
+void NntpMultiplexer::backendError(QString aError){
+    Backend *backend = iBackends.value(static_cast<NntpConnection *>(sender()), Q_NULLPTR);
+    if (backend == Q_NULLPTR)
+        return;
+
+    QString str("Backend error: ");
+    str += aError;
+    _log(str);
+    backendFailed(backend);
+    dropBackend(backend);
+    iRetryTimer->start();
+}
+
+void NntpMultiplexer::backendServerRemoved(){
+    Backend *backend = iBackends.value(static_cast<NntpConnection *>(sender()), Q_NULLPTR);
+    if (backend == Q_NULLPTR)
+        return;
+
+    _log("Backend server removed from the system...");
+    backendFailed(backend);
+    dropBackend(backend, false); // the server doesn't exist anymore
+    iRetryTimer->start();
+}
+
+void NntpMultiplexer::releaseIdleBackends(){
+    qint64 maxIdleMs = 1000 * static_cast<qint64>(cMuxBackendIdleTimeout);
+    for (int i = iIdleBackends.size() - 1; i >= 0; --i){
+        Backend *backend = iIdleBackends[i];
+        if (backend->idleTimer.elapsed() < maxIdleMs)
+            continue;
+
+        iIdleBackends.removeAt(i);
+        iBackends.remove(backend->con);
+        backend->con->disconnect(this);
+
+        if (!iSrvMgr.recycleNntpConnection(backend->con)){
+            iSrvMgr.releaseNntpConnection(backend->con);
+            delete backend->con;
+        }
+        delete backend;
+    }
+
+    if (iClients.isEmpty() && iBackends.isEmpty())
+        iIdleTimer->stop();
+}
+
+
+QByteArray NntpMultiplexer::getArgument(const QByteArray &aCmd){
+    QList<QByteArray> tokens = aCmd.simplified().split(' ');
+    return tokens.size() > 1 ? tokens[1] : QByteArray();
+}
+
+bool NntpMultiplexer::isGroupCommand(const QByteArray &aCmd){
+    const char *cmd = aCmd.constData();
+    if (Nntp::isMessageIdCommand(cmd))
+        return false;
+
+    static const char *sNoGroupCmds[] = {"GROUP", "LIST", "HELP", "CAPABILITIES", "DATE", "MODE",
+                                         "NEWGROUPS", "NEWNEWS", "XGTITLE", "QUIT"};
+    for (const char *noGroupCmd : sNoGroupCmds){
+        if (Nntp::isCommand(cmd, noGroupCmd))
+            return false;
+    }
+    return true;
+}
+
+void NntpMultiplexer::updateState(const QByteArray &aCmd, const QByteArray &aStatusLine,
+                                  QByteArray &aGroup, QByteArray &aArticle){
+    ushort code = Nntp::getResponseCode(aStatusLine.constData());
+    const char *cmd = aCmd.constData();
+
+    if (Nntp::isCommand(cmd, "GROUP") || Nntp::isCommand(cmd, "LISTGROUP")){
+        QByteArray group = getArgument(aCmd);
+        if (code == 211 && !group.isEmpty()){
+            aGroup = group;
+            aArticle.clear();
+        }
+    } else if (code >= 220 && code <= 223 && !Nntp::isMessageIdCommand(cmd)){
+        // ARTICLE/HEAD/BODY/STAT [n], NEXT, LAST: "22x n <message-id>"
+        QList<QByteArray> tokens = aStatusLine.simplified().split(' ');
+        if (tokens.size() > 1 && tokens[1] != "0")
+            aArticle = tokens[1];
+    }
+}
@@ -0,0 +1,178 @@
+#ifndef NNTPMULTIPLEXER_H
+#define NNTPMULTIPLEXER_H
+
+#include "constants.h"
+#include "nntpproxy.h"
+#include "bandwidthshaper.h"
+
+#include <QObject>
+#include <QHash>
+#include <QList>
+#include <QElapsedTimer>
+
+QT_FORWARD_DECLARE_CLASS(InputConnection)
+QT_FORWARD_DECLARE_CLASS(NntpConnection)
+QT_FORWARD_DECLARE_CLASS(NntpServerManager)
+QT_FORWARD_DECLARE_CLASS(User)
+QT_FORWARD_DECLARE_CLASS(Flight)
+QT_FORWARD_DECLARE_CLASS(Failover)
+QT_FORWARD_DECLARE_CLASS(QTimer)
+
+/*!
+ * \brief Command level multiplexing of the client sessions of a Worker over shared NntpConnections
+ * - one per Worker, living in its thread (so no locking between the sessions it serves)
+ * - each client command is queued and dispatched to any idle backend NntpConnection
+ *   (one command in flight per client, so each client still gets its responses in order)
+ * - the GROUP and current article of each client are tracked and replayed (GROUP / STAT)
+ *   on the chosen backend when its own state differs
+ * - the backends are borrowed from the NntpServerManager (no User accounting)
+ *   and given back to the pool of their server once they stay idle
+ * - the articles by message-id present in the ArticleCache are answered without backend
+ * - so are the ones being fetched for another session (SingleFlight): the client reads the response in flight
+ * - an article missing on the server of a backend (430/423) is asked to the other servers by a Failover
+ *   (the backend is free again meanwhile)
+ * - the responses forwarded to a client (backend, cache, Flight, Failover) are charged to the buckets of its user
+ *   and of its IP (BandwidthShaper): while they're in debt, its next commands wait (iThrottledClients)
+ * - POST and IHAVE are answered 440 (posting not permitted): the data block of the client would hold
+ *   a shared backend for as long as it sends it, the clients that post need multiplexing off
+ */
+class NntpMultiplexer : public QObject
+{
+    Q_OBJECT
+
+public:
+    /*!
+     * \brief NntpMultiplexer constructor
+     * \param aId     : id of the Worker (used for log purposes and as id of the backends)
+     * \param aSrvMgr : handle on the NntpServerManager to borrow the backends
+     */
+    explicit NntpMultiplexer(ushort aId, NntpServerManager & aSrvMgr);
+    NntpMultiplexer(const NntpMultiplexer &)              = delete;
+    NntpMultiplexer(const NntpMultiplexer &&)             = delete;
+    NntpMultiplexer & operator=(const NntpMultiplexer &)  = delete;
+    NntpMultiplexer & operator=(const NntpMultiplexer &&) = delete;
+
+    ~NntpMultiplexer(); //!< release all the backends
+
+    void addClient(InputConnection *aInput, User *aUser); //!< start multiplexing the commands of a session
+    void removeClient(InputConnection *aInput);           //!< drop the queued commands of a session (before its deletion)
+
+    inline int getNumberOfClients() const;  //!< number of sessions served
+    inline int getNumberOfBackends() const; //!< number of backends borrowed (connecting, busy or idle)
+
+    /*!
+     * \brief commands restoring the state of a client on a backend before one of its commands
+     * \param aCmd            : command of the client
+     * \param aClientGroup    : group selected by the client
+     * \param aClientArticle  : current article of the client (empty: first of the group)
+     * \param aBackendGroup   : group selected on the backend
+     * \param aBackendArticle : current article on the backend (empty: first of the group)
+     * \return GROUP and/or STAT to send first (empty if the state of the backend fits)
+     */
+    static QList<QByteArray> getReplay(const QByteArray &aCmd,
+                                       const QByteArray &aClientGroup, const QByteArray &aClientArticle,
+                                       const QByteArray &aBackendGroup, const QByteArray &aBackendArticle);
+
+    //! update the group/article state with a command and its response
+    static void updateState(const QByteArray &aCmd, const QByteArray &aStatusLine,
+                            QByteArray &aGroup, QByteArray &aArticle);
+
+public slots:
+    void clientCommand(QByteArray aCmd); //!< connects to &InputConnection::commandReceived
+
+    void backendAuthenticated(); //!< connects to &NntpConnection::authenticated
+    void backendResponseDone(QByteArray aCmd, QByteArray aStatusLine, qint64 aSize); //!< connects to &NntpConnection::responseDone
+    void backendClosed();                //!< connects to &NntpConnection::closed
+    void backendError(QString aError);   //!< connects to &Connection::socketError
+    void backendServerRemoved();         //!< connects to &NntpConnection::serverRemoved
+    void backendArticleMissing(QByteArray aCmd, QByteArray aStatusLine, Flight *aFlight); //!< connects to &NntpConnection::articleMissing
+
+    void failoverDone(QByteArray aCmd, QByteArray aStatusLine, qint64 aSize); //!< connects to &Failover::done
+    void failoverFailed();                                                    //!< connects to &Failover::failed
+
+    void dispatch();            //!< give the queued commands to the idle backends (borrow new ones if needed)
+    void shapingReady();        //!< iShapingTimer: the clients back under their rate are served again
+    void releaseIdleBackends(); //!< give back to their server the backends idle for too long
+
+    //! a Flight followed has new data (queued by Flight) or a client drained (&Connection::writeBufferDrained)
+    void flightUpdated();
+
+private:
+    struct Client{ //!< state of a session
+        InputConnection  *input;   //!< input connection of the session (not owned)
+        User             *user;    //!< user of the session (not owned)
+        QList<QByteArray> cmds;    //!< commands waiting (the first one is in flight when isBusy)
+        QByteArray        group;   //!< group selected by the client
+        QByteArray        article; //!< current article number of the client (empty: first of the group)
+        bool              isBusy;  //!< is a backend (or a Flight) serving the client
+        Flight           *flight;  //!< response of another session being read (holds a reference)
+        qint64            flightOffset; //!< bytes of flight already written to the client
+        Failover         *failover; //!< first command being asked to the other servers (owned)
+        BandwidthShaper::Flow shaping;  //!< buckets of the user and of its IP (released with the client)
+        qint64            shapedUntil;  //!< TokenBucket::now() until which the client is over its rate (0: it isn't)
+    };
+
+    struct Backend{ //!< state of a borrowed NntpConnection
+        NntpConnection   *con;             //!< the connection (owned)
+        Client           *client;          //!< client being served
+        QByteArray        group;           //!< group selected on the server
+        QByteArray        article;         //!< current article number on the server (empty: first of the group)
+        QList<QByteArray> replay;          //!< commands to send before the client one to restore its state
+        bool              isClientCmdSent; //!< has the client command been sent (or are we still replaying)
+        bool              isConnecting;    //!< handshake in progress
+        QElapsedTimer     idleTimer;       //!< time since the backend is idle
+    };
+
+    inline void _log(const QString & aMessage) const; //!< Add a log line
+    inline void _log(const char*     aMessage) const; //!< Add a log line
+
+    bool borrowBackend();                          //!< get a new backend from the NntpServerManager
+    void dropBackend(Backend *aBackend, bool aRelease = true); //!< disconnect and delete a backend
+    void setIdle(Backend *aBackend);               //!< backend ready for a new command
+    void startCommand(Backend *aBackend, Client *aClient); //!< prepare the replay and send the command of the client
+    void sendNext(Backend *aBackend);              //!< send the next replay command or the client one
+    void backendFailed(Backend *aBackend);         //!< requeue or close the client of a failing backend
+    void clientQuit(Client *aClient);              //!< answer the QUIT of a client (all its previous commands are done)
+    bool serveFromCache(Client *aClient);          //!< answer the first command of a client from the ArticleCache (false if not cached)
+    bool followFlight(Client *aClient);            //!< answer the first command of a client from a Flight (false if not in flight)
+    void readFlight(Client *aClient);              //!< write what the Flight of a client has received
+    void releaseFlight(Client *aClient);           //!< stop following the Flight of a client
+    void chargeShaping(Client *aClient, qint64 aBytes); //!< charge what has been forwarded to a client to its buckets
+    bool isOverRate(Client *aClient);              //!< are the buckets of a client in debt (iShapingTimer started if so)
+    Client *getFailoverClient(QObject *aFailover) const; //!< client of a Failover (Q_NULLPTR if none)
+    //! ask the next servers for the article missing on aServerId (takes the reference on aFlight)
+    void startFailover(Client *aClient, const QByteArray &aCmd, const QByteArray &aStatusLine,
+                       ushort aServerId, Flight *aFlight);
+
+    static Flight *leadFlight(const QByteArray &aCmd); //!< start the Flight of a command sent to a backend (Q_NULLPTR if none)
+
+    static QByteArray getArgument(const QByteArray &aCmd); //!< first argument of a command line
+    static bool       isGroupCommand(const QByteArray &aCmd); //!< does the command depend on the selected group
+
+private:
+    const ushort                        iId;           //!< id of the Worker
+    NntpServerManager                 & iSrvMgr;       //!< handle on the NntpServerManager
+    QHash<InputConnection *, Client *>  iClients;      //!< sessions served (owns the Clients)
+    QList<Client *>                     iReadyClients; //!< clients with a command waiting for a backend (FIFO)
+    QList<Client *>                     iThrottledClients; //!< ready clients waiting for their buckets
+    QHash<NntpConnection *, Backend *>  iBackends;     //!< all the borrowed backends (owns them)
+    QList<Backend *>                    iIdleBackends; //!< backends ready for a command
+    int                                 iNbConnecting; //!< backends in their handshake
+    QTimer                             *iRetryTimer;   //!< retry to borrow a backend (owns it)
+    QTimer                             *iIdleTimer;    //!< periodic releaseIdleBackends (owns it)
+    QTimer                             *iShapingTimer; //!< end of the debt of the first throttled client (owns it)
+    const QString                       iLogPrefix;    //!< log prefix
+};
+
+int NntpMultiplexer::getNumberOfClients() const {return iClients.size();}
+int NntpMultiplexer::getNumberOfBackends() const {return iBackends.size();}
+
+void NntpMultiplexer::_log(const char* aMessage) const {
+     NntpProxy::log(iLogPrefix, aMessage);
+}
+
+void NntpMultiplexer::_log(const QString & aMessage) const {
+     NntpProxy::log(iLogPrefix, aMessage);
+}
+
+#endif // NNTPMULTIPLEXER_H
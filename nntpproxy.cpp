@@ -1,12 +1,21 @@
 #include "nntpproxy.h"
 #include "sessionmanager.h"
 #include "sessionhandler.h"
-#include "mythread.h"
+#include "workermanager.h"
 #include "usermanager.h"
 #include "database.h"
 #include "nntpservermanager.h"
+#include "nntpscanner.h"
+#include "articlecache.h"
+#include "articlestore.h"
+#include "hottracker.h"
+#include "monitoringserver.h"
+#include "singleflight.h"
+#include "bandwidthshaper.h"
 
 #include <QXmlStreamReader>
+#include <QTimer>
+#include <QThread>
 #include <QFile>
 #include <QDate>
 
@@ -14,6 +23,35 @@ ushort NntpProxy::iPortNntp               = cDefaultPortNntp;
 ushort NntpProxy::iPortMonitor            = cDefaultPortMonitor;
 ushort NntpProxy::iSocketTimeout          = cDefaultSocketTimeout;
 ushort NntpProxy::sMaxConnectionsPerUser  = cDefaultMaxConPerUser;
+ushort NntpProxy::sNbWorkers              = cDefaultNbWorkers;
+bool   NntpProxy::sReusePort              = cUseReusePort;
+ushort NntpProxy::sStatsInterval          = cDefaultStatsInterval;
+bool   NntpProxy::sMultiplexing           = cUseMultiplexing;
+ushort NntpProxy::sPipelineWindow         = cDefaultPipelineWindow;
+bool   NntpProxy::sSplice                 = cUseSplice;
+qint64 NntpProxy::sWriteBufferHigh        = cDefaultWriteBufferHigh * 1024;
+qint64 NntpProxy::sWriteBufferLow         = cDefaultWriteBufferLow * 1024;
+ushort NntpProxy::sArticleCacheSize       = cDefaultArticleCacheSize;
+QString NntpProxy::sArticleStoreDir       = "";
+ushort NntpProxy::sArticleStoreSegmentSize = cDefaultArticleStoreSegmentSize;
+ushort NntpProxy::sArticleStoreSegments   = cDefaultArticleStoreSegments;
+ArticleCache *NntpProxy::sArticleCache    = Q_NULLPTR;
+ushort NntpProxy::sHotWindow              = cDefaultHotWindow;
+ushort NntpProxy::sHotWindows             = cDefaultHotWindows;
+HotTracker *NntpProxy::sHotTracker        = Q_NULLPTR;
+bool   NntpProxy::sCoalescing             = cUseCoalescing;
+SingleFlight *NntpProxy::sSingleFlight    = Q_NULLPTR;
+bool   NntpProxy::sFailover               = cUseFailover;
+ushort NntpProxy::sMissingIndexSize       = cDefaultMissingIndexSize;
+double NntpProxy::sMissingIndexFpr        = cDefaultMissingIndexFpr;
+bool   NntpProxy::sServerScoring          = cUseServerScoring;
+ushort NntpProxy::sAdmissionQueueSize     = cDefaultAdmissionQueueSize;
+ushort NntpProxy::sAdmissionTimeout       = cDefaultAdmissionTimeout;
+bool   NntpProxy::sShaping                = cUseShaping;
+uint   NntpProxy::sIpRate                 = 0;
+uint   NntpProxy::sIpBurst                = cDefaultShapingBurst;
+QString NntpProxy::sShapingPassword       = "";
+BandwidthShaper *NntpProxy::sBandwidthShaper = Q_NULLPTR;
 
 bool NntpProxy::sClientSSL                = cIsClientSSL;
 bool NntpProxy::sMonitoring               = cUseMonitorServer;
@@ -28,6 +66,7 @@ MyCrypt * NntpProxy::sCrypt               = Q_NULLPTR;
 
 QVector<NntpServerParameters *> NntpProxy::iServParams      = QVector<NntpServerParameters *>();
 DatabaseParameters             *NntpProxy::iDbParams        = Q_NULLPTR;
+QVector<UserClassParameters *>  NntpProxy::iUserClassParams = QVector<UserClassParameters *>();
 
 
 
@@ -46,6 +85,14 @@ void NntpProxy::shutDown(){
     delete sInstance;
 
     _log("Instance deleted...");
+    // reverse order of initStatics (the ArticleCache closes its ArticleStore)
+    delete sArticleCache;
+    sArticleCache = Q_NULLPTR;
+    delete sBandwidthShaper;
+    sBandwidthShaper = Q_NULLPTR;
+    delete sSingleFlight;
+    sSingleFlight = Q_NULLPTR;
+
     delete sCrypt;
     delete sLogMain;
     std::cout << "Log deleted...\n";
@@ -54,6 +101,9 @@ void NntpProxy::shutDown(){
     for (int i=0; i<iServParams.size(); ++i){
         delete iServParams[i];
     }
+    for (int i=0; i<iUserClassParams.size(); ++i){
+        delete iUserClassParams[i];
+    }
 
     std::cout << "Shutdown done...\n";
 }
@@ -61,7 +111,9 @@ void NntpProxy::shutDown(){
 
 NntpProxy::NntpProxy(QObject *parent):
     QTcpServer(parent), iSessionMgr(Q_NULLPTR), iUserMgr(Q_NULLPTR),
-    iNntpSrvMgr(Q_NULLPTR), iDatabase(Q_NULLPTR)
+    iNntpSrvMgr(Q_NULLPTR), iDatabase(Q_NULLPTR), iWorkerMgr(Q_NULLPTR),
+    iStatsTimer(Q_NULLPTR), iStatsElapsed(), iLastNbAccepts(0),
+    iMonitorThread(Q_NULLPTR), iMonitorServer(Q_NULLPTR)
 {}
 
 bool NntpProxy::initStatics(char * aConfigFile){
@@ -73,14 +125,31 @@ bool NntpProxy::initStatics(char * aConfigFile){
         return false;
     }
 
+    if (sNbWorkers == 0)
+        sNbWorkers = QThread::idealThreadCount() > 0 ? QThread::idealThreadCount() : 1;
+
+    if (sWriteBufferLow >= sWriteBufferHigh)
+        sWriteBufferLow = sWriteBufferHigh / 2;
+
     sCrypt = new MyCrypt(cEncryptionKey);
 
     Nntp::initMaps();
+    NntpScanner::init();
+    std::cout << "Nntp scanner: " << NntpScanner::getImplementationName() << "\n";
 
     std::cout << *iDbParams;
 
+    bool hasPrimaryServer = false;
     for (int i=0; i<iServParams.size(); ++i){
         std::cout << *(iServParams[i]);
+        if (!iServParams[i]->fill)
+            hasPrimaryServer = true;
+    }
+    for (int i=0; i<iUserClassParams.size(); ++i)
+        std::cout << *(iUserClassParams[i]);
+    if (!iServParams.isEmpty() && !hasPrimaryServer){
+        std::cerr << "Error: the fill servers need at least one primary server...\n";
+        return false;
     }
 
     NntpProxy::sLogMain = new Log(QDate::currentDate().toString("NntpProxy.yyyy.MM"));
@@ -91,6 +160,27 @@ bool NntpProxy::initStatics(char * aConfigFile){
     }
 
     _log("Starting Log!");
+
+    if (sCoalescing && !sSingleFlight)
+        sSingleFlight = new SingleFlight();
+
+    if (sShaping && !sBandwidthShaper)
+        sBandwidthShaper = new BandwidthShaper(iUserClassParams, sIpRate, sIpBurst);
+
+    if ((sArticleCacheSize > 0 || !sArticleStoreDir.isEmpty()) && !sArticleCache){
+        sArticleCache = new ArticleCache(static_cast<qint64>(sArticleCacheSize) * 1048576);
+        if (!sArticleStoreDir.isEmpty()){
+            ArticleStore *store = new ArticleStore(sArticleStoreDir,
+                                                   static_cast<qint64>(sArticleStoreSegmentSize) * 1048576,
+                                                   sArticleStoreSegments);
+            if (store->open())
+                sArticleCache->setStore(store);
+            else {
+                _log(QString("Error opening the article store in ").append(sArticleStoreDir));
+                delete store;
+            }
+        }
+    }
     return true;
 }
 
@@ -119,6 +209,9 @@ bool NntpProxy::init(char * aConfigFile){
     }
 
     iSessionMgr = new SessionManager(*iUserMgr, *iDatabase, *iNntpSrvMgr);
+    iWorkerMgr  = new WorkerManager(sNbWorkers);
+    if (sMultiplexing)
+        iWorkerMgr->startMultiplexers(*iNntpSrvMgr);
 
     return true;
 }
@@ -128,7 +221,15 @@ bool NntpProxy::startProxy(char * aConfigFile){
         return false;
 
     QString str;
-    if (!this->listen(QHostAddress::Any, iPortNntp)){
+    if (sReusePort){
+        // each Worker accepts on its own socket
+        if (!iWorkerMgr->listen(iPortNntp, *iSessionMgr)){
+            str = "Workers can't listen (SO_REUSEPORT) on port ";
+        } else {
+            isAcceptingConnection = true;
+            str = "Server started, Workers listening (SO_REUSEPORT) on port: ";
+        }
+    } else if (!this->listen(QHostAddress::Any, iPortNntp)){
         str = "Server can't listen on port ";
     } else {
         isAcceptingConnection = true;
@@ -138,6 +239,29 @@ bool NntpProxy::startProxy(char * aConfigFile){
     str += QString::number(iPortNntp);
     _log(str);
 
+    if (isAcceptingConnection && sStatsInterval > 0){
+        iStatsTimer = new QTimer(this);
+        connect(iStatsTimer, &QTimer::timeout, this, &NntpProxy::logStats);
+        iStatsTimer->start(sStatsInterval * 1000);
+        iStatsElapsed.start();
+    }
+
+    if (isAcceptingConnection && sMonitoring){
+        // the tracker and its server share a thread: no lock to read the statistics
+        iMonitorThread = new QThread();
+        sHotTracker    = new HotTracker(sNbWorkers, sHotWindow, sHotWindows);
+        iMonitorServer = new MonitoringServer(*sHotTracker);
+        sHotTracker->moveToThread(iMonitorThread);
+        iMonitorServer->moveToThread(iMonitorThread);
+
+        // deferred deletion is processed when the event loop of the thread exits
+        connect(iMonitorThread, &QThread::finished, iMonitorServer, &QObject::deleteLater);
+        connect(iMonitorThread, &QThread::finished, sHotTracker, &QObject::deleteLater);
+        iMonitorThread->start();
+
+        emit iMonitorServer->startListening(iPortMonitor); // listen inside the monitoring thread
+    }
+
     return isAcceptingConnection;
 }
 
@@ -148,12 +272,44 @@ NntpProxy::~NntpProxy()
 
     _log("Deleting NntpProxy!");
     delete iSessionMgr;
+    delete iWorkerMgr; // after the sessions as they're running in the Workers
+
+    if (iMonitorThread){
+        // no more producers: the tracker and its server are deleted with their thread
+        sHotTracker = Q_NULLPTR;
+        iMonitorThread->quit();
+        iMonitorThread->wait();
+        delete iMonitorThread;
+    }
     delete iNntpSrvMgr;
     delete iUserMgr;
     delete iDatabase;
 
 }
 
+void NntpProxy::logStats(){
+    uint   nbAccepts  = iWorkerMgr->getNumberOfAccepts();
+    qint64 elapsedMs  = iStatsElapsed.restart();
+    double acceptRate = 0;
+    if (elapsedMs > 0)
+        acceptRate = 1000.0 * (nbAccepts - iLastNbAccepts) / elapsedMs;
+    iLastNbAccepts = nbAccepts;
+
+    QTextStream &ostream = acquireLog("[NntpProxy] ");
+    ostream << "Stats: accept rate: " << QString::number(acceptRate, 'f', 2)
+            << " /s (total accepted: " << nbAccepts << ")\n";
+    iWorkerMgr->dump(ostream);
+    if (sArticleCache)
+        sArticleCache->dump(ostream);
+    if (sSingleFlight)
+        sSingleFlight->dump(ostream);
+    if (sBandwidthShaper)
+        sBandwidthShaper->dump(ostream);
+    iNntpSrvMgr->dumpStats(ostream);
+    iSessionMgr->dumpStats(ostream);
+    releaseLog();
+}
+
 void NntpProxy::incomingConnection(qintptr aSocketDescriptor){
 
     // We have a new connection
@@ -166,22 +322,13 @@ void NntpProxy::incomingConnection(qintptr aSocketDescriptor){
         return;
     }
 
-    MyThread * thread = new MyThread(aSocketDescriptor);
-    thread->start(); // start the event loop
+    Worker * worker = iWorkerMgr->getLeastLoadedWorker();
 
     // Create the SessionHandler handler
-    SessionHandler *session = iSessionMgr->newSession(aSocketDescriptor, thread);
-    session->moveToThread(thread);
+    SessionHandler *session = iSessionMgr->newSession(aSocketDescriptor, worker);
+    session->moveToThread(worker);
 
-    connect(session, &SessionHandler::destroyed, thread, &QThread::quit);
-    connect(thread, &QThread::finished, thread, &QObject::deleteLater);
-    connect(thread, &QThread::destroyed, this, &NntpProxy::threadDeleted);
-
-    emit session->startConnection(); // starting the connection inside the new thread
-}
-
-void NntpProxy::threadDeleted(){
-    _log("Thread deleted");
+    emit session->startConnection(); // starting the connection inside the Worker thread
 }
 
 bool NntpProxy::encrypt(QString & aStr, ushort aMultiplier){
@@ -228,8 +375,10 @@ bool NntpProxy::parseConfig(const QString & aFileName)
     xml.setDevice(&file); // Initialise l'instance reader avec le flux XML venant de file
 
     NntpServerParameters *serv  = Q_NULLPTR;
+    UserClassParameters *userClass = Q_NULLPTR;
     bool servSection            = false;
     bool databaseSection        = false;
+    bool userClassSection       = false;
 
     while (! xml.atEnd()){
         xml.readNext();
@@ -245,8 +394,21 @@ bool NntpProxy::parseConfig(const QString & aFileName)
             else if (xml.name() == "database"){
                 iDbParams = new DatabaseParameters();
                 databaseSection = true;
+            }
+            else if (xml.name() == "userClass"){
+                userClass = new UserClassParameters();
+                userClassSection = true;
             } else if (xml.name() == "name") {
-                serv->name = xml.readElementText().trimmed();
+                if (userClassSection)
+                    userClass->name = xml.readElementText().trimmed();
+                else
+                    serv->name = xml.readElementText().trimmed();
+            } else if (xml.name() == "rate") {
+                userClass->rate = xml.readElementText().trimmed().toUInt();
+            } else if (xml.name() == "burst") {
+                userClass->burst = xml.readElementText().trimmed().toUInt();
+            } else if (xml.name() == "users") {
+                userClass->users = xml.readElementText().simplified().split(' ', QString::SkipEmptyParts);
             } else if (xml.name() == "port") {
                 if (servSection)
                     serv->port = xml.readElementText().trimmed().toInt();
@@ -260,6 +422,14 @@ bool NntpProxy::parseConfig(const QString & aFileName)
                 iSocketTimeout = xml.readElementText().trimmed().toInt();
             } else if (xml.name() == "maxConnections") {
                 serv->maxConnections = xml.readElementText().trimmed().toInt();
+            } else if (xml.name() == "poolIdleTimeout") {
+                serv->poolIdleTimeout = xml.readElementText().trimmed().toInt();
+            } else if (xml.name() == "priority") {
+                serv->priority = xml.readElementText().trimmed().toInt();
+            } else if (xml.name() == "fill") {
+                serv->fill = (xml.readElementText().trimmed().toLower() == "yes");
+            } else if (xml.name() == "maxRate") {
+                serv->maxRate = xml.readElementText().trimmed().toUInt();
             } else if (xml.name() == "ssl") {
                 if (xml.readElementText().trimmed().toLower() == "yes")
                     serv->ssl = true;
@@ -287,6 +457,63 @@ bool NntpProxy::parseConfig(const QString & aFileName)
                 iDbParams->name = xml.readElementText().trimmed();
             } else if (xml.name() == "maxUserConnections") {
                 sMaxConnectionsPerUser = xml.readElementText().trimmed().toInt();
+            } else if (xml.name() == "workerThreads") {
+                sNbWorkers = xml.readElementText().trimmed().toInt();
+            } else if (xml.name() == "reusePort") {
+                if (xml.readElementText().trimmed().toLower() == "yes")
+                    NntpProxy::sReusePort = true;
+            } else if (xml.name() == "statsInterval") {
+                sStatsInterval = xml.readElementText().trimmed().toInt();
+            } else if (xml.name() == "pipelineWindow") {
+                sPipelineWindow = xml.readElementText().trimmed().toInt();
+                if (sPipelineWindow == 0)
+                    sPipelineWindow = 1;
+            } else if (xml.name() == "writeBufferHigh") {
+                sWriteBufferHigh = xml.readElementText().trimmed().toLongLong() * 1024;
+            } else if (xml.name() == "writeBufferLow") {
+                sWriteBufferLow = xml.readElementText().trimmed().toLongLong() * 1024;
+            } else if (xml.name() == "articleCacheSize") {
+                sArticleCacheSize = xml.readElementText().trimmed().toInt();
+            } else if (xml.name() == "articleStoreDir") {
+                sArticleStoreDir = xml.readElementText().trimmed();
+            } else if (xml.name() == "articleStoreSegmentSize") {
+                sArticleStoreSegmentSize = xml.readElementText().trimmed().toInt();
+            } else if (xml.name() == "hotWindow") {
+                sHotWindow = xml.readElementText().trimmed().toInt();
+            } else if (xml.name() == "hotWindows") {
+                sHotWindows = xml.readElementText().trimmed().toInt();
+            } else if (xml.name() == "articleStoreSegments") {
+                sArticleStoreSegments = xml.readElementText().trimmed().toInt();
+            } else if (xml.name() == "splice") {
+                if (xml.readElementText().trimmed().toLower() == "yes")
+                    NntpProxy::sSplice = true;
+            } else if (xml.name() == "coalescing") {
+                NntpProxy::sCoalescing = (xml.readElementText().trimmed().toLower() == "yes");
+            } else if (xml.name() == "failover") {
+                NntpProxy::sFailover = (xml.readElementText().trimmed().toLower() == "yes");
+            } else if (xml.name() == "missingIndexSize") {
+                sMissingIndexSize = xml.readElementText().trimmed().toInt();
+            } else if (xml.name() == "missingIndexFpr") {
+                sMissingIndexFpr = xml.readElementText().trimmed().toDouble();
+            } else if (xml.name() == "serverScoring") {
+                NntpProxy::sServerScoring = (xml.readElementText().trimmed().toLower() == "yes");
+            } else if (xml.name() == "admissionQueueSize") {
+                sAdmissionQueueSize = xml.readElementText().trimmed().toInt();
+            } else if (xml.name() == "admissionTimeout") {
+                sAdmissionTimeout = xml.readElementText().trimmed().toInt();
+                if (sAdmissionTimeout == 0)
+                    sAdmissionTimeout = 1;
+            } else if (xml.name() == "shaping") {
+                NntpProxy::sShaping = (xml.readElementText().trimmed().toLower() == "yes");
+            } else if (xml.name() == "ipRate") {
+                sIpRate = xml.readElementText().trimmed().toUInt();
+            } else if (xml.name() == "ipBurst") {
+                sIpBurst = xml.readElementText().trimmed().toUInt();
+            } else if (xml.name() == "shapingPassword") {
+                sShapingPassword = xml.readElementText().trimmed();
+            } else if (xml.name() == "multiplexing") {
+                if (xml.readElementText().trimmed().toLower() == "yes")
+                    NntpProxy::sMultiplexing = true;
             } else if (xml.name() == "clientSSL") {
                 if (xml.readElementText().trimmed().toLower() == "yes")
                     NntpProxy::sClientSSL = true;
@@ -302,6 +529,9 @@ bool NntpProxy::parseConfig(const QString & aFileName)
                 iServParams.append(serv);
             } else if (xml.name() == "database") {
                 databaseSection = false;
+            } else if (xml.name() == "userClass") {
+                userClassSection = false;
+                iUserClassParams.append(userClass);
             }
         }
 
@@ -349,11 +579,26 @@ std::ostream & operator<<(std::ostream &stream, const NntpServerParameters & p)
 
     stream << "\t\t<maxConnections>" << p.maxConnections << "</maxConnections>\n"
            << "\t\t<ssl>" << p.ssl << "</ssl>\n"
+           << "\t\t<poolIdleTimeout>" << p.poolIdleTimeout << "</poolIdleTimeout>\n"
+           << "\t\t<priority>" << p.priority << "</priority>\n"
+           << "\t\t<fill>" << p.fill << "</fill>\n"
+           << "\t\t<maxRate>" << p.maxRate << "</maxRate>\n"
            << "\t</server>\n";
 
     return stream;
 }
 
+std::ostream & operator<<(std::ostream &stream, const UserClassParameters & p) {
+    stream << "\t<userClass>\n"
+           << "\t\t<name>"  << p.name  << "</name>\n"
+           << "\t\t<rate>"  << p.rate  << "</rate>\n"
+           << "\t\t<burst>" << p.burst << "</burst>\n"
+           << "\t\t<users>" << p.users.join(" ") << "</users>\n"
+           << "\t</userClass>\n";
+
+    return stream;
+}
+
 std::ostream & operator<<(std::ostream &stream, const DatabaseParameters & p) {
     stream << "\t<database>\n"
            << "\t\t<type>"   << p.type   << "</type>\n"
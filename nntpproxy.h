@@ -7,6 +7,7 @@
 #include "mycrypt.h"
 
 #include <QtNetwork/QTcpServer>
+#include <QElapsedTimer>
 
 QT_FORWARD_DECLARE_CLASS(SessionManager)
 QT_FORWARD_DECLARE_CLASS(SessionHandler)
@@ -14,6 +15,13 @@ QT_FORWARD_DECLARE_CLASS(Log)
 QT_FORWARD_DECLARE_CLASS(UserManager)
 QT_FORWARD_DECLARE_CLASS(Database)
 QT_FORWARD_DECLARE_CLASS(NntpServerManager);
+QT_FORWARD_DECLARE_CLASS(WorkerManager)
+QT_FORWARD_DECLARE_CLASS(ArticleCache)
+QT_FORWARD_DECLARE_CLASS(HotTracker)
+QT_FORWARD_DECLARE_CLASS(SingleFlight)
+QT_FORWARD_DECLARE_CLASS(BandwidthShaper)
+QT_FORWARD_DECLARE_CLASS(MonitoringServer)
+QT_FORWARD_DECLARE_CLASS(QTimer)
 
 
 
@@ -42,8 +50,27 @@ public:
 
 
     inline static bool isClientSSL(); //!< Are the clients using SSL connection (from congig file)
+    inline static bool isAcceptingConnections(); //!< is the proxy accepting input connections?
     inline static LOG_LEVEL logLevel(); //!< return the log level
     inline static ushort getMaxConnectionsPerUser(); //!< return the maximum number of connection per user (from config file)
+    inline static ushort getNumberOfWorkers(); //!< return the number of Worker Threads (from config file, default number of cores)
+    inline static ushort getSocketTimeout();   //!< return the timeout (ms) of the asynchronous socket handshakes (from config file)
+    inline static bool isMultiplexing();       //!< are the client commands multiplexed over shared NntpConnections (from config file)
+    inline static ushort getPipelineWindow();  //!< return the max number of client commands in flight on a NntpConnection (from config file)
+    inline static bool useSplice();            //!< forward with splice() when client and server are plaintext (from config file)
+    inline static qint64 getWriteBufferHigh(); //!< bytes queued on a socket before pausing the reading of its source (from config file)
+    inline static qint64 getWriteBufferLow();  //!< bytes queued on a socket under which its source is read again (from config file)
+    inline static ArticleCache *getArticleCache(); //!< shared article cache, memory and/or disk (Q_NULLPTR if disabled in config file)
+    inline static HotTracker *getHotTracker();     //!< popularity of the articles, groups, users and IPs (Q_NULLPTR if not monitoring)
+    inline static SingleFlight *getSingleFlight(); //!< coalescing of the concurrent article fetches (Q_NULLPTR if disabled in config file)
+    inline static bool useFailover();              //!< ask the next servers for the articles missing on a server (from config file)
+    inline static qint64 getMissingIndexSize();    //!< bytes per server of the index of the articles missing on it (0: no index)
+    inline static double getMissingIndexFpr();     //!< target false positive rate of the missing index (from config file)
+    inline static bool useServerScoring();         //!< weight the server selection by the measured performance (from config file)
+    inline static ushort getAdmissionQueueSize();  //!< max number of sessions waiting for a NntpConnection (from config file, 0: no wait)
+    inline static ushort getAdmissionTimeout();    //!< seconds a session waits for a NntpConnection (from config file)
+    inline static BandwidthShaper *getBandwidthShaper(); //!< token buckets of the users and IPs (Q_NULLPTR if disabled in config file)
+    inline static const QString &getShapingPassword();  //!< password of the SHAPE commands of the MonitoringServer (from config file, empty: refused)
 
     //! Acquire the Log file (locking it) and writing a new line with a prefix
     inline static QTextStream& acquireLog(const char *    aAcquirerName);
@@ -62,7 +89,7 @@ public:
     inline static void log(const QString & aClassPrefix, const char * aMessage); //!< Add a log line with prefix then message
 
 public slots:
-    void threadDeleted(); //!< Slot in main Thread to close an Session Thread (connected to &QThread::destroyed)
+    void logStats(); //!< log the proxy statistics (accept rate, distribution of the sessions between the Workers)
 
 // Singleton pattern
 private:
@@ -82,27 +109,65 @@ private:
     UserManager       *iUserMgr;    //!< User Manager (holds and owns all the connected Users)
     NntpServerManager *iNntpSrvMgr; //!< NntpServer Manager (holds and owns all the active NntpServers)
     Database          *iDatabase;   //!< Shared Thread-Safe Database Connection
+    WorkerManager     *iWorkerMgr;  //!< Worker Manager (holds and owns the pool of Threads running the sessions)
+
+    QTimer            *iStatsTimer;    //!< periodic trigger of logStats (owns it)
+    QElapsedTimer      iStatsElapsed;  //!< time since the last logStats
+    uint               iLastNbAccepts; //!< number of accepts at the last logStats
+
+    QThread           *iMonitorThread; //!< Thread of the HotTracker and the MonitoringServer (owns it)
+    MonitoringServer  *iMonitorServer; //!< Monitoring server (owns it)
 
 
     static MyCrypt   *sCrypt;       //!< Encryption utility
     static ushort     iPortNntp;    //!< Server port (from config file, default 119 for unencrypted service)
-    static ushort     iPortMonitor; //!< Monitoring/Control server port (TODO, implementation of MonitoringServer)
+    static ushort     iPortMonitor; //!< Monitoring server port (from config file)
 
-    static ushort     iSocketTimeout; //!< Socket Timeout (TODO, add a timer on sockets)
+    static ushort     iSocketTimeout; //!< Socket Timeout used by the asynchronous handshakes (ms)
 
     static ushort     sMaxConnectionsPerUser; //!< max number of connection per user (from config file)
+    static ushort     sNbWorkers;             //!< number of Worker Threads (from config file, 0 means number of cores)
+    static bool       sReusePort;             //!< one listening socket per Worker with SO_REUSEPORT (from config file)
+    static ushort     sStatsInterval;         //!< interval in seconds between two logStats (from config file, 0 to disable)
+    static bool       sMultiplexing;          //!< multiplex the client commands over shared NntpConnections (from config file)
+    static ushort     sPipelineWindow;        //!< max number of client commands in flight on a NntpConnection (from config file)
+    static bool       sSplice;                //!< forward with splice() when client and server are plaintext (from config file)
+    static qint64     sWriteBufferHigh;       //!< high watermark of the write buffers in bytes (from config file in KB)
+    static qint64     sWriteBufferLow;        //!< low watermark of the write buffers in bytes (from config file in KB)
+    static ushort     sArticleCacheSize;      //!< size of the article cache in MB (from config file, 0 to disable)
+    static QString    sArticleStoreDir;       //!< directory of the disk tier of the article cache (from config file, empty to disable)
+    static ushort     sArticleStoreSegmentSize; //!< size of a segment file of the article store in MB (from config file)
+    static ushort     sArticleStoreSegments;  //!< max number of segment files of the article store (from config file)
+    static ArticleCache *sArticleCache;       //!< article cache shared by all the sessions (owns it)
+    static ushort     sHotWindow;             //!< duration of a window of the HotTracker in seconds (from config file)
+    static ushort     sHotWindows;            //!< number of windows of the sliding window of the HotTracker (from config file)
+    static HotTracker *sHotTracker;           //!< HotTracker fed by all the sessions (owns it)
+    static bool       sCoalescing;            //!< coalesce the concurrent fetches of the same article (from config file)
+    static SingleFlight *sSingleFlight;       //!< articles being fetched, shared by all the sessions (owns it)
+    static bool       sFailover;              //!< retry the articles missing on a server (430/423) on the next ones (from config file)
+    static ushort     sMissingIndexSize;      //!< size in KB of the index of the articles missing on each server (from config file, 0 to disable)
+    static double     sMissingIndexFpr;       //!< target false positive rate of the missing index (from config file)
+    static bool       sServerScoring;         //!< weight the server selection by the ServerScore of the servers (from config file)
+    static ushort     sAdmissionQueueSize;    //!< max number of sessions waiting for a NntpConnection (from config file, 0 to disable)
+    static ushort     sAdmissionTimeout;      //!< seconds a session waits for a NntpConnection before its 502 (from config file)
+    static bool       sShaping;               //!< limit the bandwidth of the users (classes) and of the IPs (from config file)
+    static uint       sIpRate;                //!< KB/s per IP (from config file, 0 to disable)
+    static uint       sIpBurst;               //!< burst of an IP in KB (from config file)
+    static QString    sShapingPassword;       //!< AUTH password of the SHAPE monitoring commands (from config file, empty to refuse them)
+    static BandwidthShaper *sBandwidthShaper; //!< token buckets shared by all the NntpConnections (owns it)
 
     static Log      *sLogMain;  //!< Log file handler (file name and path from config file)
     static LOG_LEVEL sLogLevel; //!< Log level (TODO TO_USE? from config file)
 
     static bool      sClientSSL;  //!< Are the clients using SSL (from config file)
-    static bool      sMonitoring; //!< Are we using the Monitoring Server
+    static bool      sMonitoring; //!< Are we using the Monitoring Server (and the HotTracker)
 
     static QVector<NntpServerParameters *> iServParams; //!< Nntp Servers parameters (parsed from config file)
     static DatabaseParameters             *iDbParams;   //!< Database parameters (parsed from config file)
+    static QVector<UserClassParameters *>  iUserClassParams; //!< user classes of the shaping (parsed from config file)
 
 protected:
-    //! QTcpServer, create a SessionHandler via SessionManager and move it to a new Thread
+    //! QTcpServer, create a SessionHandler via SessionManager and move it to the least loaded Worker
     void incomingConnection(qintptr aSocketDescriptor);
 
 
@@ -114,8 +179,46 @@ private:
 
 bool  NntpProxy::isClientSSL(){return NntpProxy::sClientSSL;}
 
+bool  NntpProxy::isAcceptingConnections(){return NntpProxy::isAcceptingConnection;}
+
 ushort NntpProxy::getMaxConnectionsPerUser(){return NntpProxy::sMaxConnectionsPerUser;}
 
+ushort NntpProxy::getNumberOfWorkers(){return NntpProxy::sNbWorkers;}
+
+ushort NntpProxy::getSocketTimeout(){return NntpProxy::iSocketTimeout;}
+
+bool NntpProxy::isMultiplexing(){return NntpProxy::sMultiplexing;}
+
+ushort NntpProxy::getPipelineWindow(){return NntpProxy::sPipelineWindow;}
+
+bool NntpProxy::useSplice(){return NntpProxy::sSplice;}
+
+qint64 NntpProxy::getWriteBufferHigh(){return NntpProxy::sWriteBufferHigh;}
+
+qint64 NntpProxy::getWriteBufferLow(){return NntpProxy::sWriteBufferLow;}
+
+ArticleCache *NntpProxy::getArticleCache(){return NntpProxy::sArticleCache;}
+
+HotTracker *NntpProxy::getHotTracker(){return NntpProxy::sHotTracker;}
+
+SingleFlight *NntpProxy::getSingleFlight(){return NntpProxy::sSingleFlight;}
+
+bool NntpProxy::useFailover(){return NntpProxy::sFailover;}
+
+qint64 NntpProxy::getMissingIndexSize(){return static_cast<qint64>(NntpProxy::sMissingIndexSize) * 1024;}
+
+double NntpProxy::getMissingIndexFpr(){return NntpProxy::sMissingIndexFpr;}
+
+bool NntpProxy::useServerScoring(){return NntpProxy::sServerScoring;}
+
+ushort NntpProxy::getAdmissionQueueSize(){return NntpProxy::sAdmissionQueueSize;}
+
+ushort NntpProxy::getAdmissionTimeout(){return NntpProxy::sAdmissionTimeout;}
+
+BandwidthShaper *NntpProxy::getBandwidthShaper(){return NntpProxy::sBandwidthShaper;}
+
+const QString &NntpProxy::getShapingPassword(){return NntpProxy::sShapingPassword;}
+
 LOG_LEVEL NntpProxy::logLevel(){return sLogLevel;}
 
 QTextStream & NntpProxy::acquireLog(const char * aAcquirerName){
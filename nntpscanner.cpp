@@ -0,0 +1,186 @@
+#include "nntpscanner.h"
+
+#include <cstring>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define NNTP_SCANNER_X86 1
+#include <immintrin.h>
+#endif
+
+NntpScanner::Implementation NntpScanner::sImplementation = NntpScanner::Scalar;
+NntpScanner::ScanFunction   NntpScanner::sFindLineEnd    = &NntpScanner::findLineEndScalar;
+NntpScanner::ScanFunction   NntpScanner::sFindTerminator = &NntpScanner::findTerminatorScalar;
+
+void NntpScanner::init(){
+    setImplementation(detectImplementation());
+}
+
+NntpScanner::Implementation NntpScanner::getImplementation(){
+    return sImplementation;
+}
+
+const char *NntpScanner::getImplementationName(){
+    switch (sImplementation) {
+    case SSE2: return "SSE2";
+    case AVX2: return "AVX2";
+    default:   return "Scalar";
+    }
+}
+
+bool NntpScanner::isSupported(Implementation aImpl){
+    switch (aImpl) {
+    case Scalar:
+        return true;
+#ifdef NNTP_SCANNER_X86
+    case SSE2:
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("sse2");
+    case AVX2:
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2");
+#endif
+    default:
+        return false;
+    }
+}
+
+bool NntpScanner::setImplementation(Implementation aImpl){
+    if (!isSupported(aImpl))
+        return false;
+
+    switch (aImpl) {
+    case SSE2:
+        sFindLineEnd    = &NntpScanner::findLineEndSSE2;
+        sFindTerminator = &NntpScanner::findTerminatorSSE2;
+        break;
+    case AVX2:
+        sFindLineEnd    = &NntpScanner::findLineEndAVX2;
+        sFindTerminator = &NntpScanner::findTerminatorAVX2;
+        break;
+    default:
+        sFindLineEnd    = &NntpScanner::findLineEndScalar;
+        sFindTerminator = &NntpScanner::findTerminatorScalar;
+        break;
+    }
+    sImplementation = aImpl;
+    return true;
+}
+
+NntpScanner::Implementation NntpScanner::detectImplementation(){
+    if (isSupported(AVX2))
+        return AVX2;
+    if (isSupported(SSE2))
+        return SSE2;
+    return Scalar;
+}
+
+
+// is there a terminator at aPos knowing it starts with "\r\n."
+static inline bool endsTerminator(const char *aData, qint64 aLen, qint64 aPos){
+    return aPos + 5 <= aLen && aData[aPos + 3] == '\r' && aData[aPos + 4] == '\n';
+}
+
+qint64 NntpScanner::findLineEndScalar(const char *aData, qint64 aLen){
+    const char *eol = static_cast<const char *>(memchr(aData, '\n', static_cast<size_t>(aLen)));
+    return eol ? eol - aData : -1;
+}
+
+qint64 NntpScanner::findTerminatorScalar(const char *aData, qint64 aLen){
+    qint64 pos = 0;
+    while (pos + 5 <= aLen){
+        const char *cr = static_cast<const char *>(memchr(aData + pos, '\r', static_cast<size_t>(aLen - pos - 4)));
+        if (!cr)
+            return -1;
+        pos = cr - aData;
+        if (aData[pos + 1] == '\n' && aData[pos + 2] == '.' && endsTerminator(aData, aLen, pos))
+            return pos + 5;
+        ++pos;
+    }
+    return -1;
+}
+
+#ifdef NNTP_SCANNER_X86
+
+qint64 NntpScanner::findLineEndSSE2(const char *aData, qint64 aLen){
+    const __m128i lf = _mm_set1_epi8('\n');
+    qint64 pos = 0;
+    for (; pos + 16 <= aLen; pos += 16){
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(aData + pos));
+        int     mask  = _mm_movemask_epi8(_mm_cmpeq_epi8(block, lf));
+        if (mask)
+            return pos + __builtin_ctz(static_cast<unsigned>(mask));
+    }
+    qint64 tail = findLineEndScalar(aData + pos, aLen - pos);
+    return tail == -1 ? -1 : pos + tail;
+}
+
+qint64 NntpScanner::findTerminatorSSE2(const char *aData, qint64 aLen){
+    const __m128i cr  = _mm_set1_epi8('\r');
+    const __m128i lf  = _mm_set1_epi8('\n');
+    const __m128i dot = _mm_set1_epi8('.');
+    qint64 pos = 0;
+    // candidates "\r\n." found 16 at a time (the 3 loads stay in the buffer)
+    for (; pos + 18 <= aLen; pos += 16){
+        const char *p = aData + pos;
+        __m128i m = _mm_and_si128(
+                    _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p)), cr),
+                    _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 1)), lf));
+        m = _mm_and_si128(m, _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 2)), dot));
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(m));
+        while (mask){
+            qint64 candidate = pos + __builtin_ctz(mask);
+            if (endsTerminator(aData, aLen, candidate))
+                return candidate + 5;
+            mask &= mask - 1; // dot-stuffed line or terminator cut by the end of the buffer
+        }
+    }
+    qint64 tail = findTerminatorScalar(aData + pos, aLen - pos);
+    return tail == -1 ? -1 : pos + tail;
+}
+
+__attribute__((target("avx2")))
+qint64 NntpScanner::findLineEndAVX2(const char *aData, qint64 aLen){
+    const __m256i lf = _mm256_set1_epi8('\n');
+    qint64 pos = 0;
+    for (; pos + 32 <= aLen; pos += 32){
+        __m256i  block = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(aData + pos));
+        unsigned mask  = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, lf)));
+        if (mask)
+            return pos + __builtin_ctz(mask);
+    }
+    qint64 tail = findLineEndScalar(aData + pos, aLen - pos);
+    return tail == -1 ? -1 : pos + tail;
+}
+
+__attribute__((target("avx2")))
+qint64 NntpScanner::findTerminatorAVX2(const char *aData, qint64 aLen){
+    const __m256i cr  = _mm256_set1_epi8('\r');
+    const __m256i lf  = _mm256_set1_epi8('\n');
+    const __m256i dot = _mm256_set1_epi8('.');
+    qint64 pos = 0;
+    for (; pos + 34 <= aLen; pos += 32){
+        const char *p = aData + pos;
+        __m256i m = _mm256_and_si256(
+                    _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(p)), cr),
+                    _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(p + 1)), lf));
+        m = _mm256_and_si256(m, _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(p + 2)), dot));
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(m));
+        while (mask){
+            qint64 candidate = pos + __builtin_ctz(mask);
+            if (endsTerminator(aData, aLen, candidate))
+                return candidate + 5;
+            mask &= mask - 1;
+        }
+    }
+    qint64 tail = findTerminatorScalar(aData + pos, aLen - pos);
+    return tail == -1 ? -1 : pos + tail;
+}
+
+#else // no vectorized implementation (never selected, isSupported is false)
+
+qint64 NntpScanner::findLineEndSSE2(const char *aData, qint64 aLen){return findLineEndScalar(aData, aLen);}
+qint64 NntpScanner::findTerminatorSSE2(const char *aData, qint64 aLen){return findTerminatorScalar(aData, aLen);}
+qint64 NntpScanner::findLineEndAVX2(const char *aData, qint64 aLen){return findLineEndScalar(aData, aLen);}
+qint64 NntpScanner::findTerminatorAVX2(const char *aData, qint64 aLen){return findTerminatorScalar(aData, aLen);}
+
+#endif
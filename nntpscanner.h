@@ -0,0 +1,59 @@
+#ifndef NNTPSCANNER_H
+#define NNTPSCANNER_H
+
+#include <QtGlobal>
+
+/*!
+ * \brief Pure Static class (no instance) to search the NNTP framing sequences in raw data
+ * - vectorized implementations (SSE2 / AVX2 on x86) and a scalar fallback
+ * - the best one supported by the CPU is selected at runtime by init() (scalar before)
+ * - the searches are stateless: the matches spanning two buffers are handled by the caller
+ *   (cf ResponseFramer that keeps the partial terminator of the previous chunk)
+ * - dot-stuffed lines ("\r\n..") are candidates rejected by the full check, never matches
+ */
+class NntpScanner
+{
+public:
+    enum Implementation {Scalar = 0, SSE2 = 1, AVX2 = 2};
+
+    static void init(); //!< select the best implementation supported by the CPU (at startup, before the Workers)
+
+    //! position of the first '\n' (end of a CRLF line) in aData, -1 if there is none
+    static inline qint64 findLineEnd(const char *aData, qint64 aLen);
+
+    //! position just after the first "\r\n.\r\n" entirely in aData, -1 if there is none
+    static inline qint64 findTerminator(const char *aData, qint64 aLen);
+
+    static Implementation getImplementation();             //!< implementation used
+    static const char    *getImplementationName();         //!< name of the implementation used (logs)
+    static bool           isSupported(Implementation aImpl);  //!< can the CPU run aImpl
+    static bool           setImplementation(Implementation aImpl); //!< force aImpl (tests, benchmarks), false if not supported
+
+private:
+    explicit NntpScanner(); // no instances
+    NntpScanner(const NntpScanner &)              = delete;
+    NntpScanner(const NntpScanner &&)             = delete;
+    NntpScanner & operator=(const NntpScanner &)  = delete;
+    NntpScanner & operator=(const NntpScanner &&) = delete;
+
+    typedef qint64 (*ScanFunction)(const char *aData, qint64 aLen);
+
+    static Implementation detectImplementation(); //!< best implementation supported by the CPU
+
+    static qint64 findLineEndScalar(const char *aData, qint64 aLen);
+    static qint64 findTerminatorScalar(const char *aData, qint64 aLen);
+    static qint64 findLineEndSSE2(const char *aData, qint64 aLen);
+    static qint64 findTerminatorSSE2(const char *aData, qint64 aLen);
+    static qint64 findLineEndAVX2(const char *aData, qint64 aLen);
+    static qint64 findTerminatorAVX2(const char *aData, qint64 aLen);
+
+private:
+    static Implementation sImplementation;  //!< implementation used
+    static ScanFunction   sFindLineEnd;     //!< implementation of findLineEnd
+    static ScanFunction   sFindTerminator;  //!< implementation of findTerminator
+};
+
+qint64 NntpScanner::findLineEnd(const char *aData, qint64 aLen){return sFindLineEnd(aData, aLen);}
+qint64 NntpScanner::findTerminator(const char *aData, qint64 aLen){return sFindTerminator(aData, aLen);}
+
+#endif // NNTPSCANNER_H
@@ -1,73 +1,180 @@
 #include "nntpserver.h"
 #include "nntpconnection.h"
 #include "nntpproxy.h"
+#include "bloomfilter.h"
+#include "readscheduler.h"
 
 #include <QTcpSocket>
 #include <QList>
+#include <QEventLoop>
+#include <QThread>
 
 unsigned short NntpServer::sNextId = 0;
 
+//! deleter of the ReadScheduler: its timers must be stopped in its thread (the last owner may be a Worker)
+static void deleteReadScheduler(ReadScheduler *aScheduler){
+    if (aScheduler->thread() == QThread::currentThread())
+        delete aScheduler;
+    else
+        aScheduler->deleteLater();
+}
+
 NntpServer::NntpServer(const NntpServerParameters & aParams):
-    iParams(aParams), iId(sNextId++), iNntpCons(), mMutex(),
+    iParams(aParams), iId(sNextId++),
+    iSlots(new QAtomicPointer<NntpConnection>[aParams.maxConnections]), iNbInUse(0),
+    iIdleCons(), mMutex(), iNbMissing(0), iNbRescued(0),
+    iNbSkipped(0), iMissingIndex(), iScore(new ServerScore()),
+    iReadScheduler(new ReadScheduler(static_cast<qint64>(aParams.maxRate) * 1024,
+                                     static_cast<qint64>(cDefaultShapingBurst) * 1024),
+                   deleteReadScheduler),
     iLogPrefix(QString("NntpServer").append("[").append(QString::number(iId)).append("] "))
 {
 #ifdef LOG_CONSTRUCTORS
     _log("Constructor");
 #endif
-    iNntpCons.reserve(aParams.maxConnections);
+    for (int i=0; i<iParams.maxConnections; ++i)
+        iSlots[i].store(Q_NULLPTR);
+
+    // the index is only read by the failover
+    if (NntpProxy::useFailover() && NntpProxy::getMissingIndexSize() > 0)
+        iMissingIndex.reset(new BloomFilter(NntpProxy::getMissingIndexSize(), NntpProxy::getMissingIndexFpr()));
 }
 
 NntpServer::~NntpServer(){
-    mMutex.lock();
 #ifdef LOG_CONSTRUCTORS
     QString str("Destructor, ");
-    str += getSizeStr_noLock();
+    str += getSizeStr();
     _log(str);
 #endif
-    for (int i=0; i<iNntpCons.size(); ++i){
+    mMutex.lock();
+    for (int i=0; i<iParams.maxConnections; ++i){
         // we don't own the NntpConnection, SessionHandler does
         // we send a signal so the whole session will be closed properly
-        emit iNntpCons[i]->serverRemoved();
+        NntpConnection *con = iSlots[i].fetchAndStoreOrdered(Q_NULLPTR);
+        if (con)
+            emit con->serverRemoved();
+    }
+    delete[] iSlots;
+
+    // the pooled connections are ours (no thread affinity, we pull them to delete them)
+    for (int i=0; i<iIdleCons.size(); ++i){
+        iIdleCons[i]->moveToThread(QThread::currentThread());
+        delete iIdleCons[i];
     }
-    iNntpCons.clear();
+    iIdleCons.clear();
     mMutex.unlock();
 }
 
+void NntpServer::addMissing(const QByteArray &aMessageId){
+    iNbMissing.fetchAndAddRelaxed(1);
+    if (iMissingIndex && !aMessageId.isEmpty())
+        iMissingIndex->add(aMessageId); // a known one gets refreshed in the current generation
+}
+
+bool NntpServer::isKnownMissing(const QByteArray &aMessageId){
+    if (!iMissingIndex || aMessageId.isEmpty() || !iMissingIndex->contains(aMessageId))
+        return false;
+
+    addSkipped();
+    return true;
+}
+
 QTextStream &  operator<<(QTextStream & stream, const NntpServer &aServer){
     stream << aServer.iLogPrefix;
     return stream;
 }
 
+QString NntpServer::getSizeStr() const{
+    QString str("Available connection: ");
+    str += QString::number(getNumberOfConnectionsAvailable());
+    str += " / ";
+    str += QString::number(iParams.maxConnections);
+    str += " (idle: ";
+    str += QString::number(getNumberOfIdleConnections());
+    str += ")";
+    return str;
+}
+
+bool NntpServer::reserveSlot(){
+    int nbInUse = iNbInUse.load();
+    do {
+        if (nbInUse >= iParams.maxConnections)
+            return false;
+    } while (!iNbInUse.testAndSetOrdered(nbInUse, nbInUse + 1, nbInUse));
+    return true;
+}
+
+void NntpServer::claimSlot(NntpConnection *aNntpCon){
+    // a slot is free for each reservation: the scan ends (a free slot may be taken by a concurrent claim)
+    for (int i=0; ; i = (i + 1) % iParams.maxConnections){
+        if (iSlots[i].testAndSetOrdered(Q_NULLPTR, aNntpCon))
+            return;
+    }
+}
+
+bool NntpServer::freeSlot(NntpConnection *aNntpCon){
+    for (int i=0; i<iParams.maxConnections; ++i){
+        if (iSlots[i].testAndSetOrdered(aNntpCon, Q_NULLPTR))
+            return true;
+    }
+    return false;
+}
+
+NntpConnection *NntpServer::takeFromPool(qintptr aInputId){
+    if (!hasConnectionPool())
+        return Q_NULLPTR;
+
+    // most recently used first, dropping the unhealthy ones (checked out of the lock)
+    qint64 maxIdleMs = 1000 * static_cast<qint64>(iParams.poolIdleTimeout);
+    while (true){
+        NntpConnection *con = Q_NULLPTR;
+        {
+            QMutexLocker lock(&mMutex);
+            if (iIdleCons.isEmpty())
+                return Q_NULLPTR;
+            con = iIdleCons.takeLast();
+        }
+        if (con->acquireFromPool(aInputId, maxIdleMs))
+            return con;
+
+        _log("Dropping an unhealthy pooled connection");
+        delete con;
+    }
+}
+
 NntpConnection* NntpServer::getNntpConnection(qintptr aInputId){
-    QMutexLocker lock(&mMutex);
-    if (iNntpCons.size() >= iParams.maxConnections){
+    if (!reserveSlot()){
         _log("Error getNntpConnection: can't provide a connection as they're all used already");
         return Q_NULLPTR;
     }
 
-    NntpConnection *con = new NntpConnection(aInputId, *this);
-    iNntpCons.append(con);
+    NntpConnection *con = takeFromPool(aInputId);
+    bool isPooled = (con != Q_NULLPTR);
+    if (!isPooled)
+        con = new NntpConnection(aInputId, *this);
+    claimSlot(con);
 
     QTextStream &is = NntpProxy::acquireLog(iLogPrefix);
-    is << "Adding new Nntp Connection with id: " << aInputId
-       << ", " << getSizeStr_noLock();
+    is << (isPooled ? "Reusing pooled Nntp Connection for id: " : "Adding new Nntp Connection with id: ")
+       << aInputId << ", " << getSizeStr();
     NntpProxy::releaseLog();
 
     return con;
 }
 
-NntpConnection* NntpServer::getNntpConnection_noLock(qintptr aInputId){
-    if (iNntpCons.size() >= iParams.maxConnections){
-        _log("Error getNntpConnection: can't provide a connection as they're all used already");
+NntpConnection* NntpServer::takeOverNntpConnection(qintptr aInputId, NntpConnection *aOldCon){
+    // the reservation of the old connection (counter) goes to the new one
+    if (!freeSlot(aOldCon))
         return Q_NULLPTR;
-    }
 
-    NntpConnection *con = new NntpConnection(aInputId, *this);
-    iNntpCons.append(con);
+    NntpConnection *con = takeFromPool(aInputId);
+    if (con == Q_NULLPTR)
+        con = new NntpConnection(aInputId, *this);
+    claimSlot(con);
 
     QTextStream &is = NntpProxy::acquireLog(iLogPrefix);
-    is << "Adding new Nntp Connection with id: " << aInputId
-       << ", " << getSizeStr_noLock();
+    is << "Nntp Connection with id: " << aOldCon->getId()
+       << " replaced by a new one with id: " << aInputId << ", " << getSizeStr();
     NntpProxy::releaseLog();
 
     return con;
@@ -79,18 +186,45 @@ bool NntpServer::releaseNntpConnection(NntpConnection *aNntpCon){
         return false;
     }
 
-    QMutexLocker lock(&mMutex);
-    bool out = iNntpCons.removeOne(aNntpCon);
+    bool out = freeSlot(aNntpCon);
+    if (out)
+        iNbInUse.fetchAndSubOrdered(1);
 
     QTextStream &is = NntpProxy::acquireLog(iLogPrefix);
     is << "Release Nntp Connection with id: " << aNntpCon->getId()
        << ", result: " << out
-       << ", " << getSizeStr_noLock();
+       << ", " << getSizeStr();
     NntpProxy::releaseLog();
 
     return out;
 }
 
+bool NntpServer::recycleNntpConnection(NntpConnection *aNntpCon){
+    if (aNntpCon->getServerId() != iId){
+        _log("Error recycleNntpConnection: trying to recycle a connection to the wrong server...");
+        return false;
+    }
+
+    if (!hasConnectionPool() || !aNntpCon->isAuthenticated()
+            || aNntpCon->getNumberOfPendingCommands() > 0 || !freeSlot(aNntpCon))
+        return false;
+
+    // in the pool before the slot is given back so the next reservation can reuse it
+    aNntpCon->releaseToPool();
+    {
+        QMutexLocker lock(&mMutex);
+        iIdleCons.append(aNntpCon);
+    }
+    iNbInUse.fetchAndSubOrdered(1);
+
+    QTextStream &is = NntpProxy::acquireLog(iLogPrefix);
+    is << "Recycle Nntp Connection with id: " << aNntpCon->getId()
+       << ", " << getSizeStr();
+    NntpProxy::releaseLog();
+
+    return true;
+}
+
 
 
 bool NntpServer::canUseAllConnections() {
@@ -101,32 +235,49 @@ bool NntpServer::canUseAllConnections() {
     str += QString::number(maxCon);
     _log(str);
 
+    // The connections are asynchronous, we run a local event loop
+    // until they're all authenticated or one fails
+    QEventLoop loop;
+    ushort nbPending = maxCon;
+
     QList<NntpConnection *> cons;
     for (int i=0; i<maxCon; ++i){
         NntpConnection * con = getNntpConnection(i);
         cons.append(con);
 
-        if (!con->startTcpConnection(iParams.name.toLatin1().constData(), iParams.port)){
+        QObject::connect(con, &NntpConnection::authenticated, &loop, [&nbPending, &loop](){
+            if (--nbPending == 0)
+                loop.quit();
+        });
+        QObject::connect(con, &Connection::socketError, &loop, [this, i, &canUseAllConnections, &loop](QString aError){
             QString err("Error canUseAllConnections, the connection #");
             err += QString::number(i);
-            err += " failed to connect...";
+            err += " failed: ";
+            err += aError;
             _log(err);
             canUseAllConnections = false;
-            break;
-        }
-        if (iParams.auth && !con->doAuthentication()){
+            loop.quit();
+        });
+
+        if (!con->startTcpConnection(iParams.name.toLatin1().constData(), iParams.port)){
             QString err("Error canUseAllConnections, the connection #");
             err += QString::number(i);
-            err += " failed to authenticate...";
+            err += " failed to start...";
             _log(err);
             canUseAllConnections = false;
             break;
         }
     }
 
+    if (canUseAllConnections && nbPending > 0)
+        loop.exec();
+
+    // the successful connections warm up the pool
     for (int i=0; i < cons.size(); ++i){
-        releaseNntpConnection(cons[i]);
-        delete cons[i];
+        if (!canUseAllConnections || !recycleNntpConnection(cons[i])){
+            releaseNntpConnection(cons[i]);
+            delete cons[i];
+        }
     }
 
     cons.clear();
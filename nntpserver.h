@@ -3,32 +3,43 @@
 
 #include "constants.h"
 #include "nntpproxy.h"
+#include "serverscore.h"
 
 #include <QMutex>
 #include <QMutexLocker>
 #include <QList>
+#include <QAtomicInteger>
+#include <QAtomicPointer>
+#include <QSharedPointer>
 
 QT_FORWARD_DECLARE_CLASS(NntpConnection)
 QT_FORWARD_DECLARE_CLASS(QTcpSocket)
 QT_FORWARD_DECLARE_CLASS(QTextStream)
+QT_FORWARD_DECLARE_CLASS(BloomFilter)
+QT_FORWARD_DECLARE_CLASS(ReadScheduler)
 
 
 /*!
  * \brief NntpServer represents an NntpServer we can connect to
  * - initialised via an NntpServerParameters created by parsing the config file.
- * - holds but NOT owns a list of handles of all the NntpConnection currently in use by the users.
+ * - holds but NOT owns the handles of all the NntpConnection currently in use by the users
+ *   in a fixed array of maxConnections slots: a slot is reserved with an atomic counter
+ *   and claimed with a compare and swap, getting and releasing a connection is lock free
  * - creates the NntpConnections to offer them to users (if some still available).
  * - is NOT responsible for the destruction of the NntpConnection (SessionHandler is)
+ * - keeps a warm pool of idle authenticated NntpConnections (released by clients QUITing)
+ *   that it owns until they are handed out again (cf poolIdleTimeout parameter)
+ * - has a tier in the failover order (priority parameter) and can be a fill server (block account)
+ *   only asked for the articles the primary servers don't have
+ * - remembers the message-ids of its last missing articles (rotating BloomFilter, cf missingIndexSize)
+ *   so the failover goes straight to the next servers when they're asked again
+ * - measures its performance through its connections (ServerScore) to weight the server selection
+ * - shares its bandwidth ceiling (maxRate parameter) between its connections and measures
+ *   its current and peak throughput (ReadScheduler)
  */
 class NntpServer
 {
 public:
-    friend class NntpServerManager; //!< Manager is able to lock/unlock the NntpServer
-
-#ifdef TESTNNTPSERVER_H
-    friend class TestNntpServer; //!< simulate NntpServerManager
-#endif
-
     enum TypeOfConnectionNumber{ //!< Type of number of connections that can be requested
         MaxNuber = 0,
         InUse = 1,
@@ -43,12 +54,18 @@ public:
 
     ~NntpServer(); //!< send signals to all its NntpConnection to get them closed (other Threads)
 
+    //! the connection aOldCon (being closed) leaves its slot to a new connection for aInputId (Q_NULLPTR if not ours)
+    NntpConnection* takeOverNntpConnection(qintptr aInputId, NntpConnection *aOldCon);
+
     inline ushort getId() const;                //!< return the server id (needed by MyManager template)
     inline const QString& getName() const;      //!< return the server name
     inline ushort getPort() const;              //!< return the server port
     inline const QString & getAuthUser() const; //!< return server user
     inline const QString & getAuthPass() const; //!< return server pass
     inline bool isSsl() const;                  //!< return if the server connection should be encrypted
+    inline bool needAuthentication() const;     //!< return if the server requires AUTHINFO
+    inline ushort getPriority() const;          //!< return the tier of the server in the failover order (lowest first)
+    inline bool isFill() const;                 //!< is it a fill server (only used by the failover)
 
     //!< To be able to print a NntpServer
     friend QTextStream &  operator<<(QTextStream & stream, const NntpServer &aServer);
@@ -57,25 +74,39 @@ public:
     inline ushort getNumberOfConnectionsAvailable() const; //!< number of connections currently available
     inline ushort getNumberOfConnectionsInUse() const;     //!< number of connections currently in use
     inline bool   hasConnectionAvailable() const;          //!< is there any connections currently available
+    inline ushort getNumberOfIdleConnections() const;      //!< number of authenticated connections in the pool
+    inline bool   hasConnectionPool() const;               //!< is the warm pool activated (poolIdleTimeout > 0)
 
 
-    NntpConnection* getNntpConnection(qintptr aInputId);  //!< provides an NntpConnection if there are still some available
-    bool releaseNntpConnection(NntpConnection *aNntpCon); //!< release an NntpConnection but doesn't delete it
+    NntpConnection* getNntpConnection(qintptr aInputId);  //!< provides an NntpConnection if there are still some available (lock free but the pool)
+    bool releaseNntpConnection(NntpConnection *aNntpCon); //!< release an NntpConnection but doesn't delete it (lock free)
+    bool recycleNntpConnection(NntpConnection *aNntpCon); //!< put an authenticated NntpConnection back in the pool (we own it then)
 
     bool canUseAllConnections(); //!< Check if we can use all the NntpConnections at the same time
 
+    void           addMissing(const QByteArray &aMessageId);           //!< an article was missing (430/423) on the server (Thread_Safe)
+    inline void    addRescued();                                       //!< the server had an article missing on a previous one (Thread_Safe)
+    inline void    addSkipped();                                       //!< an article wasn't asked as it is in the missing index (Thread_Safe)
+    bool           isKnownMissing(const QByteArray &aMessageId);       //!< is the article in the missing index (counted as skipped, Thread_Safe)
+    inline quint64 getNumberOfMissing() const;   //!< articles missing since start
+    inline quint64 getNumberOfRescued() const;   //!< articles found after a failover since start
+    inline quint64 getNumberOfSkipped() const;   //!< articles not asked because they're in the missing index
+    //! index of the missing articles (null if disabled, Thread_Safe, shared with its NntpConnections: they may outlive the server)
+    inline const QSharedPointer<BloomFilter> &getMissingIndex() const;
+    //! measured performance (Thread_Safe, shared with its NntpConnections: they may outlive the server)
+    inline const QSharedPointer<ServerScore> &getScore() const;
+    //! bandwidth ceiling and throughput (Thread_Safe, shared with its NntpConnections: they may outlive the server)
+    inline const QSharedPointer<ReadScheduler> &getReadScheduler() const;
+
 private:
     inline void _log(const QString &     aMessage) const; //!< Add a log line
     inline void _log(const char*         aMessage) const; //!< Add a log line
-    inline QString  getSizeStr_noLock() const;            //!< get String of the list size
+    QString         getSizeStr() const;                   //!< get String of the number of connections
 
-    ///////////////////////
-    /// Funtions to be used only by friend NntpServerManger
-    ///
-    inline ushort   getNumberOfConnectionsAvailable_noLock() const; //!< number of connections currently available
-    inline ushort   getNumberOfConnectionsInUse_noLock() const;     //!< number of connections currently in use
-    inline bool     hasConnectionAvailable_noLock() const;          //!< is there any connections currently available
-    NntpConnection* getNntpConnection_noLock(qintptr aInputId);     //!< give an NntpConnection to be used
+    bool reserveSlot();                      //!< count one more connection in use (false if they're all used)
+    void claimSlot(NntpConnection *aNntpCon); //!< store the connection in a free slot (one has been reserved)
+    bool freeSlot(NntpConnection *aNntpCon);  //!< empty the slot of the connection (false if not found), the counter isn't changed
+    NntpConnection *takeFromPool(qintptr aInputId); //!< healthy pooled connection (Q_NULLPTR if none)
 
 
 private:
@@ -84,8 +115,17 @@ private:
     const NntpServerParameters iParams;    //!< server parameters (from config.xml)
     const ushort               iId;        //!< Server id
 
-    QList<NntpConnection *>    iNntpCons;  //!< List of all the connections currently in use
-    mutable QMutex             mMutex;     //!< thread safe iNntpCons
+    QAtomicPointer<NntpConnection> *iSlots; //!< connections currently in use (maxConnections slots, Q_NULLPTR: free)
+    QAtomicInteger<int>        iNbInUse;   //!< slots reserved (at most maxConnections)
+    QList<NntpConnection *>    iIdleCons;  //!< Pool of idle authenticated connections (owned)
+    mutable QMutex             mMutex;     //!< thread safe iIdleCons
+
+    QAtomicInteger<quint64>    iNbMissing; //!< articles missing since start
+    QAtomicInteger<quint64>    iNbRescued; //!< articles found after a failover since start
+    QAtomicInteger<quint64>    iNbSkipped; //!< articles not asked because they're in the missing index
+    QSharedPointer<BloomFilter> iMissingIndex; //!< message-ids of the last missing articles (null if disabled)
+    QSharedPointer<ServerScore> iScore;    //!< measured performance
+    QSharedPointer<ReadScheduler> iReadScheduler; //!< bandwidth ceiling and throughput
 
     const QString              iLogPrefix; //!< log prefix
 };
@@ -98,38 +138,35 @@ ushort NntpServer::getPort() const {return iParams.port;}
 const QString & NntpServer::getAuthUser() const{return iParams.login;}
 const QString & NntpServer::getAuthPass() const{return iParams.pass;}
 bool NntpServer::isSsl() const {return iParams.ssl;}
-
-QString NntpServer::getSizeStr_noLock() const{
-    QString str("Available connection: ");
-    str += QString::number(getNumberOfConnectionsAvailable_noLock());
-    str += " / ";
-    str += QString::number(iParams.maxConnections);
-    return str;
-}
+bool NntpServer::needAuthentication() const {return iParams.auth;}
+ushort NntpServer::getPriority() const {return iParams.priority;}
+bool NntpServer::isFill() const {return iParams.fill;}
+
+void    NntpServer::addRescued(){iNbRescued.fetchAndAddRelaxed(1);}
+void    NntpServer::addSkipped(){iNbSkipped.fetchAndAddRelaxed(1);}
+quint64 NntpServer::getNumberOfMissing() const {return iNbMissing.load();}
+quint64 NntpServer::getNumberOfRescued() const {return iNbRescued.load();}
+quint64 NntpServer::getNumberOfSkipped() const {return iNbSkipped.load();}
+const QSharedPointer<BloomFilter> &NntpServer::getMissingIndex() const {return iMissingIndex;}
+const QSharedPointer<ServerScore> &NntpServer::getScore() const {return iScore;}
+const QSharedPointer<ReadScheduler> &NntpServer::getReadScheduler() const {return iReadScheduler;}
 
 ushort NntpServer::getMaxNumberOfConnections() const { return iParams.maxConnections;}
 ushort NntpServer::getNumberOfConnectionsAvailable() const {
-    QMutexLocker lock(&mMutex);
-    return iParams.maxConnections - iNntpCons.size();
+    return iParams.maxConnections - static_cast<ushort>(iNbInUse.load());
 }
 ushort NntpServer::getNumberOfConnectionsInUse() const {
-    QMutexLocker lock(&mMutex);
-    return iNntpCons.size();
+    return static_cast<ushort>(iNbInUse.load());
 }
 bool NntpServer::hasConnectionAvailable() const {
-    QMutexLocker lock(&mMutex);
-    return (iNntpCons.size() < iParams.maxConnections);
+    return iNbInUse.load() < iParams.maxConnections;
 }
 
-ushort NntpServer::getNumberOfConnectionsAvailable_noLock() const {
-    return iParams.maxConnections - iNntpCons.size();
-}
-ushort NntpServer::getNumberOfConnectionsInUse_noLock() const {
-    return iNntpCons.size();
-}
-bool NntpServer::hasConnectionAvailable_noLock() const {
-    return (iNntpCons.size() < iParams.maxConnections);
+ushort NntpServer::getNumberOfIdleConnections() const {
+    QMutexLocker lock(&mMutex);
+    return iIdleCons.size();
 }
+bool NntpServer::hasConnectionPool() const {return iParams.poolIdleTimeout > 0;}
 
 void NntpServer::_log(const char* aMessage) const {
      NntpProxy::log(iLogPrefix, aMessage);
@@ -1,16 +1,25 @@
 #include "nntpservermanager.h"
 #include "nntpserver.h"
 #include "nntpconnection.h"
+#include "bloomfilter.h"
+#include "readscheduler.h"
 #include "user.h"
 #include "usermanager.h"
 
 NntpServerManager::NntpServerManager(const QVector<NntpServerParameters *> &aServParams, UserManager & aUserMgr):
     MyManager<NntpServer>("NntpServer"), iUserMgr(aUserMgr),
-    iNumberNntpConMax(0), iNumberNntpConInUse(0)
+    iNumberNntpConMax(0), iNumberNntpConInUse(0), iListLock(),
+    iAdmissionQueue(NntpProxy::getAdmissionQueueSize())
 {
     for (int i=0; i<aServParams.size(); ++i){
-        iList.append(new NntpServer(*(aServParams[i])));
-        iNumberNntpConMax += aServParams[i]->maxConnections;
+        NntpServer *serv = new NntpServer(*(aServParams[i]));
+        if (!isServerSlotFree_noLock(serv->getId())){
+            _log(QString("Error too many servers, ignoring: ").append(aServParams[i]->name));
+            delete serv;
+            continue;
+        }
+        insert(serv, false);
+        iNumberNntpConMax.fetchAndAddOrdered(aServParams[i]->maxConnections);
     }
 }
 
@@ -47,9 +56,19 @@ short NntpServerManager::addNntpServer(const NntpServerParameters &aParam){
     }
 
     QMutexLocker lock(mMutex);
-    iList.append(serv);
-    iNumberNntpConMax += aParam.maxConnections;
-    return serv->iId;
+    QWriteLocker lockList(&iListLock);
+    if (!isServerSlotFree_noLock(serv->getId())){
+        QString str("Error too many servers active (max: ");
+        str += QString::number(cMaxNntpServers);
+        str += ")";
+        _log(str);
+        delete serv;
+        return -1;
+    }
+    insert(serv, false);
+    iNumberNntpConMax.fetchAndAddOrdered(aParam.maxConnections);
+    admitWaitingSessions();
+    return serv->getId();
 }
 
 
@@ -57,6 +76,7 @@ short NntpServerManager::addNntpServer(const NntpServerParameters &aParam){
 bool NntpServerManager::removeNntpServer(ushort aServerId){
     // Mutex for both find and erase
     QMutexLocker lock(mMutex);
+    QWriteLocker lockList(&iListLock);
 
     NntpServer *serv = find(aServerId, false);
     if (serv == Q_NULLPTR){
@@ -68,23 +88,21 @@ bool NntpServerManager::removeNntpServer(ushort aServerId){
 
     erase(serv, false);
 
-    iNumberNntpConMax   -= serv->getMaxNumberOfConnections();
-    iNumberNntpConInUse -= serv->getNumberOfConnectionsInUse();
+    iNumberNntpConMax.fetchAndSubOrdered(serv->getMaxNumberOfConnections());
+    iNumberNntpConInUse.fetchAndSubOrdered(serv->getNumberOfConnectionsInUse());
     delete serv;
     return true;
 }
 
 
 ushort NntpServerManager::getNumberOfConnections(NntpServer::TypeOfConnectionNumber aTypeOfConnection) const {
-    QMutexLocker lock(mMutex);
-
     switch (aTypeOfConnection) {
     case NntpServer::TypeOfConnectionNumber::MaxNuber :
-        return iNumberNntpConMax;
+        return static_cast<ushort>(iNumberNntpConMax.load());
     case NntpServer::TypeOfConnectionNumber::InUse :
-        return iNumberNntpConInUse;
+        return static_cast<ushort>(iNumberNntpConInUse.load());
     case NntpServer::TypeOfConnectionNumber::Available :
-        return iNumberNntpConMax - iNumberNntpConInUse;
+        return static_cast<ushort>(iNumberNntpConMax.load() - iNumberNntpConInUse.load());
     }
 
     return 0;
@@ -95,7 +113,7 @@ ushort NntpServerManager::getNumberOfConnections(NntpServer::TypeOfConnectionNum
 int NntpServerManager::getNumberOfConnections(
         ushort aServerId, NntpServer::TypeOfConnectionNumber aTypeOfConnection) const{
 
-    QMutexLocker lock(mMutex);
+    QReadLocker lock(&iListLock);
 
     NntpServer * serv = find(aServerId, false);
     if (serv == Q_NULLPTR){
@@ -124,59 +142,119 @@ int NntpServerManager::getNumberOfConnections(
 
 
 
-bool NntpServerManager::releaseNntpConnection(NntpConnection *aCon, bool useMutex){
+bool NntpServerManager::releaseNntpConnection(NntpConnection *aCon){
     ushort servId = aCon->getServerId();
     bool conReleased = false;
 
-    // Mutex for both find and erase
-    if (useMutex)
-        mMutex->lock();
-
+    QReadLocker lock(&iListLock);
     NntpServer *serv = find(servId, false);
     if (serv == Q_NULLPTR){
         QString err("Error can't find the connection server with id: ");
         err += QString::number(servId);
         _log(err);
-    } else {
-        if (serv->releaseNntpConnection(aCon) ){
-            --iNumberNntpConInUse;
-            conReleased = true;
-        }
+    } else if (serv->releaseNntpConnection(aCon)){
+        iNumberNntpConInUse.fetchAndSubOrdered(1);
+        conReleased = true;
     }
+    lock.unlock();
 
-    // Mutex for both find and erase
-    if (useMutex)
-        mMutex->unlock();
-
+    if (conReleased)
+        admitWaitingSessions();
     return conReleased;
+}
 
+bool NntpServerManager::recycleNntpConnection(NntpConnection *aCon){
+    QReadLocker lock(&iListLock);
+    NntpServer *serv = find(aCon->getServerId(), false);
+    if (serv == Q_NULLPTR || !serv->recycleNntpConnection(aCon))
+        return false;
+
+    iNumberNntpConInUse.fetchAndSubOrdered(1);
+    lock.unlock();
+
+    admitWaitingSessions(); // the next session gets the warm connection from the pool
+    return true;
 }
 
-void NntpServerManager::lockAllServers(){
-    for (int i=0; i< iList.size(); ++i)
-        iList[i]->mMutex.lock();
+void NntpServerManager::admitWaitingSessions(){
+    if (iAdmissionQueue.getNumberOfWaiting() > 0)
+        iAdmissionQueue.admit(iNumberNntpConMax.load() - iNumberNntpConInUse.load());
 }
 
-void NntpServerManager::unlockAllServers(){
-    for (int i=0; i< iList.size(); ++i)
-        iList[i]->mMutex.unlock();
+bool NntpServerManager::queueForNntpConnection(QObject *aSession){
+    if (!iAdmissionQueue.push(aSession)){
+        _log("No more room in the admission queue...");
+        return false;
+    }
+
+    admitWaitingSessions(); // a connection may have been released in between
+    return true;
 }
 
+void NntpServerManager::admittedForNntpConnection(QObject *aSession, bool aGotConnection){
+    iAdmissionQueue.admitted(aSession);
+    if (!aGotConnection) // taken meanwhile (failover...): the next one released is for it
+        iAdmissionQueue.push(aSession, true);
+}
 
+void NntpServerManager::leaveAdmissionQueue(QObject *aSession){
+    if (iAdmissionQueue.leave(aSession))
+        admitWaitingSessions();
+}
 
-NntpConnection *NntpServerManager::getNntpConnection(qintptr aInputConId, User *aUser){
+NntpConnection *NntpServerManager::takeOverNntpConnection(qintptr aInputConId, NntpConnection *aOldCon){
+    QReadLocker lock(&iListLock);
+    NntpServer *serv = find(aOldCon->getServerId(), false);
+    if (serv == Q_NULLPTR){
+        QString err("Error can't find the server with id: ");
+        err += QString::number(aOldCon->getServerId());
+        _log(err);
+        return Q_NULLPTR;
+    }
 
-    QMutexLocker lock(mMutex);
-    if (iNumberNntpConInUse == iNumberNntpConMax){
+    return serv->takeOverNntpConnection(aInputConId, aOldCon); // the connection count doesn't change
+}
+
+
+
+NntpConnection *NntpServerManager::getNntpConnection(qintptr aInputConId, User *aUser, bool aIsAdmitted){
+    int nbFree = iNumberNntpConMax.load() - iNumberNntpConInUse.load();
+    if (nbFree <= 0){
         _log("All the connections are already in use...");
         return Q_NULLPTR;
     }
+    if (!aIsAdmitted && !iAdmissionQueue.isOpen(nbFree)){
+        _log("The connections available are for the sessions waiting...");
+        return Q_NULLPTR;
+    }
 
-    lockAllServers();
+    QReadLocker lock(&iListLock);
     iUserMgr.lockUser(aUser);
 
-    ushort nbServers    = iList.size();
+    // a server may lose its last slot to a concurrent session in between: choose again without it
+    double bestTime = getBestExpectedTime_noLock();
+    QList<NntpServer *> fullServers;
     NntpConnection *con = Q_NULLPTR;
+    while (con == Q_NULLPTR){
+        NntpServer *serv = chooseServer_noLock(aUser, bestTime, fullServers);
+        if (serv == Q_NULLPTR)
+            break;
+
+        con = serv->getNntpConnection(aInputConId);
+        if (con == Q_NULLPTR)
+            fullServers.append(serv);
+    }
+
+    if (con!=Q_NULLPTR)
+        iNumberNntpConInUse.fetchAndAddOrdered(1);
+
+    iUserMgr.unlockUser(aUser);
+
+    return con;
+}
+
+NntpServer *NntpServerManager::chooseServer_noLock(User *aUser, double aBestTime, const QList<NntpServer *> &aFullServers){
+    ushort nbServers = iList.size();
 
     // 1.:
     // find all the Nntp Servers with connections available
@@ -185,7 +263,7 @@ NntpConnection *NntpServerManager::getNntpConnection(qintptr aInputConId, User *
     unusedServers.reserve(nbServers);
     for (int i=0; i< nbServers;  ++i){
         NntpServer *srv = iList[i];
-        if (srv->hasConnectionAvailable_noLock()
+        if (!srv->isFill() && srv->hasConnectionAvailable() && !aFullServers.contains(srv)
                 && !iUserMgr.hasUserConnectionWithServer_noLock(aUser, srv->getId())){
             unusedServers.append(srv);
         }
@@ -193,66 +271,227 @@ NntpConnection *NntpServerManager::getNntpConnection(qintptr aInputConId, User *
 
     // 2:
     // if there are servers that the user doesn't use yet,
-    // we give the one with the most available connections
+    // we give the one with the most available connections (weighted by its performance)
     if (unusedServers.size() > 0) {
-        ushort maxConAvailable = 0;
+        double maxConAvailable = 0, weightMax = 1;
         NntpServer *servMaxConAv = Q_NULLPTR;
         for (int i=0; i < unusedServers.size(); ++i){
-            if (unusedServers[i]->getNumberOfConnectionsAvailable_noLock() > maxConAvailable){
+            double weight = getWeight(unusedServers[i], aBestTime);
+            if (unusedServers[i]->getNumberOfConnectionsAvailable() * weight > maxConAvailable){
                 servMaxConAv    = unusedServers[i];
-                maxConAvailable = servMaxConAv->getNumberOfConnectionsAvailable_noLock();
+                weightMax       = weight;
+                maxConAvailable = servMaxConAv->getNumberOfConnectionsAvailable() * weight;
             }
         }
-        _log("we found a NEW connection for the user");
-        con = servMaxConAv->getNntpConnection_noLock(aInputConId);
+        if (servMaxConAv != Q_NULLPTR)
+            logChoice("we found a NEW connection for the user", servMaxConAv, weightMax);
+        return servMaxConAv;
     }
+
     // 3.: Otherwise if no unused server
     // we take a connection from the server that the user has less
-    // (We get the list of serverId ordered by number min of connection
-    // and we take a connection from the first server that has some available)
-    else {
-        vectNntpSrvOrderByCons userServCon = iUserMgr.getUserVectorOfNntpServerOrderedByNumberOfCons_noLock(aUser);
-        for (auto it = userServCon.cbegin(); it!= userServCon.cend(); ++it){
-            ushort servId = it->first;
-            NntpServer * serv = find(servId, false); // non blocking
-            if (serv == Q_NULLPTR){
-                QTextStream &ostream = NntpProxy::acquireLog(iLogPrefix);
-                ostream << "Error getting new Nntp Connection for user: " << aUser
-                        << ", it is still using a server that is not anymore active..."
-                        << " (serverId: " << servId;
-                NntpProxy::releaseLog();
+    // (number of connections of the user divided by the performance weight of the server,
+    // among the servers that have some available)
+    vectNntpSrvOrderByCons userServCon = iUserMgr.getUserVectorOfNntpServerOrderedByNumberOfCons_noLock(aUser);
+    NntpServer *servMin = Q_NULLPTR;
+    double      loadMin = 0, weightMin = 1;
+    for (auto it = userServCon.cbegin(); it!= userServCon.cend(); ++it){
+        ushort servId = it->first;
+        NntpServer * serv = find(servId, false); // non blocking
+        if (serv == Q_NULLPTR){
+            QTextStream &ostream = NntpProxy::acquireLog(iLogPrefix);
+            ostream << "Error getting new Nntp Connection for user: " << aUser
+                    << ", it is still using a server that is not anymore active..."
+                    << " (serverId: " << servId;
+            NntpProxy::releaseLog();
+            continue;
+        }
+        if (!serv->hasConnectionAvailable() || aFullServers.contains(serv))
+            continue;
+
+        double weight = getWeight(serv, aBestTime);
+        double load   = (it->second + 1) / weight;
+        if (servMin == Q_NULLPTR || load < loadMin){
+            servMin   = serv;
+            loadMin   = load;
+            weightMin = weight;
+        }
+    }
+    if (servMin != Q_NULLPTR)
+        logChoice("we found a connection for the user", servMin, weightMin);
+    return servMin;
+}
+
+NntpConnection *NntpServerManager::getSharedNntpConnection(qintptr aConId){
+    if (iNumberNntpConInUse.load() >= iNumberNntpConMax.load())
+        return Q_NULLPTR;
+
+    QReadLocker lock(&iListLock);
+
+    double bestTime = getBestExpectedTime_noLock();
+    QList<NntpServer *> fullServers;
+    NntpConnection *con = Q_NULLPTR;
+    while (con == Q_NULLPTR){
+        double maxConAvailable = 0;
+        NntpServer *servMaxConAv = Q_NULLPTR;
+        for (int i=0; i < iList.size(); ++i){
+            if (iList[i]->isFill() || fullServers.contains(iList[i]))
                 continue;
-            }
-            if (serv->hasConnectionAvailable_noLock()){
-                _log("we found a connection for the user");
-                con = serv->getNntpConnection_noLock(aInputConId);
-                break;
+            double conAvailable = iList[i]->getNumberOfConnectionsAvailable() * getWeight(iList[i], bestTime);
+            if (conAvailable > maxConAvailable){
+                servMaxConAv    = iList[i];
+                maxConAvailable = conAvailable;
             }
         }
+        if (servMaxConAv == Q_NULLPTR)
+            break;
+
+        con = servMaxConAv->getNntpConnection(aConId);
+        if (con == Q_NULLPTR)
+            fullServers.append(servMaxConAv);
     }
 
     if (con!=Q_NULLPTR)
-        ++iNumberNntpConInUse;
-
-    iUserMgr.unlockUser(aUser);
-    unlockAllServers();
+        iNumberNntpConInUse.fetchAndAddOrdered(1);
 
     return con;
 }
 
-NntpConnection *NntpServerManager::getOfferedNntpConnectionFromServer_noLock(qintptr aInputConId, ushort aServId){
-    _log("getOfferedNntpConnectionFromServer_noLock");
-    NntpServer *serv = find(aServId, false);
-    if (serv == Q_NULLPTR){
-        QString err("Error can't find the server with id: ");
-        err += QString::number(aServId);
-        _log(err);
+NntpConnection *NntpServerManager::getFailoverNntpConnection(qintptr aConId, const QList<ushort> &aTriedServers,
+                                                             const QByteArray &aMessageId){
+    if (iNumberNntpConInUse.load() >= iNumberNntpConMax.load())
         return Q_NULLPTR;
+
+    QReadLocker lock(&iListLock);
+
+    QList<ushort> skipped(aTriedServers); // plus the ones that got full in between
+    NntpConnection *con = Q_NULLPTR;
+    while (con == Q_NULLPTR){
+        NntpServer *next = Q_NULLPTR;
+        for (int i=0; i < iList.size(); ++i){
+            NntpServer *srv = iList[i];
+            if (skipped.contains(srv->getId()) || !srv->hasConnectionAvailable())
+                continue;
+            if (next != Q_NULLPTR && !isBeforeInFailoverOrder(srv, next))
+                continue;
+            if (srv->isKnownMissing(aMessageId))
+                continue; // said no recently
+            next = srv;
+        }
+        if (next == Q_NULLPTR)
+            break;
+
+        con = next->getNntpConnection(aConId);
+        if (con == Q_NULLPTR)
+            skipped.append(next->getId());
     }
 
-    return serv->getNntpConnection_noLock(aInputConId);;
+    if (con!=Q_NULLPTR)
+        iNumberNntpConInUse.fetchAndAddOrdered(1);
+
+    return con;
 }
 
+bool NntpServerManager::isServerSlotFree_noLock(ushort aServerId) const{
+    ushort slot = User::getServerSlot(aServerId);
+    for (int i=0; i<iList.size(); ++i){
+        if (User::getServerSlot(iList[i]->getId()) == slot)
+            return false;
+    }
+    return true;
+}
+
+bool NntpServerManager::isBeforeInFailoverOrder(const NntpServer *aFirst, const NntpServer *aSecond){
+    if (aFirst->isFill() != aSecond->isFill())
+        return !aFirst->isFill();
+    if (aFirst->getPriority() != aSecond->getPriority())
+        return aFirst->getPriority() < aSecond->getPriority();
+    return aFirst->getId() < aSecond->getId();
+}
+
+double NntpServerManager::getBestExpectedTime_noLock() const {
+    double bestTime = -1;
+    for (int i=0; i < iList.size(); ++i){
+        double time = iList[i]->getScore()->getExpectedTime();
+        if (!iList[i]->isFill() && time > 0 && (bestTime < 0 || time < bestTime))
+            bestTime = time;
+    }
+    return bestTime;
+}
+
+double NntpServerManager::getWeight(const NntpServer *aServer, double aBestTime){
+    if (!NntpProxy::useServerScoring() || aBestTime <= 0)
+        return 1;
+
+    double time = aServer->getScore()->getExpectedTime();
+    if (time <= 0)
+        return 1; // not measured yet: it gets its chance
+    return aBestTime / time;
+}
+
+void NntpServerManager::logChoice(const char *aWhy, const NntpServer *aServer, double aWeight){
+    QTextStream &ostream = NntpProxy::acquireLog(iLogPrefix);
+    ostream << aWhy << " on " << aServer->getName()
+            << " (available: " << aServer->getNumberOfConnectionsAvailable()
+            << ", weight: " << aWeight << ", ";
+    aServer->getScore()->dump(ostream);
+    ostream << ")";
+    NntpProxy::releaseLog();
+}
+
+void NntpServerManager::addMissing(ushort aServerId, const QByteArray &aMessageId){
+    QMutexLocker lock(mMutex);
+    NntpServer *serv = find(aServerId, false);
+    if (serv != Q_NULLPTR)
+        serv->addMissing(aMessageId);
+}
+
+void NntpServerManager::addRescued(ushort aServerId){
+    QMutexLocker lock(mMutex);
+    NntpServer *serv = find(aServerId, false);
+    if (serv != Q_NULLPTR)
+        serv->addRescued();
+}
+
+void NntpServerManager::addSkipped(ushort aServerId){
+    QMutexLocker lock(mMutex);
+    NntpServer *serv = find(aServerId, false);
+    if (serv != Q_NULLPTR)
+        serv->addSkipped();
+}
+
+void NntpServerManager::dumpStats(QTextStream &aStream){
+    QMutexLocker lock(mMutex);
+    aStream << "Nntp servers:\n";
+    double bestTime = getBestExpectedTime_noLock();
+    for (int i=0; i < iList.size(); ++i){
+        NntpServer *serv = iList[i];
+        aStream << "\t- " << serv->getName() << " (id: " << serv->getId()
+                << ", priority: " << serv->getPriority() << (serv->isFill() ? ", fill" : "")
+                << "): connections in use: " << serv->getNumberOfConnectionsInUse()
+                << " / " << serv->getMaxNumberOfConnections()
+                << ", missing: " << serv->getNumberOfMissing()
+                << ", rescued: " << serv->getNumberOfRescued() << "\n";
+
+        aStream << "\t  score: ";
+        serv->getScore()->dump(aStream);
+        aStream << ", weight: " << getWeight(serv, bestTime) << "\n";
+
+        aStream << "\t  bandwidth: ";
+        serv->getReadScheduler()->dump(aStream);
+        aStream << "\n";
+
+        const BloomFilter *index = serv->getMissingIndex().data();
+        if (index)
+            aStream << "\t  missing index: " << index->getMemorySize() / 1024 << " KB"
+                    << ", " << index->getNumberOfHashes() << " hashes"
+                    << ", keys: " << index->getNumberOfKeys() << " (capacity: 2 x " << index->getCapacity() << ")"
+                    << ", estimated fpr: " << index->getFalsePositiveRate()
+                    << ", rotations: " << index->getNumberOfRotations()
+                    << ", skipped: " << serv->getNumberOfSkipped() << "\n";
+    }
+    iAdmissionQueue.dump(aStream);
+}
 
 NntpConnection *NntpServerManager::getMonitoringNntpConnection(){
     NntpConnection *con = Q_NULLPTR;
@@ -5,6 +5,10 @@
 #include "mymanager.h"
 #include "nntpserver.h"
 #include "usermanager.h"
+#include "admissionqueue.h"
+
+#include <QReadWriteLock>
+#include <QAtomicInteger>
 
 QT_FORWARD_DECLARE_CLASS(NntpConnection)
 QT_FORWARD_DECLARE_CLASS(User)
@@ -14,11 +18,19 @@ QT_FORWARD_DECLARE_CLASS(SessionManager)
 /*!
  * \brief Manager that OWNS all the actives NntpServers
  * - owns the NntpServers (delete them on removal)
+ * - the connection paths only share a read lock on the list of servers (their slots are lock free),
+ *   adding or removing a server takes it for writing (with mMutex)
+ * - the sessions only get connections from the primary servers,
+ *   the fill servers are only used by the failover of the missing articles
+ * - the available connections of the servers are weighted by their measured performance
+ *   (expected time of the best server / expected time of the server, cf ServerScore)
+ * - when they're all in use, the sessions may wait in the AdmissionQueue: each connection released
+ *   admits the next session waiting, the newcomers can't take the connections free for the admitted ones
  */
 class NntpServerManager : public MyManager<NntpServer>
 {
 public:
-    friend class SessionManager; //!< SessionManager::tryToGetNntpConnectionFromOtherUser is able to lock/unlock
+    friend class SessionManager; //!< the SessionHandlers yielding their connection take it over (via SessionManager)
 
     //!< Constructor with a list of NntpServerParameters (from parsing config file)
     explicit NntpServerManager(const QVector<NntpServerParameters *> &aServParams, UserManager & aUserMgr);
@@ -41,25 +53,72 @@ public:
 
 
     /*!
-     * \brief provide a NntpConnection for a given User (if some available, from Server where the user has the less connections)
+     * \brief provide a NntpConnection for a given User (if some available)
+     * - from the servers the user doesn't use yet: the one with the most weighted available connections
+     * - otherwise the server where the user has the less weighted connections
      * \param aInputConId : SessionHandler Id (used for log purposes)
      * \param aUser : User that ask for a connection
+     * \param aIsAdmitted : the session has been admitted by the AdmissionQueue (otherwise it doesn't pass the waiting ones)
      * \return
      */
-    NntpConnection *getNntpConnection(qintptr aInputConId, User *aUser);
+    NntpConnection *getNntpConnection(qintptr aInputConId, User *aUser, bool aIsAdmitted = false);
     NntpConnection *getMonitoringNntpConnection(); //!< TODO: for monitor server (no user needed)
 
     /*!
-     * \brief release a NntpConnection via its server (Thread_Safe by default)
-     * \param aCon     : connection to release
-     * \param useMutex : Should it be blocking?
-     * \return
+     * \brief provide a NntpConnection shared by several users (multiplexing mode, no User accounting)
+     * from the server with the most weighted available connections
+     * \param aConId : id of the connection (used for log purposes)
+     * \return Q_NULLPTR if all the connections are in use
+     */
+    NntpConnection *getSharedNntpConnection(qintptr aConId);
+
+    /*!
+     * \brief provide a NntpConnection to ask an article missing on other servers (no User accounting)
+     * from the first server in the failover order that hasn't been tried yet and has a connection available:
+     * primary servers then fill ones, by priority (then by id)
+     * the servers that have the article in their missing index are skipped
+     * \param aConId        : id of the connection (used for log purposes)
+     * \param aTriedServers : servers that already answered the article was missing
+     * \param aMessageId    : message-id of the article (empty: no index lookup)
+     * \return Q_NULLPTR if there is no server left to try
      */
-    bool releaseNntpConnection(NntpConnection *aCon, bool useMutex = true);
+    NntpConnection *getFailoverNntpConnection(qintptr aConId, const QList<ushort> &aTriedServers,
+                                              const QByteArray &aMessageId = QByteArray());
+
+    void addMissing(ushort aServerId, const QByteArray &aMessageId); //!< record an article missing on a server (Thread_Safe)
+    void addRescued(ushort aServerId); //!< count an article found on a server after a failover (Thread_Safe)
+    void addSkipped(ushort aServerId); //!< count an article not asked to a server as it is in its missing index (Thread_Safe)
+    void dumpStats(QTextStream &aStream); //!< write the connections and failover statistics of each server
+
+    /*!
+     * \brief release a NntpConnection via its server (Thread_Safe)
+     * \param aCon : connection to release
+     * \return false if the connection doesn't hold a slot of its server
+     */
+    bool releaseNntpConnection(NntpConnection *aCon);
+
+    /*!
+     * \brief give back an authenticated NntpConnection to the pool of its server (Thread_Safe)
+     * \param aCon : connection to recycle (not to be used nor deleted by the caller if it succeeds)
+     * \return false if the server has no pool (the connection must then be released and deleted)
+     */
+    bool recycleNntpConnection(NntpConnection *aCon);
 
     //!< Check if all the servers can use all their connections at the same time
     bool canConnectToNntpServers();
 
+    /*!
+     * \brief wait for the next connection released (Thread_Safe)
+     * \param aSession : SessionHandler (its slot admissionGranted() will be called)
+     * \return false if the queue is full (or disabled)
+     */
+    bool queueForNntpConnection(QObject *aSession);
+    //! the admitted aSession called getNntpConnection: if it didn't get any, it waits again at the head (Thread_Safe)
+    void admittedForNntpConnection(QObject *aSession, bool aGotConnection);
+    inline bool cancelNntpConnectionWait(QObject *aSession); //!< timeout: false if aSession has been admitted meanwhile (Thread_Safe)
+    void leaveAdmissionQueue(QObject *aSession); //!< aSession is closing: its admission goes to the next one (Thread_Safe)
+    inline AdmissionQueue &getAdmissionQueue();  //!< sessions waiting for a connection
+
 
 private:
     //! Factoring function to get the number of connection depending on the type
@@ -68,21 +127,44 @@ private:
     //! Factoring code to get the number of connection of a specific server depending on the type
     int    getNumberOfConnections(ushort aServerId, NntpServer::TypeOfConnectionNumber aTypeOfConnection) const;
 
-    void lockAllServers();   //!< Lock all servers (block their list of connections)
-    void unlockAllServers(); //!< Unlock all servers (block their list of connections)
-
     /*!
-     * \brief Used by SessionManager::tryToGetNntpConnectionFromOtherUser to get a NntpConnection from a Server
+     * \brief Used by a SessionHandler yielding its connection (FairShareScheduler) to give its slot to a new one
      * \param aInputConId : InputId for the created NntpConnection
-     * \param aServId     : Server from which we get the NntpConnection (one just got released)
-     * \return
+     * \param aOldCon     : connection yielded to another user (being closed, its release will fail)
+     * \return Q_NULLPTR if aOldCon doesn't hold a slot anymore
+     */
+    NntpConnection *takeOverNntpConnection(qintptr aInputConId, NntpConnection *aOldCon);
+
+    /*!
+     * \brief server to give a connection to a user (iListLock and the user locked)
+     * \param aUser        : the user
+     * \param aBestTime    : getBestExpectedTime_noLock
+     * \param aFullServers : servers that got full since they've been chosen
+     * \return Q_NULLPTR if no server has a connection available
+     */
+    NntpServer *chooseServer_noLock(User *aUser, double aBestTime, const QList<NntpServer *> &aFullServers);
+
+    static bool isBeforeInFailoverOrder(const NntpServer *aFirst, const NntpServer *aSecond); //!< order of the failover
+    bool isServerSlotFree_noLock(ushort aServerId) const; //!< no active server uses the User counter slot of aServerId
+
+    double getBestExpectedTime_noLock() const; //!< smallest expected time of the primary servers (-1 if none measured)
+
+    /*!
+     * \brief performance weight of a server in the selection
+     * \param aServer   : the server
+     * \param aBestTime : getBestExpectedTime_noLock
+     * \return aBestTime / expected time of the server in ]0, 1] (1 if not measured yet or without scoring)
      */
-    NntpConnection *getOfferedNntpConnectionFromServer_noLock(qintptr aInputConId, ushort aServId);
+    static double getWeight(const NntpServer *aServer, double aBestTime);
+    void logChoice(const char *aWhy, const NntpServer *aServer, double aWeight); //!< why a server has been chosen
+    void admitWaitingSessions(); //!< a connection has been released: admit the sessions waiting for it
 
 private:
     UserManager & iUserMgr;     //!< UserManager handle to be able to lock users
-    ushort iNumberNntpConMax;   //!< Number max of connections
-    ushort iNumberNntpConInUse; //!< Global number of used connections (to avoid to go through the list of servers)
+    QAtomicInteger<int> iNumberNntpConMax;   //!< Number max of connections
+    QAtomicInteger<int> iNumberNntpConInUse; //!< Global number of used connections (to avoid to go through the list of servers)
+    mutable QReadWriteLock iListLock;        //!< iList: shared by the connection paths, exclusive for add/remove server
+    AdmissionQueue iAdmissionQueue;          //!< sessions waiting for a connection
 
 };
 
@@ -113,4 +195,12 @@ int NntpServerManager::getNumberOfConnectionsInUse(ushort aServerId) const{
     return getNumberOfConnections(aServerId, NntpServer::TypeOfConnectionNumber::InUse);
 }
 
+bool NntpServerManager::cancelNntpConnectionWait(QObject *aSession){
+    return iAdmissionQueue.cancel(aSession);
+}
+
+AdmissionQueue &NntpServerManager::getAdmissionQueue(){
+    return iAdmissionQueue;
+}
+
 #endif // NNTPSERVERMANAGER_H
@@ -0,0 +1,134 @@
+#include "readscheduler.h"
+
+#include <QMutexLocker>
+#include <QTextStream>
+#include <QTimer>
+
+ReadScheduler::ReadScheduler(qint64 aRate, qint64 aBurst):
+    QObject(), iBucket(aRate, aBurst),
+    iQuantum(qMax(cShapingChunk, aRate * cReadGrantInterval / 1000)),
+    iMutex(), iWaiters(), iFinish(), iVirtualTime(0),
+    iGrantTimer(new QTimer(this)), iSampleTimer(new QTimer(this)),
+    iLastSample(TokenBucket::now()), iLastBytes(0),
+    iNbWaiting(0), isScheduled(0), iNbGrants(0), iCurrentRate(0), iPeakRate(0)
+{
+    iGrantTimer->setSingleShot(true);
+    iGrantTimer->setTimerType(Qt::PreciseTimer);
+    connect(iGrantTimer, &QTimer::timeout, this, &ReadScheduler::grantNext);
+
+    iSampleTimer->setInterval(cBandwidthSampleInterval);
+    connect(iSampleTimer, &QTimer::timeout, this, &ReadScheduler::sampleNow);
+    iSampleTimer->start();
+}
+
+qint64 ReadScheduler::take(QObject *aCon, qint64 aWanted, uint aWeight){
+    if (aWanted <= 0)
+        return 0;
+
+    // lock free while nobody waits (always without ceiling)
+    if (!iBucket.isLimited() || iNbWaiting.load() == 0){
+        qint64 delay   = 0;
+        qint64 granted = iBucket.take(aWanted, TokenBucket::now(), delay);
+        if (granted > 0)
+            return granted;
+    }
+
+    QMutexLocker lock(&iMutex);
+    bool isWaiting = false;
+    for (const Waiter &waiter : iWaiters){
+        if (waiter.con == aCon){
+            isWaiting = true;
+            break;
+        }
+    }
+    if (!isWaiting){
+        // a connection served recently starts after the others
+        Waiter waiter = {aCon, aWeight > 0 ? aWeight : 1, qMax(iVirtualTime, iFinish.value(aCon, 0))};
+        iWaiters.append(waiter);
+        iNbWaiting.store(iWaiters.size());
+    }
+
+    if (isScheduled.testAndSetOrdered(0, 1))
+        QMetaObject::invokeMethod(this, "grantNext", Qt::QueuedConnection);
+    return 0;
+}
+
+void ReadScheduler::giveBack(qint64 aBytes){
+    iBucket.giveBack(aBytes);
+}
+
+void ReadScheduler::leave(QObject *aCon){
+    QMutexLocker lock(&iMutex);
+    for (int i = 0; i < iWaiters.size(); ++i){
+        if (iWaiters[i].con == aCon){
+            iWaiters.removeAt(i);
+            break;
+        }
+    }
+    iFinish.remove(aCon);
+    iNbWaiting.store(iWaiters.size());
+}
+
+int ReadScheduler::nextWaiter_noLock() const {
+    int next = 0;
+    for (int i = 1; i < iWaiters.size(); ++i){
+        if (iWaiters[i].start < iWaiters[next].start)
+            next = i; // FIFO between equal tags
+    }
+    return next;
+}
+
+void ReadScheduler::grantNext(){
+    QMutexLocker lock(&iMutex);
+    while (!iWaiters.isEmpty()){
+        qint64 delay   = 0;
+        qint64 granted = iBucket.take(iQuantum, TokenBucket::now(), delay);
+        if (granted == 0){
+            iGrantTimer->start(static_cast<int>((delay + 999999) / 1000000));
+            return; // still scheduled
+        }
+
+        Waiter waiter = iWaiters.takeAt(nextWaiter_noLock());
+        iVirtualTime  = waiter.start;
+        iFinish.insert(waiter.con, waiter.start + granted / waiter.weight);
+        iNbWaiting.store(iWaiters.size());
+        iNbGrants.fetchAndAddRelaxed(1);
+        QMetaObject::invokeMethod(waiter.con, "readGranted", Qt::QueuedConnection, Q_ARG(qint64, granted));
+    }
+    isScheduled.store(0);
+}
+
+void ReadScheduler::sampleNow(){
+    sample(TokenBucket::now());
+}
+
+void ReadScheduler::sample(qint64 aNow){
+    QMutexLocker lock(&iMutex);
+    qint64 elapsed = aNow - iLastSample;
+    if (elapsed <= 0)
+        return;
+
+    // bytes given back after the previous sample may have been counted in it
+    quint64 bytes = iBucket.getNumberOfBytes();
+    qint64  rate  = 0;
+    if (bytes > iLastBytes)
+        rate = static_cast<qint64>(static_cast<double>(bytes - iLastBytes) * TokenBucket::sNsPerSecond / elapsed);
+
+    iCurrentRate.store(rate);
+    if (rate > iPeakRate.load())
+        iPeakRate.store(rate);
+    iLastSample = aNow;
+    iLastBytes  = bytes;
+}
+
+void ReadScheduler::dump(QTextStream &aStream){
+    aStream << "throughput: " << getCurrentRate() / 1024 << " KB/s"
+            << " (peak: " << getPeakRate() / 1024 << " KB/s), ceiling: ";
+    if (isLimited())
+        aStream << getRate() / 1024 << " KB/s";
+    else
+        aStream << "none";
+    aStream << ", waiting: " << getNumberOfWaiting() << ", grants: " << getNumberOfGrants()
+            << ", throttled: " << getThrottledTime() / 1000000 << " ms"
+            << ", read: " << getNumberOfBytes() / (1024 * 1024) << " MB";
+}
@@ -0,0 +1,113 @@
+#ifndef READSCHEDULER_H
+#define READSCHEDULER_H
+
+#include "constants.h"
+#include "tokenbucket.h"
+
+#include <QObject>
+#include <QList>
+#include <QHash>
+#include <QMutex>
+#include <QAtomicInteger>
+
+QT_FORWARD_DECLARE_CLASS(QTextStream)
+QT_FORWARD_DECLARE_CLASS(QTimer)
+
+/*!
+ * \brief Bandwidth ceiling of a NntpServer shared by all its NntpConnections (Thread_Safe)
+ * - a TokenBucket with the rate of the server (maxRate parameter, 0: no ceiling)
+ * - while nobody waits, a connection takes from the bucket lock free (take)
+ * - once it is empty, the connections wait in the scheduler instead of reading their socket:
+ *   they're served in weighted order (start-time fair queueing: the least served for its weight first)
+ *   with a grant of cReadGrantInterval ms of the ceiling, by a queued call of their slot readGranted(qint64)
+ * - the newcomers don't overtake the connections waiting (no lock free take while some wait)
+ * - the bytes read through it are sampled every cBandwidthSampleInterval ms:
+ *   current and peak throughput of the server (whether it has a ceiling or not)
+ * - lives in the thread that created it (its timers), called from the Workers
+ */
+class ReadScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+    /*!
+     * \brief ReadScheduler constructor
+     * \param aRate  : bytes per second (0: no ceiling)
+     * \param aBurst : bytes that can be read at once after an idle period
+     */
+    explicit ReadScheduler(qint64 aRate, qint64 aBurst);
+    ReadScheduler(const ReadScheduler &)              = delete;
+    ReadScheduler(const ReadScheduler &&)             = delete;
+    ReadScheduler & operator=(const ReadScheduler &)  = delete;
+    ReadScheduler & operator=(const ReadScheduler &&) = delete;
+
+    ~ReadScheduler() = default;
+
+    /*!
+     * \brief take up to aWanted bytes to read for aCon
+     * \param aCon    : connection reading (its slot readGranted(qint64) is called if it has to wait)
+     * \param aWanted : bytes it would read
+     * \param aWeight : share of aCon relative to the other connections waiting
+     * \return bytes that can be read now, 0: aCon is queued (nothing should be read till readGranted)
+     */
+    qint64 take(QObject *aCon, qint64 aWanted, uint aWeight = 1);
+    void   giveBack(qint64 aBytes); //!< bytes taken (or granted) but not read
+    void   leave(QObject *aCon);    //!< the connection doesn't read anymore (closed or back in the pool)
+
+    inline bool    isLimited() const;            //!< is there a ceiling
+    inline qint64  getRate() const;              //!< ceiling in bytes per second (0: none)
+    inline int     getNumberOfWaiting() const;   //!< connections waiting for a grant
+    inline quint64 getNumberOfGrants() const;    //!< grants to waiting connections since start
+    inline quint64 getNumberOfBytes() const;     //!< bytes read since start
+    inline qint64  getCurrentRate() const;       //!< bytes per second of the last sample
+    inline qint64  getPeakRate() const;          //!< highest sample since start (bytes per second)
+    inline qint64  getThrottledTime() const;     //!< ns the connections waited for a grant since start
+    inline void    addThrottledTime(qint64 aNs); //!< a connection waited aNs for its grant
+
+    void sample(qint64 aNow); //!< throughput since the previous sample (aNow: TokenBucket::now())
+
+    void dump(QTextStream &aStream); //!< write the throughput and the ceiling
+
+public slots:
+    void grantNext(); //!< serve the waiting connections while the bucket has tokens (then wait for it)
+    void sampleNow(); //!< iSampleTimer
+
+private:
+    struct Waiter {      //!< a connection waiting for a grant
+        QObject *con;    //!< the connection
+        uint     weight; //!< its share
+        qint64   start;  //!< virtual start tag (the smallest is served first)
+    };
+
+    int nextWaiter_noLock() const; //!< index of the waiter with the smallest start tag
+
+private:
+    TokenBucket             iBucket;    //!< the ceiling
+    const qint64            iQuantum;   //!< bytes granted at once to a waiting connection
+    QMutex                  iMutex;     //!< protects what follows
+    QList<Waiter>           iWaiters;   //!< connections waiting
+    QHash<QObject *, qint64> iFinish;   //!< virtual finish tag of the last grant of the connections
+    qint64                  iVirtualTime; //!< start tag of the last grant
+    QTimer                 *iGrantTimer;  //!< next tokens for the waiters (owns it)
+    QTimer                 *iSampleTimer; //!< periodic throughput sample (owns it)
+    qint64                  iLastSample;  //!< TokenBucket::now() of the previous sample
+    quint64                 iLastBytes;   //!< bytes read at the previous sample
+
+    QAtomicInteger<int>     iNbWaiting;   //!< iWaiters.size() (lock free reads)
+    QAtomicInteger<int>     isScheduled;  //!< a grantNext is queued or iGrantTimer is running
+    QAtomicInteger<quint64> iNbGrants;    //!< grants since start
+    QAtomicInteger<qint64>  iCurrentRate; //!< bytes per second of the last sample
+    QAtomicInteger<qint64>  iPeakRate;    //!< highest sample since start
+};
+
+bool    ReadScheduler::isLimited() const {return iBucket.isLimited();}
+qint64  ReadScheduler::getRate() const {return iBucket.getRate();}
+int     ReadScheduler::getNumberOfWaiting() const {return iNbWaiting.load();}
+quint64 ReadScheduler::getNumberOfGrants() const {return iNbGrants.load();}
+quint64 ReadScheduler::getNumberOfBytes() const {return iBucket.getNumberOfBytes();}
+qint64  ReadScheduler::getCurrentRate() const {return iCurrentRate.load();}
+qint64  ReadScheduler::getPeakRate() const {return iPeakRate.load();}
+qint64  ReadScheduler::getThrottledTime() const {return iBucket.getThrottledTime();}
+void    ReadScheduler::addThrottledTime(qint64 aNs){iBucket.addThrottledTime(aNs);}
+
+#endif // READSCHEDULER_H
@@ -0,0 +1,89 @@
+#include "responseframer.h"
+#include "nntp.h"
+#include "nntpscanner.h"
+
+static const char sTerminator[] = "\r\n.\r\n";
+
+ResponseFramer::ResponseFramer():
+    iPendingCmds(), iStatusLine(), isStatusRead(false), isEnd(false),
+    iMatched(0), iResponseSize(0)
+{}
+
+void ResponseFramer::addCommand(const QByteArray &aCmd){
+    iPendingCmds.append(aCmd);
+}
+
+qint64 ResponseFramer::scan(const char *aData, qint64 aLen){
+    isEnd = false;
+    if (iPendingCmds.isEmpty())
+        return aLen; // nothing expected (server message), forwarded as it is
+
+    qint64 pos = 0;
+    if (!isStatusRead){
+        qint64 eol     = NntpScanner::findLineEnd(aData, aLen);
+        qint64 lineLen = (eol != -1) ? (eol + 1) : aLen;
+        if (iStatusLine.size() < sMaxStatusLineSize)
+            iStatusLine.append(aData, static_cast<int>(qMin<qint64>(lineLen, sMaxStatusLineSize - iStatusLine.size())));
+        iResponseSize += lineLen;
+        pos = lineLen;
+        if (eol == -1)
+            return pos;
+
+        isStatusRead = true;
+        ushort code  = Nntp::getResponseCode(iStatusLine.constData());
+        if (!Nntp::isMultiLineResponse(iPendingCmds.first().constData(), code)){
+            isEnd = true;
+            return pos;
+        }
+        iMatched = 2; // the CRLF of the status line starts the terminator of an empty body
+    }
+
+    qint64 bodyLen = findTerminator(aData + pos, aLen - pos);
+    iResponseSize += bodyLen;
+    return pos + bodyLen;
+}
+
+bool ResponseFramer::matchTerminator(char aChar){
+    if (aChar == sTerminator[iMatched])
+        ++iMatched;
+    else
+        iMatched = (aChar == '\r') ? 1 : 0;
+    return iMatched == 5;
+}
+
+qint64 ResponseFramer::findTerminator(const char *aData, qint64 aLen){
+    // end of a terminator started in the previous chunk (at most 4 chars to look at)
+    qint64 i = 0;
+    while (iMatched > 0 && i < aLen){
+        if (matchTerminator(aData[i++])){
+            isEnd = true;
+            return i;
+        }
+    }
+    if (i == aLen)
+        return aLen;
+
+    // whole terminator in the chunk: vectorized search
+    qint64 end = NntpScanner::findTerminator(aData + i, aLen - i);
+    if (end != -1){
+        isEnd = true;
+        return i + end;
+    }
+
+    // keep the beginning of a terminator cut by the end of the chunk
+    for (qint64 j = qMax(i, aLen - 4); j < aLen; ++j)
+        matchTerminator(aData[j]);
+    return aLen;
+}
+
+void ResponseFramer::takeResponse(QByteArray &aCmd, QByteArray &aStatusLine, qint64 &aSize){
+    aCmd        = iPendingCmds.takeFirst();
+    aStatusLine = iStatusLine;
+    aSize       = iResponseSize;
+
+    iStatusLine.clear();
+    isStatusRead  = false;
+    isEnd         = false;
+    iMatched      = 0;
+    iResponseSize = 0;
+}
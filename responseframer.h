@@ -0,0 +1,74 @@
+#ifndef RESPONSEFRAMER_H
+#define RESPONSEFRAMER_H
+
+#include "constants.h"
+
+#include <QByteArray>
+#include <QList>
+
+/*!
+ * \brief Framing of the responses received on a NntpConnection (byte stream, no copy)
+ * - FIFO of the commands sent, the first one is the one being answered
+ * - scan() goes through raw data chunks of any size and stops at the end of each response
+ * - the status line tells if the response is multi-line (Nntp::isMultiLineResponse)
+ * - the terminator "\r\n.\r\n" is searched with NntpScanner and matched across chunk boundaries
+ *   (dot-stuffed lines ".." never match it, they're forwarded as they are)
+ */
+class ResponseFramer
+{
+public:
+    ResponseFramer();
+    ResponseFramer(const ResponseFramer &)              = delete;
+    ResponseFramer(const ResponseFramer &&)             = delete;
+    ResponseFramer & operator=(const ResponseFramer &)  = delete;
+    ResponseFramer & operator=(const ResponseFramer &&) = delete;
+
+    void addCommand(const QByteArray &aCmd); //!< a command has been sent, its response is expected
+
+    inline int  getNumberOfPendingCommands() const; //!< commands still waiting for the end of their response
+    inline bool hasResponseStarted() const;         //!< has some data of the current response been scanned
+    inline bool isEndOfResponse() const;            //!< did the last scan stop at the end of a response
+    inline bool isStatusLineRead() const;           //!< has the whole status line of the current response been scanned
+    inline const QByteArray &getStatusLine() const; //!< status line of the current response (truncated if too long)
+    inline const QByteArray &getCurrentCommand() const; //!< command being answered (there must be a pending one)
+
+    /*!
+     * \brief scan data received on the connection
+     * \param aData : data received
+     * \param aLen  : size of the data
+     * \return number of bytes belonging to the current response
+     * (up to its end included if isEndOfResponse(), aLen if no command is pending)
+     */
+    qint64 scan(const char *aData, qint64 aLen);
+
+    /*!
+     * \brief pop the response that has just ended (to be called when isEndOfResponse())
+     * \param aCmd        : command answered
+     * \param aStatusLine : first line of the response
+     * \param aSize       : size of the whole response
+     */
+    void takeResponse(QByteArray &aCmd, QByteArray &aStatusLine, qint64 &aSize);
+
+private:
+    qint64 findTerminator(const char *aData, qint64 aLen); //!< bytes up to the end of the terminator (aLen if not found)
+    bool   matchTerminator(char aChar); //!< go on matching the terminator with aChar, true once complete
+
+private:
+    static const int  sMaxStatusLineSize = 512; //!< we don't keep more of the status line
+
+    QList<QByteArray> iPendingCmds;   //!< commands waiting for their response
+    QByteArray        iStatusLine;    //!< status line of the current response
+    bool              isStatusRead;   //!< is the status line complete
+    bool              isEnd;          //!< did the last scan end the current response
+    ushort            iMatched;       //!< number of chars of "\r\n.\r\n" matched so far
+    qint64            iResponseSize;  //!< size of the current response scanned so far
+};
+
+int  ResponseFramer::getNumberOfPendingCommands() const {return iPendingCmds.size();}
+bool ResponseFramer::hasResponseStarted() const {return iResponseSize > 0;}
+bool ResponseFramer::isEndOfResponse() const {return isEnd;}
+bool ResponseFramer::isStatusLineRead() const {return isStatusRead;}
+const QByteArray &ResponseFramer::getStatusLine() const {return iStatusLine;}
+const QByteArray &ResponseFramer::getCurrentCommand() const {return iPendingCmds.first();}
+
+#endif // RESPONSEFRAMER_H
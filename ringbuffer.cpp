@@ -0,0 +1,17 @@
+#include "ringbuffer.h"
+
+RingBuffer::RingBuffer(qint64 aCapacity):
+    iCapacity(roundCapacity(aCapacity)), iMask(iCapacity - 1),
+    iData(new char[iCapacity]), iHead(0), iTail(0)
+{}
+
+RingBuffer::~RingBuffer(){
+    delete[] iData;
+}
+
+qint64 RingBuffer::roundCapacity(qint64 aCapacity){
+    qint64 capacity = 1;
+    while (capacity < aCapacity)
+        capacity <<= 1;
+    return capacity;
+}
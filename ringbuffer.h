@@ -0,0 +1,72 @@
+#ifndef RINGBUFFER_H
+#define RINGBUFFER_H
+
+#include <QtGlobal>
+
+/*!
+ * \brief Fixed capacity byte ring buffer used to forward data in chunks
+ * - allocated once (capacity rounded up to a power of 2), never grows
+ * - the producer writes directly in the free contiguous space (getWritePtr / commit)
+ * - the consumer reads directly the contiguous data (getReadPtr / consume)
+ * - at most two calls are needed on each side to go through the whole buffer
+ */
+class RingBuffer
+{
+public:
+    explicit RingBuffer(qint64 aCapacity);
+    ~RingBuffer();
+    RingBuffer(const RingBuffer &)              = delete;
+    RingBuffer(const RingBuffer &&)             = delete;
+    RingBuffer & operator=(const RingBuffer &)  = delete;
+    RingBuffer & operator=(const RingBuffer &&) = delete;
+
+    inline qint64 getCapacity() const; //!< size of the buffer
+    inline qint64 size() const;        //!< bytes stored
+    inline qint64 getFreeSize() const; //!< bytes that can still be stored
+    inline bool   isEmpty() const;     //!< is there nothing stored
+    inline bool   isFull() const;      //!< is there no free space
+    inline void   clear();             //!< drop what is stored
+
+    inline char       *getWritePtr();                 //!< where to write the next bytes
+    inline qint64      getWritableContiguous() const; //!< free bytes available from getWritePtr()
+    inline void        commit(qint64 aLen);           //!< aLen bytes have been written at getWritePtr()
+
+    inline const char *getReadPtr() const;            //!< first byte stored
+    inline qint64      getReadableContiguous() const; //!< stored bytes available from getReadPtr()
+    inline void        consume(qint64 aLen);          //!< drop the aLen first bytes stored
+
+private:
+    static qint64 roundCapacity(qint64 aCapacity); //!< next power of 2
+
+private:
+    const qint64 iCapacity; //!< size of iData (power of 2)
+    const qint64 iMask;     //!< iCapacity - 1
+    char        *iData;     //!< the buffer (owns it)
+    qint64       iHead;     //!< position of the next read (never wrapped)
+    qint64       iTail;     //!< position of the next write (never wrapped)
+};
+
+qint64 RingBuffer::getCapacity() const {return iCapacity;}
+qint64 RingBuffer::size() const {return iTail - iHead;}
+qint64 RingBuffer::getFreeSize() const {return iCapacity - size();}
+bool   RingBuffer::isEmpty() const {return iTail == iHead;}
+bool   RingBuffer::isFull() const {return size() == iCapacity;}
+void   RingBuffer::clear() {iHead = iTail = 0;}
+
+char *RingBuffer::getWritePtr() {return iData + (iTail & iMask);}
+qint64 RingBuffer::getWritableContiguous() const {
+    return qMin(getFreeSize(), iCapacity - (iTail & iMask));
+}
+void RingBuffer::commit(qint64 aLen) {iTail += aLen;}
+
+const char *RingBuffer::getReadPtr() const {return iData + (iHead & iMask);}
+qint64 RingBuffer::getReadableContiguous() const {
+    return qMin(size(), iCapacity - (iHead & iMask));
+}
+void RingBuffer::consume(qint64 aLen){
+    iHead += aLen;
+    if (iHead == iTail)
+        iHead = iTail = 0; // restart at the beginning: bigger contiguous spaces
+}
+
+#endif // RINGBUFFER_H
@@ -0,0 +1,73 @@
+#include "serverscore.h"
+
+#include <QMutexLocker>
+#include <QTextStream>
+
+//! average in aUnit (ms or KB/s), "-" if not measured yet
+static QString toString(double aValue, double aDivisor, const char *aUnit){
+    if (aValue < 0)
+        return QString("-");
+    return QString::number(qRound64(aValue / aDivisor)).append(aUnit);
+}
+
+ServerScore::ServerScore():
+    iMutex(), iConnectTime(-1), iFirstByte(-1), iThroughput(-1)
+{}
+
+double ServerScore::addSample(double aAverage, double aSample){
+    if (aAverage < 0)
+        return aSample;
+    return aAverage + cScoreEwmaAlpha * (aSample - aAverage);
+}
+
+void ServerScore::addConnectTime(qint64 aMs){
+    QMutexLocker lock(&iMutex);
+    iConnectTime = addSample(iConnectTime, static_cast<double>(aMs));
+}
+
+void ServerScore::addFirstByteTime(qint64 aMs){
+    QMutexLocker lock(&iMutex);
+    iFirstByte = addSample(iFirstByte, static_cast<double>(aMs));
+}
+
+void ServerScore::addTransfer(qint64 aBytes, qint64 aMs){
+    if (aBytes < cScoreMinTransferSize)
+        return; // dominated by the latency
+
+    QMutexLocker lock(&iMutex);
+    iThroughput = addSample(iThroughput, aBytes * 1000. / qMax(aMs, static_cast<qint64>(1)));
+}
+
+double ServerScore::getConnectTime() const {
+    QMutexLocker lock(&iMutex);
+    return iConnectTime;
+}
+
+double ServerScore::getFirstByteTime() const {
+    QMutexLocker lock(&iMutex);
+    return iFirstByte;
+}
+
+double ServerScore::getThroughput() const {
+    QMutexLocker lock(&iMutex);
+    return iThroughput;
+}
+
+double ServerScore::getExpectedTime() const {
+    QMutexLocker lock(&iMutex);
+    if (iFirstByte < 0 && iThroughput < 0)
+        return -1;
+
+    double expected = qMax(iFirstByte, 0.);
+    if (iThroughput > 0)
+        expected += cScoreArticleSize * 1000. / iThroughput;
+    return qMax(expected, 1.); // the weights are ratios of expected times
+
+}
+
+void ServerScore::dump(QTextStream &aStream) const {
+    aStream << "connect: "       << toString(getConnectTime(),   1,    " ms")
+            << ", first byte: "  << toString(getFirstByteTime(), 1,    " ms")
+            << ", throughput: "  << toString(getThroughput(),    1024, " KB/s")
+            << ", expected: "    << toString(getExpectedTime(),  1,    " ms");
+}
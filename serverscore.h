@@ -0,0 +1,49 @@
+#ifndef SERVERSCORE_H
+#define SERVERSCORE_H
+
+#include "constants.h"
+
+#include <QMutex>
+
+QT_FORWARD_DECLARE_CLASS(QTextStream)
+
+/*!
+ * \brief Measured performance of a NntpServer (Thread_Safe)
+ * - exponentially weighted moving averages (cScoreEwmaAlpha) of:
+ *   - the connect time (TCP, TLS and welcome message)
+ *   - the time to first byte of the responses
+ *   - the throughput of the big responses (at least cScoreMinTransferSize)
+ * - the expected time is what a reference article (cScoreArticleSize) should take:
+ *   time to first byte + size / throughput (the connections come mostly from the warm pool)
+ * - fed by the NntpConnections of the server on the Qt path (nothing is seen on the splice path)
+ */
+class ServerScore
+{
+public:
+    ServerScore();
+    ServerScore(const ServerScore &)              = delete;
+    ServerScore(const ServerScore &&)             = delete;
+    ServerScore & operator=(const ServerScore &)  = delete;
+    ServerScore & operator=(const ServerScore &&) = delete;
+
+    void addConnectTime(qint64 aMs);             //!< a connection has been established
+    void addFirstByteTime(qint64 aMs);           //!< a response started aMs after its command (or the previous response)
+    void addTransfer(qint64 aBytes, qint64 aMs); //!< a response of aBytes took aMs (ignored if too small)
+
+    double getConnectTime() const;   //!< average connect time in ms (-1 if not measured yet)
+    double getFirstByteTime() const; //!< average time to first byte in ms (-1 if not measured yet)
+    double getThroughput() const;    //!< average throughput in bytes/s (-1 if not measured yet)
+    double getExpectedTime() const;  //!< expected ms of a reference article, at least 1 (-1 if not measured yet)
+
+    void dump(QTextStream &aStream) const; //!< write the averages
+
+    static double addSample(double aAverage, double aSample); //!< EWMA update (aAverage < 0: first sample)
+
+private:
+    mutable QMutex iMutex;       //!< protects what follows
+    double         iConnectTime; //!< EWMA of the connect time in ms (-1: no sample)
+    double         iFirstByte;   //!< EWMA of the time to first byte in ms (-1: no sample)
+    double         iThroughput;  //!< EWMA of the throughput in bytes/s (-1: no sample)
+};
+
+#endif // SERVERSCORE_H
@@ -2,32 +2,50 @@
 #include "inputconnection.h"
 #include "sessionmanager.h"
 #include "nntpproxy.h"
-#include "mythread.h"
+#include "worker.h"
 #include "nntpconnection.h"
+#include "nntpmultiplexer.h"
 #include "user.h"
 #include "database.h"
+#include "articlecache.h"
+#include "singleflight.h"
+#include "failover.h"
+#include "fairsharescheduler.h"
+#include "bandwidthshaper.h"
+#include "tokenbucket.h"
 
 
 #include <QTextStream>
+#include <QThread>
+#include <QTimer>
+
+QAtomicInteger<quint64> SessionHandler::sNextId(1);
 
 SessionHandler::SessionHandler(qintptr aSocketDescriptor, SessionManager & aInputMgr,
-                               MyThread *aThread):
-    QObject(), iSocketDescriptor(aSocketDescriptor),
+                               Worker *aWorker):
+    QObject(), iId(sNextId.fetchAndAddRelaxed(1)), iSocketDescriptor(aSocketDescriptor),
     iInputCon(Q_NULLPTR), iSessionMgr(aInputMgr),
-    iThread(aThread), iNntpCon(Q_NULLPTR), iUser(Q_NULLPTR),
+    iWorker(aWorker), iNntpCon(Q_NULLPTR), iMultiplexer(Q_NULLPTR), iUser(Q_NULLPTR),
     isActive(true),
     iLogPrefix(QString("SessionHandler").append("[").append(QString::number(iSocketDescriptor)).append("] ")),
     isForwarding(false),
     isNntpServerActive(true),
-    mNntpConOffered(Q_NULLPTR), wNntpConOffered(Q_NULLPTR), isNntpConOffered(false),
+    isNntpConReleased(false),
+    iClientCmds(), iNbCmdsInFlight(0), isWaitingPost(false), isPostingData(false), isQuitting(false),
+    iMaxBufferedSize(0),
+    iFlight(Q_NULLPTR), iFlightCmd(), iFlightOffset(0),
+    iShapingTimer(Q_NULLPTR), isWaitingBuckets(false), iThrottleStart(0), iFailover(Q_NULLPTR),
+    iAdmissionTimer(Q_NULLPTR),
     mShutdownManager(Q_NULLPTR), wShutdownManager(Q_NULLPTR), isShutdownManager(false)
 {
 #ifdef LOG_CONSTRUCTORS
     _log("Constructor");
 #endif
 
+    iWorker->newSession();
+
     iInputCon = new InputConnection(iSocketDescriptor);
-    iInputCon->moveToThread(iThread);
+    iInputCon->moveToThread(iWorker);
 
     connect(this, &SessionHandler::startConnection, iInputCon, &Connection::startTcpConnection);
     connect(this, &SessionHandler::stopSession, this, &SessionHandler::closeSession);
@@ -35,6 +53,8 @@ SessionHandler::SessionHandler(qintptr aSocketDescriptor, SessionManager & aInpu
     connect(iInputCon, &InputConnection::closed, this, &SessionHandler::closeSession);
     connect(iInputCon, &Connection::socketError, this, &SessionHandler::handleSocketError);
     connect(iInputCon, &InputConnection::authenticated, this, &SessionHandler::inputAuthenticated);
+    connect(iInputCon, &InputConnection::commandReceived, this, &SessionHandler::clientCommand);
+    connect(iInputCon, &Connection::writeBufferDrained, this, &SessionHandler::flightUpdated);
 
     connect(this, &SessionHandler::deleteSession, this, &QObject::deleteLater);
     qRegisterMetaType<std::string>("std::string" );
@@ -71,7 +91,26 @@ void SessionHandler::inputAuthenticated(std::string aLogin, std::string aPass){
         return;
     }
 
-    startForwarding();
+    if (HotTracker *tracker = NntpProxy::getHotTracker())
+        iInputCon->setHotTracker(tracker, iWorker->getId(), QByteArray(aLogin.c_str()));
+
+    if (NntpProxy::isMultiplexing())
+        startMultiplexing();
+    else
+        startForwarding();
+}
+
+void SessionHandler::startMultiplexing(){
+    iMultiplexer = iWorker->getMultiplexer();
+    iMultiplexer->addClient(iInputCon, iUser);
+    disconnect(iInputCon, &InputConnection::commandReceived, this, &SessionHandler::clientCommand);
+    connect(iInputCon, &InputConnection::commandReceived, iMultiplexer, &NntpMultiplexer::clientCommand);
+
+    iInputCon->write(Nntp::getResponse(281));
+    _log("User commands are multiplexed");
+
+    // wait for input cmds
+    iInputCon->startAsyncRead();
 }
 
 
@@ -83,26 +122,140 @@ void SessionHandler::startForwarding(){
     if (iNntpCon == Q_NULLPTR){
         _log("Error couldn't get an NNTP connection");
 
-        // check if we can steal one to another user
-        iNntpCon = iSessionMgr.tryToGetNntpConnectionFromOtherUser(iInputCon->getId(), iUser);
-
-        if (iNntpCon == Q_NULLPTR){
-            _log("Couldn't get a connection from another user...");
-            iInputCon->write(Nntp::getResponse(502));
-            closeSession();
+        // ask for the one of another user (nntpConnectionGranted or nntpConnectionRefused)
+        if (iSessionMgr.requestNntpConnection(this, iInputCon->getId(), iUser)){
+            _log("Waiting for the connection of another user...");
             return;
         }
+
+        _log("Couldn't get a connection from another user...");
+        if (waitForNntpConnection())
+            return;
+
+        iInputCon->write(Nntp::getResponse(502));
+        closeSession();
+        return;
+    }
+
+    useNntpConnection();
+}
+
+bool SessionHandler::waitForNntpConnection(){
+    if (!iSessionMgr.queueForNntpConnection(this))
+        return false;
+
+    if (iAdmissionTimer == Q_NULLPTR){
+        iAdmissionTimer = new QTimer(this);
+        iAdmissionTimer->setSingleShot(true);
+        connect(iAdmissionTimer, &QTimer::timeout, this, &SessionHandler::admissionExpired);
+    }
+    iAdmissionTimer->start(NntpProxy::getAdmissionTimeout() * 1000);
+    _log("Waiting for a connection to be released...");
+    return true;
+}
+
+void SessionHandler::admissionGranted(){
+    if (!isActive)
+        return; // closeSession has passed our admission on
+
+    iNntpCon = iSessionMgr.getNntpConnection(iInputCon->getId(), iUser, true);
+    iSessionMgr.admittedForNntpConnection(this, iNntpCon != Q_NULLPTR);
+    if (iNntpCon == Q_NULLPTR){
+        _log("The connection released has been taken, waiting for the next one...");
+        return;
     }
 
+    iAdmissionTimer->stop();
+    _log("Got a connection released");
+    useNntpConnection();
+}
+
+void SessionHandler::admissionExpired(){
+    if (!isActive || !iSessionMgr.cancelNntpConnectionWait(this))
+        return; // admitted meanwhile: admissionGranted is on its way
+
+    _log("No connection released in time...");
+    iInputCon->write(Nntp::getResponse(502));
+    closeSession();
+}
+
+void SessionHandler::nntpConnectionGranted(){
+    NntpConnection *con = iSessionMgr.getScheduler().takeGranted(this);
+    if (con == Q_NULLPTR)
+        return; // closed meanwhile
 
-//    iNntpCon->moveToThread(iThread);
+    // yielded by a session of another thread without thread affinity: we adopt it
+    con->moveToThread(QThread::currentThread());
+    iNntpCon = con;
+    _log("Got the connection of another user");
+    useNntpConnection();
+}
+
+void SessionHandler::nntpConnectionRefused(){
+    if (!isActive)
+        return;
+
+    _log("Couldn't get a connection from another user...");
+    if (waitForNntpConnection())
+        return;
+
+    iInputCon->write(Nntp::getResponse(502));
+    closeSession();
+}
+
+void SessionHandler::yieldNntpConnection(){
+    FairShareScheduler &scheduler = iSessionMgr.getScheduler();
+    if (!isActive || !isForwarding || isNntpConReleased){
+        scheduler.yieldFailed(this);
+        return;
+    }
+
+    qintptr inputConId = 0;
+    if (!scheduler.startYield(this, inputConId))
+        return; // the requester has gone
+
+    QTextStream &ostream = NntpProxy::acquireLog(iLogPrefix);
+    ostream << "Yielding our NntpConnection to another user. " << *iUser;
+    NntpProxy::releaseLog();
+
+    // the slot of our connection goes straight to the new one (our release will then fail)
+    iInputCon->setOutput(Q_NULLPTR);
+    iNntpCon->disconnect(this);
+    NntpConnection *con = iSessionMgr.takeOverNntpConnection(inputConId, offerNntpConnection());
+    if (con == Q_NULLPTR){
+        _log("Error taking over the Nntp Connection");
+        scheduler.yieldFailed(this);
+    } else {
+        con->moveToThread(Q_NULLPTR); // the requester adopts it
+        if (!scheduler.yielded(this, con))
+            releaseGrantedConnection(con);
+    }
+
+    closeSession();
+}
+
+void SessionHandler::releaseGrantedConnection(NntpConnection *aCon){
+    aCon->moveToThread(QThread::currentThread());
+    iSessionMgr.releaseNntpConnection(aCon);
+    delete aCon;
+}
+
+void SessionHandler::useNntpConnection(){
     connect(iNntpCon, &NntpConnection::closed, this, &SessionHandler::closeNntpConnection);
     connect(iNntpCon, &Connection::socketError, this, &SessionHandler::handleNntpSocketError);
     connect(iNntpCon, &NntpConnection::serverRemoved, this, &SessionHandler::nntpServerRemoved);
+    connect(iNntpCon, &NntpConnection::authenticated, this, &SessionHandler::nntpAuthenticated);
+    connect(iNntpCon, &NntpConnection::responseDone, this, &SessionHandler::nntpResponseDone);
+    connect(iNntpCon, &NntpConnection::articleMissing, this, &SessionHandler::nntpArticleMissing);
 
+    // Connection from the warm pool of the server: ready to use
+    if (iNntpCon->isAuthenticated()){
+        nntpAuthenticated();
+        return;
+    }
 
-
-
+    // Asynchronous: connect, welcome message and authentication
+    // (errors are handled by handleNntpSocketError)
     if (!iNntpCon->startTcpConnection(
                 iNntpCon->getServerHost().toStdString().c_str(),
                 iNntpCon->getServerPort())){
@@ -111,13 +264,11 @@ void SessionHandler::startForwarding(){
         closeSession();
         return;
     }
+}
 
-    if (!iNntpCon->doAuthentication()){
-        _log("Error Nntp Authentication...");
-        iInputCon->write(Nntp::getResponse(502));
-        closeSession();
+void SessionHandler::nntpAuthenticated(){
+    if (!isActive)
         return;
-    }
 
     iInputCon->write(Nntp::getResponse(281));
 
@@ -131,14 +282,20 @@ void SessionHandler::startForwarding(){
     iInputCon->setOutput(iNntpCon);
     iNntpCon->setOutput(iInputCon);
 
+    // the responses are forwarded at the rate of the user (and of its IP)
+    if (BandwidthShaper *shaper = NntpProxy::getBandwidthShaper())
+        iNntpCon->setShaping(shaper->acquire(iUser->getLogin(), iUser->getIp()));
+
 
-    iNntpCon->startAsyncRead();
+    // plaintext on both sides: zero copy forwarding of the responses
+    if (!NntpProxy::useSplice() || !iNntpCon->startSplice(iInputCon))
+        iNntpCon->startAsyncRead();
 
     // wait for input cmds
     iInputCon->startAsyncRead();
 
     isForwarding = true;
-
+    iSessionMgr.getScheduler().addForwarding(this, iUser);
 }
 
 void SessionHandler::nntpServerRemoved(){
@@ -152,21 +309,256 @@ void SessionHandler::closeNntpConnection(){
     closeSession();
 }
 
-NntpConnection *SessionHandler::offerNntpConnection(){
-    isForwarding = false;
+void SessionHandler::clientCommand(QByteArray aCmd){
+    if (!isForwarding || isNntpConReleased || isQuitting)
+        return;
+
+    // the article of a POST/IHAVE is not made of commands
+    if (isPostingData){
+        iNntpCon->sendData(aCmd);
+        if (strcmp(aCmd.constData(), ".\r\n") == 0){
+            isPostingData = false;
+            iNntpCon->expectResponse(aCmd); // result of the posting
+            ++iNbCmdsInFlight;
+            sendClientCommands();
+        }
+        return;
+    }
+
+    iInputCon->recordCommand(aCmd);
+
+    if (Nntp::isCommand(aCmd.constData(), "QUIT")){
+        isQuitting = true;
+        if (iNbCmdsInFlight == 0 && iClientCmds.isEmpty() && !iFlight)
+            clientQuit();
+        return;
+    }
+
+    iClientCmds.append(aCmd);
+    sendClientCommands();
+}
+
+void SessionHandler::sendClientCommands(){
+    ushort        window  = NntpProxy::getPipelineWindow();
+    ArticleCache *cache   = iNntpCon->isSplicing() ? Q_NULLPTR : NntpProxy::getArticleCache();
+    SingleFlight *flights = iNntpCon->isSplicing() ? Q_NULLPTR : NntpProxy::getSingleFlight();
+    while (!iClientCmds.isEmpty() && iNbCmdsInFlight < window && !isWaitingPost && !isPostingData && !iFlight){
+        // no failover on the splice path (the status lines aren't seen before being forwarded)
+        bool isFailover     = !iNntpCon->isSplicing() && Failover::canFailover(iClientCmds.first());
+        bool isKnownMissing = isFailover && !iFailover
+                && iNntpCon->isKnownMissing(Failover::getMessageId(iClientCmds.first()));
+        // our server said no recently: the next ones answer once the responses in flight are done
+        if (isKnownMissing && iNbCmdsInFlight > 0)
+            return;
+
+        QByteArray key = (cache || flights) ? ArticleCache::getKey(iClientCmds.first()) : QByteArray();
+        if (cache){
+            // a hit is answered once the responses in flight are done (order of the responses)
+            if (!key.isEmpty() && cache->contains(key)){
+                if (iNbCmdsInFlight > 0 || isWaitingBuckets)
+                    return; // or once the user is back under its rate (shapingReady)
+                if (serveFromCache(cache, key)){
+                    iClientCmds.removeFirst();
+                    continue;
+                }
+            }
+        }
+
+        Flight *flight = Q_NULLPTR;
+        if (flights && !key.isEmpty()){
+            // same for an article being fetched by another session
+            if (flights->isInFlight(key)){
+                if (iNbCmdsInFlight > 0)
+                    return;
+                iFlight = flights->follow(key, this);
+                if (iFlight){
+                    iFlightCmd    = iClientCmds.takeFirst();
+                    iFlightOffset = 0;
+                    return; // flightUpdated queued
+                }
+            }
+            flight = flights->lead(key); // Q_NULLPTR if another session just started it: duplicate fetch
+        }
+
+        QByteArray cmd = iClientCmds.takeFirst();
+        if (Nntp::isCommand(cmd.constData(), "POST") || Nntp::isCommand(cmd.constData(), "IHAVE"))
+            isWaitingPost = true; // the client waits for 340/335 before sending the article
+
+        ++iNbCmdsInFlight;
+        if (isKnownMissing){
+            iSessionMgr.getNntpServerManager().addSkipped(iNntpCon->getServerId());
+            iNntpCon->holdResponses(); // the next commands are answered after the Failover
+            startFailover(cmd, QByteArray(Nntp::getResponse(430)), flight);
+            return;
+        }
+        iNntpCon->sendCommand(cmd, flight, isFailover);
+    }
+}
+
+void SessionHandler::flightUpdated(){
+    if (!iFlight || !isForwarding || isNntpConReleased || iInputCon->isWriteBufferFull() || isWaitingBuckets)
+        return; // nothing followed, the client is full (called again once it drains) or over its rate (shapingReady)
+
+    QByteArray data;
+    Flight::STATE state = iFlight->read(this, iFlightOffset, data);
+    if (!data.isEmpty()){
+        iInputCon->write(data);
+        iUser->addDownloadSize(static_cast<ulong>(data.size()));
+        NntpProxy::getSingleFlight()->addBytesShared(data.size());
+        chargeShaping(data.size());
+    }
+    if (state == Flight::InProgress)
+        return;
+
+    releaseFlight();
+    if (state == Flight::Failed){
+        if (iFlightOffset > 0){
+            _log("Flight lost in the middle of a response, closing the session...");
+            closeSession();
+            return;
+        }
+        iClientCmds.prepend(iFlightCmd); // nothing written yet: fetch it ourselves
+    }
+    iFlightCmd.clear();
+
+    sendClientCommands();
+
+    if (isQuitting && iNbCmdsInFlight == 0 && iClientCmds.isEmpty() && !iFlight)
+        clientQuit();
+}
+
+void SessionHandler::releaseFlight(){
+    if (!iFlight)
+        return;
+
+    iFlight->removeReader(this);
+    iFlight->deref();
+    iFlight = Q_NULLPTR;
+}
+
+void SessionHandler::nntpResponseDone(QByteArray aCmd, QByteArray aStatusLine, qint64 aSize){
+    Q_UNUSED(aSize); // accounted with the total download size of the connection
+    --iNbCmdsInFlight;
+
+    // the client write buffer is the fullest at the end of a response
+    qint64 buffered = getBufferedSize();
+    if (buffered > iMaxBufferedSize){
+        iMaxBufferedSize = buffered;
+        iWorker->updateMaxSessionBuffer(buffered);
+    }
+
+    if (Nntp::isCommand(aCmd.constData(), "POST") || Nntp::isCommand(aCmd.constData(), "IHAVE")){
+        isWaitingPost = false;
+        ushort code   = Nntp::getResponseCode(aStatusLine.constData());
+        isPostingData = (code == 340 || code == 335);
+    }
+
+    sendClientCommands();
+
+    if (isQuitting && iNbCmdsInFlight == 0 && iClientCmds.isEmpty() && !iFlight)
+        clientQuit();
+}
+
+void SessionHandler::nntpArticleMissing(QByteArray aCmd, QByteArray aStatusLine, Flight *aFlight){
+    // the responses of iNntpCon are held: only one article missing at a time
+    startFailover(aCmd, aStatusLine, aFlight);
+}
+
+void SessionHandler::startFailover(const QByteArray &aCmd, const QByteArray &aStatusLine, Flight *aFlight){
+    iFailover = new Failover(iInputCon->getId(), iSessionMgr.getNntpServerManager(), iInputCon,
+                             aCmd, aStatusLine, iNntpCon->getServerId(), aFlight);
+    connect(iFailover, &Failover::done,   this, &SessionHandler::failoverDone);
+    connect(iFailover, &Failover::failed, this, &SessionHandler::closeSession);
+    iFailover->start();
+}
+
+void SessionHandler::failoverDone(QByteArray aCmd, QByteArray aStatusLine, qint64 aSize){
+    iFailover->deleteLater(); // we're in one of its signals
+    iFailover = Q_NULLPTR;
+
+    // the connections of the Failover aren't accounted with iNntpCon
+    iUser->addDownloadSize(static_cast<ulong>(aSize));
+    iNntpCon->releaseResponses();
+    nntpResponseDone(aCmd, aStatusLine, 0);
+}
+
+void SessionHandler::clientQuit(){
+    // detach the NntpConnection from the session before the input closes it
+    iInputCon->setOutput(Q_NULLPTR);
+    iNntpCon->disconnect(this);
+
     iUser->addDownloadSize(iNntpCon->getDownloadSize());
     iUser->delNntpConnection(iNntpCon->getServerId());
-    return iNntpCon;
+    isForwarding = false;
+    iSessionMgr.getScheduler().removeForwarding(this);
+
+    if (iSessionMgr.recycleNntpConnection(iNntpCon)){
+        _log("NntpConnection given back to the pool of its server");
+        iNntpCon = Q_NULLPTR; // not ours anymore
+    }
+
+    iInputCon->write(Nntp::getResponse(205));
+    iInputCon->closeConnection();
 }
 
-void SessionHandler::waitNntpSessionClosed(){
-    isNntpConOffered = true;
+bool SessionHandler::serveFromCache(ArticleCache *aCache, const QByteArray &aKey){
+    QByteArray response;
+    if (!aCache->get(aKey, response))
+        return false; // evicted in between
+
+    iInputCon->write(response);
+    iUser->addDownloadSize(static_cast<ulong>(response.size()));
+    chargeShaping(response.size());
+    return true;
+}
+
+void SessionHandler::chargeShaping(qint64 aBytes){
+    // already written: the buckets go in debt and the next hits wait for them
+    qint64 delay = BandwidthShaper::charge(iNntpCon->getShaping(), aBytes);
+    if (delay <= 0)
+        return;
 
-    mNntpConOffered = new QMutex();
-    wNntpConOffered = new QWaitCondition();
-    mNntpConOffered->lock();
-    wNntpConOffered->wait(mNntpConOffered);
-    mNntpConOffered->unlock();
+    if (iShapingTimer == Q_NULLPTR){
+        iShapingTimer = new QTimer(this);
+        iShapingTimer->setSingleShot(true);
+        iShapingTimer->setTimerType(Qt::PreciseTimer);
+        connect(iShapingTimer, &QTimer::timeout, this, &SessionHandler::shapingReady);
+    }
+    isWaitingBuckets = true;
+    iThrottleStart   = TokenBucket::now();
+    iShapingTimer->start(static_cast<int>((delay + 999999) / 1000000));
+}
+
+void SessionHandler::shapingReady(){
+    isWaitingBuckets = false;
+    if (!isForwarding || isNntpConReleased)
+        return;
+
+    BandwidthShaper::addThrottledTime(iNntpCon->getShaping(), TokenBucket::now() - iThrottleStart);
+    if (iFlight){
+        flightUpdated(); // goes on with the commands once it is done
+        return;
+    }
+
+    sendClientCommands();
+
+    if (isQuitting && iNbCmdsInFlight == 0 && iClientCmds.isEmpty() && !iFlight)
+        clientQuit();
+}
+
+qint64 SessionHandler::getBufferedSize() const {
+    qint64 size = iInputCon->getBufferedSize();
+    if (iNntpCon)
+        size += iNntpCon->getBufferedSize();
+    return size;
+}
+
+NntpConnection *SessionHandler::offerNntpConnection(){
+    isForwarding      = false;
+    isNntpConReleased = true;
+    iUser->addDownloadSize(iNntpCon->getDownloadSize());
+    iUser->delNntpConnection(iNntpCon->getServerId());
+    return iNntpCon;
 }
 
 void SessionHandler::waitForDeletion(){
@@ -181,29 +573,29 @@ void SessionHandler::waitForDeletion(){
 
 SessionHandler::~SessionHandler(){
 #ifdef LOG_CONSTRUCTORS
-    _log("Destructor");
+    _log(QString("Destructor (max buffered: %1 KB)").arg(iMaxBufferedSize / 1024));
 #endif
+    releaseFlight();
+    delete iFailover; // before the input it writes to
+    iFailover = Q_NULLPTR;
+
     if (isForwarding){
         // Add the download size of this connection to the user
         // (it may have several connections)
         iUser->addDownloadSize(iNntpCon->getDownloadSize());
         iUser->delNntpConnection(iNntpCon->getServerId());
-
-        if (isNntpServerActive)
-            iSessionMgr.releaseNntpConnection(iNntpCon);
     }
 
+    // the connection may still be in its asynchronous handshake (not forwarding yet)
+    // if it has been offered, SessionManager has already released it
+    if (iNntpCon && isNntpServerActive && !isNntpConReleased)
+        iSessionMgr.releaseNntpConnection(iNntpCon);
+
     delete iNntpCon;
     iNntpCon  = Q_NULLPTR;
 
-    if (isNntpConOffered){
-        wNntpConOffered->wakeOne();
-        mNntpConOffered->lock();
-        mNntpConOffered->unlock();
-
-        delete wNntpConOffered;
-        delete mNntpConOffered;
-    }
+    if (iMultiplexer)
+        iMultiplexer->removeClient(iInputCon);
 
     delete iInputCon;
     iInputCon = Q_NULLPTR;
@@ -220,7 +612,7 @@ SessionHandler::~SessionHandler(){
         delete mShutdownManager;
     }
 
-    emit destroyed();
+    iWorker->delSession();
 }
 
 
@@ -243,7 +635,14 @@ void SessionHandler::closeSession(){
         _log("closeSession SessionHandler");
         isActive = false;
         iInputCon->closeConnection();
-        iSessionMgr.erase(this, !isNntpConOffered);
+
+        // no more yield nor grant, a connection granted meanwhile is released
+        NntpConnection *granted = iSessionMgr.getScheduler().removeSession(this);
+        if (granted)
+            releaseGrantedConnection(granted);
+        iSessionMgr.leaveAdmissionQueue(this);
+
+        iSessionMgr.erase(this);
         emit deleteSession();
     }
 }
@@ -10,19 +10,39 @@
 QT_FORWARD_DECLARE_CLASS(InputConnection)
 QT_FORWARD_DECLARE_CLASS(SessionManager)
 QT_FORWARD_DECLARE_CLASS(NntpProxy)
-QT_FORWARD_DECLARE_CLASS(MyThread)
+QT_FORWARD_DECLARE_CLASS(Worker)
 QT_FORWARD_DECLARE_CLASS(NntpConnection)
+QT_FORWARD_DECLARE_CLASS(NntpMultiplexer)
 QT_FORWARD_DECLARE_CLASS(User)
+QT_FORWARD_DECLARE_CLASS(ArticleCache)
+QT_FORWARD_DECLARE_CLASS(SingleFlight)
+QT_FORWARD_DECLARE_CLASS(Flight)
+QT_FORWARD_DECLARE_CLASS(Failover)
 QT_FORWARD_DECLARE_CLASS(QTextStream)
+QT_FORWARD_DECLARE_CLASS(QTimer)
 
 #include <QWaitCondition>
 #include <QMutex>
+#include <QAtomicInteger>
 
 
 /*!
- * \brief SessionHandler runs in a Thread and take care of the whole user session
+ * \brief SessionHandler runs in a Worker Thread (shared with other sessions) and take care of the whole user session
  * - owns the InputConnection and the output NntpConnection
  * - DOESN't own the User (as it is shared between multiple sessions)
+ * - in multiplexing mode, doesn't get its own NntpConnection: the commands are given
+ *   to the NntpMultiplexer of its Worker
+ * - the articles by message-id present in the ArticleCache are answered without the NntpConnection
+ * - so are the ones being fetched by another session (SingleFlight): the session reads the response
+ *   in flight, or leads the fetch on its NntpConnection if it's the first one asking for it
+ * - an article missing on the server of its NntpConnection (430/423) is asked to the other servers
+ *   by a Failover, the next responses of the NntpConnection are held meanwhile
+ * - when all the NntpConnections are in use, it asks the FairShareScheduler for the one of another user
+ *   and waits for it without blocking (nntpConnectionGranted), it may be asked to yield its own the same way
+ * - if none can be taken, it waits for the next one released in the AdmissionQueue (admissionGranted)
+ *   and answers 502 only once its admission timeout expires
+ * - its NntpConnection forwards the responses at the rate of the user and of its IP (BandwidthShaper),
+ *   the responses served from the ArticleCache or a Flight are charged to the same buckets (chargeShaping)
  */
 class SessionHandler : public QObject
 {
@@ -35,17 +55,20 @@ public:
      * \brief SessionHandler constructor
      * \param aSocketDescriptor: where to attach the socket
      * \param aInputMgr : handle on session manager to getUser, getNntpConnection...
-     * \param aThread : handle on running thread (Not own it but could wait for it on main thread)
+     * \param aWorker : handle on the Worker thread running the session (Not own it, WorkerManager does)
      */
     explicit SessionHandler(qintptr aSocketDescriptor, SessionManager & aInputMgr,
-                            MyThread *aThread);
+                            Worker *aWorker);
     SessionHandler(const SessionHandler &)              = delete;
     SessionHandler(const SessionHandler &&)             = delete;
     SessionHandler & operator=(const SessionHandler &)  = delete;
     SessionHandler & operator=(const SessionHandler &&) = delete;
 
     ~SessionHandler();            //!< Release all the allocated resources, Connetions, User...
-    inline qintptr getId() const; //!< return iSocketDescriptor (needed by MyManager template)
+    inline quint64 getId() const; //!< return iId (needed by MyManager template)
+
+    qint64 getBufferedSize() const;           //!< bytes held by the session (buffers of both connections)
+    inline qint64 getMaxBufferedSize() const; //!< highest getBufferedSize seen at the end of a response
 
     //!< To be able to print a NntpServer
     friend QTextStream &  operator<<(QTextStream & stream, const SessionHandler &aSession);
@@ -58,44 +81,94 @@ public slots:
 
     void inputAuthenticated(std::string aLogin, std::string aPass); //!< connects to &InputConnection::authenticated
 
+    void nntpAuthenticated();   //!< connects to &NntpConnection::authenticated (start forwarding)
     void closeNntpConnection(); //!< connects to &NntpConnection::closed
     void nntpServerRemoved();   //!< connects to &NntpConnection::serverRemoved
+    void clientCommand(QByteArray aCmd); //!< connects to &InputConnection::commandReceived (queue the command)
+
+    //! connects to &NntpConnection::responseDone (send the next commands of the window)
+    void nntpResponseDone(QByteArray aCmd, QByteArray aStatusLine, qint64 aSize);
+
+    //! the Flight followed has new data (queued by Flight) or the client drained (&Connection::writeBufferDrained)
+    void flightUpdated();
+
+    //! connects to &NntpConnection::articleMissing (ask the other servers)
+    void nntpArticleMissing(QByteArray aCmd, QByteArray aStatusLine, Flight *aFlight);
+    //! connects to &Failover::done (the response has been written, go on with the held ones)
+    void failoverDone(QByteArray aCmd, QByteArray aStatusLine, qint64 aSize);
+
+    void nntpConnectionGranted(); //!< queued by FairShareScheduler: the connection of another user is ours
+    void nntpConnectionRefused(); //!< queued by FairShareScheduler: no connection for us
+    void yieldNntpConnection();   //!< queued by FairShareScheduler: give our connection to another user and close
+    void admissionGranted();      //!< queued by AdmissionQueue: a connection has been released for us
 
 signals:
     void startConnection(const char* aHost=NULL, ushort aPort=0); //!< trigger &Connection::startTcpConnection
     void stopSession();   //!< trigger &SessionHandler::closeSession
     void deleteSession(); //!< trigger &QObject::deleteLater to suicide
-    void destroyed();     //!< &QThread::quit to delete thread from main Thread
 
 
 private:
     inline void _log(const QString & aMessage) const; //!< Add a log line
     inline void _log(const char*     aMessage) const; //!< Add a log line
 
-    void startForwarding(); //!< Start the proxy job (forwarding commands/responses from iInputCon to iNntpCon)
+    void startForwarding(); //!< Get an NntpConnection and start it (forwarding starts once it is authenticated)
+    void useNntpConnection(); //!< start iNntpCon (forwarding starts once it is authenticated)
+    bool waitForNntpConnection(); //!< wait in the AdmissionQueue (false if full: 502)
+    void admissionExpired();      //!< connects to iAdmissionTimer: 502 if still waiting
+    void startMultiplexing(); //!< Give the commands of the client to the NntpMultiplexer of the Worker
+    void sendClientCommands(); //!< send the queued commands while the pipeline window is not full (or answer them from the ArticleCache)
+    bool serveFromCache(ArticleCache *aCache, const QByteArray &aKey); //!< answer a command from the ArticleCache (false if not cached anymore)
+    void chargeShaping(qint64 aBytes); //!< charge what is written from the cache or a Flight to the buckets of the user (wait if over its rate)
+    void shapingReady();               //!< connects to iShapingTimer: serve the cache and the Flight again
+    void releaseFlight();      //!< stop following iFlight
+    //! ask the other servers for an article missing on ours (takes the reference on aFlight)
+    void startFailover(const QByteArray &aCmd, const QByteArray &aStatusLine, Flight *aFlight);
+    void clientQuit();         //!< QUIT: recycle the NntpConnection and close the input
+
+    NntpConnection * offerNntpConnection(); //!< stop forwarding on iNntpCon to give its slot to another user
+    void releaseGrantedConnection(NntpConnection *aCon); //!< release a connection granted to us that we won't use
 
-    NntpConnection * offerNntpConnection(); //!< Used by friend and owner SessionManager
-
-    void waitNntpSessionClosed(); //!< From other thread, wait for the NntpSession to be closed so we can offer it to another user
     void waitForDeletion();       //!< From main thread, on Proxy shutdown, we wait for the session to finish properly
 
 private:
-    qintptr           iSocketDescriptor; //!< Input Socket descriptor used as Session id
+    static QAtomicInteger<quint64> sNextId; //!< id of the next SessionHandler
+
+    const quint64     iId;               //!< Session id, unique (a descriptor is reused as soon as it is closed)
+    qintptr           iSocketDescriptor; //!< Input Socket descriptor
     InputConnection  *iInputCon;         //!< input connection (owns it)
     SessionManager  & iSessionMgr;       //!< Handle on manager
-    MyThread         *iThread;           //!< Handle on Thread it is running in
+    Worker           *iWorker;           //!< Handle on Worker Thread it is running in
     NntpConnection   *iNntpCon;          //!< nntp connnection (owns it)
+    NntpMultiplexer  *iMultiplexer;      //!< multiplexer of the Worker in multiplexing mode (DOES NOT own it)
     User             *iUser;             //!< handle on user (DOES NOT own it, UserManager does)
     bool             isActive;           //!< in order to close the session only once (if we get several socket errors...)
     const QString    iLogPrefix;         //!< log prefix
 
     bool isForwarding;                   //!< Do we have an NntpConnection?
     bool isNntpServerActive;             //!< is the NntpServer still active?
+    bool isNntpConReleased;              //!< has iNntpCon already been released to its server (offered)
+
+    // Pipelining of the client commands (dedicated NntpConnection)
+    QList<QByteArray> iClientCmds;       //!< commands received not sent yet
+    ushort            iNbCmdsInFlight;   //!< commands sent waiting for their response
+    bool              isWaitingPost;     //!< POST/IHAVE sent, nothing else is sent until its response
+    bool              isPostingData;     //!< the client is sending the article of a POST/IHAVE
+    bool              isQuitting;        //!< QUIT received, wait for the responses in flight
+    qint64            iMaxBufferedSize;  //!< highest buffered size sampled (reported to the Worker)
+
+    // Coalescing of the article fetches (dedicated NntpConnection)
+    Flight           *iFlight;           //!< response of another session being read (holds a reference)
+    QByteArray        iFlightCmd;        //!< command answered by iFlight
+    qint64            iFlightOffset;     //!< bytes of iFlight already written to the client
+
+    // Shaping of what doesn't come from iNntpCon (its Flow, BandwidthShaper)
+    QTimer           *iShapingTimer;     //!< wait for the buckets after a cache hit or a Flight read (child, created on the first wait)
+    bool              isWaitingBuckets;  //!< nothing is served from the cache nor the Flight till iShapingTimer
+    qint64            iThrottleStart;    //!< TokenBucket::now() when the wait started
 
-    // To handle properly closing from other thread when the Nntp connection is offered
-    QMutex         *mNntpConOffered; //!< Mutex to close Session from another thread when the NntpCon is offered
-    QWaitCondition *wNntpConOffered; //!< WaitCond to close Session from another thread when the NntpCon is offered
-    bool            isNntpConOffered;//!< bool to know if the NntpCon is beeing offered
+    Failover         *iFailover;         //!< article missing being asked to the other servers (owns it)
+    QTimer           *iAdmissionTimer;   //!< timeout of the wait in the AdmissionQueue (child, created on the first wait)
 
     // To handle shutdown properly
     QMutex         *mShutdownManager; //!< Mutex to close Session properly from Main Thread on Shutdown
@@ -104,7 +177,8 @@ private:
 
 };
 
-qintptr SessionHandler::getId() const {return iSocketDescriptor;}
+quint64 SessionHandler::getId() const {return iId;}
+qint64  SessionHandler::getMaxBufferedSize() const {return iMaxBufferedSize;}
 
 void SessionHandler::_log(const char* aMessage) const {
      NntpProxy::log(iLogPrefix, aMessage);
@@ -1,11 +1,12 @@
 #include "sessionmanager.h"
 #include "sessionhandler.h"
-#include "mythread.h"
+#include "worker.h"
 #include "user.h"
 #include "nntpconnection.h"
 
 SessionManager::SessionManager(UserManager & aUserMgr, Database & aDb, NntpServerManager & aSrvMgr) :
-    MyManager<SessionHandler>("Session"), iUserMgr(aUserMgr), iDb(aDb), iSrvMgr(aSrvMgr)
+    MyManager<SessionHandler, quint64>("Session"), iUserMgr(aUserMgr), iDb(aDb), iSrvMgr(aSrvMgr),
+    iScheduler()
 {}
 
 SessionManager::~SessionManager(){
@@ -30,16 +31,18 @@ SessionManager::~SessionManager(){
 }
 
 
-SessionHandler* SessionManager::newSession(qintptr aSocketDescriptor, MyThread *aThread){
+SessionHandler* SessionManager::newSession(qintptr aSocketDescriptor, Worker *aWorker){
     QMutexLocker lock(mMutex);
-    SessionHandler *session = new SessionHandler(aSocketDescriptor, *this, aThread);
+    SessionHandler *session = new SessionHandler(aSocketDescriptor, *this, aWorker);
 
     if (session){
-        iList.append(session);
-
         QTextStream &is = NntpProxy::acquireLog(iLogPrefix);
-        is << "New " << iDataName << " with id: " << aSocketDescriptor
-           << " added.  " << getSizeStr_noLock();
+        if (insert(session, false))
+            is << "New " << iDataName << " with id: " << session->getId()
+               << " (socket " << aSocketDescriptor << ") added.  " << getSizeStr_noLock();
+        else
+            is << "Error: " << iDataName << " id " << session->getId()
+               << " already used, the session isn't tracked (socket " << aSocketDescriptor << ")";
         NntpProxy::releaseLog();
 
     } else {
@@ -49,73 +52,26 @@ SessionHandler* SessionManager::newSession(qintptr aSocketDescriptor, MyThread *
     return session;
 }
 
-NntpConnection * SessionManager::tryToGetNntpConnectionFromOtherUser(qintptr aInputConId, User *aUser){
-    _log("[tryToGetNntpConnectionFromOtherUser] >>>>>");
-
-    QMutexLocker lockUserMgr(iUserMgr.mMutex); // it's a friend
-    QMutexLocker lockNntpServMgr(iSrvMgr.mMutex); // also a friend
-    QMutexLocker lock(mMutex);
-
-    ushort averageNntpConsPerUser = iSrvMgr.getMaxNumberOfConnections() / iUserMgr.size_noLock();
-
-    iUserMgr.lockUser(aUser);
-
-    // Check if the user has already more connection than the average
-    if (iUserMgr.getUserNumberOfNntpCons_noLock(aUser) >= averageNntpConsPerUser){
-        QString str("The User already have the average number of connection: ");
-        str += QString::number(averageNntpConsPerUser);
-        _log(str);
-        iUserMgr.unlockUser(aUser);
-        return Q_NULLPTR;
-    }
+bool SessionManager::requestNntpConnection(SessionHandler *aSession, qintptr aInputConId, User *aUser){
+    return iScheduler.requestNntpConnection(aSession, aUser, aInputConId, iSrvMgr.getMaxNumberOfConnections());
+}
 
-    // Get a user having more connections than the average
-    User *victim=iUserMgr.getUserHavingTooMuchNntpConnection_noLock(averageNntpConsPerUser);
-    if (victim == Q_NULLPTR){
-        QString str("There are no user with more connection than the average: ");
-        str += QString::number(averageNntpConsPerUser);
-        _log(str);
-        iUserMgr.unlockUser(aUser);
-        return Q_NULLPTR;
-    }
+bool SessionManager::queueForNntpConnection(SessionHandler *aSession){
+    return iSrvMgr.queueForNntpConnection(aSession);
+}
 
+void SessionManager::admittedForNntpConnection(SessionHandler *aSession, bool aGotConnection){
+    iSrvMgr.admittedForNntpConnection(aSession, aGotConnection);
+}
 
-    // Find the first Session of the victim
-    NntpConnection *con = Q_NULLPTR;
-    for (int i=0; i<iList.size(); ++i){
-        SessionHandler *session = iList[i];
-        User *user = session->iUser;
-        if (user == victim){
-            QString str("We found a victim, session: ");
-            str += QString::number(session->getId());
-            str += ". user: ";
-            str += user->str();
-            _log(str);
-
-            con           = session->offerNntpConnection();
-            ushort servId = con->getServerId();
-            if (!iSrvMgr.releaseNntpConnection(con, false)){
-                _log("Error releasing Nntp Connection");
-                iUserMgr.unlockUser(aUser);
-                return Q_NULLPTR;
-            }
-
-            // send a signal to close the session
-            emit session->stopSession();
-            _log("emit session->stopSession (switch to session thread)\n");
-
-            // wait for the NntpConnection to have been released
-            session->waitNntpSessionClosed();
-
-            _log("\nwaitNntpSessionClosed ok");
-
-            con = iSrvMgr.getOfferedNntpConnectionFromServer_noLock(aInputConId, servId);
-            break;
-        }
-    }
+bool SessionManager::cancelNntpConnectionWait(SessionHandler *aSession){
+    return iSrvMgr.cancelNntpConnectionWait(aSession);
+}
 
+void SessionManager::leaveAdmissionQueue(SessionHandler *aSession){
+    iSrvMgr.leaveAdmissionQueue(aSession);
+}
 
-    iUserMgr.unlockUser(aUser);
-    _log("[tryToGetNntpConnectionFromOtherUser] <<<<<\n\n");
-    return con;
+void SessionManager::dumpStats(QTextStream &aStream){
+    iScheduler.dump(aStream);
 }
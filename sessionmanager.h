@@ -6,10 +6,11 @@
 #include "usermanager.h"
 #include "database.h"
 #include "nntpservermanager.h"
+#include "fairsharescheduler.h"
 
 
 QT_FORWARD_DECLARE_CLASS(SessionHandler)
-QT_FORWARD_DECLARE_CLASS(MyThread)
+QT_FORWARD_DECLARE_CLASS(Worker)
 
 /*!
  * \brief Manager of SessionHandler (does NOT own them)
@@ -17,8 +18,10 @@ QT_FORWARD_DECLARE_CLASS(MyThread)
  * - provide them an interface to UserManager so they can get a User
  * - provide them an interface to the Database
  * - provide them an interface to NntpServerManager so they can get a NntpConnection
+ * - share the NntpConnections fairly between the users once they're all in use (FairShareScheduler)
+ * - otherwise let them wait for the next NntpConnection released (AdmissionQueue of NntpServerManager)
  */
-class SessionManager : public MyManager<SessionHandler>
+class SessionManager : public MyManager<SessionHandler, quint64>
 {
 public:
     //! Constructor with handles on UserManager, Database and NntpServerManager
@@ -31,12 +34,12 @@ public:
      ~SessionManager(); //!< emit &SessionHandler::stopSession and wait for all of them to close properly
 
     /*!
-     * \brief create a new SessionHandler with its socket descriptor and its thread
+     * \brief create a new SessionHandler with its socket descriptor and its Worker
      * \param aSocketDescriptor: socket descriptor created within the QTcpSocket
-     * \param aThread: Thread where the SessionHandler will be moved
+     * \param aWorker: Worker Thread where the SessionHandler will be moved
      * \return the new SessionHandler
      */
-    SessionHandler * newSession(qintptr aSocketDescriptor, MyThread *aThread);
+    SessionHandler * newSession(qintptr aSocketDescriptor, Worker *aWorker);
 
     inline User * getUser(const QString & aIpAddress, const QString & aLogin); //!< return new or existing User
     inline bool releaseUser(User *aUser); //!< release user (via UserManager)
@@ -45,17 +48,38 @@ public:
     inline bool checkUserAuthentication(User *const aUser, const QString aPass);
 
     //! Interface to NntpServerManager to get a new NntpConnection for the given user
-    inline NntpConnection *getNntpConnection(qintptr aInputConId, User *aUser);
+    inline NntpConnection *getNntpConnection(qintptr aInputConId, User *aUser, bool aIsAdmitted = false);
 
-    //! If no more available NntpConnection, check if we can steal one from another user
-    NntpConnection * tryToGetNntpConnectionFromOtherUser(qintptr aInputConId, User *aUser);
+    /*!
+     * \brief If no more available NntpConnection, ask the FairShareScheduler for the one of another user (asynchronous)
+     * \return false if refused, otherwise the slot nntpConnectionGranted() or nntpConnectionRefused() of aSession will be called
+     */
+    bool requestNntpConnection(SessionHandler *aSession, qintptr aInputConId, User *aUser);
+    inline FairShareScheduler &getScheduler(); //!< fair share of the connections (victim and requester sides)
+
+    /*!
+     * \brief Last resort: wait for the next NntpConnection released (asynchronous)
+     * \return false if the admission queue is full, otherwise the slot admissionGranted() of aSession will be called
+     */
+    bool queueForNntpConnection(SessionHandler *aSession);
+    void admittedForNntpConnection(SessionHandler *aSession, bool aGotConnection); //!< aSession has been admitted and asked for its connection
+    bool cancelNntpConnectionWait(SessionHandler *aSession); //!< aSession gives up waiting (false if it has been admitted meanwhile)
+    void leaveAdmissionQueue(SessionHandler *aSession);      //!< aSession is closing: its admission goes to the next one
+
+    //! Interface to NntpServerManager to give the slot of a yielded connection to a new one (in the thread of the victim)
+    inline NntpConnection *takeOverNntpConnection(qintptr aInputConId, NntpConnection *aOldCon);
     inline bool releaseNntpConnection(NntpConnection *aNntpCon); //!< interface to NntpServerManager to release a NntpConnction
+    inline bool recycleNntpConnection(NntpConnection *aNntpCon); //!< interface to NntpServerManager to pool a NntpConnction
+    inline NntpServerManager &getNntpServerManager(); //!< NntpServerManager used by the Failovers of the sessions
+
+    void dumpStats(QTextStream &aStream); //!< write the statistics of the fair share
 
 
 private:
     UserManager       & iUserMgr; //!< Handle on UserManager
     Database          & iDb;      //!< Handle on Database
     NntpServerManager & iSrvMgr;  //!< Handle on NntpServerManager
+    FairShareScheduler  iScheduler; //!< fair share of the connections between the users
 };
 
 
@@ -71,12 +95,28 @@ bool SessionManager::releaseUser(User *aUser){
     return iUserMgr.releaseUser(aUser, iDb);
 }
 
-NntpConnection *SessionManager::getNntpConnection(qintptr aInputConId, User *aUser){
-    return iSrvMgr.getNntpConnection(aInputConId, aUser);
+NntpConnection *SessionManager::getNntpConnection(qintptr aInputConId, User *aUser, bool aIsAdmitted){
+    return iSrvMgr.getNntpConnection(aInputConId, aUser, aIsAdmitted);
+}
+
+FairShareScheduler &SessionManager::getScheduler(){
+    return iScheduler;
+}
+
+NntpConnection *SessionManager::takeOverNntpConnection(qintptr aInputConId, NntpConnection *aOldCon){
+    return iSrvMgr.takeOverNntpConnection(aInputConId, aOldCon);
 }
 
 bool SessionManager::releaseNntpConnection(NntpConnection *aNntpCon){
     return iSrvMgr.releaseNntpConnection(aNntpCon);
 }
 
+bool SessionManager::recycleNntpConnection(NntpConnection *aNntpCon){
+    return iSrvMgr.recycleNntpConnection(aNntpCon);
+}
+
+NntpServerManager &SessionManager::getNntpServerManager(){
+    return iSrvMgr;
+}
+
 #endif // SessionManager_H
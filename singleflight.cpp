@@ -0,0 +1,144 @@
+#include "singleflight.h"
+
+#include <QObject>
+#include <QMutexLocker>
+#include <QTextStream>
+
+Flight::Flight(SingleFlight &aRegistry, const QByteArray &aKey):
+    iRegistry(aRegistry), iKey(aKey), iMutex(), iData(), iState(InProgress),
+    isTooBig(false), iReaders(), iRefs(1)
+{}
+
+void Flight::deref(){
+    if (!iRefs.deref())
+        delete this;
+}
+
+void Flight::notifyReaders(){
+    for (auto it = iReaders.begin(); it != iReaders.end(); ++it){
+        if (!it.value().isNotified){
+            it.value().isNotified = true;
+            QMetaObject::invokeMethod(it.key(), "flightUpdated", Qt::QueuedConnection);
+        }
+    }
+}
+
+void Flight::append(const char *aData, qint64 aLen){
+    bool land = false;
+    {
+        QMutexLocker lock(&iMutex);
+        if (isTooBig)
+            return;
+
+        if (iReaders.isEmpty() && iData.size() + aLen > cArticleCacheMaxArticle){
+            // nobody to share it with: don't keep a huge response in memory
+            isTooBig = true;
+            iData    = QByteArray();
+            land     = true;
+        } else {
+            iData.append(aData, static_cast<int>(aLen));
+            notifyReaders();
+        }
+    }
+    if (land)
+        iRegistry.land(this);
+}
+
+void Flight::finish(bool aComplete){
+    {
+        QMutexLocker lock(&iMutex);
+        iState = aComplete ? Done : Failed;
+        notifyReaders();
+    }
+    iRegistry.land(this);
+}
+
+bool Flight::addReader(QObject *aReader){
+    QMutexLocker lock(&iMutex);
+    if (isTooBig)
+        return false;
+
+    Reader &reader = iReaders[aReader];
+    ++reader.nbReads;
+    if (!reader.isNotified){
+        reader.isNotified = true;
+        QMetaObject::invokeMethod(aReader, "flightUpdated", Qt::QueuedConnection);
+    }
+    return true;
+}
+
+void Flight::removeReader(QObject *aReader){
+    QMutexLocker lock(&iMutex);
+    auto it = iReaders.find(aReader);
+    if (it != iReaders.end() && --it.value().nbReads <= 0)
+        iReaders.erase(it);
+}
+
+Flight::STATE Flight::read(QObject *aReader, qint64 &aOffset, QByteArray &aData){
+    QMutexLocker lock(&iMutex);
+    auto it = iReaders.find(aReader);
+    if (it != iReaders.end())
+        it.value().isNotified = false;
+
+    if (aOffset < iData.size()){
+        aData    = iData.mid(static_cast<int>(aOffset));
+        aOffset += aData.size();
+    }
+    return iState;
+}
+
+
+SingleFlight::SingleFlight():
+    iMutex(), iFlights(), iNbLeads(0), iNbFollows(0), iBytesShared(0)
+{}
+
+SingleFlight::~SingleFlight(){
+    QMutexLocker lock(&iMutex);
+    iFlights.clear();
+}
+
+Flight *SingleFlight::lead(const QByteArray &aKey){
+    QMutexLocker lock(&iMutex);
+    if (iFlights.contains(aKey))
+        return Q_NULLPTR;
+
+    Flight *flight = new Flight(*this, aKey);
+    iFlights.insert(aKey, flight);
+    iNbLeads.fetchAndAddRelaxed(1);
+    return flight;
+}
+
+Flight *SingleFlight::follow(const QByteArray &aKey, QObject *aReader){
+    QMutexLocker lock(&iMutex);
+    Flight *flight = iFlights.value(aKey, Q_NULLPTR);
+    if (!flight || !flight->addReader(aReader))
+        return Q_NULLPTR;
+
+    // the flight is still referenced by its leader while it is registered
+    flight->ref();
+    iNbFollows.fetchAndAddRelaxed(1);
+    return flight;
+}
+
+bool SingleFlight::isInFlight(const QByteArray &aKey){
+    QMutexLocker lock(&iMutex);
+    return iFlights.contains(aKey);
+}
+
+void SingleFlight::land(Flight *aFlight){
+    QMutexLocker lock(&iMutex);
+    auto it = iFlights.find(aFlight->getKey());
+    if (it != iFlights.end() && it.value() == aFlight)
+        iFlights.erase(it);
+}
+
+int SingleFlight::getNumberOfFlights(){
+    QMutexLocker lock(&iMutex);
+    return iFlights.size();
+}
+
+void SingleFlight::dump(QTextStream &aStream){
+    aStream << "Single flight: " << getNumberOfFlights() << " in flight, "
+            << getNumberOfLeads() << " fetches, " << getNumberOfFollows() << " coalesced"
+            << ", shared: " << getBytesShared() / 1048576 << " MB\n";
+}
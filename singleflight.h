@@ -0,0 +1,132 @@
+#ifndef SINGLEFLIGHT_H
+#define SINGLEFLIGHT_H
+
+#include "constants.h"
+
+#include <QByteArray>
+#include <QHash>
+#include <QMutex>
+#include <QAtomicInt>
+#include <QAtomicInteger>
+
+QT_FORWARD_DECLARE_CLASS(QObject)
+QT_FORWARD_DECLARE_CLASS(QTextStream)
+QT_FORWARD_DECLARE_CLASS(SingleFlight)
+
+/*!
+ * \brief Response of an article command being fetched by one NntpConnection and read by other sessions (Thread_Safe)
+ * - the leader NntpConnection appends the response while forwarding it to its own client
+ * - the readers (SessionHandlers or NntpMultiplexers, any thread) copy it from their offset
+ *   and are notified with a queued call of their slot flightUpdated() (at most one call pending per reader)
+ * - reference counted: the leader connection and each reader hold a reference
+ */
+class Flight
+{
+public:
+    enum STATE {InProgress = 0, Done, Failed};
+
+    Flight(SingleFlight &aRegistry, const QByteArray &aKey); //!< created by SingleFlight::lead
+    Flight(const Flight &)              = delete;
+    Flight(const Flight &&)             = delete;
+    Flight & operator=(const Flight &)  = delete;
+    Flight & operator=(const Flight &&) = delete;
+
+    inline const QByteArray &getKey() const; //!< ArticleCache key of the command
+
+    // leader side
+    void append(const char *aData, qint64 aLen); //!< a chunk of the response has been forwarded
+    void finish(bool aComplete);                  //!< end of the response (aComplete false: the connection was lost)
+
+    // reader side
+    bool addReader(QObject *aReader);    //!< aReader::flightUpdated() will be called when there is something new (false if too late)
+    void removeReader(QObject *aReader); //!< stop the notifications once all the adds of aReader are removed
+
+    /*!
+     * \brief copy what has been received after aOffset
+     * \param aReader : the reader (its next notification is rearmed)
+     * \param aOffset : bytes already read, increased by the size of aData
+     * \param aData   : the new bytes
+     * \return the state of the flight (Failed: the leader lost its connection)
+     */
+    STATE read(QObject *aReader, qint64 &aOffset, QByteArray &aData);
+
+    inline void ref();   //!< take a reference
+    void        deref(); //!< release a reference (deleted with the last one)
+
+private:
+    struct Reader{ //!< a QObject reading the flight (a NntpMultiplexer may read it for several clients)
+        int  nbReads;    //!< number of addReader not removed
+        bool isNotified; //!< is a flightUpdated() call pending
+    };
+
+    ~Flight() = default; //!< deleted by deref
+
+    void notifyReaders(); //!< queue flightUpdated() to the readers not notified yet (iMutex held)
+
+private:
+    SingleFlight          &iRegistry; //!< registry of the flights in progress
+    const QByteArray       iKey;      //!< ArticleCache key of the command
+    QMutex                 iMutex;    //!< protects what follows
+    QByteArray             iData;     //!< response received so far
+    STATE                  iState;    //!< state of the flight
+    bool                   isTooBig;  //!< the response got too big without readers: not buffered anymore
+    QHash<QObject *, Reader> iReaders; //!< readers to notify
+    QAtomicInt             iRefs;     //!< number of references
+};
+
+/*!
+ * \brief Single-flight of the article commands by message-id (Thread_Safe)
+ * - the first session asking for an article leads the fetch on its NntpConnection (lead)
+ * - the sessions asking for the same article meanwhile become readers of the
+ *   response in flight instead of using another backend connection (follow)
+ * - a flight leaves the registry once its response is done (or failed)
+ * - independent of the ArticleCache (works without it)
+ */
+class SingleFlight
+{
+public:
+    SingleFlight();
+    SingleFlight(const SingleFlight &)              = delete;
+    SingleFlight(const SingleFlight &&)             = delete;
+    SingleFlight & operator=(const SingleFlight &)  = delete;
+    SingleFlight & operator=(const SingleFlight &&) = delete;
+
+    ~SingleFlight(); //!< the flights still in progress belong to their connections
+
+    //! start a flight for aKey (ArticleCache::getKey), Q_NULLPTR if one is already in progress (follow it)
+    Flight *lead(const QByteArray &aKey);
+
+    //! read the flight in progress for aKey (aReader registered, reference taken), Q_NULLPTR if none
+    Flight *follow(const QByteArray &aKey, QObject *aReader);
+
+    bool isInFlight(const QByteArray &aKey); //!< is aKey being fetched
+
+    void land(Flight *aFlight); //!< the flight is over (or not joinable anymore): remove it
+
+    inline void addBytesShared(qint64 aBytes); //!< bytes given to the readers
+
+    int            getNumberOfFlights();            //!< flights in progress
+    inline quint64 getNumberOfLeads() const;        //!< flights started since start
+    inline quint64 getNumberOfFollows() const;      //!< commands answered from a flight since start
+    inline quint64 getBytesShared() const;          //!< bytes given to the readers since start
+
+    void dump(QTextStream &aStream); //!< write the statistics
+
+private:
+    QMutex                     iMutex;       //!< protects iFlights
+    QHash<QByteArray, Flight*> iFlights;     //!< flights in progress (held by their leader connection)
+
+    QAtomicInteger<quint64>    iNbLeads;     //!< flights started since start
+    QAtomicInteger<quint64>    iNbFollows;   //!< readers since start
+    QAtomicInteger<quint64>    iBytesShared; //!< bytes given to the readers since start
+};
+
+const QByteArray &Flight::getKey() const {return iKey;}
+void Flight::ref(){iRefs.ref();}
+
+void    SingleFlight::addBytesShared(qint64 aBytes){iBytesShared.fetchAndAddRelaxed(static_cast<quint64>(aBytes));}
+quint64 SingleFlight::getNumberOfLeads() const {return iNbLeads.load();}
+quint64 SingleFlight::getNumberOfFollows() const {return iNbFollows.load();}
+quint64 SingleFlight::getBytesShared() const {return iBytesShared.load();}
+
+#endif // SINGLEFLIGHT_H
@@ -0,0 +1,74 @@
+#include "spacesaving.h"
+
+#include <algorithm>
+
+SpaceSaving::SpaceSaving(int aCapacity):
+    iCapacity(aCapacity > 0 ? aCapacity : 1), iHeap(), iIndex()
+{
+    iHeap.reserve(iCapacity);
+    iIndex.reserve(iCapacity);
+}
+
+void SpaceSaving::offer(const QByteArray &aKey, quint64 aCount){
+    auto it = iIndex.constFind(aKey);
+    if (it != iIndex.constEnd()){
+        int pos = it.value();
+        iHeap[pos].count += aCount;
+        siftDown(pos);
+    } else if (iHeap.size() < iCapacity){
+        iHeap.append({aKey, aCount, 0});
+        iIndex.insert(aKey, iHeap.size() - 1);
+        siftUp(iHeap.size() - 1);
+    } else {
+        // the least counted key is replaced
+        Item &min = iHeap[0];
+        iIndex.remove(min.key);
+        min.key   = aKey;
+        min.error = min.count;
+        min.count += aCount;
+        iIndex.insert(aKey, 0);
+        siftDown(0);
+    }
+}
+
+QList<SpaceSaving::Item> SpaceSaving::getTop(int aNb) const {
+    QList<Item> items;
+    for (const Item &item : iHeap)
+        items.append(item);
+    std::sort(items.begin(), items.end(), [](const Item &a, const Item &b){
+        return a.count > b.count;
+    });
+    while (items.size() > aNb)
+        items.removeLast();
+    return items;
+}
+
+void SpaceSaving::clear(){
+    iHeap.clear();
+    iIndex.clear();
+}
+
+void SpaceSaving::siftUp(int aPos){
+    while (aPos > 0){
+        int parent = (aPos - 1) / 2;
+        if (iHeap[parent].count <= iHeap[aPos].count)
+            break;
+        swapItems(parent, aPos);
+        aPos = parent;
+    }
+}
+
+void SpaceSaving::siftDown(int aPos){
+    int size = iHeap.size();
+    while (true){
+        int smallest = aPos, left = 2 * aPos + 1, right = left + 1;
+        if (left < size && iHeap[left].count < iHeap[smallest].count)
+            smallest = left;
+        if (right < size && iHeap[right].count < iHeap[smallest].count)
+            smallest = right;
+        if (smallest == aPos)
+            return;
+        swapItems(aPos, smallest);
+        aPos = smallest;
+    }
+}
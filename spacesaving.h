@@ -0,0 +1,64 @@
+#ifndef SPACESAVING_H
+#define SPACESAVING_H
+
+#include "constants.h"
+
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QVector>
+
+/*!
+ * \brief Space-Saving top-k: the most frequent keys of a stream in a fixed memory
+ * - monitors at most aCapacity keys (min-heap on their count + hash index)
+ * - an unmonitored key replaces the least counted one and inherits its count (kept as error)
+ * - any key more frequent than total / capacity is monitored, count - error <= real <= count
+ * - not Thread_Safe (one HotTracker thread)
+ */
+class SpaceSaving
+{
+public:
+    struct Item{ //!< a monitored key
+        QByteArray key;
+        quint64    count; //!< upper bound of its real count
+        quint64    error; //!< over-estimation max (count inherited when it got monitored)
+    };
+
+    explicit SpaceSaving(int aCapacity = cHotTopK); //!< max number of monitored keys
+    SpaceSaving(const SpaceSaving &)              = delete;
+    SpaceSaving(const SpaceSaving &&)             = delete;
+    SpaceSaving & operator=(const SpaceSaving &)  = delete;
+    SpaceSaving & operator=(const SpaceSaving &&) = delete;
+
+    void        offer(const QByteArray &aKey, quint64 aCount = 1); //!< count aKey
+    QList<Item> getTop(int aNb) const; //!< the aNb most counted keys (decreasing count)
+    void        clear();               //!< forget all the keys
+
+    inline const QVector<Item> &getItems() const; //!< monitored keys (heap order)
+    inline int  size() const;        //!< number of monitored keys
+    inline int  getCapacity() const; //!< max number of monitored keys
+
+private:
+    void siftUp(int aPos);   //!< restore the heap after a decrease (new key)
+    void siftDown(int aPos); //!< restore the heap after an increase
+    inline void swapItems(int aPos1, int aPos2); //!< swap two heap positions (and their index)
+
+private:
+    const int                 iCapacity; //!< max number of monitored keys
+    QVector<Item>             iHeap;     //!< min-heap on the count
+    QHash<QByteArray, int>    iIndex;    //!< position of a key in iHeap
+};
+
+const QVector<SpaceSaving::Item> &SpaceSaving::getItems() const {return iHeap;}
+int SpaceSaving::size() const {return iHeap.size();}
+int SpaceSaving::getCapacity() const {return iCapacity;}
+
+void SpaceSaving::swapItems(int aPos1, int aPos2){
+    iHeap[aPos1].key.swap(iHeap[aPos2].key);
+    qSwap(iHeap[aPos1].count, iHeap[aPos2].count);
+    qSwap(iHeap[aPos1].error, iHeap[aPos2].error);
+    iIndex[iHeap[aPos1].key] = aPos1;
+    iIndex[iHeap[aPos2].key] = aPos2;
+}
+
+#endif // SPACESAVING_H
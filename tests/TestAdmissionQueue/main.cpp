@@ -0,0 +1,7 @@
+#include <QCoreApplication>
+
+#include <QtTest/QtTest>
+#include "testadmissionqueue.h"
+
+QTEST_MAIN(TestAdmissionQueue)
+#include "moc_testadmissionqueue.cpp"
@@ -0,0 +1,131 @@
+#include "testadmissionqueue.h"
+
+void TestAdmissionQueue::test_fifoAdmission(){
+    AdmissionQueue queue(4);
+    WaitingSession s1, s2, s3;
+    QVERIFY(queue.push(&s1));
+    QVERIFY(queue.push(&s2));
+    QVERIFY(queue.push(&s3));
+    QVERIFY(queue.getNumberOfWaiting() == 3);
+
+    // no connection free: nobody admitted
+    QVERIFY(queue.admit(0) == 0);
+
+    // one released: the oldest one
+    QVERIFY(queue.admit(1) == 1);
+    QCoreApplication::processEvents();
+    QVERIFY(s1.iNbAdmissions == 1 && s2.iNbAdmissions == 0 && s3.iNbAdmissions == 0);
+    QVERIFY(queue.getNumberOfWaiting() == 2 && queue.getNumberOfAdmitted() == 1);
+
+    // the free connection is still for s1
+    QVERIFY(queue.admit(1) == 0);
+    queue.admitted(&s1);
+    QVERIFY(queue.getNumberOfAdmitted() == 0);
+
+    // s2 didn't get its connection: it's the next one anyway
+    QVERIFY(queue.admit(1) == 1);
+    queue.admitted(&s2);
+    QVERIFY(queue.push(&s2, true));
+    QVERIFY(queue.admit(1) == 1);
+    QCoreApplication::processEvents();
+    QVERIFY(s2.iNbAdmissions == 2 && s3.iNbAdmissions == 0);
+    QVERIFY(queue.getNumberOfQueued() == 3);
+    QVERIFY(queue.getNumberOfAdmissions() == 3);
+}
+
+void TestAdmissionQueue::test_full(){
+    AdmissionQueue queue(2);
+    WaitingSession s1, s2, s3;
+    QVERIFY(queue.push(&s1));
+    QVERIFY(queue.push(&s2));
+    QVERIFY(!queue.push(&s3));
+    QVERIFY(queue.getNumberOfFull() == 1);
+
+    AdmissionQueue noQueue(0);
+    QVERIFY(!noQueue.push(&s1));
+    QVERIFY(noQueue.getNumberOfFull() == 0);
+}
+
+void TestAdmissionQueue::test_cancelAndLeave(){
+    AdmissionQueue queue(4);
+    WaitingSession s1, s2, s3;
+    queue.push(&s1);
+    queue.push(&s2);
+    queue.push(&s3);
+
+    // timeout of a waiting session
+    QVERIFY(queue.cancel(&s2));
+    QVERIFY(!queue.cancel(&s2));
+    QVERIFY(queue.getNumberOfTimeouts() == 1);
+
+    // admitted before its timeout: the admission is on its way
+    queue.admit(1);
+    QVERIFY(!queue.cancel(&s1));
+    QVERIFY(queue.getNumberOfAdmitted() == 1);
+
+    // closing while admitted: to pass on
+    QVERIFY(queue.leave(&s1));
+    QVERIFY(queue.getNumberOfAdmitted() == 0);
+    QVERIFY(!queue.leave(&s3));
+    QVERIFY(queue.getNumberOfWaiting() == 0);
+
+    QCoreApplication::processEvents();
+    QVERIFY(s1.iNbAdmissions == 1 && s2.iNbAdmissions == 0 && s3.iNbAdmissions == 0);
+}
+
+void TestAdmissionQueue::test_isOpen(){
+    AdmissionQueue queue(4);
+    WaitingSession s1, s2;
+    QVERIFY(queue.isOpen(1));
+    QVERIFY(!queue.isOpen(0));
+
+    queue.push(&s1);
+    QVERIFY(!queue.isOpen(3)); // s1 first
+
+    queue.push(&s2);
+    queue.admit(2);
+    QVERIFY(!queue.isOpen(2)); // both free connections are for them
+    QVERIFY(queue.isOpen(3));
+
+    queue.admitted(&s1);
+    queue.admitted(&s2);
+    QVERIFY(queue.isOpen(1));
+}
+
+void TestAdmissionQueue::test_histograms(){
+    QVERIFY(AdmissionQueue::getLengthBucket(1) == 0);
+    QVERIFY(AdmissionQueue::getLengthBucket(2) == 1);
+    QVERIFY(AdmissionQueue::getLengthBucket(3) == 2);
+    QVERIFY(AdmissionQueue::getLengthBucket(4) == 2);
+    QVERIFY(AdmissionQueue::getLengthBucket(64) == 6);
+    QVERIFY(AdmissionQueue::getLengthBucket(65) == AdmissionQueue::sNbBuckets - 1);
+    QVERIFY(AdmissionQueue::getLengthBucket(10000) == AdmissionQueue::sNbBuckets - 1);
+
+    QVERIFY(AdmissionQueue::getWaitBucket(0) == 0);
+    QVERIFY(AdmissionQueue::getWaitBucket(9) == 0);
+    QVERIFY(AdmissionQueue::getWaitBucket(10) == 1);
+    QVERIFY(AdmissionQueue::getWaitBucket(999) == 4);
+    QVERIFY(AdmissionQueue::getWaitBucket(1000) == 5);
+    QVERIFY(AdmissionQueue::getWaitBucket(60000) == AdmissionQueue::sNbBuckets - 1);
+
+    AdmissionQueue queue(4);
+    WaitingSession s1, s2, s3;
+    queue.push(&s1);
+    queue.push(&s2);
+    queue.push(&s3);
+    QVERIFY(queue.getLengthCount(0) == 1);
+    QVERIFY(queue.getLengthCount(1) == 1);
+    QVERIFY(queue.getLengthCount(2) == 1);
+
+    queue.admit(3);
+    quint64 nbWaits = 0;
+    for (int i = 0; i < AdmissionQueue::sNbBuckets; ++i)
+        nbWaits += queue.getWaitCount(i);
+    QVERIFY(nbWaits == 3);
+
+    QString dump;
+    QTextStream stream(&dump);
+    queue.dump(stream);
+    stream.flush();
+    QVERIFY(dump.contains("3 admissions"));
+}
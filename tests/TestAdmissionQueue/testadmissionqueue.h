@@ -0,0 +1,33 @@
+#ifndef TESTADMISSIONQUEUE_H
+#define TESTADMISSIONQUEUE_H
+
+#include <QtTest/QtTest>
+
+#include "../../admissionqueue.h"
+
+//! session counting the admissions given by the AdmissionQueue
+class WaitingSession : public QObject
+{
+    Q_OBJECT
+
+public:
+    WaitingSession() : QObject(), iNbAdmissions(0) {}
+    int iNbAdmissions;
+
+public slots:
+    void admissionGranted(){++iNbAdmissions;}
+};
+
+class TestAdmissionQueue : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void test_fifoAdmission();
+    void test_full();
+    void test_cancelAndLeave();
+    void test_isOpen();
+    void test_histograms();
+};
+
+#endif // TESTADMISSIONQUEUE_H
@@ -0,0 +1,7 @@
+#include <QCoreApplication>
+
+#include <QtTest/QtTest>
+#include "testarticlecache.h"
+
+QTEST_MAIN(TestArticleCache)
+#include "moc_testarticlecache.cpp"
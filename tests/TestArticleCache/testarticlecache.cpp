@@ -0,0 +1,78 @@
+#include "testarticlecache.h"
+
+QByteArray TestArticleCache::response(const char *aMsgId, int aSize){
+    QByteArray resp("222 0 ");
+    resp.append(aMsgId).append("\r\n");
+    resp.append(QByteArray(aSize - resp.size() - 5, 'x'));
+    resp.append("\r\n.\r\n");
+    return resp;
+}
+
+void TestArticleCache::test_getKey(){
+    QVERIFY(ArticleCache::getKey("BODY <a@b>\r\n")     == "B<a@b>");
+    QVERIFY(ArticleCache::getKey("article <a@b>\r\n")  == "A<a@b>");
+    QVERIFY(ArticleCache::getKey("HEAD   <a@b>\r\n")   == "H<a@b>");
+
+    // depends on the group or not an article
+    QVERIFY(ArticleCache::getKey("BODY 1234\r\n").isEmpty());
+    QVERIFY(ArticleCache::getKey("BODY\r\n").isEmpty());
+    QVERIFY(ArticleCache::getKey("STAT <a@b>\r\n").isEmpty());
+    QVERIFY(ArticleCache::getKey("BODYX <a@b>\r\n").isEmpty());
+    QVERIFY(ArticleCache::getKey("BODY <a@b\r\n").isEmpty());
+}
+
+void TestArticleCache::test_isArticleResponse(){
+    QVERIFY(ArticleCache::isArticleResponse("220 0 <a@b>\r\n"));
+    QVERIFY(ArticleCache::isArticleResponse("222 0 <a@b>\r\n"));
+    QVERIFY(!ArticleCache::isArticleResponse("430 no such article\r\n"));
+    QVERIFY(!ArticleCache::isArticleResponse("223 0 <a@b>\r\n"));
+}
+
+void TestArticleCache::test_hitMiss(){
+    ArticleCache cache(1024 * 1024, 4);
+    QByteArray resp = response("<a@b>", 1000);
+    QByteArray out;
+
+    QVERIFY(!cache.get("B<a@b>", out));
+    cache.insert("B<a@b>", resp);
+    QVERIFY(cache.contains("B<a@b>"));
+    QVERIFY(cache.get("B<a@b>", out));
+    QVERIFY(out == resp);
+    QVERIFY(!cache.contains("A<a@b>"));
+
+    QVERIFY(cache.getNumberOfHits()   == 1);
+    QVERIFY(cache.getNumberOfMisses() == 1);
+    QVERIFY(cache.getBytesServed()    == 1000);
+    QVERIFY(cache.getNumberOfArticles() == 1);
+    QVERIFY(cache.getSize() == 1000);
+}
+
+void TestArticleCache::test_lruEviction(){
+    // a single shard of 3000 Bytes: room for 3 responses of 1000
+    ArticleCache cache(3000, 1);
+    cache.insert("B<1@b>", response("<1@b>", 1000));
+    cache.insert("B<2@b>", response("<2@b>", 1000));
+    cache.insert("B<3@b>", response("<3@b>", 1000));
+
+    QByteArray out;
+    QVERIFY(cache.get("B<1@b>", out)); // <2@b> is now the least recently used
+
+    cache.insert("B<4@b>", response("<4@b>", 1000));
+    QVERIFY(cache.contains("B<1@b>"));
+    QVERIFY(!cache.contains("B<2@b>"));
+    QVERIFY(cache.contains("B<3@b>"));
+    QVERIFY(cache.contains("B<4@b>"));
+    QVERIFY(cache.getNumberOfEvictions() == 1);
+    QVERIFY(cache.getSize() == 3000);
+}
+
+void TestArticleCache::test_maxArticleSize(){
+    ArticleCache cache(100000, 1, 2000);
+    cache.insert("B<big@b>", response("<big@b>", 3000));
+    QVERIFY(!cache.contains("B<big@b>"));
+    QVERIFY(cache.getMaxArticleSize() == 2000);
+
+    // never bigger than a shard
+    ArticleCache small(4000, 4, 2000);
+    QVERIFY(small.getMaxArticleSize() == 1000);
+}
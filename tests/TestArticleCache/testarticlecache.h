@@ -0,0 +1,23 @@
+#ifndef TESTARTICLECACHE_H
+#define TESTARTICLECACHE_H
+
+#include <QtTest/QtTest>
+
+#include "../../articlecache.h"
+
+class TestArticleCache : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void test_getKey();
+    void test_isArticleResponse();
+    void test_hitMiss();
+    void test_lruEviction();
+    void test_maxArticleSize();
+
+private:
+    static QByteArray response(const char *aMsgId, int aSize); //!< BODY response of aSize Bytes
+};
+
+#endif // TESTARTICLECACHE_H
@@ -0,0 +1,100 @@
+QT += core network sql testlib
+QT -= gui
+
+TARGET = testArticleStore
+CONFIG += console
+CONFIG -= app_bundle
+CONFIG += c++11
+
+TEMPLATE = app
+
+QMAKE_CXXFLAGS += -Wno-write-strings
+
+# Test coverage
+QMAKE_CXXFLAGS += -g -Wall -fprofile-arcs -ftest-coverage -O0
+QMAKE_LFLAGS += -g -Wall -fprofile-arcs -ftest-coverage  -O0
+
+LIBS += \
+    -lgcov
+
+SOURCES += main.cpp \
+    ../../user.cpp \
+    testarticlestore.cpp \
+    ../../connection.cpp \
+    ../../inputconnection.cpp \
+    ../../log.cpp \
+    ../../worker.cpp \
+    ../../workermanager.cpp \
+    ../../nntp.cpp \
+    ../../nntpconnection.cpp \
+    ../../nntpproxy.cpp \
+    ../../nntpserver.cpp \
+    ../../nntpservermanager.cpp \
+    ../../sessionhandler.cpp \
+    ../../sessionmanager.cpp \
+    ../../usermanager.cpp \
+    ../../database.cpp \
+    ../../mycrypt.cpp \
+    ../../nntplistener.cpp \
+    ../../nntpmultiplexer.cpp \
+    ../../responseframer.cpp \
+    ../../ringbuffer.cpp \
+    ../../nntpscanner.cpp \
+    ../../articlecache.cpp \
+    ../../articlestore.cpp \
+    ../../countminsketch.cpp \
+    ../../spacesaving.cpp \
+    ../../hottracker.cpp \
+    ../../monitoringserver.cpp \
+    ../../singleflight.cpp \
+    ../../failover.cpp \
+    ../../bloomfilter.cpp \
+    ../../serverscore.cpp \
+    ../../fairsharescheduler.cpp \
+    ../../admissionqueue.cpp \
+    ../../tokenbucket.cpp \
+    ../../bandwidthshaper.cpp \
+    ../../readscheduler.cpp
+
+HEADERS += \
+    ../../user.h \
+    testarticlestore.h \
+    ../../connection.h \
+    ../../constants.h \
+    ../../constants_tests.h \
+    ../../inputconnection.h \
+    ../../log.h \
+    ../../mymanager.h \
+    ../../worker.h \
+    ../../workermanager.h \
+    ../../nntp.h \
+    ../../nntpconnection.h \
+    ../../nntpproxy.h \
+    ../../nntpserver.h \
+    ../../nntpservermanager.h \
+    ../../sessionhandler.h \
+    ../../sessionmanager.h \
+    ../../usermanager.h \
+    ../../database.h \
+    ../../mycrypt.h \
+    ../../nntplistener.h \
+    ../../nntpmultiplexer.h \
+    ../../responseframer.h \
+    ../../ringbuffer.h \
+    ../../nntpscanner.h \
+    ../../articlecache.h \
+    ../../articlestore.h \
+    ../../countminsketch.h \
+    ../../spacesaving.h \
+    ../../hottracker.h \
+    ../../monitoringserver.h \
+    ../../singleflight.h \
+    ../../failover.h \
+    ../../bloomfilter.h \
+    ../../serverscore.h \
+    ../../fairsharescheduler.h \
+    ../../admissionqueue.h \
+    ../../tokenbucket.h \
+    ../../bandwidthshaper.h \
+    ../../readscheduler.h
+
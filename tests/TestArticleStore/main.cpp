@@ -0,0 +1,7 @@
+#include <QCoreApplication>
+
+#include <QtTest/QtTest>
+#include "testarticlestore.h"
+
+QTEST_MAIN(TestArticleStore)
+#include "moc_testarticlestore.cpp"
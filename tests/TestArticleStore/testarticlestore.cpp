@@ -0,0 +1,143 @@
+#include "testarticlestore.h"
+#include "../../nntpproxy.h"
+#include "../../articlecache.h"
+
+#include <QDir>
+#include <QFile>
+
+static const char *sStoreDir = "./testArticleStore";
+
+void TestArticleStore::initTestCase(){
+    bool init = NntpProxy::initStatics();
+    std::cout << "Proxy init? " << init << "\n";
+}
+
+void TestArticleStore::init(){
+    QDir(sStoreDir).removeRecursively();
+}
+
+void TestArticleStore::cleanup(){
+    QDir(sStoreDir).removeRecursively();
+}
+
+QByteArray TestArticleStore::response(const char *aMsgId, int aSize){
+    QByteArray resp("222 0 ");
+    resp.append(aMsgId).append("\r\n");
+    resp.append(QByteArray(aSize - resp.size() - 5, 'x'));
+    resp.append("\r\n.\r\n");
+    return resp;
+}
+
+void TestArticleStore::test_insertGet(){
+    ArticleStore store(sStoreDir, sSegmentSize, 4);
+    QVERIFY(store.open());
+
+    QByteArray resp = response("<a@b>", 1000);
+    QByteArray out;
+    QVERIFY(!store.get("B<a@b>", out));
+
+    store.insert("B<a@b>", resp);
+    QVERIFY(store.contains("B<a@b>"));
+    QVERIFY(store.get("B<a@b>", out));
+    QVERIFY(out == resp);
+    QVERIFY(!store.get("A<a@b>", out));
+
+    QVERIFY(store.getNumberOfHits()     == 1);
+    QVERIFY(store.getNumberOfMisses()   == 2);
+    QVERIFY(store.getBytesServed()      == 1000);
+    QVERIFY(store.getNumberOfArticles() == 1);
+}
+
+void TestArticleStore::test_restart(){
+    {
+        ArticleStore store(sStoreDir, sSegmentSize, 4);
+        QVERIFY(store.open());
+        for (int i = 0; i < 100; ++i){
+            QByteArray msgId = QByteArray("<").append(QByteArray::number(i)).append("@b>");
+            store.insert(QByteArray("B").append(msgId), response(msgId.constData(), 1000));
+        }
+        QVERIFY(store.getNumberOfSegments() == 2);
+    }
+
+    // the index is rebuilt from the segment files
+    ArticleStore store(sStoreDir, sSegmentSize, 4);
+    QVERIFY(store.open());
+    QVERIFY(store.getNumberOfSegments() == 2);
+    QVERIFY(store.getNumberOfArticles() == 100);
+
+    QByteArray out;
+    QVERIFY(store.get("B<42@b>", out));
+    QVERIFY(out == response("<42@b>", 1000));
+
+    // appends go on in the last segment
+    store.insert("B<new@b>", response("<new@b>", 1000));
+    QVERIFY(store.getNumberOfSegments() == 2);
+    QVERIFY(store.get("B<new@b>", out));
+}
+
+void TestArticleStore::test_segmentEviction(){
+    ArticleStore store(sStoreDir, sSegmentSize, 2);
+    QVERIFY(store.open());
+
+    // ~20KB records: 3 per segment, the first segment is evicted by the 7th
+    for (int i = 0; i < 7; ++i){
+        QByteArray msgId = QByteArray("<").append(QByteArray::number(i)).append("@b>");
+        store.insert(QByteArray("B").append(msgId), response(msgId.constData(), 20000));
+    }
+
+    QVERIFY(store.getNumberOfSegments() == 2);
+    QVERIFY(store.getNumberOfEvictedSegments() == 1);
+    QVERIFY(!store.contains("B<0@b>"));
+    QVERIFY(!store.contains("B<2@b>"));
+    QVERIFY(store.contains("B<3@b>"));
+    QVERIFY(store.contains("B<6@b>"));
+    QVERIFY(store.getNumberOfArticles() == 4);
+
+    // too big for a segment
+    store.insert("B<big@b>", response("<big@b>", sSegmentSize));
+    QVERIFY(!store.contains("B<big@b>"));
+}
+
+void TestArticleStore::test_truncatedRecord(){
+    {
+        ArticleStore store(sStoreDir, sSegmentSize, 2);
+        QVERIFY(store.open());
+        store.insert("B<1@b>", response("<1@b>", 1000));
+        store.insert("B<2@b>", response("<2@b>", 1000));
+    }
+
+    // corrupt the magic of the second record (crash in the middle of an append)
+    QFile file(QString(sStoreDir).append("/segment-000000000001.seg"));
+    QVERIFY(file.open(QIODevice::ReadWrite));
+    uchar *map = file.map(0, sSegmentSize);
+    qint64 secondRecord = 16 + 12 + 6 + 1000;
+    map[secondRecord] = 0;
+    file.unmap(map);
+    file.close();
+
+    ArticleStore store(sStoreDir, sSegmentSize, 2);
+    QVERIFY(store.open());
+    QVERIFY(store.contains("B<1@b>"));
+    QVERIFY(!store.contains("B<2@b>"));
+}
+
+void TestArticleStore::test_cacheTier(){
+    ArticleStore *store = new ArticleStore(sStoreDir, sSegmentSize, 4);
+    QVERIFY(store->open());
+    QByteArray resp = response("<a@b>", 1000);
+    store->insert("B<a@b>", resp); // on disk only
+
+    ArticleCache cache(1048576, 1);
+    cache.setStore(store);
+
+    QByteArray out;
+    QVERIFY(cache.get("B<a@b>", out)); // from the disk
+    QVERIFY(out == resp);
+    QVERIFY(cache.get("B<a@b>", out)); // back in memory
+    QVERIFY(!cache.get("B<c@d>", out));
+
+    QVERIFY(cache.getNumberOfStoreHits() == 1);
+    QVERIFY(cache.getNumberOfHits()      == 1);
+    QVERIFY(cache.getNumberOfMisses()    == 1);
+    QVERIFY(cache.getBytesServed()       == 2000);
+}
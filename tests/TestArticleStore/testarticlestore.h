@@ -0,0 +1,28 @@
+#ifndef TESTARTICLESTORE_H
+#define TESTARTICLESTORE_H
+
+#include <QtTest/QtTest>
+
+#include "../../articlestore.h"
+
+class TestArticleStore : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void init();
+    void cleanup();
+
+    void test_insertGet();
+    void test_restart();
+    void test_segmentEviction();
+    void test_truncatedRecord();
+    void test_cacheTier();
+
+private:
+    static QByteArray response(const char *aMsgId, int aSize); //!< BODY response of aSize Bytes
+    static const qint64 sSegmentSize = 65536;
+};
+
+#endif // TESTARTICLESTORE_H
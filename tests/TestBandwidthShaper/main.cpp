@@ -0,0 +1,7 @@
+#include <QCoreApplication>
+
+#include <QtTest/QtTest>
+#include "testbandwidthshaper.h"
+
+QTEST_MAIN(TestBandwidthShaper)
+#include "moc_testbandwidthshaper.cpp"
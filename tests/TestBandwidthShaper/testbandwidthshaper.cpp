@@ -0,0 +1,152 @@
+#include "testbandwidthshaper.h"
+#include "../../tokenbucket.h"
+
+static const qint64 sBig = 100 * 1024 * 1024; // more than any burst
+
+void TestBandwidthShaper::initTestCase(){
+    NntpProxy::initStatics();
+}
+
+void TestBandwidthShaper::init(){
+    iClasses.append(new UserClassParameters("limited", 100, 16, QStringList() << "alice"));
+    iShaper = new BandwidthShaper(iClasses, 0, 0);
+}
+
+void TestBandwidthShaper::cleanup(){
+    delete iShaper;
+    qDeleteAll(iClasses);
+    iClasses.clear();
+}
+
+void TestBandwidthShaper::test_userBuckets(){
+    // the sessions of a user share its bucket
+    BandwidthShaper::Flow flow1 = iShaper->acquire("alice", "1.1.1.1");
+    BandwidthShaper::Flow flow2 = iShaper->acquire("alice", "2.2.2.2");
+    BandwidthShaper::Flow flow3 = iShaper->acquire("bob",   "1.1.1.1");
+    QVERIFY(BandwidthShaper::isAcquired(flow1));
+    QVERIFY(flow1.user == flow2.user);
+    QVERIFY(flow1.user != flow3.user);
+    QVERIFY(flow1.ipBucket == Q_NULLPTR); // no IP rate
+
+    qint64 delay = 0;
+    QCOMPARE(BandwidthShaper::take(flow1, sBig, delay), Q_INT64_C(16 * 1024));
+    QCOMPARE(BandwidthShaper::take(flow2, sBig, delay), Q_INT64_C(0));
+    QVERIFY(delay > 0);
+
+    // released flows are unlimited
+    iShaper->release(flow1);
+    QVERIFY(!BandwidthShaper::isAcquired(flow1));
+    QCOMPARE(BandwidthShaper::take(flow1, sBig, delay), sBig);
+
+    iShaper->release(flow2);
+    iShaper->release(flow3);
+}
+
+void TestBandwidthShaper::test_classes(){
+    QCOMPARE(iShaper->getUserClass("alice"), QString("limited"));
+    QCOMPARE(iShaper->getUserClass("bob"),   QString(cDefaultUserClass));
+
+    BandwidthShaper::Flow alice = iShaper->acquire("alice", "1.1.1.1");
+    BandwidthShaper::Flow bob   = iShaper->acquire("bob",   "1.1.1.1");
+    QCOMPARE(alice.user->getRate(), Q_INT64_C(100 * 1024));
+    QVERIFY(!bob.user->isLimited());
+
+    qint64 delay = 0;
+    QCOMPARE(BandwidthShaper::take(bob, sBig, delay), sBig);
+    QCOMPARE(delay, Q_INT64_C(0));
+
+    iShaper->release(alice);
+    iShaper->release(bob);
+}
+
+void TestBandwidthShaper::test_setClass(){
+    BandwidthShaper::Flow alice = iShaper->acquire("alice", "1.1.1.1");
+    QVERIFY(!iShaper->setClass("", 10, 10));
+
+    // the active bucket gets the new limits
+    QVERIFY(iShaper->setClass("limited", 0, 16));
+    QVERIFY(!alice.user->isLimited());
+    qint64 delay = 0;
+    QCOMPARE(BandwidthShaper::take(alice, sBig, delay), sBig);
+
+    QVERIFY(iShaper->setClass("limited", 50, 32));
+    QCOMPARE(alice.user->getRate(),  Q_INT64_C(50 * 1024));
+    QCOMPARE(alice.user->getBurst(), Q_INT64_C(32 * 1024));
+
+    // and so do the next ones
+    iShaper->release(alice);
+    alice = iShaper->acquire("alice", "1.1.1.1");
+    QCOMPARE(alice.user->getRate(), Q_INT64_C(50 * 1024));
+    iShaper->release(alice);
+}
+
+void TestBandwidthShaper::test_setUserClass(){
+    BandwidthShaper::Flow bob = iShaper->acquire("bob", "1.1.1.1");
+    QVERIFY(!iShaper->setUserClass("bob", "unknown"));
+    QVERIFY(!bob.user->isLimited());
+
+    QVERIFY(iShaper->setUserClass("bob", "limited"));
+    QCOMPARE(iShaper->getUserClass("bob"), QString("limited"));
+    QCOMPARE(bob.user->getRate(), Q_INT64_C(100 * 1024));
+
+    QVERIFY(iShaper->setUserClass("bob", cDefaultUserClass));
+    QCOMPARE(iShaper->getUserClass("bob"), QString(cDefaultUserClass));
+    QVERIFY(!bob.user->isLimited());
+    iShaper->release(bob);
+}
+
+void TestBandwidthShaper::test_ipBucket(){
+    BandwidthShaper::Flow before = iShaper->acquire("bob", "1.1.1.1");
+    iShaper->setIpRate(10, 16);
+
+    // the IP bucket limits the users of the IP, whatever their class
+    BandwidthShaper::Flow bob   = iShaper->acquire("bob",   "1.1.1.1");
+    BandwidthShaper::Flow carol = iShaper->acquire("carol", "1.1.1.1");
+    BandwidthShaper::Flow dave  = iShaper->acquire("dave",  "2.2.2.2");
+    QVERIFY(before.ipBucket == Q_NULLPTR);
+    QVERIFY(bob.ipBucket != Q_NULLPTR);
+    QVERIFY(bob.ipBucket == carol.ipBucket);
+    QVERIFY(bob.ipBucket != dave.ipBucket);
+
+    qint64 delay = 0;
+    QCOMPARE(BandwidthShaper::take(bob,   sBig, delay), Q_INT64_C(16 * 1024));
+    QCOMPARE(BandwidthShaper::take(carol, sBig, delay), Q_INT64_C(0));
+    QVERIFY(delay > 0);
+    QCOMPARE(BandwidthShaper::take(dave,  sBig, delay), Q_INT64_C(16 * 1024));
+    QCOMPARE(BandwidthShaper::take(before, sBig, delay), sBig);
+
+    // the bytes given back are for the next one
+    BandwidthShaper::giveBack(bob, 1024);
+    QCOMPARE(BandwidthShaper::take(carol, 1024, delay), Q_INT64_C(1024));
+
+    iShaper->release(before);
+    iShaper->release(bob);
+    iShaper->release(carol);
+    iShaper->release(dave);
+}
+
+void TestBandwidthShaper::test_throttledTime(){
+    BandwidthShaper::Flow flow1 = iShaper->acquire("alice", "1.1.1.1");
+    BandwidthShaper::Flow flow2 = iShaper->acquire("alice", "1.1.1.1");
+    BandwidthShaper::addThrottledTime(flow1, 3000000);
+    BandwidthShaper::addThrottledTime(flow2, 2000000);
+    QCOMPARE(iShaper->getThrottledTime("alice"), Q_INT64_C(5000000));
+    QCOMPARE(iShaper->getThrottledTime("bob"),   Q_INT64_C(0));
+
+    // kept once the sessions are gone
+    iShaper->release(flow1);
+    iShaper->release(flow2);
+    QCOMPARE(iShaper->getThrottledTime("alice"), Q_INT64_C(5000000));
+
+    flow1 = iShaper->acquire("alice", "1.1.1.1");
+    BandwidthShaper::addThrottledTime(flow1, 1000000);
+    QCOMPARE(iShaper->getThrottledTime("alice"), Q_INT64_C(6000000));
+
+    QString dump;
+    QTextStream stream(&dump);
+    iShaper->dump(stream);
+    stream.flush();
+    QVERIFY(dump.contains("alice throttled: 6 ms"));
+    QVERIFY(dump.contains("class limited: 100 KB/s"));
+    iShaper->release(flow1);
+}
@@ -0,0 +1,29 @@
+#ifndef TESTBANDWIDTHSHAPER_H
+#define TESTBANDWIDTHSHAPER_H
+
+#include <QtTest/QtTest>
+
+#include "../../bandwidthshaper.h"
+
+class TestBandwidthShaper : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void init();
+    void cleanup();
+
+    void test_userBuckets();
+    void test_classes();
+    void test_setClass();
+    void test_setUserClass();
+    void test_ipBucket();
+    void test_throttledTime();
+
+private:
+    QVector<UserClassParameters *> iClasses;
+    BandwidthShaper               *iShaper;
+};
+
+#endif // TESTBANDWIDTHSHAPER_H
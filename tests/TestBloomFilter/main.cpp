@@ -0,0 +1,7 @@
+#include <QCoreApplication>
+
+#include <QtTest/QtTest>
+#include "testbloomfilter.h"
+
+QTEST_MAIN(TestBloomFilter)
+#include "moc_testbloomfilter.cpp"
@@ -0,0 +1,93 @@
+#include "testbloomfilter.h"
+
+#include <cmath>
+
+static QByteArray msgId(int aNum){
+    return QByteArray("<").append(QByteArray::number(aNum)).append("@test>");
+}
+
+void TestBloomFilter::test_sizing(){
+    BloomFilter filter(64 * 1024, 0.01);
+    QCOMPARE(filter.getMemorySize(), static_cast<qint64>(64 * 1024));
+    QCOMPARE(filter.getNumberOfHashes(), 7);                   // log2(100) rounded up
+    QCOMPARE(filter.getCapacity(), static_cast<int>(32 * 1024 * 8 * std::log(2) * std::log(2) / std::log(100)));
+    QCOMPARE(filter.getNumberOfKeys(), 0);
+
+    // rounded down to a power of 2, with a minimum
+    BloomFilter odd(100 * 1024, 0.01);
+    QCOMPARE(odd.getMemorySize(), static_cast<qint64>(64 * 1024));
+    BloomFilter tiny(1, 0.5);
+    QCOMPARE(tiny.getMemorySize(), static_cast<qint64>(2 * 1024 / 8));
+    QCOMPARE(tiny.getNumberOfHashes(), 1);
+
+    // invalid rate: default one
+    BloomFilter invalid(64 * 1024, 2);
+    QCOMPARE(invalid.getNumberOfHashes(), filter.getNumberOfHashes());
+}
+
+void TestBloomFilter::test_noFalseNegative(){
+    BloomFilter filter(64 * 1024, 0.01);
+    int nbKeys = filter.getCapacity() - 1;
+    for (int i = 0; i < nbKeys; ++i)
+        filter.add(msgId(i));
+
+    QCOMPARE(filter.getNumberOfKeys(), nbKeys);
+    QCOMPARE(filter.getNumberOfRotations(), static_cast<quint64>(0));
+    for (int i = 0; i < nbKeys; ++i)
+        QVERIFY(filter.contains(msgId(i)));
+}
+
+void TestBloomFilter::test_falsePositiveRate(){
+    BloomFilter filter(64 * 1024, 0.01);
+    int nbKeys = filter.getCapacity() - 1;
+    for (int i = 0; i < nbKeys; ++i)
+        filter.add(msgId(i));
+
+    int nbTests = 100000, nbFalsePositives = 0;
+    for (int i = 0; i < nbTests; ++i){
+        if (filter.contains(msgId(nbKeys + i)))
+            ++nbFalsePositives;
+    }
+    double rate = static_cast<double>(nbFalsePositives) / nbTests;
+    QVERIFY(rate < 0.02);
+    QVERIFY(qAbs(filter.getFalsePositiveRate() - 0.01) < 0.005);
+}
+
+void TestBloomFilter::test_rotation(){
+    BloomFilter filter(2 * 1024, 0.01);
+    int capacity = filter.getCapacity();
+
+    // first generation full: rotated, its keys are still there
+    for (int i = 0; i < capacity; ++i)
+        filter.add(msgId(i));
+    QCOMPARE(filter.getNumberOfRotations(), static_cast<quint64>(1));
+    QCOMPARE(filter.getNumberOfKeys(), capacity);
+    for (int i = 0; i < capacity; ++i)
+        QVERIFY(filter.contains(msgId(i)));
+
+    // second generation full: the first one is cleared
+    for (int i = capacity; i < 2 * capacity; ++i)
+        filter.add(msgId(i));
+    QCOMPARE(filter.getNumberOfRotations(), static_cast<quint64>(2));
+    QCOMPARE(filter.getNumberOfKeys(), capacity);
+    for (int i = capacity; i < 2 * capacity; ++i)
+        QVERIFY(filter.contains(msgId(i)));
+
+    int nbRemembered = 0;
+    for (int i = 0; i < capacity; ++i){
+        if (filter.contains(msgId(i)))
+            ++nbRemembered;
+    }
+    QVERIFY(nbRemembered < capacity / 10); // only false positives
+}
+
+void TestBloomFilter::test_clear(){
+    BloomFilter filter(8 * 1024, 0.01);
+    filter.add(msgId(1));
+    QVERIFY(filter.contains(msgId(1)));
+
+    filter.clear();
+    QVERIFY(!filter.contains(msgId(1)));
+    QCOMPARE(filter.getNumberOfKeys(), 0);
+    QCOMPARE(filter.getFalsePositiveRate(), 0.);
+}
@@ -0,0 +1,20 @@
+#ifndef TESTBLOOMFILTER_H
+#define TESTBLOOMFILTER_H
+
+#include <QtTest/QtTest>
+
+#include "../../bloomfilter.h"
+
+class TestBloomFilter : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void test_sizing();
+    void test_noFalseNegative();
+    void test_falsePositiveRate();
+    void test_rotation();
+    void test_clear();
+};
+
+#endif // TESTBLOOMFILTER_H
@@ -0,0 +1,7 @@
+#include <QCoreApplication>
+
+#include <QtTest/QtTest>
+#include "testfailover.h"
+
+QTEST_MAIN(TestFailover)
+#include "moc_testfailover.cpp"
@@ -0,0 +1,34 @@
+#include "testfailover.h"
+
+void TestFailover::test_canFailover(){
+    QVERIFY(Failover::canFailover("BODY <a@b>\r\n"));
+    QVERIFY(Failover::canFailover("article <a@b>\r\n"));
+    QVERIFY(Failover::canFailover("HEAD <a@b>\r\n"));
+    QVERIFY(Failover::canFailover("STAT <a@b>\r\n"));
+
+    // the article numbers are specific to each server
+    QVERIFY(!Failover::canFailover("BODY 1234\r\n"));
+    QVERIFY(!Failover::canFailover("ARTICLE\r\n"));
+
+    QVERIFY(!Failover::canFailover("GROUP alt.test\r\n"));
+    QVERIFY(!Failover::canFailover("XOVER 1-10\r\n"));
+    QVERIFY(!Failover::canFailover("BODYX <a@b>\r\n"));
+}
+
+void TestFailover::test_isMissing(){
+    QVERIFY(Failover::isMissing("430 no such article found\r\n"));
+    QVERIFY(Failover::isMissing("423 no such article number in this group\r\n"));
+
+    QVERIFY(!Failover::isMissing("222 0 <a@b>\r\n"));
+    QVERIFY(!Failover::isMissing("223 0 <a@b>\r\n"));
+    QVERIFY(!Failover::isMissing("400 service discontinued\r\n"));
+    QVERIFY(!Failover::isMissing("43"));
+}
+
+void TestFailover::test_getMessageId(){
+    QCOMPARE(Failover::getMessageId("BODY <a@b>\r\n"), QByteArray("<a@b>"));
+    QCOMPARE(Failover::getMessageId("stat <part1of2.xyz@news>\r\n"), QByteArray("<part1of2.xyz@news>"));
+
+    QVERIFY(Failover::getMessageId("BODY 1234\r\n").isEmpty());
+    QVERIFY(Failover::getMessageId("BODY <a@b\r\n").isEmpty());
+}
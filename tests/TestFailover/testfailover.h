@@ -0,0 +1,18 @@
+#ifndef TESTFAILOVER_H
+#define TESTFAILOVER_H
+
+#include <QtTest/QtTest>
+
+#include "../../failover.h"
+
+class TestFailover : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void test_canFailover();
+    void test_isMissing();
+    void test_getMessageId();
+};
+
+#endif // TESTFAILOVER_H
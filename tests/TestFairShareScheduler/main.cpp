@@ -0,0 +1,7 @@
+#include <QCoreApplication>
+
+#include <QtTest/QtTest>
+#include "testfairsharescheduler.h"
+
+QTEST_MAIN(TestFairShareScheduler)
+#include "moc_testfairsharescheduler.cpp"
@@ -0,0 +1,133 @@
+#include "testfairsharescheduler.h"
+#include "../../constants_tests.h"
+#include "../../nntpconnection.h"
+
+void TestFairShareScheduler::initTestCase(){
+    NntpProxy::initStatics();
+}
+
+void TestFairShareScheduler::init(){
+    iParams = new NntpServerParameters(cTestNntpServParamSSL());
+    iServer = new NntpServer(*iParams);
+    iUserA  = new User("127.0.0.1", "userA");
+    iUserB  = new User("127.0.0.2", "userB");
+}
+
+void TestFairShareScheduler::cleanup(){
+    delete iUserB;
+    delete iUserA;
+    delete iServer;
+    delete iParams;
+}
+
+void TestFairShareScheduler::test_refusedWhenFair(){
+    FairShareScheduler scheduler;
+    SchedulerSession a1, a2, b;
+    scheduler.addForwarding(&a1, iUserA);
+    scheduler.addForwarding(&a2, iUserA);
+    QVERIFY(scheduler.getNumberOfUsers() == 1);
+
+    // 4 connections for 2 users: userA doesn't have more than its share
+    QVERIFY(!scheduler.requestNntpConnection(&b, iUserB, 42, 4));
+    QCoreApplication::processEvents();
+    QVERIFY(a1.iNbYields == 0 && a2.iNbYields == 0);
+    QVERIFY(scheduler.getNumberOfRefusals() == 1);
+    QVERIFY(scheduler.getNumberOfUsers() == 1);
+
+    // nor when userA is the one asking
+    QVERIFY(!scheduler.requestNntpConnection(&b, iUserA, 42, 2));
+    QVERIFY(scheduler.getNumberOfRefusals() == 2);
+}
+
+void TestFairShareScheduler::test_yieldAndGrant(){
+    FairShareScheduler scheduler;
+    SchedulerSession a1, a2, a3, b;
+    scheduler.addForwarding(&a1, iUserA);
+    scheduler.addForwarding(&a2, iUserA);
+    scheduler.addForwarding(&a3, iUserA);
+
+    // 3 connections for 2 users: the oldest session of userA yields
+    QVERIFY(scheduler.requestNntpConnection(&b, iUserB, 42, 3));
+    QVERIFY(scheduler.getNumberOfUsers() == 2);
+    QCoreApplication::processEvents();
+    QVERIFY(a1.iNbYields == 1 && a2.iNbYields == 0 && a3.iNbYields == 0);
+    QVERIFY(scheduler.takeGranted(&b) == Q_NULLPTR); // not yielded yet
+
+    qintptr inputConId = 0;
+    QVERIFY(scheduler.startYield(&a1, inputConId));
+    QVERIFY(inputConId == 42);
+    QVERIFY(!scheduler.startYield(&a2, inputConId));
+
+    NntpConnection *con = iServer->getNntpConnection(inputConId);
+    QVERIFY(scheduler.yielded(&a1, con));
+    QVERIFY(!scheduler.yielded(&a1, con)); // only once
+    QCoreApplication::processEvents();
+    QVERIFY(b.iNbGrants == 1 && b.iNbRefusals == 0);
+
+    QVERIFY(scheduler.takeGranted(&b) == con);
+    QVERIFY(scheduler.takeGranted(&b) == Q_NULLPTR);
+    QVERIFY(scheduler.getNumberOfGrants() == 1);
+
+    // userB isn't counted until its session forwards
+    QVERIFY(scheduler.removeSession(&a1) == Q_NULLPTR);
+    QVERIFY(scheduler.getNumberOfUsers() == 1);
+    scheduler.addForwarding(&b, iUserB);
+    QVERIFY(scheduler.getNumberOfUsers() == 2);
+
+    iServer->releaseNntpConnection(con);
+    delete con;
+}
+
+void TestFairShareScheduler::test_victimGone(){
+    FairShareScheduler scheduler;
+    SchedulerSession a1, a2, a3, b;
+    scheduler.addForwarding(&a1, iUserA);
+    scheduler.addForwarding(&a2, iUserA);
+    scheduler.addForwarding(&a3, iUserA);
+
+    QVERIFY(scheduler.requestNntpConnection(&b, iUserB, 42, 3));
+    QCoreApplication::processEvents();
+    QVERIFY(a1.iNbYields == 1);
+
+    // the victim closes before yielding: the next one is asked
+    QVERIFY(scheduler.removeSession(&a1) == Q_NULLPTR);
+    QCoreApplication::processEvents();
+    QVERIFY(a2.iNbYields == 1);
+
+    // it can't yield: userA has its share left, the request is refused
+    scheduler.yieldFailed(&a2);
+    QCoreApplication::processEvents();
+    QVERIFY(a3.iNbYields == 0);
+    QVERIFY(b.iNbRefusals == 1 && b.iNbGrants == 0);
+    QVERIFY(scheduler.getNumberOfRefusals() == 1);
+    QVERIFY(scheduler.getNumberOfUsers() == 1);
+}
+
+void TestFairShareScheduler::test_requesterGone(){
+    FairShareScheduler scheduler;
+    SchedulerSession a1, a2, a3, b, c;
+    scheduler.addForwarding(&a1, iUserA);
+    scheduler.addForwarding(&a2, iUserA);
+    scheduler.addForwarding(&a3, iUserA);
+
+    // the requester closes before the yield: the victim keeps its connection
+    QVERIFY(scheduler.requestNntpConnection(&b, iUserB, 42, 3));
+    QVERIFY(scheduler.removeSession(&b) == Q_NULLPTR);
+    qintptr inputConId = 0;
+    QVERIFY(!scheduler.startYield(&a1, inputConId));
+    QVERIFY(scheduler.getNumberOfUsers() == 1);
+
+    // a victim candidate again (after the other sessions of userA)
+    QVERIFY(scheduler.requestNntpConnection(&c, iUserB, 43, 3));
+    QCoreApplication::processEvents();
+    QVERIFY(a2.iNbYields == 1);
+
+    // the requester closes after the yield: the connection comes back to be released
+    NntpConnection *con = iServer->getNntpConnection(43);
+    QVERIFY(scheduler.yielded(&a2, con));
+    QVERIFY(scheduler.removeSession(&c) == con);
+    QVERIFY(scheduler.takeGranted(&c) == Q_NULLPTR);
+
+    iServer->releaseNntpConnection(con);
+    delete con;
+}
@@ -0,0 +1,49 @@
+#ifndef TESTFAIRSHARESCHEDULER_H
+#define TESTFAIRSHARESCHEDULER_H
+
+#include <QtTest/QtTest>
+
+#include "../../fairsharescheduler.h"
+#include "../../nntpserver.h"
+#include "../../user.h"
+
+//! session counting the calls of the FairShareScheduler
+class SchedulerSession : public QObject
+{
+    Q_OBJECT
+
+public:
+    SchedulerSession() : QObject(), iNbYields(0), iNbGrants(0), iNbRefusals(0) {}
+    int iNbYields;
+    int iNbGrants;
+    int iNbRefusals;
+
+public slots:
+    void yieldNntpConnection(){++iNbYields;}
+    void nntpConnectionGranted(){++iNbGrants;}
+    void nntpConnectionRefused(){++iNbRefusals;}
+};
+
+class TestFairShareScheduler : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase(); // Called once before the test cases
+
+    void init(); // called before each test case
+    void cleanup(); // called after each test case
+
+    void test_refusedWhenFair();
+    void test_yieldAndGrant();
+    void test_victimGone();
+    void test_requesterGone();
+
+private:
+    NntpServerParameters *iParams;
+    NntpServer           *iServer; //!< gives the connections yielded
+    User                 *iUserA;  //!< user with many connections
+    User                 *iUserB;  //!< user asking for one
+};
+
+#endif // TESTFAIRSHARESCHEDULER_H
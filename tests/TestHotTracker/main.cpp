@@ -0,0 +1,7 @@
+#include <QCoreApplication>
+
+#include <QtTest/QtTest>
+#include "testhottracker.h"
+
+QTEST_MAIN(TestHotTracker)
+#include "moc_testhottracker.cpp"
@@ -0,0 +1,111 @@
+#include "testhottracker.h"
+
+void TestHotTracker::test_sketch(){
+    CountMinSketch sketch(1000, 4);
+    QVERIFY(sketch.getWidth() == 1024);
+    QVERIFY(sketch.estimate("<a@b>") == 0);
+
+    for (int i = 0; i < 5000; ++i)
+        sketch.add(QByteArray("<").append(QByteArray::number(i % 500)).append("@b>"));
+    for (int i = 0; i < 100; ++i)
+        sketch.add("<hot@b>");
+
+    // never under-counts, over-counts by little with that width
+    QVERIFY(sketch.estimate("<hot@b>") >= 100);
+    QVERIFY(sketch.estimate("<hot@b>") <= 130);
+    for (int i = 0; i < 500; ++i)
+        QVERIFY(sketch.estimate(QByteArray("<").append(QByteArray::number(i)).append("@b>")) >= 10);
+    QVERIFY(sketch.getTotal() == 5100);
+
+    sketch.clear();
+    QVERIFY(sketch.estimate("<hot@b>") == 0);
+}
+
+void TestHotTracker::test_spaceSaving(){
+    SpaceSaving top(20);
+
+    // 3 heavy hitters in the middle of many rare keys
+    for (int i = 0; i < 1000; ++i){
+        top.offer(QByteArray("rare").append(QByteArray::number(i)));
+        if (i % 10 == 0)
+            top.offer("hot1", 3);
+        if (i % 20 == 0)
+            top.offer("hot2", 3);
+        if (i % 25 == 0)
+            top.offer("hot3", 3);
+    }
+    QVERIFY(top.size() == 20);
+
+    QList<SpaceSaving::Item> items = top.getTop(3);
+    QVERIFY(items.size() == 3);
+    QVERIFY(items[0].key == "hot1");
+    QVERIFY(items[1].key == "hot2");
+    QVERIFY(items[2].key == "hot3");
+    for (const SpaceSaving::Item &item : items)
+        QVERIFY(item.count >= item.error);
+    QVERIFY(items[0].count - items[0].error <= 300 && items[0].count >= 300);
+
+    top.clear();
+    QVERIFY(top.size() == 0);
+}
+
+void TestHotTracker::test_tracker(){
+    HotTracker tracker(2, 60, 3);
+
+    for (int i = 0; i < 10; ++i)
+        tracker.record(0, "BODY <hot@b>\r\n", "user1", "10.0.0.1");
+    for (int i = 0; i < 4; ++i)
+        tracker.record(1, "article <warm@b>\r\n", "user2", "10.0.0.2");
+    tracker.record(1, "GROUP alt.binaries.test\r\n", "user2", "10.0.0.2");
+    tracker.record(1, "BODY 1234\r\n", "user2", "10.0.0.2"); // not by message-id
+    tracker.drain();
+
+    QVERIFY(tracker.getNumberOfEvents() == 16);
+    QVERIFY(tracker.getNumberOfDroppedEvents() == 0);
+
+    QList<HotTracker::Hit> hits = tracker.getTop(HotTracker::MessageId, 10);
+    QVERIFY(hits.size() == 2);
+    QVERIFY(hits[0].key == "<hot@b>" && hits[0].count == 10);
+    QVERIFY(hits[1].key == "<warm@b>" && hits[1].count == 4);
+
+    QVERIFY(tracker.getEstimate(HotTracker::Group, "alt.binaries.test") == 1);
+    QVERIFY(tracker.getTop(HotTracker::User, 1).first().key == "user1");
+    QVERIFY(tracker.getEstimate(HotTracker::User, "user2") == 6);
+    QVERIFY(tracker.getEstimate(HotTracker::ClientIp, "10.0.0.2") == 6);
+
+    HotTracker::DIMENSION dimension;
+    QVERIFY(HotTracker::getDimension("IP", dimension) && dimension == HotTracker::ClientIp);
+    QVERIFY(!HotTracker::getDimension("foo", dimension));
+}
+
+void TestHotTracker::test_rotation(){
+    HotTracker tracker(1, 60, 2);
+
+    tracker.record(0, "BODY <old@b>\r\n", "user", "ip");
+    tracker.rotate(); // <old@b> is in the previous window
+    tracker.record(0, "BODY <new@b>\r\n", "user", "ip");
+    tracker.drain();
+
+    QVERIFY(tracker.getEstimate(HotTracker::MessageId, "<old@b>") == 1);
+    QVERIFY(tracker.getEstimate(HotTracker::MessageId, "<new@b>") == 1);
+    QVERIFY(tracker.getEstimate(HotTracker::User, "user") == 2);
+
+    tracker.rotate(); // the window of <old@b> is dropped
+    QVERIFY(tracker.getEstimate(HotTracker::MessageId, "<old@b>") == 0);
+    QVERIFY(tracker.getEstimate(HotTracker::MessageId, "<new@b>") == 1);
+    QVERIFY(tracker.getTop(HotTracker::MessageId, 10).size() == 1);
+}
+
+void TestHotTracker::test_queueFull(){
+    HotTracker tracker(1);
+
+    for (int i = 0; i < cHotQueueSize; ++i)
+        QVERIFY(tracker.record(0, "BODY <a@b>\r\n", "user", "ip"));
+    QVERIFY(!tracker.record(0, "BODY <a@b>\r\n", "user", "ip"));
+    QVERIFY(tracker.getNumberOfDroppedEvents() == 1);
+
+    tracker.drain(); // the slots are given back
+    QVERIFY(tracker.record(0, "BODY <a@b>\r\n", "user", "ip"));
+    tracker.drain();
+    QVERIFY(tracker.getEstimate(HotTracker::MessageId, "<a@b>") == static_cast<quint64>(cHotQueueSize) + 1);
+}
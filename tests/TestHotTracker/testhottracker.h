@@ -0,0 +1,20 @@
+#ifndef TESTHOTTRACKER_H
+#define TESTHOTTRACKER_H
+
+#include <QtTest/QtTest>
+
+#include "../../hottracker.h"
+
+class TestHotTracker : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void test_sketch();
+    void test_spaceSaving();
+    void test_tracker();
+    void test_rotation();
+    void test_queueFull();
+};
+
+#endif // TESTHOTTRACKER_H
@@ -21,7 +21,8 @@ SOURCES += main.cpp \
     ../../connection.cpp \
     ../../inputconnection.cpp \
     ../../log.cpp \
-    ../../mythread.cpp \
+    ../../worker.cpp \
+    ../../workermanager.cpp \
     ../../nntp.cpp \
     ../../nntpconnection.cpp \
     ../../nntpproxy.cpp \
@@ -32,7 +33,27 @@ SOURCES += main.cpp \
     ../../user.cpp \
     ../../database.cpp \
     ../../mycrypt.cpp \
-    ../../usermanager.cpp
+    ../../usermanager.cpp \
+    ../../nntplistener.cpp \
+    ../../nntpmultiplexer.cpp \
+    ../../responseframer.cpp \
+    ../../ringbuffer.cpp \
+    ../../nntpscanner.cpp \
+    ../../articlecache.cpp \
+    ../../articlestore.cpp \
+    ../../countminsketch.cpp \
+    ../../spacesaving.cpp \
+    ../../hottracker.cpp \
+    ../../monitoringserver.cpp \
+    ../../singleflight.cpp \
+    ../../failover.cpp \
+    ../../bloomfilter.cpp \
+    ../../serverscore.cpp \
+    ../../fairsharescheduler.cpp \
+    ../../admissionqueue.cpp \
+    ../../tokenbucket.cpp \
+    ../../bandwidthshaper.cpp \
+    ../../readscheduler.cpp
 
 
 
@@ -44,7 +65,8 @@ HEADERS += \
     ../../inputconnection.h \
     ../../log.h \
     ../../mymanager.h \
-    ../../mythread.h \
+    ../../worker.h \
+    ../../workermanager.h \
     ../../nntp.h \
     ../../nntpconnection.h \
     ../../nntpproxy.h \
@@ -55,7 +77,27 @@ HEADERS += \
     ../../user.h \
     ../../database.h \
     ../../mycrypt.h \
-    ../../usermanager.h
+    ../../usermanager.h \
+    ../../nntplistener.h \
+    ../../nntpmultiplexer.h \
+    ../../responseframer.h \
+    ../../ringbuffer.h \
+    ../../nntpscanner.h \
+    ../../articlecache.h \
+    ../../articlestore.h \
+    ../../countminsketch.h \
+    ../../spacesaving.h \
+    ../../hottracker.h \
+    ../../monitoringserver.h \
+    ../../singleflight.h \
+    ../../failover.h \
+    ../../bloomfilter.h \
+    ../../serverscore.h \
+    ../../fairsharescheduler.h \
+    ../../admissionqueue.h \
+    ../../tokenbucket.h \
+    ../../bandwidthshaper.h \
+    ../../readscheduler.h
 
 
 
@@ -44,9 +44,12 @@ void TestNntpConnection::test_authenticate(){
 
 
 
+    // connection and authentication are asynchronous
+    QSignalSpy authSpy(iNntpCon, &NntpConnection::authenticated);
     emit startConnection(iParams->name.toLatin1().constData(), iParams->port);
 
-    QVERIFY(iNntpCon->doAuthentication());
+    QVERIFY(authSpy.wait(NntpProxy::getSocketTimeout()));
+    QVERIFY(iNntpCon->isAuthenticated());
 
     delete iNntpCon;
     delete iServer;
@@ -66,9 +69,46 @@ void TestNntpConnection::test_authenticate_ssl(){
 
 
 
+    // connection and authentication are asynchronous
+    QSignalSpy authSpy(iNntpCon, &NntpConnection::authenticated);
     emit startConnection(iParams->name.toLatin1().constData(), iParams->port);
 
-    QVERIFY(iNntpCon->doAuthentication());
+    QVERIFY(authSpy.wait(NntpProxy::getSocketTimeout()));
+    QVERIFY(iNntpCon->isAuthenticated());
+
+    delete iNntpCon;
+    delete iServer;
+    delete iParams;
+}
+
+
+void TestNntpConnection::test_pipelinedCommands(){
+    iParams = new NntpServerParameters(cTestNntpServParam());
+    iServer = new NntpServer(*iParams);
+
+    iNntpCon = new NntpConnection(0, *iServer);
+    connect(this, &TestNntpConnection::startConnection, iNntpCon, &Connection::startTcpConnection);
+
+    QSignalSpy authSpy(iNntpCon, &NntpConnection::authenticated);
+    emit startConnection(iParams->name.toLatin1().constData(), iParams->port);
+    QVERIFY(authSpy.wait(NntpProxy::getSocketTimeout()));
+
+    // single line and multi-line responses sent in the same segment
+    QSignalSpy respSpy(iNntpCon, &NntpConnection::responseDone);
+    iNntpCon->startAsyncRead();
+    iNntpCon->sendCommand("DATE\r\n");
+    iNntpCon->sendCommand("HELP\r\n");
+    iNntpCon->sendCommand("DATE\r\n");
+    QVERIFY(iNntpCon->getNumberOfPendingCommands() == 3);
+
+    while (respSpy.count() < 3)
+        QVERIFY(respSpy.wait(NntpProxy::getSocketTimeout()));
+
+    QVERIFY(iNntpCon->getNumberOfPendingCommands() == 0);
+    QVERIFY(respSpy.at(0).at(0).toByteArray() == "DATE\r\n");
+    QVERIFY(respSpy.at(1).at(0).toByteArray() == "HELP\r\n");
+    QVERIFY(Nntp::getResponseCode(respSpy.at(1).at(1).toByteArray().constData()) == 100);
+    QVERIFY(respSpy.at(2).at(0).toByteArray() == "DATE\r\n");
 
     delete iNntpCon;
     delete iServer;
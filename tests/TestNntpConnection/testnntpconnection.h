@@ -24,6 +24,7 @@ private slots:
 
     void test_authenticate();
     void test_authenticate_ssl();
+    void test_pipelinedCommands();
 
 
 private:
@@ -0,0 +1,7 @@
+#include <QCoreApplication>
+
+#include <QtTest/QtTest>
+#include "testnntpmultiplexer.h"
+
+QTEST_MAIN(TestNntpMultiplexer)
+#include "moc_testnntpmultiplexer.cpp"
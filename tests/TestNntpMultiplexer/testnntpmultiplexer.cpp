@@ -0,0 +1,76 @@
+#include "testnntpmultiplexer.h"
+
+static const QByteArray sGroup("a.b.c");
+
+void TestNntpMultiplexer::test_sameState(){
+    QByteArray group, article;
+    NntpMultiplexer::updateState("GROUP a.b.c\r\n", "211 10 1 10 a.b.c\r\n", group, article);
+    QVERIFY(group == sGroup);
+    QVERIFY(article.isEmpty());
+
+    QVERIFY(NntpMultiplexer::getReplay("NEXT\r\n", group, article, group, article).isEmpty());
+}
+
+void TestNntpMultiplexer::test_otherGroup(){
+    QList<QByteArray> replay = NntpMultiplexer::getReplay("ARTICLE\r\n", sGroup, "3", "x.y.z", "7");
+    QCOMPARE(replay.size(), 2);
+    QVERIFY(replay[0] == "GROUP a.b.c\r\n");
+    QVERIFY(replay[1] == "STAT 3\r\n");
+
+    // the GROUP is enough for the first article
+    replay = NntpMultiplexer::getReplay("ARTICLE\r\n", sGroup, QByteArray(), "x.y.z", "7");
+    QCOMPARE(replay.size(), 1);
+    QVERIFY(replay[0] == "GROUP a.b.c\r\n");
+}
+
+void TestNntpMultiplexer::test_otherArticle(){
+    // two clients in the same group, the backend is on the article of the second one
+    QByteArray groupA, articleA, groupB, articleB, backendGroup, backendArticle;
+    NntpMultiplexer::updateState("GROUP a.b.c\r\n", "211 10 1 10 a.b.c\r\n", groupA, articleA);
+    NntpMultiplexer::updateState("NEXT\r\n", "223 3 <3@b>\r\n", groupA, articleA);
+    NntpMultiplexer::updateState("GROUP a.b.c\r\n", "211 10 1 10 a.b.c\r\n", groupB, articleB);
+    NntpMultiplexer::updateState("NEXT\r\n", "223 7 <7@b>\r\n", groupB, articleB);
+    backendGroup   = groupB;
+    backendArticle = articleB;
+
+    QList<QByteArray> replay = NntpMultiplexer::getReplay("NEXT\r\n", groupA, articleA, backendGroup, backendArticle);
+    QCOMPARE(replay.size(), 1);
+    QVERIFY(replay[0] == "STAT 3\r\n");
+}
+
+void TestNntpMultiplexer::test_firstArticle(){
+    // the first client only selected the group, the second moved the backend
+    QByteArray groupA, articleA, groupB, articleB;
+    NntpMultiplexer::updateState("GROUP a.b.c\r\n", "211 10 1 10 a.b.c\r\n", groupA, articleA);
+    NntpMultiplexer::updateState("GROUP a.b.c\r\n", "211 10 1 10 a.b.c\r\n", groupB, articleB);
+    NntpMultiplexer::updateState("NEXT\r\n", "223 7 <7@b>\r\n", groupB, articleB);
+    QVERIFY(articleA.isEmpty());
+
+    const char *cmds[] = {"NEXT\r\n", "LAST\r\n", "ARTICLE\r\n", "HEAD\r\n", "BODY\r\n"};
+    for (const char *cmd : cmds){
+        QList<QByteArray> replay = NntpMultiplexer::getReplay(cmd, groupA, articleA, groupB, articleB);
+        QCOMPARE(replay.size(), 1);
+        QVERIFY(replay[0] == "GROUP a.b.c\r\n");
+    }
+
+    // the replayed GROUP puts the backend back on the first article
+    QByteArray backendGroup = groupB, backendArticle = articleB;
+    NntpMultiplexer::updateState("GROUP a.b.c\r\n", "211 10 1 10 a.b.c\r\n", backendGroup, backendArticle);
+    QVERIFY(NntpMultiplexer::getReplay("NEXT\r\n", groupA, articleA, backendGroup, backendArticle).isEmpty());
+}
+
+void TestNntpMultiplexer::test_withArgument(){
+    // an article number or a message-id doesn't use the current article
+    QVERIFY(NntpMultiplexer::getReplay("ARTICLE 5\r\n", sGroup, QByteArray(), sGroup, "7").isEmpty());
+    QVERIFY(NntpMultiplexer::getReplay("BODY <5@b>\r\n", sGroup, "3", "x.y.z", "7").isEmpty());
+
+    QList<QByteArray> replay = NntpMultiplexer::getReplay("ARTICLE 5\r\n", sGroup, QByteArray(), "x.y.z", "7");
+    QCOMPARE(replay.size(), 1);
+    QVERIFY(replay[0] == "GROUP a.b.c\r\n");
+}
+
+void TestNntpMultiplexer::test_noGroup(){
+    // nothing to restore for a client that hasn't selected a group
+    QVERIFY(NntpMultiplexer::getReplay("NEXT\r\n", QByteArray(), QByteArray(), sGroup, "7").isEmpty());
+    QVERIFY(NntpMultiplexer::getReplay("LIST\r\n", sGroup, "3", "x.y.z", "7").isEmpty());
+}
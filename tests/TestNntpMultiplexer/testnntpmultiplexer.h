@@ -0,0 +1,25 @@
+#ifndef TESTNNTPMULTIPLEXER_H
+#define TESTNNTPMULTIPLEXER_H
+
+#include <QtTest/QtTest>
+
+#include "../../nntpmultiplexer.h"
+
+/*!
+ * \brief Tests of the replay of the state of the clients on the shared backends
+ * (the client and backend states are driven with NntpMultiplexer::updateState)
+ */
+class TestNntpMultiplexer : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void test_sameState();
+    void test_otherGroup();
+    void test_otherArticle();
+    void test_firstArticle();
+    void test_withArgument();
+    void test_noGroup();
+};
+
+#endif // TESTNNTPMULTIPLEXER_H
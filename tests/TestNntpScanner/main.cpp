@@ -0,0 +1,7 @@
+#include <QCoreApplication>
+
+#include <QtTest/QtTest>
+#include "testnntpscanner.h"
+
+QTEST_MAIN(TestNntpScanner)
+#include "moc_testnntpscanner.cpp"
@@ -0,0 +1,181 @@
+#include "testnntpscanner.h"
+#include "../../responseframer.h"
+
+#include <QBuffer>
+
+static const NntpScanner::Implementation sImplementations[] =
+    {NntpScanner::Scalar, NntpScanner::SSE2, NntpScanner::AVX2};
+
+void TestNntpScanner::initTestCase(){
+    iBody = yEncBody(750 * 1024);
+}
+
+void TestNntpScanner::cleanupTestCase(){
+    NntpScanner::init();
+}
+
+QByteArray TestNntpScanner::yEncBody(int aSize){
+    qsrand(42);
+    QByteArray body("222 0 <part1of42.abcdef@news.example>\r\n");
+    body.append("=ybegin part=1 line=128 size=768000 name=file.bin\r\n");
+    body.append("=ypart begin=1 end=768000\r\n");
+
+    QByteArray line;
+    while (body.size() < aSize){
+        uchar c = static_cast<uchar>((qrand() & 0xFF) + 42);
+        if (c == 0 || c == '\n' || c == '\r' || c == '='){
+            line.append('=');
+            c += 64;
+        }
+        line.append(static_cast<char>(c));
+        if (line.size() >= 128){
+            if (line.at(0) == '.')
+                line.prepend('.'); // dot-stuffing
+            body.append(line).append("\r\n");
+            line.clear();
+        }
+    }
+    if (!line.isEmpty())
+        body.append(line).append("\r\n");
+    body.append("=yend size=768000 part=1 pcrc32=abcdef12\r\n.\r\n");
+    return body;
+}
+
+
+void TestNntpScanner::test_findLineEnd_data(){
+    QTest::addColumn<QByteArray>("data");
+    QTest::addColumn<qint64>("pos");
+
+    QTest::newRow("empty")  << QByteArray()              << qint64(-1);
+    QTest::newRow("no eol") << QByteArray("200 ready")   << qint64(-1);
+    QTest::newRow("short")  << QByteArray("200 ok\r\n")  << qint64(7);
+    QTest::newRow("long")   << QByteArray(100, 'a').append("\r\nb\r\n") << qint64(101);
+}
+
+void TestNntpScanner::test_findLineEnd(){
+    QFETCH(QByteArray, data);
+    QFETCH(qint64, pos);
+
+    for (NntpScanner::Implementation impl : sImplementations){
+        if (!NntpScanner::setImplementation(impl))
+            continue;
+        QCOMPARE(NntpScanner::findLineEnd(data.constData(), data.size()), pos);
+    }
+}
+
+void TestNntpScanner::test_findTerminator_data(){
+    QTest::addColumn<QByteArray>("data");
+    QTest::addColumn<qint64>("pos");
+
+    QByteArray yEnc = yEncBody(10000);
+    QByteArray lines(40, 'x');
+    lines.append("\r\n..stuffed\r\n");
+    lines.append(QByteArray(30, 'y'));
+
+    QTest::newRow("empty")       << QByteArray()                    << qint64(-1);
+    QTest::newRow("terminator")  << QByteArray("\r\n.\r\n")         << qint64(5);
+    QTest::newRow("cut")         << QByteArray("body\r\n.\r")       << qint64(-1);
+    QTest::newRow("stuffed")     << lines                           << qint64(-1);
+    QTest::newRow("after stuff") << QByteArray(lines).append("\r\n.\r\nnext") << qint64(lines.size() + 5);
+    QTest::newRow("block edges") << QByteArray(14, 'z').append("\r\n.\r\n") << qint64(19);
+    QTest::newRow("yEnc")        << yEnc                            << qint64(yEnc.size());
+}
+
+void TestNntpScanner::test_findTerminator(){
+    QFETCH(QByteArray, data);
+    QFETCH(qint64, pos);
+
+    for (NntpScanner::Implementation impl : sImplementations){
+        if (!NntpScanner::setImplementation(impl))
+            continue;
+        QCOMPARE(NntpScanner::findTerminator(data.constData(), data.size()), pos);
+    }
+}
+
+void TestNntpScanner::test_implementationsAgree(){
+    // random data made of the framing chars, candidates everywhere
+    static const char chars[] = "\r\n.ab";
+    qsrand(7);
+    for (int i = 0; i < 5000; ++i){
+        QByteArray data;
+        int len = qrand() % 200;
+        for (int j = 0; j < len; ++j)
+            data.append(chars[qrand() % 5]);
+
+        int    idx      = data.indexOf("\r\n.\r\n");
+        qint64 expected = (idx == -1) ? -1 : idx + 5;
+        for (NntpScanner::Implementation impl : sImplementations){
+            if (!NntpScanner::setImplementation(impl))
+                continue;
+            QCOMPARE(NntpScanner::findTerminator(data.constData(), data.size()), expected);
+            QCOMPARE(NntpScanner::findLineEnd(data.constData(), data.size()),
+                     static_cast<qint64>(data.indexOf('\n')));
+        }
+    }
+}
+
+void TestNntpScanner::test_framerChunks(){
+    // every chunk size: the terminator (and the dot-stuffed lines) cut everywhere
+    QByteArray body = yEncBody(4000);
+    for (NntpScanner::Implementation impl : sImplementations){
+        if (!NntpScanner::setImplementation(impl))
+            continue;
+        for (int chunk = 1; chunk < 40; ++chunk){
+            ResponseFramer framer;
+            framer.addCommand("BODY <part1of42.abcdef@news.example>\r\n");
+            qint64 pos = 0;
+            while (pos < body.size() && !framer.isEndOfResponse())
+                pos += framer.scan(body.constData() + pos, qMin<qint64>(chunk, body.size() - pos));
+            QVERIFY(framer.isEndOfResponse());
+            QCOMPARE(pos, static_cast<qint64>(body.size()));
+        }
+    }
+}
+
+
+void TestNntpScanner::benchmark_readLine(){
+    QBuffer buffer(&iBody);
+    buffer.open(QIODevice::ReadOnly);
+    QBENCHMARK {
+        buffer.seek(0);
+        while (buffer.canReadLine()){
+            QByteArray line = buffer.readLine();
+            if (line == ".\r\n")
+                break;
+        }
+    }
+}
+
+void TestNntpScanner::benchmark(NntpScanner::Implementation aImpl){
+    if (!NntpScanner::setImplementation(aImpl))
+        QSKIP("not supported by the CPU");
+
+    qint64 end = 0;
+    QBENCHMARK {
+        end = NntpScanner::findTerminator(iBody.constData(), iBody.size());
+    }
+    QCOMPARE(end, static_cast<qint64>(iBody.size()));
+}
+
+void TestNntpScanner::benchmark_scalar(){
+    benchmark(NntpScanner::Scalar);
+}
+
+void TestNntpScanner::benchmark_sse2(){
+    benchmark(NntpScanner::SSE2);
+}
+
+void TestNntpScanner::benchmark_avx2(){
+    benchmark(NntpScanner::AVX2);
+}
+
+void TestNntpScanner::benchmark_framer(){
+    NntpScanner::init();
+    QBENCHMARK {
+        ResponseFramer framer;
+        framer.addCommand("BODY <part1of42.abcdef@news.example>\r\n");
+        qint64 pos = 0;
+        while (!framer.isEndOfResponse())
+            pos += framer.scan(iBody.constData() + pos, qMin<qint64>(65536, iBody.size() - pos));
+    }
+}
@@ -0,0 +1,46 @@
+#ifndef TESTNNTPSCANNER_H
+#define TESTNNTPSCANNER_H
+
+#include <QtTest/QtTest>
+
+#include "../../nntpscanner.h"
+
+/*!
+ * \brief Tests of NntpScanner and microbenchmarks of the response framing
+ * on a realistic yEnc body (750KB, 128 chars lines, some dot-stuffed ones):
+ * - readLine: the QIODevice::readLine loop the proxy was using
+ * - scalar / SSE2 / AVX2: NntpScanner::findTerminator on the whole body
+ * - framer: ResponseFramer::scan on 64KB chunks (what NntpConnection does)
+ * run with: ./testNntpScanner benchmark_readLine benchmark_scalar ...
+ * (built with -O2 and without the coverage flags of the other tests, so the timings mean something)
+ */
+class TestNntpScanner : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void test_findLineEnd_data();
+    void test_findLineEnd();
+    void test_findTerminator_data();
+    void test_findTerminator();
+    void test_implementationsAgree();
+    void test_framerChunks();
+
+    void benchmark_readLine();
+    void benchmark_scalar();
+    void benchmark_sse2();
+    void benchmark_avx2();
+    void benchmark_framer();
+
+private:
+    static QByteArray yEncBody(int aSize); //!< multi-line BODY response with a random yEnc payload
+    void benchmark(NntpScanner::Implementation aImpl);
+
+private:
+    QByteArray iBody; //!< yEnc body used by the benchmarks
+};
+
+#endif // TESTNNTPSCANNER_H
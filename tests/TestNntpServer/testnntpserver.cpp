@@ -1,6 +1,9 @@
 #include "testnntpserver.h"
 #include "../../constants_tests.h"
 
+#include <thread>
+#include <vector>
+
 void TestNntpServer::initTestCase(){
     bool init = NntpProxy::initStatics();
     std::cout << "Proxy init? " << init << "\n";
@@ -34,26 +37,63 @@ void TestNntpServer::test_getNntpConnection(){
     QVERIFY(con == Q_NULLPTR);
 }
 
-void TestNntpServer::test_getNntpConnection_noLock(){
+void TestNntpServer::test_getNntpConnection_concurrent(){
     ushort maxCon = iServer->getMaxNumberOfConnections();
 
-    iServer->mMutex.lock();
-    QVERIFY(iServer->getNumberOfConnectionsAvailable_noLock() == maxCon);
-    for (int i = 1; i <= maxCon; ++i){
-        QVERIFY(iServer->hasConnectionAvailable_noLock()==true);
-        NntpConnection * con = iServer->getNntpConnection_noLock(i);
-        QVERIFY(iServer->getNumberOfConnectionsInUse_noLock() == i);
-        QVERIFY(iServer->getNumberOfConnectionsAvailable_noLock() == maxCon - i);
-        QVERIFY(con != Q_NULLPTR);
-        QVERIFY(con->getId() == i);
+    // lock free slots: several threads getting and releasing never exceed the max
+    QAtomicInteger<int> nbInUse(0), maxInUse(0), nbFailed(0);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t){
+        threads.emplace_back([this, t, &nbInUse, &maxInUse, &nbFailed](){
+            for (int i = 0; i < 200; ++i){
+                NntpConnection *con = iServer->getNntpConnection(t * 1000 + i);
+                if (con == Q_NULLPTR){
+                    nbFailed.fetchAndAddOrdered(1);
+                    continue;
+                }
+                int inUse = nbInUse.fetchAndAddOrdered(1) + 1;
+                int max   = maxInUse.load();
+                while (inUse > max && !maxInUse.testAndSetOrdered(max, inUse, max));
+
+                nbInUse.fetchAndSubOrdered(1);
+                if (!iServer->releaseNntpConnection(con))
+                    nbFailed.fetchAndAddOrdered(1000000); // a slot lost
+                delete con;
+            }
+        });
     }
+    for (std::thread &thread : threads)
+        thread.join();
 
-    QVERIFY(iServer->hasConnectionAvailable_noLock()==false);
-    NntpConnection * con = iServer->getNntpConnection_noLock(666);
-    QVERIFY(iServer->getNumberOfConnectionsInUse_noLock() == maxCon);
-    QVERIFY(con == Q_NULLPTR);
+    QVERIFY(maxInUse.load() <= maxCon);
+    QVERIFY(nbFailed.load() < 1000000);
+    QVERIFY(iServer->getNumberOfConnectionsInUse() == 0);
+    QVERIFY(iServer->getNumberOfConnectionsAvailable() == maxCon);
+}
+
+void TestNntpServer::test_takeOverNntpConnection(){
+    ushort maxCon = iServer->getMaxNumberOfConnections();
+    QList<NntpConnection *> cons;
+    for (int i = 1; i <= maxCon; ++i)
+        cons.append(iServer->getNntpConnection(i));
+    QVERIFY(iServer->hasConnectionAvailable()==false);
+
+    // the slot goes straight to the new connection
+    NntpConnection *con = iServer->takeOverNntpConnection(42, cons.first());
+    QVERIFY(con != Q_NULLPTR);
+    QVERIFY(con->getId() == 42);
+    QVERIFY(iServer->getNumberOfConnectionsInUse() == maxCon);
+    QVERIFY(!iServer->releaseNntpConnection(cons.first()));
+    QVERIFY(iServer->takeOverNntpConnection(43, cons.first()) == Q_NULLPTR);
 
-    iServer->mMutex.unlock();
+    QVERIFY(iServer->releaseNntpConnection(con));
+    delete con;
+    for (int i = 1; i < cons.size(); ++i){
+        QVERIFY(iServer->releaseNntpConnection(cons[i]));
+        delete cons[i];
+    }
+    delete cons.first();
+    QVERIFY(iServer->getNumberOfConnectionsInUse() == 0);
 }
 
 void TestNntpServer::test_releaseNntpConnection(){
@@ -104,4 +144,41 @@ void TestNntpServer::test_canUseAllConnections_ko(){
     iServer = new NntpServer(*iParams);
 
     QVERIFY(!iServer->canUseAllConnections());
+    QVERIFY(iServer->getNumberOfIdleConnections() == 0);
+}
+
+void TestNntpServer::test_connectionPool(){
+    QVERIFY(iServer->hasConnectionPool());
+    QVERIFY(iServer->getNumberOfIdleConnections() == 0);
+
+    // the check of the connections warms up the pool
+    ushort maxCon = iServer->getMaxNumberOfConnections();
+    QVERIFY(iServer->canUseAllConnections());
+    QVERIFY(iServer->getNumberOfIdleConnections() == maxCon);
+    QVERIFY(iServer->getNumberOfConnectionsInUse() == 0);
+
+    // a pooled connection is handed out already authenticated
+    NntpConnection *con = iServer->getNntpConnection(42);
+    QVERIFY(con != Q_NULLPTR);
+    QVERIFY(con->getId() == 42);
+    QVERIFY(con->isAuthenticated());
+    QVERIFY(iServer->getNumberOfIdleConnections() == maxCon - 1);
+    QVERIFY(iServer->getNumberOfConnectionsInUse() == 1);
+
+    // and can be given back
+    QVERIFY(iServer->recycleNntpConnection(con));
+    QVERIFY(iServer->getNumberOfIdleConnections() == maxCon);
+    QVERIFY(iServer->getNumberOfConnectionsInUse() == 0);
+
+    // a connection not authenticated is not pooled
+    NntpServerParameters paramNoPool(*iParams);
+    paramNoPool.poolIdleTimeout = 0;
+    NntpServer servNoPool(paramNoPool);
+    con = servNoPool.getNntpConnection(666);
+    QVERIFY(con != Q_NULLPTR);
+    QVERIFY(!con->isAuthenticated());
+    QVERIFY(!servNoPool.recycleNntpConnection(con));
+    QVERIFY(servNoPool.getNumberOfIdleConnections() == 0);
+    QVERIFY(servNoPool.releaseNntpConnection(con));
+    delete con;
 }
@@ -19,10 +19,12 @@ private slots:
     void cleanup(); // called after each test case
 
     void test_getNntpConnection();
-    void test_getNntpConnection_noLock();
+    void test_getNntpConnection_concurrent();
+    void test_takeOverNntpConnection();
     void test_releaseNntpConnection();
     void test_canUseAllConnections_ok();
     void test_canUseAllConnections_ko();
+    void test_connectionPool();
 
 
 private:
@@ -208,3 +208,53 @@ void TestNntpServerManager::test_stealingConnections(){
     QVERIFY(iUserMgr->releaseUser(user2, *iDb));
 
 }
+
+
+void TestNntpServerManager::test_failoverOrder(){
+    NntpProxy::log("[TestNntpServerManager] ", "test_failoverOrder");
+
+    // not connected: the NntpConnections are only created
+    NntpServerParameters fillLow("fill.low.com", 119, false, "", "", 1, false, 0, 5, true);
+    NntpServerParameters primarySecond("primary.second.com", 119, false, "", "", 1, false, 0, 1);
+    NntpServerParameters fillHigh("fill.high.com", 119, false, "", "", 1, false, 0, 0, true);
+    NntpServerParameters primaryFirst("primary.first.com", 119, false, "", "", 1, false, 0, 0);
+    QVector<NntpServerParameters *> params;
+    params << &fillLow << &primarySecond << &fillHigh << &primaryFirst;
+    NntpServerManager srvMgr(params, *iUserMgr);
+
+    // the sessions only use the primary servers
+    QList<NntpConnection *> cons;
+    cons << srvMgr.getSharedNntpConnection(1) << srvMgr.getSharedNntpConnection(2);
+    QVERIFY(cons[0] != Q_NULLPTR && cons[1] != Q_NULLPTR);
+    QVERIFY(!cons[0]->getServerHost().startsWith("fill"));
+    QVERIFY(!cons[1]->getServerHost().startsWith("fill"));
+    QVERIFY(srvMgr.getSharedNntpConnection(3) == Q_NULLPTR);
+    for (NntpConnection *con : cons){
+        QVERIFY(srvMgr.releaseNntpConnection(con));
+        delete con;
+    }
+
+    // primary servers then fill ones, by priority
+    QStringList expected;
+    expected << "primary.first.com" << "primary.second.com" << "fill.high.com" << "fill.low.com";
+    QList<ushort> tried;
+    for (const QString &host : expected){
+        NntpConnection *con = srvMgr.getFailoverNntpConnection(4, tried);
+        QVERIFY(con != Q_NULLPTR);
+        QCOMPARE(con->getServerHost(), host);
+        tried.append(con->getServerId());
+        QVERIFY(srvMgr.releaseNntpConnection(con));
+        delete con;
+    }
+    QVERIFY(srvMgr.getFailoverNntpConnection(5, tried) == Q_NULLPTR);
+
+    // a busy server is skipped
+    tried.clear();
+    NntpConnection *first = srvMgr.getFailoverNntpConnection(6, tried);
+    NntpConnection *next  = srvMgr.getFailoverNntpConnection(7, tried);
+    QCOMPARE(next->getServerHost(), QString("primary.second.com"));
+    QVERIFY(srvMgr.releaseNntpConnection(first));
+    QVERIFY(srvMgr.releaseNntpConnection(next));
+    delete first;
+    delete next;
+}
@@ -29,6 +29,8 @@ private slots:
 
     void test_stealingConnections();
 
+    void test_failoverOrder();
+
 private:
     void createUserUsingAllConnections(User *aUser);
     void deleteConnections();
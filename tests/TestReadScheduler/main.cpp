@@ -0,0 +1,7 @@
+#include <QCoreApplication>
+
+#include <QtTest/QtTest>
+#include "testreadscheduler.h"
+
+QTEST_MAIN(TestReadScheduler)
+#include "moc_testreadscheduler.cpp"
@@ -0,0 +1,107 @@
+#include "testreadscheduler.h"
+
+static const qint64 sQuantum = cShapingChunk;          // burst of the tests: one grant at once
+static const qint64 sRate    = sQuantum * 100;         // a grant every 10 ms
+
+void TestReadScheduler::test_unlimited(){
+    ReadScheduler scheduler(0, 0);
+    QByteArray order;
+    ReadingConnection con(&scheduler, 1, 'a', &order, 1);
+    QVERIFY(!scheduler.isLimited());
+
+    QCOMPARE(con.take(1000000), Q_INT64_C(1000000));
+    QCOMPARE(con.take(1000000), Q_INT64_C(1000000));
+    QCOMPARE(scheduler.getNumberOfWaiting(), 0);
+
+    // what isn't read isn't counted
+    scheduler.giveBack(1000);
+    QCOMPARE(scheduler.getNumberOfBytes(), Q_UINT64_C(1999000));
+}
+
+void TestReadScheduler::test_ceiling(){
+    ReadScheduler scheduler(sRate, sQuantum);
+    QByteArray order;
+    ReadingConnection con(&scheduler, 1, 'a', &order, 1);
+    QVERIFY(scheduler.isLimited());
+
+    // the burst at once, then the connection waits (once)
+    QCOMPARE(con.take(1024 * 1024), sQuantum);
+    QCOMPARE(con.take(1024 * 1024), Q_INT64_C(0));
+    QCOMPARE(con.take(1024 * 1024), Q_INT64_C(0));
+    QCOMPARE(scheduler.getNumberOfWaiting(), 1);
+
+    QTRY_COMPARE(con.iGranted, sQuantum);
+    QCOMPARE(order, QByteArray("a"));
+    QCOMPARE(scheduler.getNumberOfWaiting(), 0);
+    QCOMPARE(scheduler.getNumberOfGrants(), Q_UINT64_C(1));
+    QCOMPARE(scheduler.getNumberOfBytes(), static_cast<quint64>(2 * sQuantum));
+}
+
+void TestReadScheduler::test_newcomerWaits(){
+    ReadScheduler scheduler(sRate, sQuantum);
+    QByteArray order;
+    ReadingConnection con1(&scheduler, 1, 'a', &order, 1), con2(&scheduler, 1, 'b', &order, 1);
+    QCOMPARE(con1.take(sQuantum), sQuantum);
+    QCOMPARE(con1.take(sQuantum), Q_INT64_C(0));
+
+    // the bucket has tokens again but they're for the connection waiting
+    scheduler.giveBack(sQuantum);
+    QCOMPARE(con2.take(1024), Q_INT64_C(0));
+    QCOMPARE(scheduler.getNumberOfWaiting(), 2);
+
+    QTRY_COMPARE(order, QByteArray("ab"));
+    QCOMPARE(scheduler.getNumberOfWaiting(), 0);
+}
+
+void TestReadScheduler::test_weightedOrder(){
+    ReadScheduler scheduler(sRate, sQuantum);
+    QByteArray order;
+    ReadingConnection a(&scheduler, 1, 'a', &order, 9), b(&scheduler, 2, 'b', &order, 9);
+    QCOMPARE(a.take(sQuantum), sQuantum);
+    QCOMPARE(a.take(sQuantum), Q_INT64_C(0));
+    QCOMPARE(b.take(sQuantum), Q_INT64_C(0));
+
+    // both ask again after each grant: b gets twice the grants of a
+    QTRY_COMPARE(order.size(), 9);
+    QCOMPARE(order, QByteArray("abbabbabb"));
+    QCOMPARE(b.iGranted, 2 * a.iGranted);
+}
+
+void TestReadScheduler::test_leave(){
+    ReadScheduler scheduler(sRate, sQuantum);
+    QByteArray order;
+    ReadingConnection con(&scheduler, 1, 'a', &order, 1);
+    QCOMPARE(con.take(sQuantum), sQuantum);
+    QCOMPARE(con.take(sQuantum), Q_INT64_C(0));
+
+    scheduler.leave(&con);
+    QCOMPARE(scheduler.getNumberOfWaiting(), 0);
+    QTest::qWait(50);
+    QCOMPARE(con.iGranted, Q_INT64_C(0));
+    QCOMPARE(scheduler.getNumberOfGrants(), Q_UINT64_C(0));
+}
+
+void TestReadScheduler::test_throughput(){
+    ReadScheduler scheduler(0, 0);
+    QByteArray order;
+    ReadingConnection con(&scheduler, 1, 'a', &order, 1);
+    qint64 start = TokenBucket::now() + 1000000;
+    scheduler.sample(start);
+    QCOMPARE(scheduler.getCurrentRate(), Q_INT64_C(0));
+
+    con.take(1024 * 1024);
+    scheduler.sample(start + TokenBucket::sNsPerSecond);
+    QCOMPARE(scheduler.getCurrentRate(), Q_INT64_C(1024 * 1024));
+    QCOMPARE(scheduler.getPeakRate(),    Q_INT64_C(1024 * 1024));
+
+    con.take(512 * 1024);
+    scheduler.sample(start + 2 * TokenBucket::sNsPerSecond);
+    QCOMPARE(scheduler.getCurrentRate(), Q_INT64_C(512 * 1024));
+    QCOMPARE(scheduler.getPeakRate(),    Q_INT64_C(1024 * 1024));
+
+    QString dump;
+    QTextStream stream(&dump);
+    scheduler.dump(stream);
+    stream.flush();
+    QVERIFY(dump.contains("throughput: 512 KB/s (peak: 1024 KB/s), ceiling: none"));
+}
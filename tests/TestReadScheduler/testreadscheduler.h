@@ -0,0 +1,48 @@
+#ifndef TESTREADSCHEDULER_H
+#define TESTREADSCHEDULER_H
+
+#include <QtTest/QtTest>
+
+#include "../../readscheduler.h"
+
+//! connection recording the grants of the ReadScheduler, it asks again till iOrder is long enough
+class ReadingConnection : public QObject
+{
+    Q_OBJECT
+
+public:
+    ReadingConnection(ReadScheduler *aScheduler, uint aWeight, char aName, QByteArray *aOrder, int aNbGrants) :
+        QObject(), iScheduler(aScheduler), iWeight(aWeight), iName(aName), iOrder(aOrder),
+        iNbGrants(aNbGrants), iGranted(0) {}
+    ReadScheduler *iScheduler;
+    uint           iWeight;
+    char           iName;
+    QByteArray    *iOrder;
+    int            iNbGrants;
+    qint64         iGranted;
+
+    qint64 take(qint64 aWanted){return iScheduler->take(this, aWanted, iWeight);}
+
+public slots:
+    void readGranted(qint64 aBytes){
+        iGranted += aBytes;
+        iOrder->append(iName);
+        if (iOrder->size() < iNbGrants)
+            take(1024 * 1024);
+    }
+};
+
+class TestReadScheduler : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void test_unlimited();
+    void test_ceiling();
+    void test_newcomerWaits();
+    void test_weightedOrder();
+    void test_leave();
+    void test_throughput();
+};
+
+#endif // TESTREADSCHEDULER_H
@@ -0,0 +1,7 @@
+#include <QCoreApplication>
+
+#include <QtTest/QtTest>
+#include "testresponseframer.h"
+
+QTEST_MAIN(TestResponseFramer)
+#include "moc_testresponseframer.cpp"
@@ -0,0 +1,128 @@
+#include "testresponseframer.h"
+#include "../../nntp.h"
+
+void TestResponseFramer::test_singleLine(){
+    ResponseFramer framer;
+    framer.addCommand("GROUP alt.test\r\n");
+
+    QByteArray resp("211 10 1 10 alt.test\r\n");
+    QVERIFY(framer.scan(resp.constData(), resp.size()) == resp.size());
+    QVERIFY(framer.isEndOfResponse());
+
+    QByteArray cmd, status;
+    qint64 size;
+    framer.takeResponse(cmd, status, size);
+    QVERIFY(cmd == "GROUP alt.test\r\n");
+    QVERIFY(status == resp);
+    QVERIFY(size == resp.size());
+    QVERIFY(framer.getNumberOfPendingCommands() == 0);
+}
+
+void TestResponseFramer::test_multiLine(){
+    ResponseFramer framer;
+    framer.addCommand("BODY <a@b>\r\n");
+
+    QByteArray resp("222 0 <a@b>\r\n=ybegin line=128\r\nsome data\r\n=yend\r\n.\r\n");
+    QVERIFY(framer.scan(resp.constData(), resp.size()) == resp.size());
+    QVERIFY(framer.isEndOfResponse());
+
+    QByteArray cmd, status;
+    qint64 size;
+    framer.takeResponse(cmd, status, size);
+    QVERIFY(status == "222 0 <a@b>\r\n");
+    QVERIFY(size == resp.size());
+}
+
+void TestResponseFramer::test_emptyBody(){
+    ResponseFramer framer;
+    framer.addCommand("LIST\r\n");
+
+    QByteArray resp("215 list follows\r\n.\r\n");
+    QVERIFY(framer.scan(resp.constData(), resp.size()) == resp.size());
+    QVERIFY(framer.isEndOfResponse());
+}
+
+void TestResponseFramer::test_dotStuffing(){
+    ResponseFramer framer;
+    framer.addCommand("BODY <a@b>\r\n");
+
+    QByteArray body("222 0 <a@b>\r\n..\r\n..not the end\r\n.\r\n");
+    QByteArray notEnd = body.left(body.size() - 3);
+    QVERIFY(framer.scan(notEnd.constData(), notEnd.size()) == notEnd.size());
+    QVERIFY(!framer.isEndOfResponse());
+
+    QVERIFY(framer.scan(".\r\n", 3) == 3);
+    QVERIFY(framer.isEndOfResponse());
+}
+
+void TestResponseFramer::test_splitTerminator(){
+    QByteArray resp("220 1 <a@b>\r\nSubject: test\r\n\r\nbody\r\n.\r\n");
+
+    // feed the response byte per byte: the terminator spans all the chunks
+    ResponseFramer framer;
+    framer.addCommand("ARTICLE 1\r\n");
+    for (int i = 0; i < resp.size(); ++i){
+        QVERIFY(framer.scan(resp.constData() + i, 1) == 1);
+        QVERIFY(framer.isEndOfResponse() == (i == resp.size() - 1));
+    }
+}
+
+void TestResponseFramer::test_pipelinedResponses(){
+    ResponseFramer framer;
+    framer.addCommand("STAT 1\r\n");
+    framer.addCommand("HEAD 1\r\n");
+    framer.addCommand("DATE\r\n");
+
+    QByteArray stat("223 1 <a@b>\r\n");
+    QByteArray head("221 1 <a@b>\r\nSubject: test\r\n.\r\n");
+    QByteArray date("111 20180101000000\r\n");
+    QByteArray all = stat + head + date;
+
+    QByteArray cmd, status;
+    qint64 size, pos = 0;
+
+    pos += framer.scan(all.constData() + pos, all.size() - pos);
+    QVERIFY(pos == stat.size() && framer.isEndOfResponse());
+    framer.takeResponse(cmd, status, size);
+    QVERIFY(cmd == "STAT 1\r\n");
+
+    pos += framer.scan(all.constData() + pos, all.size() - pos);
+    QVERIFY(pos == stat.size() + head.size() && framer.isEndOfResponse());
+    framer.takeResponse(cmd, status, size);
+    QVERIFY(cmd == "HEAD 1\r\n" && size == head.size());
+
+    pos += framer.scan(all.constData() + pos, all.size() - pos);
+    QVERIFY(pos == all.size() && framer.isEndOfResponse());
+    framer.takeResponse(cmd, status, size);
+    QVERIFY(cmd == "DATE\r\n" && status == date);
+}
+
+void TestResponseFramer::test_noPendingCommand(){
+    ResponseFramer framer;
+    QByteArray msg("400 idle timeout\r\n");
+    QVERIFY(framer.scan(msg.constData(), msg.size()) == msg.size());
+    QVERIFY(!framer.isEndOfResponse());
+    QVERIFY(!framer.hasResponseStarted());
+}
+
+void TestResponseFramer::test_splitStatusLine(){
+    ResponseFramer framer;
+    framer.addCommand("BODY <a@b>\r\n");
+    QVERIFY(!framer.isStatusLineRead());
+
+    // a 430 cut in the middle of its status line
+    QVERIFY(framer.scan("43", 2) == 2);
+    QVERIFY(!framer.isStatusLineRead());
+    QVERIFY(!framer.isEndOfResponse());
+
+    QVERIFY(framer.scan("0 no such article\r\n", 20) == 20);
+    QVERIFY(framer.isStatusLineRead());
+    QVERIFY(framer.isEndOfResponse());
+    QVERIFY(framer.getStatusLine() == "430 no such article\r\n");
+
+    QByteArray cmd, status;
+    qint64 size;
+    framer.takeResponse(cmd, status, size);
+    QVERIFY(!framer.isStatusLineRead());
+    QVERIFY(size == 22);
+}
@@ -0,0 +1,23 @@
+#ifndef TESTRESPONSEFRAMER_H
+#define TESTRESPONSEFRAMER_H
+
+#include <QtTest/QtTest>
+
+#include "../../responseframer.h"
+
+class TestResponseFramer : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void test_singleLine();
+    void test_multiLine();
+    void test_emptyBody();
+    void test_dotStuffing();
+    void test_splitTerminator();
+    void test_pipelinedResponses();
+    void test_noPendingCommand();
+    void test_splitStatusLine();
+};
+
+#endif // TESTRESPONSEFRAMER_H
@@ -0,0 +1,7 @@
+#include <QCoreApplication>
+
+#include <QtTest/QtTest>
+#include "testringbuffer.h"
+
+QTEST_MAIN(TestRingBuffer)
+#include "moc_testringbuffer.cpp"
@@ -0,0 +1,57 @@
+#include "testringbuffer.h"
+
+#include <cstring>
+
+void TestRingBuffer::test_capacity(){
+    RingBuffer ring(1000);
+    QVERIFY(ring.getCapacity() == 1024);
+    QVERIFY(ring.isEmpty());
+    QVERIFY(ring.getFreeSize() == 1024);
+    QVERIFY(ring.getWritableContiguous() == 1024);
+}
+
+void TestRingBuffer::test_writeRead(){
+    RingBuffer ring(16);
+
+    memcpy(ring.getWritePtr(), "0123456789", 10);
+    ring.commit(10);
+    QVERIFY(ring.size() == 10);
+    QVERIFY(ring.getReadableContiguous() == 10);
+    QVERIFY(memcmp(ring.getReadPtr(), "0123", 4) == 0);
+
+    ring.consume(4);
+    QVERIFY(ring.size() == 6);
+    QVERIFY(memcmp(ring.getReadPtr(), "456789", 6) == 0);
+
+    // emptied: we restart at the beginning of the buffer
+    ring.consume(6);
+    QVERIFY(ring.isEmpty());
+    QVERIFY(ring.getWritableContiguous() == 16);
+}
+
+void TestRingBuffer::test_wrapAround(){
+    RingBuffer ring(16);
+
+    memcpy(ring.getWritePtr(), "abcdefghijkl", 12);
+    ring.commit(12);
+    ring.consume(8);
+
+    // only the end of the buffer is contiguous
+    QVERIFY(ring.getWritableContiguous() == 4);
+    memcpy(ring.getWritePtr(), "mnop", 4);
+    ring.commit(4);
+    QVERIFY(ring.getWritableContiguous() == 8);
+    memcpy(ring.getWritePtr(), "qrstuvwx", 8);
+    ring.commit(8);
+    QVERIFY(ring.isFull());
+    QVERIFY(ring.getWritableContiguous() == 0);
+
+    // reading takes two chunks
+    QVERIFY(ring.getReadableContiguous() == 8);
+    QVERIFY(memcmp(ring.getReadPtr(), "ijklmnop", 8) == 0);
+    ring.consume(8);
+    QVERIFY(ring.getReadableContiguous() == 8);
+    QVERIFY(memcmp(ring.getReadPtr(), "qrstuvwx", 8) == 0);
+    ring.consume(8);
+    QVERIFY(ring.isEmpty());
+}
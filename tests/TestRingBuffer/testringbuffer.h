@@ -0,0 +1,18 @@
+#ifndef TESTRINGBUFFER_H
+#define TESTRINGBUFFER_H
+
+#include <QtTest/QtTest>
+
+#include "../../ringbuffer.h"
+
+class TestRingBuffer : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void test_capacity();
+    void test_writeRead();
+    void test_wrapAround();
+};
+
+#endif // TESTRINGBUFFER_H
@@ -0,0 +1,7 @@
+#include <QCoreApplication>
+
+#include <QtTest/QtTest>
+#include "testserverscore.h"
+
+QTEST_MAIN(TestServerScore)
+#include "moc_testserverscore.cpp"
@@ -0,0 +1,59 @@
+#include "testserverscore.h"
+
+void TestServerScore::test_notMeasured(){
+    ServerScore score;
+    QCOMPARE(score.getConnectTime(),   -1.);
+    QCOMPARE(score.getFirstByteTime(), -1.);
+    QCOMPARE(score.getThroughput(),    -1.);
+    QCOMPARE(score.getExpectedTime(),  -1.);
+}
+
+void TestServerScore::test_ewma(){
+    // the first sample is the average
+    QCOMPARE(ServerScore::addSample(-1, 100), 100.);
+    QCOMPARE(ServerScore::addSample(100, 200), 100 + cScoreEwmaAlpha * 100);
+
+    // converges to a stable value
+    double average = -1;
+    for (int i = 0; i < 100; ++i)
+        average = ServerScore::addSample(average, i < 50 ? 1000 : 10);
+    QVERIFY(qAbs(average - 10) < 0.1);
+
+    ServerScore score;
+    score.addConnectTime(50);
+    score.addConnectTime(150);
+    QCOMPARE(score.getConnectTime(), 50 + cScoreEwmaAlpha * 100);
+}
+
+void TestServerScore::test_smallTransfer(){
+    ServerScore score;
+    score.addTransfer(cScoreMinTransferSize - 1, 1);
+    QCOMPARE(score.getThroughput(), -1.);
+
+    score.addTransfer(1024 * 1024, 1000);
+    QCOMPARE(score.getThroughput(), 1024. * 1024);
+
+    score.addTransfer(1024 * 1024, 0); // no division by 0
+    QVERIFY(score.getThroughput() > 1024. * 1024);
+}
+
+void TestServerScore::test_expectedTime(){
+    ServerScore fast, slow;
+    fast.addFirstByteTime(10);
+    fast.addTransfer(cScoreArticleSize, 100);
+    slow.addFirstByteTime(30);
+    slow.addTransfer(cScoreArticleSize, 300);
+
+    QCOMPARE(fast.getExpectedTime(), 110.);
+    QCOMPARE(slow.getExpectedTime(), 330.);
+
+    // latency only
+    ServerScore latency;
+    latency.addFirstByteTime(20);
+    QCOMPARE(latency.getExpectedTime(), 20.);
+
+    // never 0: the weights are ratios
+    ServerScore local;
+    local.addFirstByteTime(0);
+    QCOMPARE(local.getExpectedTime(), 1.);
+}
@@ -0,0 +1,19 @@
+#ifndef TESTSERVERSCORE_H
+#define TESTSERVERSCORE_H
+
+#include <QtTest/QtTest>
+
+#include "../../serverscore.h"
+
+class TestServerScore : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void test_notMeasured();
+    void test_ewma();
+    void test_smallTransfer();
+    void test_expectedTime();
+};
+
+#endif // TESTSERVERSCORE_H
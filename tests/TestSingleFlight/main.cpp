@@ -0,0 +1,7 @@
+#include <QCoreApplication>
+
+#include <QtTest/QtTest>
+#include "testsingleflight.h"
+
+QTEST_MAIN(TestSingleFlight)
+#include "moc_testsingleflight.cpp"
@@ -0,0 +1,128 @@
+#include "testsingleflight.h"
+
+void TestSingleFlight::test_leadFollow(){
+    SingleFlight flights;
+    FlightReader reader;
+
+    QVERIFY(flights.follow("B<a@b>", &reader) == Q_NULLPTR);
+    QVERIFY(!flights.isInFlight("B<a@b>"));
+
+    Flight *flight = flights.lead("B<a@b>");
+    QVERIFY(flight != Q_NULLPTR);
+    QVERIFY(flights.isInFlight("B<a@b>"));
+    QVERIFY(flights.lead("B<a@b>") == Q_NULLPTR);  // already in flight
+    QVERIFY(flights.lead("A<a@b>") != Q_NULLPTR);  // not the same response
+
+    Flight *followed = flights.follow("B<a@b>", &reader);
+    QVERIFY(followed == flight);
+    QVERIFY(flights.getNumberOfLeads() == 2);
+    QVERIFY(flights.getNumberOfFollows() == 1);
+
+    flight->finish(true);
+    QVERIFY(!flights.isInFlight("B<a@b>"));
+    QVERIFY(flights.getNumberOfFlights() == 1);
+
+    followed->removeReader(&reader);
+    followed->deref();
+    flight->deref();
+}
+
+void TestSingleFlight::test_read(){
+    SingleFlight flights;
+    FlightReader reader;
+
+    Flight *flight = flights.lead("B<a@b>");
+    flight->append("222 0 <a@b>\r\n", 14);
+
+    // a late reader gets the response from its start
+    Flight *followed = flights.follow("B<a@b>", &reader);
+    QCoreApplication::processEvents();
+    QVERIFY(reader.iNbUpdates == 1);
+
+    qint64 offset = 0;
+    QByteArray data;
+    QVERIFY(followed->read(&reader, offset, data) == Flight::InProgress);
+    QVERIFY(data == "222 0 <a@b>\r\n");
+    QVERIFY(offset == 14);
+
+    // one notification pending at most
+    flight->append("line1\r\n", 7);
+    flight->append(".\r\n", 3);
+    QCoreApplication::processEvents();
+    QVERIFY(reader.iNbUpdates == 2);
+
+    flight->finish(true);
+    flight->deref();
+
+    data.clear();
+    QVERIFY(followed->read(&reader, offset, data) == Flight::Done);
+    QVERIFY(data == "line1\r\n.\r\n");
+    QVERIFY(offset == 24);
+
+    followed->removeReader(&reader);
+    followed->deref();
+}
+
+void TestSingleFlight::test_failed(){
+    SingleFlight flights;
+    FlightReader reader;
+
+    Flight *flight   = flights.lead("B<a@b>");
+    Flight *followed = flights.follow("B<a@b>", &reader);
+    flight->finish(false); // connection lost
+    flight->deref();
+    QVERIFY(!flights.isInFlight("B<a@b>"));
+
+    qint64 offset = 0;
+    QByteArray data;
+    QVERIFY(followed->read(&reader, offset, data) == Flight::Failed);
+    QVERIFY(offset == 0);
+
+    followed->removeReader(&reader);
+    followed->deref();
+}
+
+void TestSingleFlight::test_tooBig(){
+    SingleFlight flights;
+    FlightReader reader;
+
+    Flight *flight = flights.lead("B<a@b>");
+    QByteArray chunk(1048576, 'x');
+    for (int i = 0; i <= cArticleCacheMaxArticle / chunk.size(); ++i)
+        flight->append(chunk.constData(), chunk.size());
+
+    // nobody was reading it: it's not kept nor joinable anymore
+    QVERIFY(!flights.isInFlight("B<a@b>"));
+    QVERIFY(flights.follow("B<a@b>", &reader) == Q_NULLPTR);
+
+    flight->finish(true);
+    flight->deref();
+}
+
+void TestSingleFlight::test_severalReads(){
+    SingleFlight flights;
+    FlightReader reader;
+
+    // a multiplexer reads the same flight for two of its clients
+    Flight *flight = flights.lead("B<a@b>");
+    Flight *read1  = flights.follow("B<a@b>", &reader);
+    Flight *read2  = flights.follow("B<a@b>", &reader);
+    QCoreApplication::processEvents();
+    QVERIFY(reader.iNbUpdates == 1);
+
+    qint64 offset = 0;
+    QByteArray data;
+    read1->read(&reader, offset, data);
+    read1->removeReader(&reader);
+    read1->deref();
+
+    // still notified for the second client
+    flight->append("222 0 <a@b>\r\n", 14);
+    QCoreApplication::processEvents();
+    QVERIFY(reader.iNbUpdates == 2);
+
+    flight->finish(true);
+    flight->deref();
+    read2->removeReader(&reader);
+    read2->deref();
+}
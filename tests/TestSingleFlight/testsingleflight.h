@@ -0,0 +1,33 @@
+#ifndef TESTSINGLEFLIGHT_H
+#define TESTSINGLEFLIGHT_H
+
+#include <QtTest/QtTest>
+
+#include "../../singleflight.h"
+
+//! reader of a Flight counting its notifications
+class FlightReader : public QObject
+{
+    Q_OBJECT
+
+public:
+    FlightReader() : QObject(), iNbUpdates(0) {}
+    int iNbUpdates;
+
+public slots:
+    void flightUpdated(){++iNbUpdates;}
+};
+
+class TestSingleFlight : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void test_leadFollow();
+    void test_read();
+    void test_failed();
+    void test_tooBig();
+    void test_severalReads();
+};
+
+#endif // TESTSINGLEFLIGHT_H
@@ -0,0 +1,7 @@
+#include <QCoreApplication>
+
+#include <QtTest/QtTest>
+#include "testtokenbucket.h"
+
+QTEST_MAIN(TestTokenBucket)
+#include "moc_testtokenbucket.cpp"
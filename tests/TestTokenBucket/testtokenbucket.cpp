@@ -0,0 +1,138 @@
+#include "testtokenbucket.h"
+
+#include <thread>
+#include <vector>
+
+static const qint64 sRate  = 1000000; // 1 byte per us
+static const qint64 sBurst = 100000;  // 100 ms
+static const qint64 sStart = TokenBucket::sNsPerSecond;
+
+void TestTokenBucket::test_unlimited(){
+    TokenBucket bucket(0, sBurst);
+    qint64 delay = -1;
+    QVERIFY(!bucket.isLimited());
+    QCOMPARE(bucket.take(123456789, sStart, delay), Q_INT64_C(123456789));
+    QCOMPARE(delay, Q_INT64_C(0));
+    QCOMPARE(bucket.getNumberOfBytes(), Q_UINT64_C(123456789));
+
+    // what isn't read isn't counted
+    bucket.giveBack(89);
+    QCOMPARE(bucket.getNumberOfBytes(), Q_UINT64_C(123456700));
+}
+
+void TestTokenBucket::test_burst(){
+    TokenBucket bucket(sRate, sBurst);
+    qint64 delay = -1;
+    QVERIFY(bucket.isLimited());
+
+    // an idle bucket gives its burst at once, then nothing
+    QCOMPARE(bucket.take(1000000, sStart, delay), sBurst);
+    QCOMPARE(delay, Q_INT64_C(0));
+    QCOMPARE(bucket.take(1000000, sStart, delay), Q_INT64_C(0));
+    QVERIFY(delay > 0);
+
+    // a long idle period doesn't give more than the burst
+    QCOMPARE(bucket.take(1000000, sStart + 10 * TokenBucket::sNsPerSecond, delay), sBurst);
+    QCOMPARE(bucket.getNumberOfBytes(), static_cast<quint64>(2 * sBurst));
+}
+
+void TestTokenBucket::test_delay(){
+    TokenBucket bucket(sRate, sBurst);
+    qint64 delay = 0;
+    QCOMPARE(bucket.take(sBurst, sStart, delay), sBurst);
+
+    // the next grant is a chunk: 16384 bytes at 1 byte per us
+    QCOMPARE(bucket.take(1000000, sStart, delay), Q_INT64_C(0));
+    QCOMPARE(delay, cShapingChunk * 1000);
+    QCOMPARE(bucket.take(1000000, sStart + delay - 1000, delay), Q_INT64_C(0));
+    QCOMPARE(delay, Q_INT64_C(1000));
+    QCOMPARE(bucket.take(1000000, sStart + cShapingChunk * 1000, delay), cShapingChunk);
+}
+
+void TestTokenBucket::test_smallWanted(){
+    TokenBucket bucket(sRate, sBurst);
+    qint64 delay = 0;
+    QCOMPARE(bucket.take(sBurst, sStart, delay), sBurst);
+
+    // less than a chunk is granted as soon as it is available
+    QCOMPARE(bucket.take(100, sStart + 50000, delay), Q_INT64_C(0));
+    QCOMPARE(delay, Q_INT64_C(50000));
+    QCOMPARE(bucket.take(100, sStart + 100000, delay), Q_INT64_C(100));
+}
+
+void TestTokenBucket::test_giveBack(){
+    TokenBucket bucket(sRate, sBurst);
+    qint64 delay = 0;
+    QCOMPARE(bucket.take(sBurst, sStart, delay), sBurst);
+    QCOMPARE(bucket.take(sBurst, sStart, delay), Q_INT64_C(0));
+
+    bucket.giveBack(cShapingChunk);
+    QCOMPARE(bucket.getNumberOfBytes(), static_cast<quint64>(sBurst - cShapingChunk));
+    QCOMPARE(bucket.take(sBurst, sStart, delay), cShapingChunk);
+    QCOMPARE(bucket.getNumberOfBytes(), static_cast<quint64>(sBurst));
+}
+
+void TestTokenBucket::test_charge(){
+    TokenBucket bucket(sRate, sBurst);
+    qint64 delay = 0;
+
+    // within the burst: no debt
+    QCOMPARE(bucket.charge(sBurst, sStart), Q_INT64_C(0));
+
+    // 50 ms ahead of the burst: nothing before they're paid back
+    QCOMPARE(bucket.charge(50000, sStart), Q_INT64_C(50000000));
+    QCOMPARE(bucket.take(1000000, sStart + 50000000, delay), Q_INT64_C(0));
+    QCOMPARE(bucket.take(1000000, sStart + 50000000 + cShapingChunk * 1000, delay), cShapingChunk);
+    QCOMPARE(bucket.getNumberOfBytes(), static_cast<quint64>(sBurst + 50000 + cShapingChunk));
+
+    // unlimited: only counted
+    TokenBucket unlimited(0, sBurst);
+    QCOMPARE(unlimited.charge(sBurst * 10, sStart), Q_INT64_C(0));
+    QCOMPARE(unlimited.getNumberOfBytes(), static_cast<quint64>(sBurst * 10));
+}
+
+void TestTokenBucket::test_setRate(){
+    TokenBucket bucket(sRate, sBurst);
+    qint64 delay = 0;
+    QCOMPARE(bucket.take(sBurst, sStart, delay), sBurst);
+
+    bucket.setRate(0, 0);
+    QVERIFY(!bucket.isLimited());
+    QCOMPARE(bucket.take(sBurst, sStart, delay), sBurst);
+
+    // back to a limit, with a smaller burst than the chunk
+    bucket.setRate(2 * sRate, 1000);
+    QCOMPARE(bucket.getRate(), 2 * sRate);
+    QCOMPARE(bucket.getBurst(), Q_INT64_C(1000));
+    QCOMPARE(bucket.take(sBurst, sStart + TokenBucket::sNsPerSecond, delay), Q_INT64_C(1000));
+    QCOMPARE(bucket.take(sBurst, sStart + TokenBucket::sNsPerSecond, delay), Q_INT64_C(0));
+    QCOMPARE(delay, Q_INT64_C(500000)); // 1000 bytes at 2 bytes per us
+}
+
+void TestTokenBucket::test_throttledTime(){
+    TokenBucket bucket(sRate, sBurst);
+    QCOMPARE(bucket.getThrottledTime(), Q_INT64_C(0));
+    bucket.addThrottledTime(1000);
+    bucket.addThrottledTime(500);
+    QCOMPARE(bucket.getThrottledTime(), Q_INT64_C(1500));
+}
+
+void TestTokenBucket::test_concurrent(){
+    TokenBucket bucket(sRate, sBurst);
+
+    // lock free: several threads taking at the same time never get more than the burst
+    QAtomicInteger<qint64> nbGranted(0);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t){
+        threads.emplace_back([&bucket, &nbGranted](){
+            qint64 delay = 0, granted = 0;
+            while ((granted = bucket.take(1000, sStart, delay)) > 0)
+                nbGranted.fetchAndAddOrdered(granted);
+        });
+    }
+    for (std::thread &thread : threads)
+        thread.join();
+
+    QCOMPARE(nbGranted.load(), sBurst);
+    QCOMPARE(bucket.getNumberOfBytes(), static_cast<quint64>(sBurst));
+}
@@ -0,0 +1,24 @@
+#ifndef TESTTOKENBUCKET_H
+#define TESTTOKENBUCKET_H
+
+#include <QtTest/QtTest>
+
+#include "../../tokenbucket.h"
+
+class TestTokenBucket : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void test_unlimited();
+    void test_burst();
+    void test_delay();
+    void test_smallWanted();
+    void test_giveBack();
+    void test_charge();
+    void test_setRate();
+    void test_throttledTime();
+    void test_concurrent();
+};
+
+#endif // TESTTOKENBUCKET_H
@@ -23,7 +23,8 @@ SOURCES += main.cpp \
     ../../connection.cpp \
     ../../inputconnection.cpp \
     ../../log.cpp \
-    ../../mythread.cpp \
+    ../../worker.cpp \
+    ../../workermanager.cpp \
     ../../nntp.cpp \
     ../../nntpconnection.cpp \
     ../../nntpproxy.cpp \
@@ -33,7 +34,27 @@ SOURCES += main.cpp \
     ../../sessionmanager.cpp \
     ../../usermanager.cpp \
     ../../database.cpp \
-    ../../mycrypt.cpp
+    ../../mycrypt.cpp \
+    ../../nntplistener.cpp \
+    ../../nntpmultiplexer.cpp \
+    ../../responseframer.cpp \
+    ../../ringbuffer.cpp \
+    ../../nntpscanner.cpp \
+    ../../articlecache.cpp \
+    ../../articlestore.cpp \
+    ../../countminsketch.cpp \
+    ../../spacesaving.cpp \
+    ../../hottracker.cpp \
+    ../../monitoringserver.cpp \
+    ../../singleflight.cpp \
+    ../../failover.cpp \
+    ../../bloomfilter.cpp \
+    ../../serverscore.cpp \
+    ../../fairsharescheduler.cpp \
+    ../../admissionqueue.cpp \
+    ../../tokenbucket.cpp \
+    ../../bandwidthshaper.cpp \
+    ../../readscheduler.cpp
 
 HEADERS += \
     ../../user.h \
@@ -44,7 +65,8 @@ HEADERS += \
     ../../inputconnection.h \
     ../../log.h \
     ../../mymanager.h \
-    ../../mythread.h \
+    ../../worker.h \
+    ../../workermanager.h \
     ../../nntp.h \
     ../../nntpconnection.h \
     ../../nntpproxy.h \
@@ -54,5 +76,25 @@ HEADERS += \
     ../../sessionmanager.h \
     ../../usermanager.h \
     ../../database.h \
-    ../../mycrypt.h
+    ../../mycrypt.h \
+    ../../nntplistener.h \
+    ../../nntpmultiplexer.h \
+    ../../responseframer.h \
+    ../../ringbuffer.h \
+    ../../nntpscanner.h \
+    ../../articlecache.h \
+    ../../articlestore.h \
+    ../../countminsketch.h \
+    ../../spacesaving.h \
+    ../../hottracker.h \
+    ../../monitoringserver.h \
+    ../../singleflight.h \
+    ../../failover.h \
+    ../../bloomfilter.h \
+    ../../serverscore.h \
+    ../../fairsharescheduler.h \
+    ../../admissionqueue.h \
+    ../../tokenbucket.h \
+    ../../bandwidthshaper.h \
+    ../../readscheduler.h
 
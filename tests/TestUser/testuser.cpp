@@ -1,6 +1,9 @@
 #include "testuser.h"
 #include "../../nntpproxy.h"
 
+#include <thread>
+#include <vector>
+
 void TestUser::initTestCase(){
     NntpProxy::initStatics();
 }
@@ -120,3 +123,32 @@ void TestUser::getSetOfNntpServerOrderedByNumberOfConnections()
         ++index;
     }
 }
+
+
+void TestUser::concurrentCounters(){
+    const int nbThreads = 4, nbLoops = 10000;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < nbThreads; ++t){
+        threads.emplace_back([this, t, nbLoops](){
+            ushort servId = 10 + t % 2;
+            for (int i = 0; i < nbLoops; ++i){
+                iUser->newInputConnection();
+                iUser->newNntpConnection(servId);
+                iUser->addDownloadSize(1);
+                QVERIFY(iUser->delNntpConnection(servId));
+                iUser->delInputConnection();
+            }
+            iUser->newNntpConnection(servId);
+        });
+    }
+    for (std::thread &thread : threads)
+        thread.join();
+
+    QVERIFY(iUser->getNumberOfInputConnection() == 6);
+    QVERIFY(iUser->getDownloadedSize() == static_cast<ulong>(nbThreads * nbLoops));
+    QCOMPARE(iUser->str(), QString("User #0: mb@127.0.0.1 (in: 6, out: 10) {serv: 1. cons: 1} {serv: 2. cons: 3} {serv: 3. cons: 2} {serv: 10. cons: 2} {serv: 11. cons: 2} "));
+
+    // a server sharing the slot of another one doesn't release its connections
+    QVERIFY(!iUser->delNntpConnection(10 + cMaxNntpServers));
+    QVERIFY(iUser->hasConnectionWithServer_noLock(10));
+}
@@ -22,6 +22,7 @@ private slots:
     void nntpConnections();
     void hasConnectionWithServer();
     void getSetOfNntpServerOrderedByNumberOfConnections();
+    void concurrentCounters();
 
     void init(); // called before each test case
     void cleanup(); // called after each test case
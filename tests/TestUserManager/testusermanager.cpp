@@ -88,30 +88,30 @@ void TestUserManager::test_blockUser(){
 }
 
 
-void TestUserManager::test_userWithTooMuchConnection(){
-    // Add user john with 1 Nntp connection
+void TestUserManager::test_findAfterErase()
+{
+    User * mb   = iUserMgr->addUser("127.0.0.1", "mb");
     User * john = iUserMgr->addUser("127.0.0.254", "john");
-    john->newNntpConnection(0);
-    QCOMPARE(john->str(), QString("User #0: john@127.0.0.254 (in: 1, out: 1) {serv: 0. cons: 1} "));
-    QVERIFY(iUserMgr->size() == 1);
+    User * bob  = iUserMgr->addUser("127.0.0.254", "bob");
+    QVERIFY(iUserMgr->size() == 3);
 
-    // Add user mb with 3 Nntp connections
-    User * mb = iUserMgr->addUser("127.0.0.1", "mb");
-    mb->newNntpConnection(0);
-    mb->newNntpConnection(0);
-    mb->newNntpConnection(0);
-    QCOMPARE(mb->str(), QString("User #0: mb@127.0.0.1 (in: 1, out: 3) {serv: 0. cons: 3} "));
+    // mb leaves, bob (the last one) takes its place in the list
+    QVERIFY(iUserMgr->releaseUser(mb, *iDb));
     QVERIFY(iUserMgr->size() == 2);
+    QVERIFY(iUserMgr->find(User::makeId("127.0.0.1", "mb")) == Q_NULLPTR);
+    QVERIFY(iUserMgr->find(User::makeId("127.0.0.254", "john")) == john);
+    QVERIFY(iUserMgr->find(User::makeId("127.0.0.254", "bob")) == bob);
+    QVERIFY(iUserMgr->find(User::makeId("127.0.0.1", "bob")) == Q_NULLPTR);
 
-    // Add user bob with 2 Nntp connections
-    User * bob = iUserMgr->addUser("127.0.0.254", "bob");
-    bob->newNntpConnection(0);
-    bob->newNntpConnection(0);
-    QCOMPARE(bob->str(), QString("User #0: bob@127.0.0.254 (in: 1, out: 2) {serv: 0. cons: 2} "));
-    QVERIFY(iUserMgr->size() == 3);
+    // the index still gives back the existing users
+    QVERIFY(iUserMgr->addUser("127.0.0.254", "bob") == bob);
+    QVERIFY(iUserMgr->size() == 2);
+    QCOMPARE(bob->str(), QString("User #0: bob@127.0.0.254 (in: 2, out: 0) "));
 
-    User *userWithTooManyCon = iUserMgr->getUserHavingTooMuchNntpConnection_noLock(1);
-    QVERIFY(userWithTooManyCon == mb);
+    // and a new one goes at the end
+    User * mb2 = iUserMgr->addUser("127.0.0.1", "mb");
+    QVERIFY(iUserMgr->size() == 3);
+    QVERIFY(iUserMgr->find(User::makeId("127.0.0.1", "mb")) == mb2);
 }
 
 
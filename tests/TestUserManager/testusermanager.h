@@ -24,11 +24,10 @@ private slots:
 
     void test_adduser();
     void test_releaseUser();
+    void test_findAfterErase();
 
     void test_blockUser();
 
-    void test_userWithTooMuchConnection();
-
     void initTestCase(); // Called once before the test cases
     void cleanupTestCase(); // Called once after all test cases
 
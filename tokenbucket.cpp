@@ -0,0 +1,84 @@
+#include "tokenbucket.h"
+
+#include <QElapsedTimer>
+
+TokenBucket::TokenBucket(qint64 aRate, qint64 aBurst):
+    iRate(aRate > 0 ? aRate : 0), iBurst(aBurst > 0 ? aBurst : cShapingChunk),
+    iTat(0), iNbBytes(0), iThrottled(0)
+{}
+
+static QElapsedTimer startClock(){
+    QElapsedTimer clock;
+    clock.start();
+    return clock;
+}
+
+qint64 TokenBucket::now(){
+    static const QElapsedTimer sClock = startClock(); // thread safe initialization (C++11)
+    return sClock.nsecsElapsed();
+}
+
+qint64 TokenBucket::take(qint64 aWanted, qint64 aNow, qint64 &aDelay){
+    aDelay = 0;
+    qint64 rate = iRate.load();
+    if (rate <= 0 || aWanted <= 0){
+        iNbBytes.fetchAndAddRelaxed(aWanted > 0 ? aWanted : 0);
+        return aWanted;
+    }
+
+    qint64 burst     = iBurst.load();
+    qint64 burstTime = getDuration(burst, rate);
+    qint64 minGrant  = qMin(qMin(aWanted, cShapingChunk), burst);
+    while (true) {
+        qint64 tat   = iTat.load();
+        qint64 start = qMax(tat, aNow);
+        qint64 avail = (aNow + burstTime - start) * rate / sNsPerSecond;
+        if (avail < minGrant){
+            aDelay = start + getDuration(minGrant, rate) - burstTime - aNow;
+            if (aDelay < 1)
+                aDelay = 1;
+            return 0;
+        }
+
+        qint64 granted = qMin(aWanted, avail);
+        if (iTat.testAndSetOrdered(tat, start + getDuration(granted, rate))){
+            iNbBytes.fetchAndAddRelaxed(granted);
+            return granted;
+        }
+    }
+}
+
+void TokenBucket::giveBack(qint64 aBytes){
+    if (aBytes <= 0)
+        return;
+
+    iNbBytes.fetchAndSubRelaxed(aBytes); // what is read through an unlimited bucket is counted too
+    qint64 rate = iRate.load();
+    if (rate > 0)
+        iTat.fetchAndSubOrdered(getDuration(aBytes, rate));
+}
+
+qint64 TokenBucket::charge(qint64 aBytes, qint64 aNow){
+    if (aBytes <= 0)
+        return 0;
+
+    iNbBytes.fetchAndAddRelaxed(aBytes);
+    qint64 rate = iRate.load();
+    if (rate <= 0)
+        return 0;
+
+    qint64 duration = getDuration(aBytes, rate);
+    while (true) {
+        qint64 tat = iTat.load();
+        qint64 next = qMax(tat, aNow) + duration;
+        if (iTat.testAndSetOrdered(tat, next)){
+            qint64 delay = next - getDuration(iBurst.load(), rate) - aNow;
+            return delay > 0 ? delay : 0;
+        }
+    }
+}
+
+void TokenBucket::setRate(qint64 aRate, qint64 aBurst){
+    iBurst.store(aBurst > 0 ? aBurst : cShapingChunk);
+    iRate.store(aRate > 0 ? aRate : 0);
+}
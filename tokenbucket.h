@@ -0,0 +1,86 @@
+#ifndef TOKENBUCKET_H
+#define TOKENBUCKET_H
+
+#include "constants.h"
+
+#include <QAtomicInteger>
+
+/*!
+ * \brief Token bucket limiting a flow of bytes to a rate with a burst (Thread_Safe, lock free)
+ * - kept as the theoretical arrival time of the next byte (GCRA): a single atomic
+ *   updated by compare and swap, whatever the number of sessions sharing the bucket
+ * - the bytes of an interval of aNow are available if the bucket isn't more than the burst ahead
+ * - a rate of 0 means unlimited (take grants everything without touching the state)
+ * - the rate and the burst can be changed at any time (setRate)
+ * - counts the bytes granted and the time the flows have been throttled
+ * - times in ns, from now() or given by the caller (tests)
+ */
+class TokenBucket
+{
+public:
+    /*!
+     * \brief TokenBucket constructor
+     * \param aRate  : bytes per second (0: unlimited)
+     * \param aBurst : bytes that can be taken at once after an idle period
+     */
+    explicit TokenBucket(qint64 aRate, qint64 aBurst);
+    TokenBucket(const TokenBucket &)              = delete;
+    TokenBucket(const TokenBucket &&)             = delete;
+    TokenBucket & operator=(const TokenBucket &)  = delete;
+    TokenBucket & operator=(const TokenBucket &&) = delete;
+
+    ~TokenBucket() = default;
+
+    /*!
+     * \brief take up to aWanted bytes
+     * \param aWanted : bytes to send
+     * \param aNow    : now() (ns)
+     * \param aDelay  : ns to wait for a grant when none is possible now
+     * \return bytes that can be sent now: 0 if less than min(aWanted, cShapingChunk, burst) are available
+     */
+    qint64 take(qint64 aWanted, qint64 aNow, qint64 &aDelay);
+    void   giveBack(qint64 aBytes); //!< bytes taken but not sent
+
+    /*!
+     * \brief charge aBytes already sent without asking (the bucket may go ahead of its burst)
+     * \param aNow : now() (ns)
+     * \return ns to wait before the bucket has tokens again (0: it isn't in debt)
+     */
+    qint64 charge(qint64 aBytes, qint64 aNow);
+
+    void setRate(qint64 aRate, qint64 aBurst); //!< change the limits (0: unlimited)
+
+    inline qint64  getRate() const;           //!< bytes per second (0: unlimited)
+    inline qint64  getBurst() const;          //!< bytes
+    inline bool    isLimited() const;         //!< is there a rate
+    inline quint64 getNumberOfBytes() const;  //!< bytes granted since start
+    inline qint64  getThrottledTime() const;  //!< ns the flows waited for the bucket since start
+    inline void    addThrottledTime(qint64 aNs); //!< a flow waited aNs for the bucket
+
+    static qint64 now(); //!< monotonic time in ns
+
+    static const qint64 sNsPerSecond = 1000000000; //!< ns per second
+
+private:
+    inline qint64 getDuration(qint64 aBytes, qint64 aRate) const; //!< ns to send aBytes at aRate
+
+private:
+    QAtomicInteger<qint64>  iRate;       //!< bytes per second (0: unlimited)
+    QAtomicInteger<qint64>  iBurst;      //!< bytes
+    QAtomicInteger<qint64>  iTat;        //!< theoretical arrival time of the next byte (ns)
+    QAtomicInteger<quint64> iNbBytes;    //!< bytes granted since start
+    QAtomicInteger<qint64>  iThrottled;  //!< ns the flows waited since start
+};
+
+qint64  TokenBucket::getRate() const {return iRate.load();}
+qint64  TokenBucket::getBurst() const {return iBurst.load();}
+bool    TokenBucket::isLimited() const {return iRate.load() > 0;}
+quint64 TokenBucket::getNumberOfBytes() const {return iNbBytes.load();}
+qint64  TokenBucket::getThrottledTime() const {return iThrottled.load();}
+void    TokenBucket::addThrottledTime(qint64 aNs){iThrottled.fetchAndAddRelaxed(aNs);}
+
+qint64 TokenBucket::getDuration(qint64 aBytes, qint64 aRate) const {
+    return aBytes * sNsPerSecond / aRate;
+}
+
+#endif // TOKENBUCKET_H
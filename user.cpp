@@ -6,9 +6,14 @@
 
 User::User(const QString & aIpAddress, const QString & aLogin):
     iIpAddress(aIpAddress), iStartTimeMs(QDateTime::currentMSecsSinceEpoch()), iId(0),
-    iLogin(aLogin), isBlocked(0), iNumInputCons(), iNumNntpCons(),
-    mNumInput(), mNumNntp(), iDownloadSize(0), mDownSize(), iNntpServCons()
+    iLogin(aLogin), isBlocked(0), iNumInputCons(0), iNumNntpCons(0),
+    iDownloadSize(0), iNntpServCons(), mSelection()
 {
+    for (ushort i = 0; i < cMaxNntpServers; ++i){
+        iNntpServCons[i].serverId.store(-1);
+        iNntpServCons[i].nbCons.store(0);
+    }
+
 #ifdef LOG_CONSTRUCTORS
     QTextStream &ostream = NntpProxy::acquireLog("[User] ");
     ostream << "Constructor: " << *this;
@@ -34,19 +39,18 @@ bool User::operator== (const User & aUser) const{
 }
 
 QTextStream &  operator<<(QTextStream & stream, const User &aUser){
-    QMutexLocker lock1(&aUser.mNumInput);
-    QMutexLocker lock2(&aUser.mNumNntp);
-
     stream << "User #" << aUser.iId << ": "
            << aUser.iLogin << "@" << aUser.iIpAddress
-           << " (in: "  << aUser.iNumInputCons
-           << ", out: " << aUser.iNumNntpCons
+           << " (in: "  << aUser.iNumInputCons.load()
+           << ", out: " << aUser.iNumNntpCons.load()
            << ") ";
 
-    for (auto it = aUser.iNntpServCons.cbegin(); it != aUser.iNntpServCons.cend(); ++it){
-        stream << "{serv: " << it->first
-               << ", cons: " << it->second
-               << "} ";
+    for (ushort i = 0; i < cMaxNntpServers; ++i){
+        int nbCons = aUser.iNntpServCons[i].nbCons.load();
+        if (nbCons > 0)
+            stream << "{serv: " << aUser.iNntpServCons[i].serverId.load()
+                   << ", cons: " << nbCons
+                   << "} ";
     }
 
     stream << aUser.downSize();
@@ -56,9 +60,6 @@ QTextStream &  operator<<(QTextStream & stream, const User &aUser){
 
 
 QString User::str() const{
-    QMutexLocker lock1(&mNumInput);
-    QMutexLocker lock2(&mNumNntp);
-
     QString str("User #");
     str += QString::number(iId);
     str += ": ";
@@ -66,17 +67,20 @@ QString User::str() const{
     str += "@";
     str += iIpAddress;
     str += " (in: ";
-    str += QString::number(iNumInputCons);
+    str += QString::number(iNumInputCons.load());
     str += ", out: ";
-    str += QString::number(iNumNntpCons);
+    str += QString::number(iNumNntpCons.load());
     str += ") ";
 
-    for (auto it = iNntpServCons.cbegin(); it != iNntpServCons.cend(); ++it){
-        str += "{serv: ";
-        str += QString::number(it->first);
-        str += ". cons: ";
-        str += QString::number(it->second);
-        str += "} ";
+    for (ushort i = 0; i < cMaxNntpServers; ++i){
+        int nbCons = iNntpServCons[i].nbCons.load();
+        if (nbCons > 0){
+            str += "{serv: ";
+            str += QString::number(iNntpServCons[i].serverId.load());
+            str += ". cons: ";
+            str += QString::number(nbCons);
+            str += "} ";
+        }
     }
 
     return str;
@@ -85,11 +89,9 @@ QString User::str() const{
 
 QString User::downSize() const{
 
-    mDownSize.lock();
-    float  size      = iDownloadSize;
+    float  size      = iDownloadSize.load();
     float  ko        = size / 1024;
     qint64 endTimeMs = QDateTime::currentMSecsSinceEpoch();
-    mDownSize.unlock();
 
     QString format("Bytes");
     if (ko >= 1){
@@ -122,29 +124,26 @@ QString User::downSize() const{
 }
 
 void User::newNntpConnection(ushort aServerId){
-    QMutexLocker lock(&mNumNntp);
-    auto it = iNntpServCons.find(aServerId);
-    if (it == iNntpServCons.end()){
-        iNntpServCons[aServerId] = 1;
-    } else {
-        ++(it->second);
-    }
-    ++iNumNntpCons;
+    ServerCons &cons = iNntpServCons[getServerSlot(aServerId)];
+    cons.serverId.store(aServerId); // the slot is only shared with removed servers
+    cons.nbCons.ref();
+    iNumNntpCons.ref();
 }
 
 bool User::delNntpConnection(ushort aServerId){
-    QMutexLocker lock(&mNumNntp);
-    auto it = iNntpServCons.find(aServerId);
-    if (it != iNntpServCons.end()){
-        if (it->second == 1) {
-            iNntpServCons.erase(it);
-        } else {
-            --(it->second);
-        }
-        --iNumNntpCons;
-        return true;
-    }
-    return false;
+    ServerCons &cons = iNntpServCons[getServerSlot(aServerId)];
+    if (cons.serverId.load() != aServerId)
+        return false;
+
+    // never under 0 (a connection released twice)
+    int nbCons = cons.nbCons.load();
+    do {
+        if (nbCons <= 0)
+            return false;
+    } while (!cons.nbCons.testAndSetOrdered(nbCons, nbCons - 1, nbCons));
+
+    iNumNntpCons.deref();
+    return true;
 }
 
 bool compNntpServConsByValue(const std::pair<ushort,ushort>& lhs, const std::pair<ushort,ushort>& rhs) {
@@ -152,7 +151,13 @@ bool compNntpServConsByValue(const std::pair<ushort,ushort>& lhs, const std::pai
 }
 
 vectNntpSrvOrderByCons User::getVectorOfNntpServerOrderedByNumberOfConnections_noLock() const{
-    vectNntpSrvOrderByCons servers(iNntpServCons.cbegin(), iNntpServCons.cend());
+    vectNntpSrvOrderByCons servers;
+    for (ushort i = 0; i < cMaxNntpServers; ++i){
+        int nbCons = iNntpServCons[i].nbCons.load();
+        if (nbCons > 0)
+            servers.push_back(std::make_pair(static_cast<ushort>(iNntpServCons[i].serverId.load()),
+                                             static_cast<ushort>(nbCons)));
+    }
     std::sort(servers.begin(), servers.end(), compNntpServConsByValue);
     return servers;
 }
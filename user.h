@@ -3,11 +3,13 @@
 
 #include "constants.h"
 
-#include <map>
 #include <vector>
 
 #include <QMutex>
 #include <QMutexLocker>
+#include <QAtomicInteger>
+#include <QPair>
+#include <QString>
 
 QT_FORWARD_DECLARE_CLASS(QTextStream)
 
@@ -16,14 +18,20 @@ QT_FORWARD_DECLARE_CLASS(QTextStream)
 bool compNntpServConsByValue(const std::pair<ushort,ushort>& lhs, const std::pair<ushort,ushort>& rhs);
 
 
-//! vector of pair<key,val> of map iNntpServCons ordered by value (number of connections)
+//! vector of pair<serverId, nbCons> of User::iNntpServCons ordered by value (number of connections)
 typedef std::vector<std::pair<ushort,ushort>> vectNntpSrvOrderByCons;
 
+//! key of a User in the UserManager: (login, IP)
+typedef QPair<QString, QString> UserId;
+
 
 /*!
  * \brief a User is defined by the pair (IP, login)
  * A user can have multiple InputConnections that will have a corresponding NntpConnection
- * it holds a map iNntpServCons to know the distribution of the NntpConnection among the availabe NntpServers
+ * it holds an array iNntpServCons to know the distribution of the NntpConnection among the availabe NntpServers
+ * - the counters are atomics: the updates never block and the reads are wait-free snapshots
+ * - iNntpServCons has one slot per active server (getServerSlot), the NntpServerManager keeps them unique
+ * - mSelection only serializes the server choices for the user (UserManager::lockUser)
  */
 class User
 {
@@ -55,7 +63,8 @@ public:
     bool operator== (const User & aUser) const;
 
     inline const QString & getLogin() const; //!< return user login
-    inline const QString & getId() const;    //!< return user login (needed by MyManager template)
+    inline UserId          getId() const;    //!< return the pair (iLogin, iIpAddress) (key in the MyManager template)
+    inline static UserId   makeId(const QString & aIpAddress, const QString & aLogin); //!< key of a User without building it
 
     inline const QString & getIp() const;    //!< return user IP
     inline ushort          getDbId() const;  //!< return user id stored in the Database
@@ -80,15 +89,23 @@ public:
     void newNntpConnection(ushort aServerId); //!< Add a new Nntp connection Thread_Safe
     bool delNntpConnection(ushort aServerId); //!< Remove an Nntp connection Thread_Safe
 
+    inline static ushort getServerSlot(ushort aServerId); //!< slot of a server in iNntpServCons
+
 private:
     inline ushort getNumberOfNntpConnection_noLock() const; //!< Get the number of Nntp Connections
     inline bool hasConnectionWithServer_noLock(ushort aServerId) const; //!< Return if the user has any Nntp Connections with the serverId
 
-    //! return a vector of pair<key.val> of the map iNntpServCons ordered by values (Not Thread_Safe, Used by Manager)
+    //! return a vector of pair<serverId, nbCons> of iNntpServCons ordered by values (snapshot, Used by Manager)
     vectNntpSrvOrderByCons getVectorOfNntpServerOrderedByNumberOfConnections_noLock() const;
 
-    inline void lockNntpServList();  //!< Used by Manager to lock iNntpServCons
-    inline void unlockNntpServList();//!< Used by Manager to unlock iNntpServCons
+    inline void lockNntpServList();  //!< Used by Manager to serialize the server choices for the user
+    inline void unlockNntpServList();//!< Used by Manager to end a server choice for the user
+
+    //! connections of the user with the server of a slot
+    struct ServerCons {
+        QAtomicInteger<int> serverId; //!< server using the slot (last one if nbCons is 0)
+        QAtomicInteger<int> nbCons;   //!< number of connections
+    };
 
 private:
     const QString            iIpAddress;    //!< IP address
@@ -98,20 +115,18 @@ private:
     const QString            iLogin;        //!< User login
     bool                     isBlocked;     //!< From DB (no payment) but changeable live
 
-    ushort                   iNumInputCons; //!< number of input connections (or threads)
-    ushort                   iNumNntpCons;  //!< number of nntp connections
-    mutable QMutex           mNumInput;     //!< Thread safety for iNumInputCons
-    mutable QMutex           mNumNntp;      //!< Thread safety for iNumNntpCons
-
-    ulong                    iDownloadSize; //!< total download size (via all its threads)
-    mutable QMutex           mDownSize;     //!< Thread safety iDownloadSize
+    QAtomicInteger<int>      iNumInputCons; //!< number of input connections (or threads)
+    QAtomicInteger<int>      iNumNntpCons;  //!< number of nntp connections
+    QAtomicInteger<quint64>  iDownloadSize; //!< total download size (via all its threads)
 
-    std::map<ushort, ushort> iNntpServCons; //!< (server_id, number of connections)
+    ServerCons               iNntpServCons[cMaxNntpServers]; //!< connections per server slot
+    mutable QMutex           mSelection;    //!< serializes the server choices for the user (not the counters)
 };
 
 
 const QString & User::getLogin() const {return iLogin;}
-const QString & User::getId() const {return iLogin;}
+UserId          User::getId() const {return UserId(iLogin, iIpAddress);}
+UserId          User::makeId(const QString & aIpAddress, const QString & aLogin){return UserId(aLogin, aIpAddress);}
 
 const QString & User::getIp() const {return iIpAddress;}
 ushort          User::getDbId() const {return iId;}
@@ -119,21 +134,23 @@ ushort          User::getDbId() const {return iId;}
 void User::setBlocked(bool block){isBlocked = block;}
 void User::setDbId(ushort aId){iId = aId;}
 
-void   User::addDownloadSize(ulong aDownloadSize){QMutexLocker lock(&mDownSize); iDownloadSize += aDownloadSize;}
-ulong  User::getDownloadedSize() const {QMutexLocker lock(&mDownSize); return iDownloadSize;}
+void   User::addDownloadSize(ulong aDownloadSize){iDownloadSize.fetchAndAddRelaxed(aDownloadSize);}
+ulong  User::getDownloadedSize() const {return static_cast<ulong>(iDownloadSize.load());}
 
-void   User::newInputConnection(){QMutexLocker lock(&mNumInput); ++iNumInputCons;}
-void   User::delInputConnection(){QMutexLocker lock(&mNumInput); --iNumInputCons;}
-ushort User::getNumberOfInputConnection() const {QMutexLocker lock(&mNumInput); return iNumInputCons;}
+void   User::newInputConnection(){iNumInputCons.ref();}
+void   User::delInputConnection(){iNumInputCons.deref();}
+ushort User::getNumberOfInputConnection() const {return static_cast<ushort>(iNumInputCons.load());}
 
-ushort User::getNumberOfNntpConnection_noLock() const {return iNumNntpCons;}
+ushort User::getNumberOfNntpConnection_noLock() const {return static_cast<ushort>(iNumNntpCons.load());}
 
+ushort User::getServerSlot(ushort aServerId){return aServerId % cMaxNntpServers;}
 
 bool User::hasConnectionWithServer_noLock(ushort aServerId) const {
-    return iNntpServCons.find(aServerId) != iNntpServCons.end();
+    const ServerCons &cons = iNntpServCons[getServerSlot(aServerId)];
+    return cons.nbCons.load() > 0 && cons.serverId.load() == aServerId;
 }
 
-void User::lockNntpServList(){mNumNntp.lock();}
-void User::unlockNntpServList(){mNumNntp.unlock();}
+void User::lockNntpServList(){mSelection.lock();}
+void User::unlockNntpServList(){mSelection.unlock();}
 
 #endif // USER_H
@@ -5,23 +5,19 @@
 
 #include <QTcpSocket>
 
-UserManager::UserManager(): MyManager<User>("User"){}
+UserManager::UserManager(): MyManager<User, UserId>("User"){}
 
 UserManager::~UserManager(){}
 
 
 User * UserManager::addUser(const QString & aIpAddress, const QString & aLogin){
-    User * tmpUser = new User(aIpAddress, aLogin);
-
-    // Mutex for both find and append
+    // Mutex for both find and insert
     QMutexLocker lock(mMutex);
 
-    User * user = find(tmpUser, false);
-    if (user != Q_NULLPTR)
-        delete tmpUser;
-    else {
-        user = tmpUser;
-        iList.append(user);
+    User * user = find(User::makeId(aIpAddress, aLogin), false);
+    if (user == Q_NULLPTR){
+        user = new User(aIpAddress, aLogin);
+        insert(user, false);
     }
     user->newInputConnection();
     return user;
@@ -39,11 +35,14 @@ bool UserManager::releaseUser(User *aUser, Database &aDb){
         return false;
     }
 
+    // Mutex for both the last input connection and erase (addUser may find the user meanwhile)
+    QMutexLocker lock(mMutex);
     aUser->delInputConnection();
 
     if (aUser->getNumberOfInputConnection() == 0){
 
-        bool err = iList.removeOne(aUser);
+        bool err = erase(aUser, false);
+        lock.unlock();
         if (!err)
             _log(QString("Error removing user: ").append(aUser->getLogin()));
 
@@ -72,16 +71,3 @@ bool UserManager::setUserBlocked(const QString & aLogin, bool blockUser) const{
     return userFound;
 }
 
-
-User *UserManager::getUserHavingTooMuchNntpConnection_noLock(int aNbMaxOfNntpConByUser) const{
-    User * user = Q_NULLPTR;
-    ushort maxNbNntpCon = 0;
-    for (int i=0; i<iList.size(); ++i){        
-        ushort nbCon = iList[i]->getNumberOfNntpConnection_noLock();
-        if ( (nbCon > aNbMaxOfNntpConByUser) && (nbCon > maxNbNntpCon) ){
-            maxNbNntpCon = nbCon;
-            user = iList[i];
-        }
-    }
-    return user;
-}
@@ -11,10 +11,9 @@ QT_FORWARD_DECLARE_CLASS(SessionManager)
 /*!
  * \brief Manager of all the Users (own them)
  */
-class UserManager : public MyManager<User>
+class UserManager : public MyManager<User, UserId>
 {
 public:
-    friend class SessionManager;    //!< SessionManager::tryToGetNntpConnectionFromOtherUser is able to lock/unlock
     friend class NntpServerManager; //!< To be able to lock users when trying to get them a new connection
 #ifdef TESTUSERMANAGER_H
     friend class TestUserManager;
@@ -35,19 +34,15 @@ public:
     bool setUserBlocked(const QString & aLogin, bool blockUser = true) const; //!< const cause it is the iUsers holds pointers so won't be changed
 
 private:
-    //! return user having more than aNbMaxOfNntpConByUser number of NntpConnection
-    User *getUserHavingTooMuchNntpConnection_noLock(int aNbMaxOfNntpConByUser) const;
 
     inline void lockUser(User *aUser);  //!< Interface to lock user
     inline void unlockUser(User *aUser);//!< Interface to unlock user
     inline bool hasUserConnectionWithServer_noLock(User *aUser, ushort aServId); //!< interface to User non blocking funtion
-    inline ushort getUserNumberOfNntpCons_noLock(User *aUser); //!< interface to User non blocking funtion
     inline vectNntpSrvOrderByCons getUserVectorOfNntpServerOrderedByNumberOfCons_noLock(User *aUser); //!< interface to User non blocking funtion
 };
 
 void UserManager::lockUser(User *aUser){aUser->lockNntpServList();}
 void UserManager::unlockUser(User *aUser){aUser->unlockNntpServList();}
-ushort UserManager::getUserNumberOfNntpCons_noLock(User *aUser){return aUser->getNumberOfNntpConnection_noLock();}
 bool UserManager::hasUserConnectionWithServer_noLock(User *aUser, ushort aServId){
     return aUser->hasConnectionWithServer_noLock(aServId);
 }
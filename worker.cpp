@@ -0,0 +1,30 @@
+#include "worker.h"
+#include "nntpproxy.h"
+
+#include <QTextStream>
+
+Worker::Worker(ushort aId):
+    QThread(), iId(aId), iNumSessions(0), iNumAccepts(0), iMaxSessionBuffer(0), iMultiplexer(Q_NULLPTR),
+    iLogPrefix(QString("Worker").append("[").append(QString::number(iId)).append("] "))
+{
+#ifdef LOG_CONSTRUCTORS
+    _log("Constructor");
+#endif
+}
+
+Worker::~Worker(){
+#ifdef LOG_CONSTRUCTORS
+     _log("Destructor");
+#endif
+}
+
+void Worker::_log(const char *aMessage) const{
+    NntpProxy::log(iLogPrefix, aMessage);
+}
+
+QTextStream &  operator<<(QTextStream & stream, const Worker &aWorker){
+    stream << aWorker.iLogPrefix << "sessions: " << aWorker.getNumberOfSessions()
+           << ", accepted: " << aWorker.getNumberOfAccepts()
+           << ", max session buffer: " << aWorker.getMaxSessionBuffer() / 1024 << " KB";
+    return stream;
+}
@@ -0,0 +1,78 @@
+#ifndef WORKER_H
+#define WORKER_H
+
+#include "constants.h"
+
+#include <QThread>
+#include <QAtomicInt>
+#include <QAtomicInteger>
+
+QT_FORWARD_DECLARE_CLASS(QTextStream)
+QT_FORWARD_DECLARE_CLASS(NntpMultiplexer)
+
+/*!
+ * \brief Long-lived Thread running an event loop shared by many SessionHandlers
+ * - created at startup by the WorkerManager (fixed pool, default one per core)
+ * - counts the sessions it is running so the manager can pick the least loaded one
+ * - counts all the sessions it accepted (distribution of the accepts between Workers)
+ * - keeps the highest buffered size of its sessions (check that the backpressure bounds the memory)
+ * - in multiplexing mode, holds the NntpMultiplexer shared by its sessions (living in its thread)
+ */
+class Worker : public QThread
+{
+    Q_OBJECT
+
+public:
+    explicit Worker(ushort aId); //!< Worker id (index in the pool)
+    Worker(const Worker &)              = delete;
+    Worker(const Worker &&)             = delete;
+    Worker & operator=(const Worker &)  = delete;
+    Worker & operator=(const Worker &&) = delete;
+
+    ~Worker(); //!< trace destruction
+
+    inline ushort getId() const;              //!< return the worker id (needed by MyManager template)
+    inline int    getNumberOfSessions() const; //!< number of sessions currently running in the worker (Thread_Safe)
+    inline uint   getNumberOfAccepts() const;  //!< number of sessions accepted since start (Thread_Safe)
+
+    inline void newSession(); //!< a session has been assigned to the worker (Thread_Safe)
+    inline void delSession(); //!< a session running in the worker got deleted (Thread_Safe)
+
+    inline qint64 getMaxSessionBuffer() const;          //!< highest buffered size of a session (Thread_Safe)
+    inline void   updateMaxSessionBuffer(qint64 aSize); //!< a session holds aSize bytes (Thread_Safe)
+
+    inline NntpMultiplexer *getMultiplexer() const;          //!< multiplexer of the worker (Q_NULLPTR if not multiplexing)
+    inline void setMultiplexer(NntpMultiplexer *aMultiplexer); //!< set by the WorkerManager before any session starts
+
+    //!< To be able to print a Worker
+    friend QTextStream &  operator<<(QTextStream & stream, const Worker &aWorker);
+
+private:
+    inline void _log(const char *aMessage) const; //!< write trace with worker id
+
+private:
+    const ushort  iId;          //!< worker id
+    QAtomicInt    iNumSessions; //!< number of sessions living in the thread
+    QAtomicInt    iNumAccepts;  //!< number of sessions accepted since start
+    QAtomicInteger<qint64> iMaxSessionBuffer; //!< highest buffered size of a session since start
+    NntpMultiplexer *iMultiplexer; //!< multiplexer of the sessions (deleted with the thread)
+    const QString iLogPrefix;   //!< log prefix
+};
+
+ushort Worker::getId() const {return iId;}
+int    Worker::getNumberOfSessions() const {return iNumSessions.load();}
+uint   Worker::getNumberOfAccepts() const {return static_cast<uint>(iNumAccepts.load());}
+
+void   Worker::newSession(){iNumSessions.ref(); iNumAccepts.ref();}
+void   Worker::delSession(){iNumSessions.deref();}
+
+qint64 Worker::getMaxSessionBuffer() const {return iMaxSessionBuffer.load();}
+void   Worker::updateMaxSessionBuffer(qint64 aSize){
+    qint64 max = iMaxSessionBuffer.load();
+    while (aSize > max && !iMaxSessionBuffer.testAndSetOrdered(max, aSize, max));
+}
+
+NntpMultiplexer *Worker::getMultiplexer() const {return iMultiplexer;}
+void Worker::setMultiplexer(NntpMultiplexer *aMultiplexer){iMultiplexer = aMultiplexer;}
+
+#endif // WORKER_H
@@ -0,0 +1,103 @@
+#include "workermanager.h"
+#include "worker.h"
+#include "nntplistener.h"
+#include "nntpmultiplexer.h"
+
+#include <cstring>
+#include <cerrno>
+
+WorkerManager::WorkerManager(ushort aNbWorkers):
+    MyManager<Worker>("Worker"), iListeners()
+{
+    for (ushort i=0; i<aNbWorkers; ++i){
+        Worker *worker = new Worker(i);
+        worker->start(); // start the event loop
+        insert(worker, false);
+    }
+
+    QString str("Workers started: ");
+    str += QString::number(aNbWorkers);
+    _log(str);
+}
+
+WorkerManager::~WorkerManager(){
+    QMutexLocker lock(mMutex);
+    for (int i=0; i<iList.size(); ++i){
+        iList[i]->quit();
+        iList[i]->wait();
+    }
+    _log("All workers are stopped");
+
+    // Workers are stopped, we can delete their listeners from here
+    for (int i=0; i<iListeners.size(); ++i)
+        delete iListeners[i];
+    iListeners.clear();
+}
+
+bool WorkerManager::listen(ushort aPort, SessionManager &aSessionMgr){
+    QMutexLocker lock(mMutex);
+
+    for (int i=0; i<iList.size(); ++i){
+        qintptr fd = NntpListener::openReusePortSocket(aPort);
+        if (fd == -1){
+            int error = errno; // before building the message
+            QString err("Error opening SO_REUSEPORT socket for worker #");
+            err += QString::number(iList[i]->getId());
+            err += ": ";
+            err += strerror(error);
+            _log(err);
+
+            // the Workers already listening stop (in their thread, after their socket is attached)
+            for (int j=0; j<iListeners.size(); ++j)
+                iListeners[j]->deleteLater();
+            iListeners.clear();
+            return false;
+        }
+
+        NntpListener *listener = new NntpListener(iList[i], aSessionMgr);
+        listener->moveToThread(iList[i]);
+        iListeners.append(listener);
+
+        emit listener->startListening(fd); // attach the socket inside the Worker thread
+    }
+
+    return true;
+}
+
+void WorkerManager::startMultiplexers(NntpServerManager &aSrvMgr){
+    QMutexLocker lock(mMutex);
+
+    for (int i=0; i<iList.size(); ++i){
+        Worker *worker = iList[i];
+        NntpMultiplexer *mux = new NntpMultiplexer(worker->getId(), aSrvMgr);
+        mux->moveToThread(worker);
+
+        // deferred deletion is processed when the event loop of the thread exits
+        QObject::connect(worker, &QThread::finished, mux, &QObject::deleteLater);
+        worker->setMultiplexer(mux);
+    }
+    _log("Multiplexers started");
+}
+
+uint WorkerManager::getNumberOfAccepts() const{
+    QMutexLocker lock(mMutex);
+    uint nbAccepts = 0;
+    for (int i=0; i<iList.size(); ++i)
+        nbAccepts += iList[i]->getNumberOfAccepts();
+    return nbAccepts;
+}
+
+Worker *WorkerManager::getLeastLoadedWorker() const{
+    QMutexLocker lock(mMutex);
+
+    Worker *worker = Q_NULLPTR;
+    int minSessions = 0;
+    for (int i=0; i<iList.size(); ++i){
+        int nbSessions = iList[i]->getNumberOfSessions();
+        if (worker == Q_NULLPTR || nbSessions < minSessions){
+            worker      = iList[i];
+            minSessions = nbSessions;
+        }
+    }
+    return worker;
+}
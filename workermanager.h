@@ -0,0 +1,50 @@
+#ifndef WORKERMANAGER_H
+#define WORKERMANAGER_H
+
+#include "constants.h"
+#include "mymanager.h"
+#include "worker.h"
+
+QT_FORWARD_DECLARE_CLASS(NntpListener)
+QT_FORWARD_DECLARE_CLASS(SessionManager)
+QT_FORWARD_DECLARE_CLASS(NntpServerManager)
+
+/*!
+ * \brief Manager that OWNS the fixed pool of Workers
+ * - starts all the Workers event loops on construction
+ * - gives the least loaded Worker to each new SessionHandler
+ * - or in reusePort mode, owns one NntpListener per Worker (they accept themselves)
+ * - in multiplexing mode, gives one NntpMultiplexer to each Worker
+ * - stops and waits for all the Workers on destruction
+ */
+class WorkerManager : public MyManager<Worker>
+{
+public:
+    explicit WorkerManager(ushort aNbWorkers); //!< create and start aNbWorkers Workers
+    WorkerManager(const WorkerManager &)              = delete;
+    WorkerManager(const WorkerManager &&)             = delete;
+    WorkerManager & operator=(const WorkerManager &)  = delete;
+    WorkerManager & operator=(const WorkerManager &&) = delete;
+
+    ~WorkerManager(); //!< quit all the event loops and wait for the Threads to finish
+
+    Worker *getLeastLoadedWorker() const; //!< Worker running the less sessions (Thread_Safe)
+
+    /*!
+     * \brief reusePort mode: open one listening socket per Worker with SO_REUSEPORT
+     * \param aPort       : port to listen on
+     * \param aSessionMgr : Manager used by the listeners to create the SessionHandlers
+     * \return if all the sockets could be opened (otherwise none is kept listening)
+     */
+    bool listen(ushort aPort, SessionManager & aSessionMgr);
+
+    uint getNumberOfAccepts() const; //!< total number of sessions accepted by all the Workers (Thread_Safe)
+
+    //! multiplexing mode: create one NntpMultiplexer per Worker (deleted when the Worker finishes)
+    void startMultiplexers(NntpServerManager & aSrvMgr);
+
+private:
+    QList<NntpListener *> iListeners; //!< listeners of the Workers in reusePort mode (owns them)
+};
+
+#endif // WORKERMANAGER_H